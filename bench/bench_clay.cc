@@ -0,0 +1,108 @@
+#include "ec_intf.hh"
+#include "meta.hpp"
+
+#include <boost/program_options.hpp>
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+constexpr std::array<std::pair<meta::ec_param_t, meta::ec_param_t>, 6>
+    CLAY_PARAMS{{{4, 2}, {6, 3}, {8, 4}, {10, 4}, {12, 4}, {16, 4}}};
+
+struct BenchResult {
+  double seconds;
+  std::vector<util::SharedVec> stripe;
+};
+
+auto same_stripe(const std::vector<util::SharedVec> &lhs,
+                 const std::vector<util::SharedVec> &rhs) -> bool {
+  return std::ranges::equal(lhs, rhs, [](const auto &l, const auto &r) {
+    return l.as_cstr() == r.as_cstr();
+  });
+}
+
+/// encode `raw` for `rounds` times and keep the last stripe for comparison
+auto run_encode(meta::ec_param_t k, meta::ec_param_t m,
+                std::size_t parallel_planes, const std::vector<char> &raw,
+                std::size_t rounds) -> BenchResult {
+  auto encoder = ec::encoder::clay::Encoder{k, m, parallel_planes};
+  auto result = BenchResult{0.0, {}};
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < rounds; i++) {
+    result.stripe = encoder.encode(raw);
+  }
+  auto end = std::chrono::steady_clock::now();
+  result.seconds = std::chrono::duration<double>(end - start).count();
+  return result;
+}
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+  namespace po = boost::program_options;
+  auto chunk_size = std::size_t{0};
+  auto rounds = std::size_t{0};
+  auto threads = std::size_t{0};
+  auto desc = po::options_description{"Clay intra-stripe parallel encoding"};
+  desc.add_options()("help,h", "print this message")(
+      "chunk_size,c",
+      po::value(&chunk_size)->default_value(4 << 20), // NOLINT
+      "bytes per chunk")(
+      "rounds,r", po::value(&rounds)->default_value(8), "stripes per setting")(
+      "threads,t",
+      po::value(&threads)->default_value(std::thread::hardware_concurrency()),
+      "planes encoded concurrently");
+  auto vm = po::variables_map{};
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+  } catch (std::exception &e) {
+    std::cerr << "[Error] " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (vm.count("help") != 0U) {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+  if (chunk_size == 0 || rounds == 0 || threads == 0) {
+    std::cerr << "[Error] chunk_size, rounds and threads must be positive"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  fmt::print("{:>4} {:>4} {:>8} {:>12} {:>12} {:>8} {:>10}\n",
+             "k", "m", "planes", "seq GB/s", "par GB/s", "speedup",
+             "identical");
+  auto rng = std::mt19937_64{0x1234}; // NOLINT
+  for (auto [k, m] : CLAY_PARAMS) {
+    auto raw = std::vector<char>(chunk_size * k);
+    for (auto &byte : raw) {
+      byte = static_cast<char>(rng());
+    }
+    auto planes = ec::encoder::clay::Encoder{k, m}.get_sub_chunk_num();
+    auto seq = run_encode(k, m, 1, raw, rounds);
+    auto par = run_encode(k, m, threads, raw, rounds);
+    constexpr auto GB = double{1 << 30};
+    auto bytes = static_cast<double>(raw.size() * rounds);
+    fmt::print("{:>4} {:>4} {:>8} {:>12.3f} {:>12.3f} {:>8.2f} {:>10}\n",
+               k, m, planes, bytes / GB / seq.seconds,
+               bytes / GB / par.seconds, seq.seconds / par.seconds,
+               same_stripe(seq.stripe, par.stripe));
+    if (!same_stripe(seq.stripe, par.stripe)) {
+      std::cerr << "[Error] parallel encoding diverges from sequential"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
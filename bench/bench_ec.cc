@@ -0,0 +1,502 @@
+#include "clay_geometry.hh"
+#include "ec_intf.hh"
+#include "erasure_code.hh"
+#include "erasure_code_factory.hpp"
+#include "erasure_code_intf.hpp"
+#include "meta.hpp"
+
+#include <boost/program_options.hpp>
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// count every heap allocation of the process, the codecs allocate through
+// malloc, posix_memalign and operator new alike
+namespace {
+std::atomic_size_t heap_allocations{0};
+}
+extern "C" {
+// NOLINTBEGIN
+auto __libc_malloc(std::size_t size) -> void *;
+auto __libc_calloc(std::size_t n, std::size_t size) -> void *;
+auto __libc_realloc(void *ptr, std::size_t size) -> void *;
+auto __libc_memalign(std::size_t align, std::size_t size) -> void *;
+
+auto malloc(std::size_t size) -> void * {
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+auto calloc(std::size_t n, std::size_t size) -> void * {
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_calloc(n, size);
+}
+auto realloc(void *ptr, std::size_t size) -> void * {
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_realloc(ptr, size);
+}
+auto posix_memalign(void **ptr, std::size_t align, std::size_t size) -> int {
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  *ptr = __libc_memalign(align, size);
+  return *ptr == nullptr ? ENOMEM : 0;
+}
+auto aligned_alloc(std::size_t align, std::size_t size) -> void * {
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_memalign(align, size);
+}
+auto memalign(std::size_t align, std::size_t size) -> void * {
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_memalign(align, size);
+}
+// NOLINTEND
+}
+
+namespace {
+using ceph::bufferlist;
+using ceph::bufferptr;
+
+enum class Op { Encode, Decode, Repair, DegradedRead };
+
+auto op_name(Op op) -> std::string_view {
+  switch (op) {
+  case Op::Encode:
+    return "encode";
+  case Op::Decode:
+    return "decode";
+  case Op::Repair:
+    return "repair";
+  case Op::DegradedRead:
+    return "degraded_read";
+  }
+  return "unknown";
+}
+
+struct Setting {
+  meta::EcType ec_type;
+  /// jerasure coding technique of RS, empty for the other codecs
+  std::string technique;
+  int k;
+  int m;
+  /// requested chunk size, the codec may round it up
+  std::size_t chunk_size;
+};
+
+struct Record {
+  Setting setting;
+  Op op;
+  /// actual chunk size after the codec's alignment
+  std::size_t chunk_size;
+  std::size_t rounds;
+  double seconds;
+  /// bytes produced per round: encoded data, decoded data or recovered chunk
+  std::size_t output_bytes;
+  /// bytes fetched from other chunks per round
+  std::size_t read_bytes;
+  double allocations_per_round;
+};
+
+auto to_bufferlist(std::span<const char> data) -> bufferlist {
+  bufferptr ptr(ceph::buffer::create_page_aligned(data.size()));
+  ptr.zero();
+  ptr.set_length(0);
+  ptr.append(data.data(), data.size());
+  bufferlist bl;
+  bl.push_back(ptr);
+  return bl;
+}
+
+auto make_codec(const Setting &setting) -> ec::ErasureCodeInterfaceRef {
+  std::ostringstream errors;
+  ec::ErasureCodeProfile profile;
+  profile["k"] = std::to_string(setting.k);
+  profile["m"] = std::to_string(setting.m);
+  switch (setting.ec_type) {
+  case meta::EcType::RS:
+    profile["technique"] = setting.technique;
+    return ec::ErasureCodeJerasureFactory{}.make(profile, errors);
+  case meta::EcType::CLAY:
+    return ec::ErasureCodeClayFactory{}.make(profile, errors);
+  case meta::EcType::NSYS:
+    return ec::ErasureCodeLonseFactory{}.make(profile, errors);
+  default:
+    throw std::invalid_argument{"unsupported ec type"};
+  }
+}
+
+/// the helper data and the decode call of one operation, mirroring what the
+/// data workers do for the matching `BlockCommand` compute type
+struct Plan {
+  std::set<int> want_to_read;
+  std::map<int, bufferlist> chunks;
+  int chunk_size;
+  std::size_t output_bytes;
+  std::size_t read_bytes;
+};
+
+/// every other chunk sends the given byte ranges of its chunk
+auto helpers_with_ranges(const std::vector<util::SharedVec> &stripe, int lost,
+                         const std::vector<std::size_t> &offsets,
+                         std::size_t len) -> std::map<int, bufferlist> {
+  auto chunks = std::map<int, bufferlist>{};
+  for (int i = 0; i < static_cast<int>(stripe.size()); i++) {
+    if (i == lost) {
+      continue;
+    }
+    auto data = std::vector<char>{};
+    data.reserve(offsets.size() * len);
+    auto chunk = stripe.at(i).cspan<char>();
+    for (auto off : offsets) {
+      data.insert(data.end(), chunk.begin() + off, chunk.begin() + off + len);
+    }
+    chunks[i] = to_bufferlist(data);
+  }
+  return chunks;
+}
+
+auto make_plan(Op op, meta::EcType ec_type, int k, int m,
+               const std::vector<util::SharedVec> &stripe) -> Plan {
+  auto chunk_size = stripe.front().size();
+  auto plan = Plan{.chunk_size = static_cast<int>(chunk_size)};
+  auto whole_chunks = [&](int first, int count) {
+    for (int i = first; i < first + count; i++) {
+      plan.chunks[i] = to_bufferlist(stripe.at(i).cspan<char>());
+      plan.read_bytes += chunk_size;
+    }
+  };
+  // chunk 0 is the lost one for repairs and degraded reads, chunks 0..m-1
+  // for full decodes
+  constexpr int LOST{0};
+  switch (op) {
+  case Op::Decode:
+    whole_chunks(m, k);
+    plan.output_bytes = chunk_size * k;
+    if (ec_type == meta::EcType::NSYS) {
+      // non-systematic, a normal read decodes the k chunks it has
+      for (int i = m; i < k + m; i++) {
+        plan.want_to_read.insert(i);
+      }
+    } else {
+      for (int i = 0; i < k; i++) {
+        plan.want_to_read.insert(i);
+      }
+    }
+    break;
+  case Op::Repair:
+  case Op::DegradedRead:
+    plan.output_bytes = chunk_size;
+    if (ec_type == meta::EcType::RS) {
+      // RS_REPAIR, a degraded read is the same decode
+      plan.want_to_read.insert(LOST);
+      whole_chunks(1, k);
+    } else if (ec_type == meta::EcType::CLAY) {
+      // CLAY_REPAIR and CLAY_READ, d = k + m - 1 helpers send sub-chunks
+      const auto &geometry = ec::clay_geometry(k, m);
+      auto sub_chunk_size = chunk_size / geometry.sub_chunk_no;
+      plan.want_to_read.insert(LOST);
+      plan.chunks =
+          helpers_with_ranges(stripe,
+                              LOST,
+                              geometry.repair_offsets(LOST, sub_chunk_size),
+                              sub_chunk_size);
+      plan.read_bytes = static_cast<std::size_t>(k + m - 1) *
+                        geometry.repair_sub_chunk_no * sub_chunk_size;
+    } else if (op == Op::Repair) {
+      // NSYS_REPAIR, every helper sends one of its m sub-chunks
+      auto sub_chunk_size = chunk_size / m;
+      plan.want_to_read.insert(LOST);
+      plan.chunks = helpers_with_ranges(stripe, LOST, {0}, sub_chunk_size);
+      plan.read_bytes = static_cast<std::size_t>(k + m - 1) * sub_chunk_size;
+    } else {
+      // NSYS_READ, a normal read of k surviving chunks
+      whole_chunks(1, k);
+      for (int i = 1; i <= k; i++) {
+        plan.want_to_read.insert(i);
+      }
+    }
+    break;
+  case Op::Encode:
+    throw std::invalid_argument{"encode has no decode plan"};
+  }
+  return plan;
+}
+
+/// the recovered chunks must match the encoded ones for the systematic codes,
+/// NSYS repairs into a new combination and is not checked
+auto verify(meta::EcType ec_type, const Plan &plan,
+            std::map<int, bufferlist> &decoded,
+            const std::vector<util::SharedVec> &stripe) -> bool {
+  if (ec_type == meta::EcType::NSYS) {
+    return true;
+  }
+  return std::ranges::all_of(plan.want_to_read, [&](int i) {
+    auto &bl = decoded[i];
+    return bl.length() == stripe.at(i).size() &&
+           std::memcmp(bl.c_str(), stripe.at(i).data(), bl.length()) == 0;
+  });
+}
+
+template <typename F>
+auto measure(std::size_t rounds, F &&fn) -> std::pair<double, double> {
+  // warm up the codec tables and the chunk pool
+  fn();
+  auto allocations = heap_allocations.load();
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < rounds; i++) {
+    fn();
+  }
+  auto end = std::chrono::steady_clock::now();
+  auto allocs = static_cast<double>(heap_allocations.load() - allocations) /
+                static_cast<double>(rounds);
+  return {std::chrono::duration<double>(end - start).count(), allocs};
+}
+
+auto run_setting(const Setting &setting, std::size_t volume,
+                 std::size_t max_rounds) -> std::vector<Record> {
+  auto [ec_type, technique, k, m, requested] = setting;
+  auto raw = std::vector<char>(requested * k);
+  auto rng = std::mt19937_64{requested * k + m}; // NOLINT
+  std::ranges::generate(raw, [&rng] { return static_cast<char>(rng()); });
+  // the RS decodes only match the stripes of their own technique
+  auto encoder =
+      ec_type == meta::EcType::RS
+          ? std::make_unique<ec::encoder::rs::Encoder>(k, m, technique)
+          : ec::make_encoder(ec_type, k, m);
+  auto stripe = encoder->encode(raw);
+  auto chunk_size = stripe.front().size();
+  auto rounds = std::clamp<std::size_t>(
+      volume / std::max<std::size_t>(raw.size(), 1), 1, max_rounds);
+
+  auto records = std::vector<Record>{};
+  {
+    auto [seconds, allocs] = measure(rounds, [&] { encoder->encode(raw); });
+    records.push_back(Record{.setting = setting,
+                             .op = Op::Encode,
+                             .chunk_size = chunk_size,
+                             .rounds = rounds,
+                             .seconds = seconds,
+                             .output_bytes = raw.size(),
+                             .read_bytes = raw.size(),
+                             .allocations_per_round = allocs});
+  }
+  auto intf = make_codec(setting);
+  auto &codec = dynamic_cast<ec::ErasureCode &>(*intf.get());
+  for (auto op : {Op::Decode, Op::Repair, Op::DegradedRead}) {
+    auto plan = make_plan(op, ec_type, k, m, stripe);
+    auto decoded = std::map<int, bufferlist>{};
+    auto err = codec.decode(
+        plan.want_to_read, plan.chunks, &decoded, plan.chunk_size);
+    if (err != 0 || !verify(ec_type, plan, decoded, stripe)) {
+      throw std::runtime_error{fmt::format("{} {} k={} m={}: {} mismatch",
+                                           ec_type,
+                                           technique,
+                                           k,
+                                           m,
+                                           op_name(op))};
+    }
+    auto [seconds, allocs] = measure(rounds, [&] {
+      auto out = std::map<int, bufferlist>{};
+      codec.decode(plan.want_to_read, plan.chunks, &out, plan.chunk_size);
+    });
+    records.push_back(Record{.setting = setting,
+                             .op = op,
+                             .chunk_size = chunk_size,
+                             .rounds = rounds,
+                             .seconds = seconds,
+                             .output_bytes = plan.output_bytes,
+                             .read_bytes = plan.read_bytes,
+                             .allocations_per_round = allocs});
+  }
+  return records;
+}
+
+auto to_json(const Record &r) -> std::string {
+  constexpr auto GB = double{1 << 30};
+  auto bytes = static_cast<double>(r.output_bytes * r.rounds);
+  auto technique = r.setting.technique.empty()
+                       ? std::string{"null"}
+                       : fmt::format(R"("{}")", r.setting.technique);
+  return fmt::format(
+      R"({{"codec": "{}", "technique": {}, "k": {}, "m": {}, "op": "{}", )"
+      R"("requested_chunk_size": {}, "chunk_size": {}, "rounds": {}, )"
+      R"("seconds": {:.6f}, "gb_per_s": {:.4f}, )"
+      R"("read_per_output_byte": {:.4f}, "allocations_per_op": {:.2f}}})",
+      r.setting.ec_type,
+      technique,
+      r.setting.k,
+      r.setting.m,
+      op_name(r.op),
+      r.setting.chunk_size,
+      r.chunk_size,
+      r.rounds,
+      r.seconds,
+      bytes / GB / r.seconds,
+      static_cast<double>(r.read_bytes) / static_cast<double>(r.output_bytes),
+      r.allocations_per_round);
+}
+
+auto parse_km(const std::string &km) -> std::pair<int, int> {
+  auto sep = km.find(',');
+  if (sep == std::string::npos) {
+    throw std::invalid_argument{fmt::format("expect k,m but got {}", km)};
+  }
+  return {std::stoi(km.substr(0, sep)), std::stoi(km.substr(sep + 1))};
+}
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+  namespace po = boost::program_options;
+  auto codecs = std::vector<std::string>{};
+  auto techniques = std::vector<std::string>{};
+  auto params = std::vector<std::string>{};
+  auto chunk_sizes = std::vector<std::size_t>{};
+  auto volume = std::size_t{0};
+  auto max_rounds = std::size_t{0};
+  auto output = std::string{};
+  auto desc = po::options_description{
+      "EC kernels: encode, full decode, single-chunk repair, degraded read"};
+  desc.add_options()("help,h", "print this message")(
+      "codec,c",
+      po::value(&codecs)->multitoken()->default_value(
+          {"RS", "CLAY", "NSYS"}, "RS CLAY NSYS"),
+      "codecs to run")(
+      "technique,t",
+      po::value(&techniques)
+          ->multitoken()
+          ->default_value(
+              {"reed_sol_van", "reed_sol_r6_op", "cauchy_orig", "cauchy_good"},
+              "reed_sol_van reed_sol_r6_op cauchy_orig cauchy_good"),
+      "jerasure techniques of the RS runs, reed_sol_r6_op only runs with "
+      "m = 2")(
+      "km,p",
+      po::value(&params)->multitoken()->default_value(
+          {"4,2", "6,3", "8,4", "12,4"}, "4,2 6,3 8,4 12,4"),
+      "(k, m) pairs as k,m")(
+      "chunk_size,s",
+      po::value(&chunk_sizes)
+          ->multitoken()
+          ->default_value(
+              {4 << 10, 64 << 10, 1 << 20, 16 << 20, 64 << 20}, // NOLINT
+              "4KiB 64KiB 1MiB 16MiB 64MiB"),
+      "requested bytes per chunk")(
+      "volume,v",
+      po::value(&volume)->default_value(std::size_t{1} << 30), // NOLINT
+      "data bytes processed per measurement")(
+      "max_rounds,r",
+      po::value(&max_rounds)->default_value(4096), // NOLINT
+      "upper bound of operations per measurement")(
+      "output,o",
+      po::value(&output)->default_value("-"),
+      "JSON output file, - for stdout");
+  auto vm = po::variables_map{};
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+  } catch (std::exception &e) {
+    std::cerr << "[Error] " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (vm.count("help") != 0U) {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+  if (max_rounds == 0) {
+    std::cerr << "[Error] max_rounds must be positive" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto settings = std::vector<Setting>{};
+  try {
+    for (const auto &codec : codecs) {
+      auto ec_type = meta::string_to_ectype(codec);
+      auto codec_techniques = ec_type == meta::EcType::RS
+                                  ? techniques
+                                  : std::vector<std::string>{""};
+      for (const auto &technique : codec_techniques) {
+        for (const auto &km : params) {
+          auto [k, m] = parse_km(km);
+          // RAID6 codes exactly two parities
+          if (technique == "reed_sol_r6_op" && m != 2) {
+            continue;
+          }
+          for (auto chunk_size : chunk_sizes) {
+            settings.push_back(
+                Setting{ec_type, technique, k, m, chunk_size});
+          }
+        }
+      }
+    }
+  } catch (std::exception &e) {
+    std::cerr << "[Error] " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto records = std::vector<Record>{};
+  // the codecs trace to std::cout, keep it out of the measurements
+  auto *cout_buf = std::cout.rdbuf(nullptr);
+  for (const auto &setting : settings) {
+    try {
+      auto result = run_setting(setting, volume, max_rounds);
+      for (const auto &r : result) {
+        fmt::print(stderr,
+                   "{:>5} {:>14} {:>3} {:>3} {:>10} {:>14} {:>10.3f} GB/s\n",
+                   r.setting.ec_type,
+                   r.setting.technique,
+                   r.setting.k,
+                   r.setting.m,
+                   r.chunk_size,
+                   op_name(r.op),
+                   static_cast<double>(r.output_bytes * r.rounds) /
+                       double{1 << 30} / r.seconds);
+      }
+      records.insert(records.end(), result.begin(), result.end());
+    } catch (std::exception &e) {
+      std::cout.rdbuf(cout_buf);
+      std::cerr << fmt::format("[Error] {} {} k={} m={} chunk_size={}: {}",
+                               setting.ec_type,
+                               setting.technique,
+                               setting.k,
+                               setting.m,
+                               setting.chunk_size,
+                               e.what())
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::cout.rdbuf(cout_buf);
+
+  auto *out = output == "-" ? stdout : std::fopen(output.c_str(), "w");
+  if (out == nullptr) {
+    std::cerr << "[Error] cannot open " << output << std::endl;
+    return EXIT_FAILURE;
+  }
+  fmt::print(out, "[\n");
+  for (std::size_t i = 0; i < records.size(); i++) {
+    fmt::print(out,
+               "  {}{}\n",
+               to_json(records[i]),
+               i + 1 == records.size() ? "" : ",");
+  }
+  fmt::print(out, "]\n");
+  if (out != stdout) {
+    std::fclose(out);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,363 @@
+#include "azure_trace.hh"
+#include "flat_hash_map.hpp"
+#include "merge_scheme.hpp"
+#include "size_lru_cache.hpp"
+#include "synth_trace.hh"
+
+#include <boost/program_options.hpp>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+/// counts the records read through it
+class CountingTraceReader : virtual public trace::TraceReader {
+  trace::TraceReaderPtr trace_reader_;
+  std::size_t &count_;
+
+public:
+  CountingTraceReader(trace::TraceReaderPtr trace_reader, std::size_t &count)
+      : trace_reader_(std::move(trace_reader)), count_(count) {}
+
+  auto next_trace() -> trace::BlobAccessTrace override {
+    auto trace = trace_reader_->next_trace();
+    count_++;
+    return trace;
+  }
+};
+
+struct Run {
+  std::size_t records;
+  std::size_t merges;
+  std::size_t bytes;
+  double hit_rate;
+  double seconds;
+  trace::blob_stream::MergeBufferStats buffers;
+  trace::DedupStats dedup;
+};
+
+auto is_exhaust(const trace::TraceException &e) -> bool {
+  return e.error_enum() == trace::trace_error_e::Exhaust;
+}
+
+/// the records through `InterLocalityMergeStream`, payload synthesis and
+/// merging included, encoding excluded
+auto run_merge(trace::TraceReaderPtr trace_reader, std::size_t merge_size,
+               std::size_t lru_size, std::size_t k,
+               trace::blob_stream::MergeBufferLimits limits) -> Run {
+  auto run = Run{0, 0, 0, 0, 0, {}, {}};
+  auto stream = trace::blob_stream::InterLocalityMergeStream(
+      std::make_unique<CountingTraceReader>(std::move(trace_reader),
+                                            run.records),
+      merge_size,
+      lru_size,
+      k,
+      limits);
+  auto start = clock_type::now();
+  try {
+    while (true) {
+      auto [blobs, data] = stream.next_merge();
+      run.merges++;
+      run.bytes += data.size();
+    }
+  } catch (const trace::TraceException &e) {
+    if (!is_exhaust(e)) {
+      throw;
+    }
+  }
+  run.seconds =
+      std::chrono::duration<double>(clock_type::now() - start).count();
+  run.hit_rate = stream.hit_rate();
+  run.buffers = stream.merge_buffer_stats();
+  return run;
+}
+
+/// the records through the locality index of `InterLocalityMergeStream`
+/// alone: the user LRU and the lookup of the merge buffer of a user
+auto run_index(trace::TraceReaderPtr trace_reader, std::size_t merge_size,
+               std::size_t lru_size) -> Run {
+  auto run = Run{0, 0, 0, 0, 0, {}, {}};
+  auto lru = size_lru_cache::lru_cache<std::uint64_t>(lru_size);
+  auto buffers = flat_hash::FlatHashMap<std::uint64_t, std::size_t>{};
+  auto hits = std::size_t{0};
+  auto start = clock_type::now();
+  try {
+    while (true) {
+      auto trace = trace_reader->next_trace();
+      run.records++;
+      auto contains = lru.contains(trace.user_id);
+      if (trace.size <= lru.capacity()) {
+        lru.insert(trace.user_id, trace.size);
+      }
+      if (!contains || trace.size > merge_size) {
+        continue;
+      }
+      hits++;
+      auto &buffered = buffers.try_emplace(trace.user_id, 0);
+      buffered += trace.size;
+      if (buffered >= merge_size) {
+        run.merges++;
+        run.bytes += buffered;
+        buffers.erase(trace.user_id);
+      }
+    }
+  } catch (const trace::TraceException &e) {
+    if (!is_exhaust(e)) {
+      throw;
+    }
+  }
+  run.seconds =
+      std::chrono::duration<double>(clock_type::now() - start).count();
+  run.hit_rate = static_cast<double>(hits) /
+                 static_cast<double>(std::max<std::size_t>(run.records, 1));
+  return run;
+}
+
+/// the records of the trace alone, e.g. how fast the synthetic trace is
+/// generated
+auto run_generate(trace::TraceReaderPtr trace_reader) -> Run {
+  auto run = Run{0, 0, 0, 0, 0, {}, {}};
+  auto start = clock_type::now();
+  try {
+    while (true) {
+      run.bytes += trace_reader->next_trace().size;
+      run.records++;
+    }
+  } catch (const trace::TraceException &e) {
+    if (!is_exhaust(e)) {
+      throw;
+    }
+  }
+  run.seconds =
+      std::chrono::duration<double>(clock_type::now() - start).count();
+  return run;
+}
+
+/// the records through a `DedupTraceReader` of `budget` bytes
+auto run_dedup(trace::TraceReaderPtr trace_reader, std::size_t budget)
+    -> Run {
+  auto run = Run{0, 0, 0, 0, 0, {}, {}};
+  auto dedup = trace::DedupTraceReader(
+      std::make_unique<CountingTraceReader>(std::move(trace_reader),
+                                            run.records),
+      budget);
+  auto start = clock_type::now();
+  try {
+    while (true) {
+      run.bytes += dedup.next_trace().size;
+    }
+  } catch (const trace::TraceException &e) {
+    if (!is_exhaust(e)) {
+      throw;
+    }
+  }
+  run.seconds =
+      std::chrono::duration<double>(clock_type::now() - start).count();
+  run.dedup = dedup.stats();
+  return run;
+}
+
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+  namespace po = boost::program_options;
+  auto trace_file = std::string{};
+  auto step_by = std::size_t{0};
+  // every record writes a blob, as the Azure trace deduplicated by blob
+  auto workload = trace::SynthWorkload{
+      .size_cdf = {},
+      .min_size = 1,
+      .max_size = std::size_t{64} << 20, // NOLINT
+      .read_ratio = 0,
+      .user_history = 0,
+      .arrival_rate = 1};
+  auto merge_size = std::size_t{0};
+  auto lru_size = std::size_t{0};
+  auto k = std::size_t{0};
+  auto budget_mb = std::size_t{0};
+  auto dedup_budget_mb = std::size_t{0};
+  auto limits = trace::blob_stream::MergeBufferLimits{};
+  auto output = std::string{};
+  auto desc = po::options_description{
+      "InterLocality: records/s of the trace, and through the merge stream "
+      "and its locality index"};
+  desc.add_options()("help,h", "print this message")(
+      "trace",
+      po::value(&trace_file)->default_value(""),
+      "Azure CSV or converted binary trace, a synthetic trace if empty")(
+      "step_by",
+      po::value(&step_by)->default_value(0),
+      "records skipped after each record of the trace")(
+      "records,r",
+      po::value(&workload.records)->default_value(2000000), // NOLINT
+      "records of the synthetic trace")(
+      "users,u",
+      po::value(&workload.users)->default_value(100000), // NOLINT
+      "users of the synthetic trace")(
+      "zipf_s",
+      po::value(&workload.zipf_s)->default_value(1.0),
+      "skew of the users of the synthetic trace")(
+      "size_mu",
+      po::value(&workload.size_mu)->default_value(9.0), // NOLINT
+      "mean of the log of the blob sizes, 9 is about 8 KiB")(
+      "size_sigma",
+      po::value(&workload.size_sigma)->default_value(1.5), // NOLINT
+      "deviation of the log of the blob sizes")(
+      "locality",
+      po::value(&workload.locality)->default_value(0.0),
+      "probability a record of the synthetic trace keeps the user before")(
+      "seed",
+      po::value(&workload.seed)->default_value(0x5eed), // NOLINT
+      "seed of the synthetic trace")(
+      "merge_size",
+      po::value(&merge_size)->default_value(std::size_t{4} << 20), // NOLINT
+      "data bytes per stripe")(
+      "lru_size",
+      po::value(&lru_size)->default_value(std::size_t{4} << 20), // NOLINT
+      "bytes of the user LRU, the merge size in the coordinator")(
+      "k", po::value(&k)->default_value(4), "EC k, the atomic size")(
+      "budget_mb",
+      po::value(&budget_mb)->default_value(0),
+      "memory of the per-user merge buffers in MB, 0 for no limit")(
+      "dedup_budget_mb",
+      po::value(&dedup_budget_mb)->default_value(0),
+      "memory of the blob ids of the dedup run in MB, 0 to keep them "
+      "exactly")(
+      "max_age",
+      po::value(&limits.max_age)->default_value(0),
+      "trace time a merge buffer waits to fill, 0 for no limit; the time "
+      "of the synthetic trace is about the record index")(
+      "output,o",
+      po::value(&output)->default_value("-"),
+      "JSON output file, - for stdout");
+  auto vm = po::variables_map{};
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+  } catch (std::exception &e) {
+    std::cerr << "[Error] " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (vm.count("help") != 0U) {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+  if (k == 0 || merge_size == 0 ||
+      (trace_file.empty() && (workload.records == 0 || workload.users == 0))) {
+    std::cerr << "[Error] expect positive k, merge_size, records and users"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  limits.budget = budget_mb << 20U;
+  // the merge stream logs every merge with locality
+  FLAGS_minloglevel = google::GLOG_WARNING;
+
+  auto open_trace = [&]() -> trace::TraceReaderPtr {
+    if (trace_file.empty()) {
+      return std::make_unique<trace::SynthTraceReader>(workload);
+    }
+    return trace::make_azure_trace(trace_file, step_by);
+  };
+  // the dedup run reads every record, without the dedup of the trace
+  auto open_raw_trace = [&]() -> trace::TraceReaderPtr {
+    if (trace_file.empty()) {
+      return open_trace();
+    }
+    return trace::make_replay_trace(trace_file);
+  };
+  auto records = std::vector<std::string>{};
+  try {
+    for (const auto *op : {"generate", "dedup", "index", "merge"}) {
+      auto name = std::string_view{op};
+      auto run = [&] {
+        if (name == "generate") {
+          return run_generate(open_trace());
+        }
+        if (name == "dedup") {
+          return run_dedup(open_raw_trace(), dedup_budget_mb << 20U);
+        }
+        if (name == "index") {
+          return run_index(open_trace(), merge_size, lru_size);
+        }
+        return run_merge(open_trace(), merge_size, lru_size, k, limits);
+      }();
+      auto rate = static_cast<double>(run.records) / run.seconds;
+      fmt::print(stderr,
+                 "{:>8} {:>12.0f} records/s, {} merges, hit rate {:.3f}\n",
+                 op,
+                 rate,
+                 run.merges,
+                 run.hit_rate);
+      auto histogram = std::string{};
+      for (auto merges : run.buffers.fill_histogram) {
+        histogram += fmt::format("{}{}", histogram.empty() ? "" : ", ", merges);
+      }
+      records.push_back(fmt::format(
+          R"({{"op": "{}", "trace": "{}", "records": {}, "merges": {}, )"
+          R"("bytes": {}, "hit_rate": {:.4f}, "seconds": {:.6f}, )"
+          R"("records_per_s": {:.1f}, "budget_mb": {}, "max_age": {}, )"
+          R"("peak_resident_bytes": {}, "full_flushes": {}, )"
+          R"("budget_flushes": {}, "age_flushes": {}, "handed_over": {}, )"
+          R"("fill_histogram": [{}], "dedup_budget_mb": {}, )"
+          R"("dedup_blobs": {}, "dedup_bytes": {}, "dedup_approximate": {}, )"
+          R"("dedup_false_positive_rate": {:.3e}}})",
+          op,
+          trace_file.empty() ? "synthetic" : trace_file,
+          run.records,
+          run.merges,
+          run.bytes,
+          run.hit_rate,
+          run.seconds,
+          rate,
+          budget_mb,
+          limits.max_age,
+          run.buffers.peak_resident_bytes,
+          run.buffers.full_flushes,
+          run.buffers.budget_flushes,
+          run.buffers.age_flushes,
+          run.buffers.handed_over,
+          histogram,
+          dedup_budget_mb,
+          run.dedup.tracked,
+          run.dedup.bytes,
+          run.dedup.approximate,
+          run.dedup.false_positive_rate));
+    }
+  } catch (std::exception &e) {
+    std::cerr << "[Error] " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto *out = output == "-" ? stdout : std::fopen(output.c_str(), "w");
+  if (out == nullptr) {
+    std::cerr << "[Error] cannot open " << output << std::endl;
+    return EXIT_FAILURE;
+  }
+  fmt::print(out, "[\n");
+  for (std::size_t i = 0; i < records.size(); i++) {
+    fmt::print(
+        out, "  {}{}\n", records[i], i + 1 == records.size() ? "" : ",");
+  }
+  fmt::print(out, "]\n");
+  if (out != stdout) {
+    std::fclose(out);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,485 @@
+#include "meta.hpp"
+#include "meta_core.hpp"
+
+#include <boost/program_options.hpp>
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+using clock_type = std::chrono::steady_clock;
+
+struct Cluster {
+  std::size_t nodes;
+  std::size_t disks;
+  std::size_t pg_num;
+  meta::ec_param_t k;
+  meta::ec_param_t m;
+};
+
+/// blob sizes are lognormal, the blobs are merged into stripes as
+/// `BasicMergeStream` does: until the data of the stripe reaches
+/// `merge_size`, a blob is never split
+struct Workload {
+  std::size_t merge_size;
+  double size_mu;
+  double size_sigma;
+  std::size_t cache_mb;
+};
+
+class StripeSynth {
+  const Workload &workload_;
+  std::mt19937_64 gen_;
+  std::lognormal_distribution<double> size_;
+  std::atomic<meta::blob_id_t> &next_blob_;
+
+public:
+  StripeSynth(const Workload &workload, std::uint64_t seed,
+              std::atomic<meta::blob_id_t> &next_blob)
+      : workload_{workload}, gen_{seed},
+        size_{workload.size_mu, workload.size_sigma}, next_blob_{next_blob} {}
+
+  auto next() -> std::vector<meta::BlobMeta> {
+    auto blobs = std::vector<meta::BlobMeta>{};
+    std::size_t offset{0};
+    while (offset < workload_.merge_size) {
+      auto blob = meta::BlobMeta{};
+      blob.blob_id = next_blob_.fetch_add(1);
+      blob.blob_index = static_cast<meta::blob_index_t>(blobs.size());
+      blob.offset = offset;
+      blob.size = std::max<std::size_t>(1, std::llround(size_(gen_)));
+      offset += blob.size;
+      blobs.push_back(blob);
+    }
+    return blobs;
+  }
+};
+
+auto open_core(const fs::path &dir, bool create_new, const Cluster &cluster,
+               const Workload &workload, std::size_t shards)
+    -> std::unique_ptr<meta::MetaCore> {
+  constexpr std::size_t MB = std::size_t{1} << 20;
+  auto core = std::make_unique<meta::MetaCore>("bench_meta");
+  auto store_options = meta::MetaStore::DEFAULT_OPTIONS;
+  store_options.shards = shards;
+  core->setStoreOptions(store_options);
+  core->setCacheConfig(meta::MetaCache::Config{
+      .stripe_bytes = workload.cache_mb * MB / 4 * 3,
+      .blob_bytes = workload.cache_mb * MB / 4,
+      .shards = meta::MetaCache::DEFAULT_CONFIG.shards});
+  core->launch(dir, create_new);
+  for (std::size_t node = 0; node < cluster.nodes; node++) {
+    for (std::size_t i = 0; i < cluster.disks; i++) {
+      core->registerDisk(meta::DiskMeta{
+          .id = static_cast<meta::disk_id_t>(node * cluster.disks + i),
+          .node_id = node});
+    }
+    core->registerWorker(node,
+                         fmt::format("10.0.{}.{}:6379",
+                                     node / 256, // NOLINT
+                                     node % 256)); // NOLINT
+  }
+  core->registerPG(cluster.pg_num, cluster.k, cluster.m);
+  return core;
+}
+
+struct Registered {
+  double seconds;
+  std::size_t blobs;
+  meta::MetaCommitter::Stats commits;
+};
+
+/// register `stripes` stripes from `threads` threads, each waits for its
+/// stripe to be durable before the next one, as the tasks of build_data do
+auto register_stripes(meta::MetaCore &core, const Cluster &cluster,
+                      const Workload &workload, std::size_t stripes,
+                      std::size_t threads) -> Registered {
+  auto next_blob = std::atomic<meta::blob_id_t>{0};
+  auto claimed = std::atomic_size_t{0};
+  auto start = clock_type::now();
+  {
+    auto workers = std::vector<std::jthread>{};
+    for (std::size_t t = 0; t < threads; t++) {
+      workers.emplace_back([&, t] {
+        auto synth = StripeSynth{workload, t + 1, next_blob};
+        auto chunk_size = workload.merge_size / cluster.k;
+        while (claimed.fetch_add(1) < stripes) {
+          auto stripe_id = core.next_stripe_id();
+          auto chunks = std::vector<meta::ChunkMeta>{};
+          auto width = static_cast<std::size_t>(cluster.k + cluster.m);
+          for (std::size_t i = 0; i < width; i++) {
+            chunks.push_back(meta::ChunkMeta{
+                .stripe_id = stripe_id,
+                .chunk_index = static_cast<meta::chunk_index_t>(i),
+                .size = chunk_size});
+          }
+          auto record = meta::StripeMetaRecord{};
+          record.setStripeId(stripe_id)
+              .setBlobs(synth.next())
+              .setChunks(std::move(chunks))
+              .setChunkSize(chunk_size)
+              .setEcKM(cluster.k, cluster.m)
+              .setPG(core.select_pg(stripe_id))
+              .setBlobLayout(meta::BlobLayout::Horizontal)
+              .setEcType(meta::EcType::RS);
+          core.registerStripe(std::move(record)).get();
+        }
+      });
+    }
+  }
+  auto seconds =
+      std::chrono::duration<double>(clock_type::now() - start).count();
+  return {.seconds = seconds,
+          .blobs = next_blob.load(),
+          .commits = core.commitStats()};
+}
+
+/// `count` distinct ids of [0, population) in random order, by Floyd's
+/// sampling
+auto sample_ids(std::uint64_t population, std::size_t count,
+                std::mt19937_64 &gen) -> std::vector<std::uint64_t> {
+  count = std::min<std::uint64_t>(count, population);
+  auto chosen = std::unordered_set<std::uint64_t>{};
+  auto ids = std::vector<std::uint64_t>{};
+  ids.reserve(count);
+  for (auto j = population - count; j < population; j++) {
+    auto id = std::uniform_int_distribution<std::uint64_t>{0, j}(gen);
+    if (!chosen.insert(id).second) {
+      id = j;
+      chosen.insert(id);
+    }
+    ids.push_back(id);
+  }
+  std::shuffle(ids.begin(), ids.end(), gen);
+  return ids;
+}
+
+struct Latency {
+  double p50_us;
+  double p90_us;
+  double p99_us;
+  double p999_us;
+  double mean_us;
+};
+
+template <typename F>
+auto measure_lookups(const std::vector<std::uint64_t> &ids, F &&lookup)
+    -> Latency {
+  auto samples = std::vector<double>{};
+  samples.reserve(ids.size());
+  for (auto id : ids) {
+    auto start = clock_type::now();
+    lookup(id);
+    samples.push_back(
+        std::chrono::duration<double, std::micro>(clock_type::now() - start)
+            .count());
+  }
+  std::sort(samples.begin(), samples.end());
+  auto at = [&](double q) {
+    auto i = static_cast<std::size_t>(q * static_cast<double>(samples.size()));
+    return samples.at(std::min(i, samples.size() - 1));
+  };
+  auto sum = double{0};
+  for (auto s : samples) {
+    sum += s;
+  }
+  return {.p50_us = at(0.5),   // NOLINT
+          .p90_us = at(0.9),   // NOLINT
+          .p99_us = at(0.99),  // NOLINT
+          .p999_us = at(0.999), // NOLINT
+          .mean_us = sum / static_cast<double>(samples.size())};
+}
+
+auto latency_json(const std::string &op, const std::string &cache,
+                  std::size_t lookups, const Latency &l) -> std::string {
+  return fmt::format(
+      R"({{"op": "{}", "cache": "{}", "lookups": {}, "mean_us": {:.3f}, )"
+      R"("p50_us": {:.3f}, "p90_us": {:.3f}, "p99_us": {:.3f}, )"
+      R"("p999_us": {:.3f}}})",
+      op,
+      cache,
+      lookups,
+      l.mean_us,
+      l.p50_us,
+      l.p90_us,
+      l.p99_us,
+      l.p999_us);
+}
+
+struct RepairScan {
+  std::size_t pgs;
+  std::size_t stripes;
+  double seconds;
+};
+
+/// the meta data side of a disk repair: the PGs on the disk and the stripes
+/// of each, as `repair_failure_domain` walks them
+auto scan_disk_repair(meta::MetaCore &core, meta::disk_id_t disk)
+    -> RepairScan {
+  auto start = clock_type::now();
+  auto scan = RepairScan{0, 0, 0};
+  for (const auto &target : core.diskRepair(disk)) {
+    scan.pgs++;
+    for ([[maybe_unused]] auto stripe_id : core.pgStripes(target.pg.pg_id)) {
+      scan.stripes++;
+    }
+  }
+  scan.seconds =
+      std::chrono::duration<double>(clock_type::now() - start).count();
+  return scan;
+}
+
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+  namespace po = boost::program_options;
+  auto dir = std::string{};
+  auto stripes = std::size_t{0};
+  auto threads = std::vector<std::size_t>{};
+  auto shards = std::vector<std::size_t>{};
+  auto lookups = std::size_t{0};
+  auto repair_nodes = std::vector<std::size_t>{};
+  auto repair_stripes = std::size_t{0};
+  auto cluster = Cluster{};
+  auto workload = Workload{};
+  auto km = std::string{};
+  auto output = std::string{};
+  auto desc = po::options_description{
+      "MetaCore: stripe registration, blob and stripe lookups, disk repair "
+      "scan"};
+  desc.add_options()("help,h", "print this message")(
+      "dir,d",
+      po::value(&dir)->default_value("/tmp/bench_meta"),
+      "scratch directory of the meta stores, removed at the end")(
+      "stripes,s",
+      po::value(&stripes)->default_value(100000), // NOLINT
+      "stripes registered per shard count and concurrency")(
+      "threads,t",
+      po::value(&threads)->multitoken()->default_value({1, 4, 16, 64},
+                                                       "1 4 16 64"),
+      "concurrent registrations")(
+      "shards",
+      po::value(&shards)->multitoken()->default_value({1, 2, 4, 8},
+                                                      "1 2 4 8"),
+      "meta store shards of the registrations, each written by its own "
+      "thread")(
+      "lookups,l",
+      po::value(&lookups)->default_value(100000), // NOLINT
+      "distinct blobs and stripes looked up")(
+      "km,p", po::value(&km)->default_value("4,2"), "EC k,m")(
+      "nodes,n",
+      po::value(&cluster.nodes)->default_value(16), // NOLINT
+      "worker nodes of the register and lookup runs")(
+      "disks",
+      po::value(&cluster.disks)->default_value(4), // NOLINT
+      "disks per node")(
+      "pg_num",
+      po::value(&cluster.pg_num)->default_value(256), // NOLINT
+      "PGs")("merge_size",
+             po::value(&workload.merge_size)
+                 ->default_value(std::size_t{4} << 20), // NOLINT
+             "data bytes per stripe")(
+      "size_mu",
+      po::value(&workload.size_mu)->default_value(11.0), // NOLINT
+      "mean of the log of the blob sizes, 11 is about 60 KiB")(
+      "size_sigma",
+      po::value(&workload.size_sigma)->default_value(1.5), // NOLINT
+      "deviation of the log of the blob sizes")(
+      "cache_mb",
+      po::value(&workload.cache_mb)->default_value(256), // NOLINT
+      "meta cache of the lookups")(
+      "repair_nodes",
+      po::value(&repair_nodes)
+          ->multitoken()
+          ->default_value({8, 16, 32, 64}, "8 16 32 64"),
+      "cluster sizes of the disk repair scan")(
+      "repair_stripes",
+      po::value(&repair_stripes)->default_value(100000), // NOLINT
+      "stripes registered per cluster size")(
+      "output,o",
+      po::value(&output)->default_value("-"),
+      "JSON output file, - for stdout");
+  auto vm = po::variables_map{};
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+    auto sep = km.find(',');
+    if (sep == std::string::npos) {
+      throw std::invalid_argument{fmt::format("expect k,m but got {}", km)};
+    }
+    cluster.k = static_cast<meta::ec_param_t>(std::stoi(km.substr(0, sep)));
+    cluster.m = static_cast<meta::ec_param_t>(std::stoi(km.substr(sep + 1)));
+  } catch (std::exception &e) {
+    std::cerr << "[Error] " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (vm.count("help") != 0U) {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+  auto width = static_cast<std::size_t>(std::max(cluster.k + cluster.m, 0));
+  auto too_small = std::any_of(repair_nodes.begin(),
+                               repair_nodes.end(),
+                               [&](auto nodes) { return nodes < width; });
+  if (cluster.nodes < width || too_small || cluster.k <= 0 || cluster.m < 0 ||
+      threads.empty() || shards.empty() || stripes == 0 || lookups == 0 ||
+      std::find(shards.begin(), shards.end(), 0) != shards.end()) {
+    std::cerr << "[Error] expect at least k+m nodes, and positive k, "
+                 "threads, shards, stripes and lookups"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto records = std::vector<std::string>{};
+  auto root = fs::path{dir};
+  try {
+    // registration, per shard count and concurrency
+    auto lookup_dir = fs::path{};
+    auto lookup_shards = std::size_t{0};
+    auto blobs = std::size_t{0};
+    for (auto n : shards) {
+      for (auto t : threads) {
+        auto run_dir = root / fmt::format("register-{}-{}", n, t);
+        auto core = open_core(run_dir, true, cluster, workload, n);
+        auto run = register_stripes(*core, cluster, workload, stripes, t);
+        core->persist();
+        fmt::print(stderr,
+                   "register {:>2} shards {:>3} threads {:>10.0f} stripes/s, "
+                   "{:.1f} stripes/commit\n",
+                   n,
+                   t,
+                   static_cast<double>(stripes) / run.seconds,
+                   static_cast<double>(run.commits.stripes) /
+                       static_cast<double>(std::max<std::size_t>(
+                           run.commits.groups, 1)));
+        records.push_back(fmt::format(
+            R"({{"op": "register", "shards": {}, "threads": {}, )"
+            R"("stripes": {}, "blobs": {}, "seconds": {:.6f}, )"
+            R"("stripes_per_s": {:.1f}, "commit_groups": {}}})",
+            n,
+            t,
+            stripes,
+            run.blobs,
+            run.seconds,
+            static_cast<double>(stripes) / run.seconds,
+            run.commits.groups));
+        lookup_dir = run_dir;
+        lookup_shards = n;
+        blobs = run.blobs;
+      }
+    }
+
+    // lookups, on the store of the last registration; every run reopens it
+    // with an empty meta cache, the first pass over distinct ids is cold
+    // and the second one over the same ids is warm
+    auto gen = std::mt19937_64{0x1234}; // NOLINT
+    auto lookup_pass = [&](const std::string &op, auto &&lookup) {
+      auto ids = sample_ids(op == "blob_meta" ? blobs : stripes, lookups, gen);
+      auto core =
+          open_core(lookup_dir, false, cluster, workload, lookup_shards);
+      core->load_meta();
+      for (const auto *cache : {"cold", "warm"}) {
+        auto latency =
+            measure_lookups(ids, [&](auto id) { lookup(*core, id); });
+        fmt::print(stderr,
+                   "{:>10} {:>4} p50 {:>8.2f} us p99 {:>8.2f} us\n",
+                   op,
+                   cache,
+                   latency.p50_us,
+                   latency.p99_us);
+        records.push_back(latency_json(op, cache, ids.size(), latency));
+      }
+    };
+    lookup_pass("blob_meta", [](meta::MetaCore &core, std::uint64_t id) {
+      return core.blob_meta(id);
+    });
+    lookup_pass("stripe_meta", [](meta::MetaCore &core, std::uint64_t id) {
+      return core.stripe_meta(id);
+    });
+
+    // disk repair scan versus cluster size, right after recovery and again
+    // once the PG map is loaded
+    auto max_threads = *std::max_element(threads.begin(), threads.end());
+    for (auto nodes : repair_nodes) {
+      auto repair_cluster = cluster;
+      repair_cluster.nodes = nodes;
+      auto run_dir = root / fmt::format("repair-{}", nodes);
+      {
+        auto core = open_core(run_dir,
+                              true,
+                              repair_cluster,
+                              workload,
+                              meta::MetaStore::DEFAULT_OPTIONS.shards);
+        register_stripes(
+            *core, repair_cluster, workload, repair_stripes, max_threads);
+        core->persist();
+      }
+      auto core = open_core(run_dir,
+                            false,
+                            repair_cluster,
+                            workload,
+                            meta::MetaStore::DEFAULT_OPTIONS.shards);
+      core->load_meta();
+      auto cold = scan_disk_repair(*core, 0);
+      auto warm = scan_disk_repair(*core, 0);
+      fmt::print(stderr,
+                 "disk_repair {:>3} nodes {:>4} pgs {:>8} stripes cold "
+                 "{:.3f} ms warm {:.3f} ms\n",
+                 nodes,
+                 warm.pgs,
+                 warm.stripes,
+                 cold.seconds * 1e3, // NOLINT
+                 warm.seconds * 1e3); // NOLINT
+      records.push_back(fmt::format(
+          R"({{"op": "disk_repair", "nodes": {}, "disks": {}, "pgs": {}, )"
+          R"("stripes": {}, "cold_seconds": {:.6f}, )"
+          R"("warm_seconds": {:.6f}}})",
+          nodes,
+          nodes * cluster.disks,
+          warm.pgs,
+          warm.stripes,
+          cold.seconds,
+          warm.seconds));
+    }
+  } catch (std::exception &e) {
+    std::cerr << "[Error] " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::error_code ec{};
+  fs::remove_all(root, ec);
+
+  auto *out = output == "-" ? stdout : std::fopen(output.c_str(), "w");
+  if (out == nullptr) {
+    std::cerr << "[Error] cannot open " << output << std::endl;
+    return EXIT_FAILURE;
+  }
+  fmt::print(out, "[\n");
+  for (std::size_t i = 0; i < records.size(); i++) {
+    fmt::print(
+        out, "  {}{}\n", records[i], i + 1 == records.size() ? "" : ",");
+  }
+  fmt::print(out, "]\n");
+  if (out != stdout) {
+    std::fclose(out);
+  }
+  return EXIT_SUCCESS;
+}
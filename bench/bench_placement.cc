@@ -0,0 +1,250 @@
+#include "ceph_hash.hpp"
+#include "meta.hpp"
+#include "placement.hpp"
+
+#include <boost/program_options.hpp>
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Cluster {
+  std::map<meta::pg_id_t, meta::PGMeta> pgs;
+  std::map<meta::disk_id_t, meta::node_id_t> disk_to_node;
+  std::map<meta::node_id_t, meta::ip_t> worker_to_ip;
+};
+
+/// `nodes` workers of `disks` disks each, and `pg_num` PGs of k+m random
+/// nodes, as `MetaCore::registerPG` places them
+auto make_cluster(std::size_t nodes, std::size_t disks, std::size_t pg_num,
+                  std::size_t width) -> Cluster {
+  auto cluster = Cluster{};
+  auto node_ids = std::vector<meta::node_id_t>(nodes);
+  std::iota(node_ids.begin(), node_ids.end(), 1);
+  for (auto node : node_ids) {
+    cluster.worker_to_ip[node] = fmt::format("10.0.{}.{}:6379",
+                                             node / 256, // NOLINT
+                                             node % 256); // NOLINT
+    for (std::size_t i = 0; i < disks; i++) {
+      auto disk_id = static_cast<meta::disk_id_t>(node * disks + i);
+      cluster.disk_to_node[disk_id] = node;
+    }
+  }
+  constexpr std::int64_t RAND_SEED = 0x1234;
+  auto gen = std::mt19937{RAND_SEED};
+  for (std::size_t i = 0; i < pg_num; i++) {
+    auto pg = meta::PGMeta{};
+    pg.pg_id = static_cast<meta::pg_id_t>(i);
+    std::shuffle(node_ids.begin(), node_ids.end(), gen);
+    for (std::size_t j = 0; j < width; j++) {
+      auto node = node_ids[j];
+      pg.disk_list.push_back(
+          static_cast<meta::disk_id_t>(node * disks + gen() % disks));
+    }
+    cluster.pgs[pg.pg_id] = std::move(pg);
+  }
+  return cluster;
+}
+
+/// the lookups as `MetaCore` did them before the placement table
+struct LegacyPlacement {
+  const Cluster &cluster;
+
+  [[nodiscard]] auto select_pg(meta::stripe_id_t stripe_id) const
+      -> meta::pg_id_t {
+    auto s = std::to_string(stripe_id);
+    return ceph_str_hash_rjenkins(s.c_str(), s.size()) % cluster.pgs.size();
+  }
+
+  [[nodiscard]] auto pg_to_worker_ip(meta::pg_id_t pg_id) const
+      -> std::vector<meta::ip_t> {
+    const auto &disks = cluster.pgs.at(pg_id).disk_list;
+    auto ips = std::vector<meta::ip_t>{};
+    ips.reserve(disks.size());
+    for (auto disk_id : disks) {
+      ips.push_back(
+          cluster.worker_to_ip.at(cluster.disk_to_node.at(disk_id)));
+    }
+    return ips;
+  }
+};
+
+struct Record {
+  std::string impl;
+  std::string op;
+  std::size_t lookups;
+  double seconds;
+  /// largest over smallest number of stripes per PG, for `select_pg`
+  double pg_skew;
+};
+
+template <typename F> auto time_lookups(std::size_t lookups, F &&lookup) {
+  // keep the results observable so the loop is not optimized out
+  std::size_t sink{0};
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < lookups; i++) {
+    sink += lookup(static_cast<meta::stripe_id_t>(i));
+  }
+  auto end = std::chrono::steady_clock::now();
+  if (sink == 1) {
+    std::fputc('\0', stderr);
+  }
+  return std::chrono::duration<double>(end - start).count();
+}
+
+template <typename F>
+auto pg_skew(std::size_t stripes, std::size_t pg_num, F &&select_pg)
+    -> double {
+  auto counts = std::vector<std::size_t>(pg_num, 0);
+  for (std::size_t i = 0; i < stripes; i++) {
+    counts.at(select_pg(static_cast<meta::stripe_id_t>(i)))++;
+  }
+  auto [min, max] = std::minmax_element(counts.begin(), counts.end());
+  return static_cast<double>(*max) /
+         static_cast<double>(std::max<std::size_t>(*min, 1));
+}
+
+auto to_json(const Record &r) -> std::string {
+  return fmt::format(
+      R"({{"impl": "{}", "op": "{}", "lookups": {}, "seconds": {:.6f}, )"
+      R"("ns_per_lookup": {:.2f}, "pg_skew": {:.4f}}})",
+      r.impl,
+      r.op,
+      r.lookups,
+      r.seconds,
+      r.seconds * 1e9 / static_cast<double>(r.lookups), // NOLINT
+      r.pg_skew);
+}
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+  namespace po = boost::program_options;
+  auto nodes = std::size_t{0};
+  auto disks = std::size_t{0};
+  auto pg_num = std::size_t{0};
+  auto width = std::size_t{0};
+  auto lookups = std::size_t{0};
+  auto output = std::string{};
+  auto desc = po::options_description{
+      "Placement lookups: stripe to PG, PG to workers and disks"};
+  desc.add_options()("help,h", "print this message")(
+      "nodes,n", po::value(&nodes)->default_value(16), "worker nodes")(
+      "disks,d", po::value(&disks)->default_value(4), "disks per node")(
+      "pg_num,p", po::value(&pg_num)->default_value(256), "PGs")( // NOLINT
+      "width,w",
+      po::value(&width)->default_value(12), // NOLINT
+      "chunks per stripe, k+m")(
+      "lookups,l",
+      po::value(&lookups)->default_value(std::size_t{1} << 22), // NOLINT
+      "lookups per measurement")(
+      "output,o",
+      po::value(&output)->default_value("-"),
+      "JSON output file, - for stdout");
+  auto vm = po::variables_map{};
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+  } catch (std::exception &e) {
+    std::cerr << "[Error] " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (vm.count("help") != 0U) {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+  if (width > nodes || pg_num == 0 || disks == 0 || lookups == 0) {
+    std::cerr << "[Error] expect 0 < width <= nodes and positive pg_num, "
+                 "disks and lookups"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto cluster = make_cluster(nodes, disks, pg_num, width);
+  auto legacy = LegacyPlacement{cluster};
+  auto table = meta::PlacementTable{
+      cluster.pgs, cluster.disk_to_node, cluster.worker_to_ip};
+
+  auto records = std::vector<Record>{};
+  records.push_back(Record{
+      .impl = "legacy",
+      .op = "select_pg",
+      .lookups = lookups,
+      .seconds = time_lookups(
+          lookups, [&](auto stripe_id) { return legacy.select_pg(stripe_id); }),
+      .pg_skew = pg_skew(lookups, pg_num, [&](auto stripe_id) {
+        return legacy.select_pg(stripe_id);
+      })});
+  records.push_back(Record{
+      .impl = "table",
+      .op = "select_pg",
+      .lookups = lookups,
+      .seconds = time_lookups(
+          lookups, [&](auto stripe_id) { return table.select_pg(stripe_id); }),
+      .pg_skew = pg_skew(lookups, pg_num, [&](auto stripe_id) {
+        return table.select_pg(stripe_id);
+      })});
+  // a read or repair resolves the PG of a stripe and then its workers
+  records.push_back(Record{
+      .impl = "legacy",
+      .op = "stripe_to_worker_ip",
+      .lookups = lookups,
+      .seconds = time_lookups(lookups,
+                              [&](auto stripe_id) {
+                                return legacy
+                                    .pg_to_worker_ip(
+                                        legacy.select_pg(stripe_id))
+                                    .front()
+                                    .size();
+                              }),
+      .pg_skew = 0});
+  records.push_back(Record{
+      .impl = "table",
+      .op = "stripe_to_worker_ip",
+      .lookups = lookups,
+      .seconds = time_lookups(lookups,
+                              [&](auto stripe_id) {
+                                return table.pg(table.select_pg(stripe_id))
+                                    .ips.front()
+                                    .size();
+                              }),
+      .pg_skew = 0});
+
+  for (const auto &r : records) {
+    fmt::print(stderr,
+               "{:>7} {:>20} {:>8.2f} ns/lookup\n",
+               r.impl,
+               r.op,
+               r.seconds * 1e9 / static_cast<double>(r.lookups)); // NOLINT
+  }
+  auto *out = output == "-" ? stdout : std::fopen(output.c_str(), "w");
+  if (out == nullptr) {
+    std::cerr << "[Error] cannot open " << output << std::endl;
+    return EXIT_FAILURE;
+  }
+  fmt::print(out, "[\n");
+  for (std::size_t i = 0; i < records.size(); i++) {
+    fmt::print(out,
+               "  {}{}\n",
+               to_json(records[i]),
+               i + 1 == records.size() ? "" : ",");
+  }
+  fmt::print(out, "]\n");
+  if (out != stdout) {
+    std::fclose(out);
+  }
+  return EXIT_SUCCESS;
+}
@@ -5,6 +5,7 @@
 #include <condition_variable>
 #include <cstddef>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <utility>
 
@@ -17,33 +18,59 @@ private:
   std::condition_variable not_empty_cv_{};
   boost::circular_buffer<T> queue_{};
   std::size_t capacity_{};
+  bool closed_{false};
 
 public:
   static constexpr std::size_t DEFAULT_CAPACITY = 32;
   /// Build bounded blocking queue with default capacity
   BlockingQueue() : BlockingQueue(DEFAULT_CAPACITY) {}
-  BlockingQueue(std::size_t capacity) : capacity_(capacity) {}
+  BlockingQueue(std::size_t capacity)
+      : queue_(capacity), capacity_(capacity) {}
 
-  void push(T value) {
+  /// # Return
+  /// false if the queue is closed, the value is dropped
+  bool push(T value) {
     {
       std::unique_lock<mutex_t> lock(mutex_);
-      not_full_cv_.wait(lock,
-                        [this]() { return queue_.size() < this->capacity_; });
+      not_full_cv_.wait(lock, [this]() {
+        return closed_ || queue_.size() < this->capacity_;
+      });
+      if (closed_) {
+        return false;
+      }
       queue_.push_back(std::move(value));
     }
     not_empty_cv_.notify_one();
+    return true;
   };
 
-  T pop() {
+  /// # Return
+  /// the front value, or none once the queue is closed and drained
+  std::optional<T> pop() {
     std::unique_lock<mutex_t> lock(mutex_);
-    not_empty_cv_.wait(lock, [this] { return !this->queue_.empty(); });
-    T toret{std::move(queue_.front())};
+    not_empty_cv_.wait(lock,
+                       [this] { return closed_ || !this->queue_.empty(); });
+    if (queue_.empty()) {
+      return std::nullopt;
+    }
+    std::optional<T> toret{std::move(queue_.front())};
     queue_.pop_front();
     not_full_cv_.notify_one();
 
     return toret;
   };
 
+  /// wake the blocked producers and consumers, the values queued can still
+  /// be popped, the values pushed from now on are dropped
+  void close() {
+    {
+      std::unique_lock<mutex_t> lock(mutex_);
+      closed_ = true;
+    }
+    not_full_cv_.notify_all();
+    not_empty_cv_.notify_all();
+  }
+
   std::size_t size() const { return queue_.size(); }
   bool empty() const { return queue_.empty(); }
 };
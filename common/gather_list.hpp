@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace util {
+
+/// An iovec-like list of byte segments that reads as one contiguous range,
+/// e.g. the blobs of a merge, without copying them into one buffer.
+/// # Note
+/// - a segment keeps the buffer it points into alive, a segment without an
+///   owner points into memory that outlives the list, e.g. static zeros
+/// - the buffers are shared and never written through the list, a list and
+///   its slices can be read from several threads
+class GatherList {
+public:
+  struct Segment {
+    std::shared_ptr<const void> owner;
+    const char *data;
+    std::size_t size;
+  };
+
+private:
+  std::vector<Segment> segments_{};
+  std::size_t size_{0};
+
+  inline static constexpr std::size_t ZEROS_SIZE{4096};
+  inline static constexpr std::array<char, ZEROS_SIZE> ZEROS{};
+
+public:
+  GatherList() = default;
+  /// the whole buffer, shared
+  explicit GatherList(std::shared_ptr<const std::vector<char>> buffer) {
+    append(std::move(buffer));
+  }
+  /// the whole buffer, moved into the list
+  explicit GatherList(std::vector<char> buffer)
+      : GatherList(
+            std::make_shared<const std::vector<char>>(std::move(buffer))) {}
+  /// a borrowed view, the caller keeps `data` alive as long as the list
+  static auto borrow(std::span<const char> data) -> GatherList {
+    auto list = GatherList{};
+    list.append(
+        Segment{.owner = nullptr, .data = data.data(), .size = data.size()});
+    return list;
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t { return size_; }
+  [[nodiscard]] auto empty() const -> bool { return size_ == 0; }
+  [[nodiscard]] auto segments() const -> std::span<const Segment> {
+    return segments_;
+  }
+
+  auto append(Segment segment) -> void {
+    if (segment.size == 0) {
+      return;
+    }
+    size_ += segment.size;
+    segments_.push_back(std::move(segment));
+  }
+
+  auto append(std::shared_ptr<const std::vector<char>> buffer) -> void {
+    const auto *data = buffer->data();
+    auto size = buffer->size();
+    append(Segment{.owner = std::move(buffer), .data = data, .size = size});
+  }
+
+  /// append the segments of `other`, sharing their buffers
+  auto append(const GatherList &other) -> void {
+    for (const auto &segment : other.segments_) {
+      append(segment);
+    }
+  }
+
+  /// append `size` zero bytes without a buffer
+  auto append_zeros(std::size_t size) -> void {
+    while (size > 0) {
+      auto len = std::min(size, ZEROS_SIZE);
+      append(Segment{.owner = nullptr, .data = ZEROS.data(), .size = len});
+      size -= len;
+    }
+  }
+
+  /// the bytes [offset, offset + size), sharing the buffers of this list
+  [[nodiscard]] auto slice(std::size_t offset, std::size_t size) const
+      -> GatherList {
+    assert(offset + size <= size_);
+    auto list = GatherList{};
+    for (const auto &segment : segments_) {
+      if (size == 0) {
+        break;
+      }
+      if (offset >= segment.size) {
+        offset -= segment.size;
+        continue;
+      }
+      auto len = std::min(segment.size - offset, size);
+      list.append(Segment{.owner = segment.owner,
+                          .data = segment.data + offset, // NOLINT
+                          .size = len});
+      offset = 0;
+      size -= len;
+    }
+    return list;
+  }
+
+  /// gather the bytes from `offset` into `out`
+  /// # Return
+  /// the bytes copied, less than `out.size()` at the end of the list
+  auto copy_to(std::size_t offset, std::span<char> out) const -> std::size_t {
+    auto copied = std::size_t{0};
+    for (const auto &segment : segments_) {
+      if (copied == out.size()) {
+        break;
+      }
+      if (offset >= segment.size) {
+        offset -= segment.size;
+        continue;
+      }
+      auto len = std::min(segment.size - offset, out.size() - copied);
+      std::memcpy(out.data() + copied, segment.data + offset, len); // NOLINT
+      copied += len;
+      offset = 0;
+    }
+    return copied;
+  }
+
+  /// the bytes in one buffer, for the consumers that need them contiguous
+  [[nodiscard]] auto to_vector() const -> std::vector<char> {
+    auto data = std::vector<char>(size_);
+    copy_to(0, data);
+    return data;
+  }
+};
+
+} // namespace util
@@ -7,9 +7,12 @@
 #include <cstdint>
 #include <span>
 #include <string_view>
+#include <utility>
 
 namespace util {
 
+class SharedVecPool;
+
 class SharedVec {
 private:
   // NOLINTBEGIN (cppcoreguidelines-non-private-member-variables-in-classes)
@@ -20,6 +23,10 @@ private:
     std::copy(
         data.cbegin(), data.cend(), reinterpret_cast<char *>(data_.get()));
   }
+  SharedVec(boost::shared_ptr<std::byte[]> data, std::size_t size)
+      : data_(std::move(data)), size_(size) {}
+
+  friend class SharedVecPool;
 
 public:
   SharedVec() = default;
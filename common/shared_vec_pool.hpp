@@ -0,0 +1,134 @@
+#pragma once
+
+#include "shared_vec.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+namespace util {
+
+/// Recycle the buffers behind `SharedVec` so that a steady stream of equally
+/// sized stripes stops hitting the allocator.
+///
+/// # Note
+/// - a buffer goes back to the pool once the last `SharedVec` referring to it
+///   is dropped, so handing chunks between stages stays a reference-counted
+///   move
+/// - buffers are rounded up to a size class (1/8 of the leading power of two)
+///   and aligned to `ALIGNMENT`, which the SIMD paths of the codecs expect
+/// - the content of an acquired buffer is unspecified
+/// - at most `max_cached_bytes` of free buffers are kept, the rest is released
+class SharedVecPool {
+public:
+  static constexpr std::size_t ALIGNMENT{64};
+  static constexpr std::size_t DEFAULT_MAX_CACHED_BYTES{std::size_t{1} << 30};
+
+  struct Stats {
+    /// buffers obtained from the allocator
+    std::size_t allocations;
+    /// buffers served from the pool
+    std::size_t reuses;
+    /// bytes of the free buffers currently cached
+    std::size_t cached_bytes;
+  };
+
+private:
+  struct State {
+    std::mutex mtx;
+    std::unordered_map<std::size_t, std::vector<std::byte *>> free;
+    std::size_t max_cached_bytes;
+    std::size_t cached_bytes{0};
+    std::atomic_size_t allocations{0};
+    std::atomic_size_t reuses{0};
+
+    explicit State(std::size_t max_cached_bytes)
+        : max_cached_bytes(max_cached_bytes) {}
+    State(const State &) = delete;
+    auto operator=(const State &) -> State & = delete;
+    State(State &&) = delete;
+    auto operator=(State &&) -> State & = delete;
+    ~State() {
+      for (auto &[capacity, buffers] : free) {
+        for (auto *buf : buffers) {
+          ::operator delete[](buf, std::align_val_t{ALIGNMENT});
+        }
+      }
+    }
+
+    void release(std::byte *buf, std::size_t capacity) {
+      {
+        auto lock = std::lock_guard{mtx};
+        if (cached_bytes + capacity <= max_cached_bytes) {
+          free[capacity].push_back(buf);
+          cached_bytes += capacity;
+          return;
+        }
+      }
+      ::operator delete[](buf, std::align_val_t{ALIGNMENT});
+    }
+  };
+  std::shared_ptr<State> state_;
+
+  static auto size_class(std::size_t size) -> std::size_t {
+    constexpr std::size_t MIN_CLASS{ALIGNMENT};
+    if (size <= MIN_CLASS) {
+      return MIN_CLASS;
+    }
+    auto step = std::bit_floor(size) / 8;
+    return (size + step - 1) / step * step;
+  }
+
+public:
+  explicit SharedVecPool(
+      std::size_t max_cached_bytes = DEFAULT_MAX_CACHED_BYTES)
+      : state_(std::make_shared<State>(max_cached_bytes)) {}
+
+  /// a buffer of `size` bytes with unspecified content
+  auto acquire(std::size_t size) -> SharedVec {
+    auto capacity = size_class(size);
+    std::byte *buf = nullptr;
+    {
+      auto lock = std::lock_guard{state_->mtx};
+      auto it = state_->free.find(capacity);
+      if (it != state_->free.end() && !it->second.empty()) {
+        buf = it->second.back();
+        it->second.pop_back();
+        state_->cached_bytes -= capacity;
+      }
+    }
+    if (buf != nullptr) {
+      state_->reuses++;
+    } else {
+      buf = static_cast<std::byte *>(
+          ::operator new[](capacity, std::align_val_t{ALIGNMENT}));
+      state_->allocations++;
+    }
+    // the deleter keeps the state alive, buffers may outlive the pool
+    auto data = boost::shared_ptr<std::byte[]>(
+        buf, [state = state_, capacity](std::byte *p) {
+          state->release(p, capacity);
+        });
+    return SharedVec(std::move(data), size);
+  }
+
+  [[nodiscard]] auto stats() const -> Stats {
+    auto lock = std::lock_guard{state_->mtx};
+    return {.allocations = state_->allocations.load(),
+            .reuses = state_->reuses.load(),
+            .cached_bytes = state_->cached_bytes};
+  }
+};
+
+/// the pool shared by the stripe path, from the encoders to the transport
+inline auto chunk_pool() -> SharedVecPool & {
+  static auto pool = SharedVecPool{};
+  return pool;
+}
+
+} // namespace util
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/// A hashed timer wheel: a value is scheduled at a tick and fired by the
+/// `advance` that passes the tick.
+/// # Note
+/// - scheduling and firing are O(1), a tick more than one turn of the wheel
+///   ahead stays in its slot for the later turns
+/// - a value scheduled at a tick already passed fires with the next
+///   `advance`
+/// - the values of a tick fire in the order they are scheduled
+template <class T> class TimerWheel {
+  struct Timer {
+    std::uint64_t tick;
+    T value;
+  };
+
+  std::vector<std::vector<Timer>> slots_;
+  std::uint64_t mask_;
+  /// the first tick not fired yet
+  std::uint64_t next_{0};
+  std::size_t size_{0};
+
+public:
+  explicit TimerWheel(std::size_t slots)
+      : slots_(std::bit_ceil(std::max<std::size_t>(slots, 1))),
+        mask_(slots_.size() - 1) {}
+
+  [[nodiscard]] auto slots() const -> std::size_t { return slots_.size(); }
+  [[nodiscard]] auto size() const -> std::size_t { return size_; }
+  [[nodiscard]] auto empty() const -> bool { return size_ == 0; }
+  /// the first tick not fired yet
+  [[nodiscard]] auto next_tick() const -> std::uint64_t { return next_; }
+
+  auto schedule(std::uint64_t tick, T value) -> void {
+    tick = std::max(tick, next_);
+    slots_[tick & mask_].push_back(Timer{tick, std::move(value)});
+    size_++;
+  }
+
+  /// fire `fire(value)` for the values scheduled up to `tick`, in the order
+  /// of their ticks
+  template <class Fire> auto advance(std::uint64_t tick, Fire &&fire) -> void {
+    for (; next_ <= tick && size_ > 0; next_++) {
+      auto &slot = slots_[next_ & mask_];
+      // keep the timers of the later turns in place
+      auto later = std::stable_partition(
+          slot.begin(), slot.end(), [now = next_](const Timer &timer) {
+            return timer.tick == now;
+          });
+      for (auto it = slot.begin(); it != later; it++) {
+        fire(std::move(it->value));
+      }
+      size_ -= static_cast<std::size_t>(later - slot.begin());
+      slot.erase(slot.begin(), later);
+    }
+    next_ = std::max(next_, tick + 1);
+  }
+};
+
+} // namespace util
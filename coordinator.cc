@@ -118,7 +118,7 @@ auto main(int argc, char *argv[]) -> int {
     case coord::ActionType::RepairFailureDomain: {
       std::cout << "[Info] repairing failure domain..." << std::endl;
       auto epoch = std::chrono::steady_clock::now();
-      auto [size] = coord->repair_failure_domain();
+      auto [size, time_to_first_command] = coord->repair_failure_domain();
       auto elapse = std::chrono::duration_cast<std::chrono::milliseconds>(
           std::chrono::steady_clock::now() - epoch);
       std::cout << "[Info] done" << std::endl;
@@ -129,6 +129,9 @@ auto main(int argc, char *argv[]) -> int {
       std::cout << fmt::format("[Info] throughput: {:.2f}MB/s",
                                throughput(size, elapse)) // NOLINT
                 << std::endl;
+      std::cout << fmt::format("[Info] time to first repair command: {}ms",
+                               time_to_first_command.count())
+                << std::endl;
     } break;
     case coord::ActionType::Read: {
       std::cout << "[Info] Reading trace..." << std::endl;
@@ -158,6 +161,37 @@ auto main(int argc, char *argv[]) -> int {
                                throughput(total_size, elapse))
                 << std::endl;
     } break;
+    case coord::ActionType::Replay: {
+      std::cout << "[Info] Replaying trace..." << std::endl;
+      auto [ops, records, span, elapsed] = coord->replay();
+      std::cout << "[Info] done" << std::endl;
+      std::cout << fmt::format(
+          "[Info] Replayed {} records, {}ms of trace in {}ms\n",
+          records,
+          span.count(),
+          elapsed.count());
+      for (auto kind : coord::replay::ALL_OP_KINDS) {
+        const auto &op = ops.at(static_cast<std::size_t>(kind));
+        std::cout << fmt::format(
+            "[Info] {}: {} ops, {} MB, {} missing, {} failed\n",
+            kind,
+            op.count,
+            op.bytes >> 20, // NOLINT
+            op.missing,
+            op.failed);
+        std::cout << fmt::format(
+            "[Info] {} latency(us): mean {:.0f}, p50 {:.0f}, p90 {:.0f}, "
+            "p99 {:.0f}, p999 {:.0f}, max {:.0f}, lag p99 {:.0f}\n",
+            kind,
+            op.mean_us,
+            op.p50_us,
+            op.p90_us,
+            op.p99_us,
+            op.p999_us,
+            op.max_us,
+            op.lag_p99_us);
+      }
+    } break;
     default:
       err::Unreachable("unknown action");
     }
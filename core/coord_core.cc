@@ -13,6 +13,12 @@
 #include "merge_scheme.hpp"
 #include "meta.hpp"
 #include "meta_core.hpp"
+#include "payload.hh"
+#include "pipeline.hh"
+#include "replay.hh"
+#include "shared_vec_pool.hpp"
+#include "synth_trace.hh"
+#include "timer_wheel.hpp"
 
 #include "meta_exception.hpp"
 
@@ -31,8 +37,12 @@
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <numeric>
+#include <optional>
 #include <queue>
+#include <random>
+#include <span>
 #include <string>
 #include <string_view>
 #include <thread>
@@ -50,6 +60,7 @@ private:
       -> std::pair<std::vector<BlockCommand>, std::vector<meta::ip_t>> {
     namespace trc = task::repair::centralize;
     auto &meta_core = meta_core_ref.get();
+    const auto &stripe_meta = *stripe_meta_ref;
     auto stripe_id = stripe_meta.stripe_id;
     // size of the chunk
     auto const chunk_size = stripe_meta.chunk_size;
@@ -103,6 +114,7 @@ private:
     namespace trp = task::repair::pipeline;
     err::Unreachable();
     auto &meta_core = meta_core_ref.get();
+    const auto &stripe_meta = *stripe_meta_ref;
     auto stripe_id = stripe_meta.stripe_id;
     // size of the chunk
     auto const chunk_size = stripe_meta.chunk_size;
@@ -147,6 +159,7 @@ private:
     namespace trc = task::repair::centralize;
     // err::Todo("check range");
     auto &meta_core = meta_core_ref.get();
+    const auto &stripe_meta = *stripe_meta_ref;
     auto stripe_id = stripe_meta.stripe_id;
     // size of the chunk
     auto const chunk_size = stripe_meta.chunk_size;
@@ -202,6 +215,7 @@ private:
     err::Unimplemented("unreachable");
     namespace trp = task::repair::pipeline;
     auto &meta_core = meta_core_ref.get();
+    const auto &stripe_meta = *stripe_meta_ref;
     auto stripe_id = stripe_meta.stripe_id;
     // size of the chunk
     auto const chunk_size = stripe_meta.chunk_size;
@@ -258,6 +272,7 @@ public:
   /// # Return: the ip of the ack node
   [[nodiscard("wait for the ack")]] auto
   operator()(::coord::RepairManner repair_manner) -> meta::ip_t {
+    const auto &stripe_meta = *stripe_meta_ref;
     auto ec_type = stripe_meta.ec_type;
     // auto repair_manner = profile_cref.get().chunk_repair_profile().manner;
     auto ack_ip = meta::ip_t{};
@@ -317,14 +332,16 @@ public:
     }
     return ack_ip;
   }
-  meta::StripeMeta stripe_meta;
+  std::shared_ptr<const meta::StripeMeta> stripe_meta_ref;
   meta::chunk_id_t failed_chunk;
   std::reference_wrapper<meta::MetaCore> meta_core_ref;
   std::reference_wrapper<comm::CommManager> comm_ref;
 };
 
 struct ReadBlob {
-
+  /// # Return
+  /// the workers to wait for, they ack to the read ack list tagged `ack_tag`,
+  /// see `comm::make_ack_list_name`
   [[nodiscard("wait for ack")]] auto operator()() -> std::vector<meta::ip_t> {
     auto &meta_core = meta_core_ref.get();
     const auto &stripe_meta = *stripe_meta_ref.get();
@@ -443,10 +460,11 @@ struct ReadBlob {
       err::Unreachable();
     }
     for (std::size_t i = 0; i < command_list.size(); i++) {
-      const auto &commands = command_list.at(i);
+      auto &commands = command_list.at(i);
       const auto &ips = ip_list.at(i);
       for (std::size_t j = 0; j < commands.size(); j++) {
-        const auto &cmd = commands.at(j);
+        auto &cmd = commands.at(j);
+        cmd.setAckTag(ack_tag);
         comm_ref.get().push_to(ips.at(j), cmd);
         {
           DLOG(INFO) << fmt::format("{} stripe {} chunk {}, size {}, ip {}",
@@ -465,11 +483,16 @@ struct ReadBlob {
   std::shared_ptr<const meta::StripeMeta> stripe_meta_ref;
   std::reference_wrapper<meta::MetaCore> meta_core_ref;
   std::reference_wrapper<comm::CommManager> comm_ref;
+  /// tells the acks of this read apart from those of concurrent ones, the
+  /// workers ack to the shared list if it is empty
+  std::string ack_tag{};
 };
 
 struct DegradeReadBlob {
+  /// # Return
+  /// the workers to wait for and the ack lists they ack to
   [[nodiscard("wait for ack")]] auto
-  operator()() -> std::vector<std::pair<meta::ip_t, std::string_view>> {
+  operator()() -> std::vector<std::pair<meta::ip_t, std::string>> {
     auto &meta_core = meta_core_ref.get();
     const auto &stripe_meta = *stripe_meta_ref.get();
     auto pg_id = meta_core.select_pg(blob_meta.stripe_id);
@@ -480,7 +503,10 @@ struct DegradeReadBlob {
     auto command_list = std::vector<std::vector<BlockCommand>>{};
     auto ip_list =
         std::vector<std::pair<std::vector<meta::ip_t>, std::string_view>>{};
-    auto ack_ip_list = std::vector<std::pair<meta::ip_t, std::string_view>>{};
+    auto ack_ip_list = std::vector<std::pair<meta::ip_t, std::string>>{};
+    auto ack_list_name = [this](std::string_view key) {
+      return comm::make_ack_list_name(key, ack_tag);
+    };
     auto blob_range_start = blob_meta.offset;
     auto blob_range_end = blob_meta.offset + blob_meta.size;
     switch (stripe_meta.blob_layout) {
@@ -517,7 +543,8 @@ struct DegradeReadBlob {
                   .ipList = ipList,
               }
                   .build();
-          ack_ip_list.emplace_back(ips.back(), comm::REPAIR_ACK_LIST_KEY);
+          ack_ip_list.emplace_back(ips.back(),
+                                   ack_list_name(comm::REPAIR_ACK_LIST_KEY));
           command_list.emplace_back(std::move(commands));
           ip_list.emplace_back(std::move(ips), comm::REPAIR_ACK_LIST_KEY);
         }
@@ -535,7 +562,8 @@ struct DegradeReadBlob {
                   .ipList = ipList,
               }
                   .build();
-          ack_ip_list.emplace_back(ips.back(), comm::READ_ACK_LIST_KEY);
+          ack_ip_list.emplace_back(ips.back(),
+                                   ack_list_name(comm::READ_ACK_LIST_KEY));
           command_list.emplace_back(std::move(commands));
           ip_list.emplace_back(std::move(ips), comm::READ_ACK_LIST_KEY);
         }
@@ -562,7 +590,8 @@ struct DegradeReadBlob {
                   .diskList = diskList,
                   .ipList = ipList}
                   .build();
-          ack_ip_list.emplace_back(ips.back(), comm::REPAIR_ACK_LIST_KEY);
+          ack_ip_list.emplace_back(ips.back(),
+                                   ack_list_name(comm::REPAIR_ACK_LIST_KEY));
           command_list.emplace_back(std::move(commands));
           ip_list.emplace_back(std::move(ips), comm::REPAIR_ACK_LIST_KEY);
         }
@@ -593,7 +622,8 @@ struct DegradeReadBlob {
                                             .diskList = diskList,
                                             .ipList = ipList}
                   .build();
-          ack_ip_list.emplace_back(ips.back(), comm::READ_ACK_LIST_KEY);
+          ack_ip_list.emplace_back(ips.back(),
+                                   ack_list_name(comm::READ_ACK_LIST_KEY));
           command_list.emplace_back(std::move(commands));
           ip_list.emplace_back(std::move(ips), comm::READ_ACK_LIST_KEY);
         }
@@ -606,10 +636,11 @@ struct DegradeReadBlob {
       err::Unreachable();
     }
     for (std::size_t i = 0; i < command_list.size(); i++) {
-      const auto &commands = command_list.at(i);
+      auto &commands = command_list.at(i);
       const auto &ips = ip_list.at(i);
       for (std::size_t j = 0; j < commands.size(); j++) {
-        const auto &cmd = commands.at(j);
+        auto &cmd = commands.at(j);
+        cmd.setAckTag(ack_tag);
         auto &[ip, key] = ips;
         comm_ref.get().push_to(ip.at(j), cmd);
         {
@@ -629,30 +660,410 @@ struct DegradeReadBlob {
   std::shared_ptr<const meta::StripeMeta> stripe_meta_ref;
   std::reference_wrapper<meta::MetaCore> meta_core_ref;
   std::reference_wrapper<comm::CommManager> comm_ref;
+  /// tells the acks of this degraded read apart from those of concurrent
+  /// ones, the workers ack to the shared lists if it is empty
+  std::string ack_tag{};
+};
+
+/// register a stripe and distribute its chunks to the workers of its PG
+struct StoreStripe {
+  /// # Return
+  /// the bytes distributed
+  /// # Note
+  /// the stripe id is abandoned if the stripe fails before it is registered,
+  /// a registered stripe is committed or abandoned by the meta core, see
+  /// `meta::MetaCore::abandonStripe`
+  auto operator()() const -> std::size_t {
+    auto registered = std::future<meta::stripe_id_t>{};
+    try {
+      registered = register_meta();
+      auto size = distribute();
+      // the meta data is committed in the background meanwhile
+      registered.get();
+      return size;
+    } catch (...) {
+      if (registered.valid()) {
+        registered.wait();
+      } else {
+        meta_core_ref.get().abandonStripe(stripe_id);
+      }
+      throw;
+    }
+  }
+
+  meta::stripe_id_t stripe_id;
+  std::vector<meta::BlobMeta> blobs;
+  /// pooled chunk buffers, handed to the transport without a copy
+  std::vector<util::SharedVec> stripe;
+  meta::EcType ec_type;
+  meta::BlobLayout blob_layout;
+  /// the merge sizes of the stripe, recorded if chosen adaptively
+  meta::StripeTuning tuning;
+  meta::ec_param_t k;
+  meta::ec_param_t m;
+  std::reference_wrapper<meta::MetaCore> meta_core_ref;
+  std::reference_wrapper<comm::CommManager> comm_ref;
+  /// tells the acks of this stripe apart from those of concurrent ones, the
+  /// workers ack to the shared list if it is empty
+  std::string ack_tag{};
+
+private:
+  auto register_meta() const -> std::future<meta::stripe_id_t> {
+    auto &meta_core = meta_core_ref.get();
+    auto chunk_size = stripe.front().size();
+    // map this stripe to a pg
+    auto pg_id = meta_core.select_pg(stripe_id);
+    // register the stripe meta data
+    std::vector<meta::ChunkMeta> chunk_meta{};
+    chunk_meta.reserve(k + m);
+    for (meta::ec_param_t i = 0; i < k + m; i++) {
+      chunk_meta.emplace_back(meta::ChunkMeta{
+          .stripe_id = stripe_id,
+          .chunk_index = boost::numeric_cast<meta::chunk_index_t>(i),
+          .size = chunk_size,
+      });
+    }
+    auto stripe_meta_record = meta::StripeMetaRecord{};
+    stripe_meta_record.setStripeId(stripe_id)
+        .setBlobs(blobs)
+        .setChunks(std::move(chunk_meta))
+        .setChunkSize(chunk_size)
+        .setEcKM(k, m)
+        .setPG(pg_id)
+        .setBlobLayout(blob_layout)
+        .setEcType(ec_type);
+    if (tuning.epoch != 0) {
+      stripe_meta_record.setTuning(tuning);
+    }
+    return meta_core.registerStripe(std::move(stripe_meta_record));
+  }
+
+  /// # Return
+  /// the bytes distributed
+  auto distribute() const -> std::size_t {
+    auto &meta_core = meta_core_ref.get();
+    auto &comm = comm_ref.get();
+    // distribute the stripe data
+    const auto &placement = meta_core.placement(meta_core.select_pg(stripe_id));
+    const auto &distIpList = placement.ips;
+    const auto &diskList = placement.disks;
+    auto size = std::size_t{0};
+    for (std::size_t i = 0; i < stripe.size(); i++) {
+      std::string listName =
+          comm::make_list_name(stripe_id, i, stripe.at(i).size());
+      const auto &chunk = stripe.at(i);
+      comm.push_to(distIpList.at(i), listName, chunk);
+      size += chunk.size();
+      auto cmd = BlockCommand();
+      cmd.buildType2(boost::numeric_cast<BlockCommand::block_id_t>(i),
+                     stripe_id,
+                     diskList.at(i),
+                     {distIpList.at(i)},
+                     {boost::numeric_cast<BlockCommand::block_id_t>(i)},
+                     0,
+                     stripe.at(i).size(),
+                     k,
+                     m);
+      cmd.setAckTag(ack_tag);
+      comm.push_to(distIpList.at(i), cmd);
+    }
+    const auto ack_list_name =
+        comm::make_ack_list_name(comm::BUILD_ACK_LIST_KEY, ack_tag);
+    for (std::size_t i = 0; i < static_cast<std::size_t>(k + m); i++) {
+      auto ack = comm.pop_from(distIpList.at(i), ack_list_name);
+      if (ack.as_cstr() != comm::ACK_PAYLOAD) {
+        LOG(ERROR) << fmt::format("ack error: {}", ack.as_cstr()) << std::endl;
+      }
+    }
+    return size;
+  }
+};
+
+/// runs the operations of a replay, shared by the threads of its pool
+class ReplayRunner {
+  using clock_type = std::chrono::steady_clock;
+
+  const Profile &profile_;
+  std::reference_wrapper<meta::MetaCore> meta_core_ref_;
+  std::reference_wrapper<comm::CommManager> comm_ref_;
+  std::reference_wrapper<replay::LatencyRecorder> latency_ref_;
+  /// the costs of the reads by EC type, for the adaptive sizes
+  std::reference_wrapper<trace::stripe_stream::adaptive::CostLog> costs_ref_;
+  /// the encoders of the writes, one per thread at most
+  std::mutex encoders_mtx_{};
+  std::vector<ec::encoder_ptr> encoders_{};
+  /// numbers the operations, so that each waits for its own acks only
+  std::atomic<std::uint64_t> next_op_{0};
+
+  auto next_ack_tag() -> std::string {
+    return fmt::format("replay{}",
+                       next_op_.fetch_add(1, std::memory_order_relaxed));
+  }
+
+  auto acquire_encoder() -> ec::encoder_ptr {
+    {
+      auto lock = std::unique_lock{encoders_mtx_};
+      if (!encoders_.empty()) {
+        auto encoder = std::move(encoders_.back());
+        encoders_.pop_back();
+        return encoder;
+      }
+    }
+    return ec::make_encoder(profile_.ec_type,
+                            profile_.ec_k,
+                            profile_.ec_m,
+                            profile_.clay_parallel_planes);
+  }
+
+  auto release_encoder(ec::encoder_ptr encoder) -> void {
+    auto lock = std::unique_lock{encoders_mtx_};
+    encoders_.push_back(std::move(encoder));
+  }
+
+  /// # Return
+  /// false if the blob is not built
+  auto read(const replay::Op &op, bool degraded) -> bool {
+    auto &meta_core = meta_core_ref_.get();
+    auto &comm = comm_ref_.get();
+    auto blob_meta = meta::BlobMeta{};
+    try {
+      blob_meta = meta_core.blob_meta(op.blob_id);
+    } catch (const meta::NotFound &) {
+      return false;
+    }
+    auto stripe_meta_ref = meta_core.stripe_meta(blob_meta.stripe_id);
+    auto ack_tag = next_ack_tag();
+    auto started = clock_type::now();
+    if (degraded) {
+      auto ack_list = DegradeReadBlob{.blob_meta = blob_meta,
+                                      .stripe_meta_ref = stripe_meta_ref,
+                                      .meta_core_ref = meta_core_ref_,
+                                      .comm_ref = comm_ref_,
+                                      .ack_tag = ack_tag}();
+      for (const auto &[ip, ack_list_name] : ack_list) {
+        auto ack = comm.pop_from(ip, ack_list_name);
+        if (ack.as_cstr() != comm::ACK_PAYLOAD) {
+          LOG(ERROR) << fmt::format("ack error: {}", ack.as_cstr())
+                     << std::endl;
+        }
+      }
+    } else {
+      auto ack_list = ReadBlob{.blob_meta = blob_meta,
+                               .stripe_meta_ref = stripe_meta_ref,
+                               .meta_core_ref = meta_core_ref_,
+                               .comm_ref = comm_ref_,
+                               .ack_tag = ack_tag}();
+      const auto ack_list_name =
+          comm::make_ack_list_name(comm::READ_ACK_LIST_KEY, ack_tag);
+      for (const auto &ip : ack_list) {
+        auto ack = comm.pop_from(ip, ack_list_name);
+        if (ack.as_cstr() != comm::ACK_PAYLOAD) {
+          LOG(ERROR) << fmt::format("ack error: {}", ack.as_cstr())
+                     << std::endl;
+        }
+      }
+    }
+    // a degraded read decodes the data of the stripe
+    const auto &stripe_meta = *stripe_meta_ref;
+    costs_ref_.get().record(
+        degraded ? trace::stripe_stream::adaptive::CostKind::DegradeRead
+                 : trace::stripe_stream::adaptive::CostKind::Read,
+        stripe_meta.ec_type,
+        degraded ? stripe_meta.k * stripe_meta.chunk_size : blob_meta.size,
+        std::chrono::duration<double, std::micro>(clock_type::now() - started)
+            .count());
+    return true;
+  }
+
+  /// the blob is encoded and stored as a stripe of its own
+  auto write(const replay::Op &op) -> void {
+    auto encoder = acquire_encoder();
+    auto item = trace::stripe_stream::StripeStreamItem{};
+    try {
+      item = trace::stripe_stream::baseline::encode_merge(
+          *encoder,
+          {meta::BlobMeta{.blob_id = op.blob_id, .size = op.size}},
+          util::GatherList{trace::make_payload(op.blob_id, op.size)});
+    } catch (...) {
+      release_encoder(std::move(encoder));
+      throw;
+    }
+    release_encoder(std::move(encoder));
+    auto [blobs, stripe, ec_type, blob_layout, tuning] = std::move(item);
+    auto stripe_id = meta_core_ref_.get().next_stripe_id();
+    StoreStripe{.stripe_id = stripe_id,
+                .blobs = std::move(blobs),
+                .stripe = std::move(stripe),
+                .ec_type = ec_type,
+                .blob_layout = blob_layout,
+                .tuning = tuning,
+                .k = profile_.ec_k,
+                .m = profile_.ec_m,
+                .meta_core_ref = meta_core_ref_,
+                .comm_ref = comm_ref_,
+                .ack_tag = next_ack_tag()}();
+  }
+
+public:
+  ReplayRunner(const Profile &profile, meta::MetaCore &meta_core,
+               comm::CommManager &comm, replay::LatencyRecorder &latency,
+               trace::stripe_stream::adaptive::CostLog &costs)
+      : profile_{profile}, meta_core_ref_{meta_core}, comm_ref_{comm},
+        latency_ref_{latency}, costs_ref_{costs} {}
+
+  /// run `op`, due at `scheduled`, and record its latency
+  auto run(const replay::Op &op, clock_type::time_point scheduled) -> void {
+    auto &latency = latency_ref_.get();
+    auto started = clock_type::now();
+    try {
+      auto found = true;
+      switch (op.kind) {
+      case replay::OpKind::Read:
+        found = read(op, false);
+        break;
+      case replay::OpKind::DegradeRead:
+        found = read(op, true);
+        break;
+      case replay::OpKind::Write:
+        write(op);
+        break;
+      }
+      if (!found) {
+        latency.missing(op.kind);
+        return;
+      }
+      latency.record(op.kind, scheduled, started, clock_type::now(), op.size);
+    } catch (std::exception &e) {
+      LOG(ERROR) << fmt::format("{} of blob {} failed: {}",
+                                op.kind,
+                                op.blob_id,
+                                e.what())
+                 << std::endl;
+      latency.failed(op.kind);
+    }
+  }
 };
+
+/// the first access of each blob of the trace of `profile`, stepped by
+/// `step_by`, or of its synthetic workload, which is not stepped
+/// # Note
+/// `dedup` is set to the dedup stage, if the trace is not mapped
+auto open_build_trace(const Profile &profile, std::size_t step_by,
+                      const trace::DedupTraceReader *&dedup)
+    -> trace::TraceReaderPtr {
+  auto budget = profile.dedup_budget_mb << 20U;
+  if (profile.synthetic.has_value()) {
+    // the reads of the written blobs are dropped
+    auto deduped = std::make_unique<trace::DedupTraceReader>(
+        std::make_unique<trace::SynthTraceReader>(profile.synthetic.value()),
+        budget);
+    dedup = deduped.get();
+    return deduped;
+  }
+  return trace::make_azure_trace(profile.trace, step_by, budget, &dedup);
+}
+
+/// add the costs an action measured to the cost file of the adaptive sizes,
+/// if there is one
+auto save_costs(const Profile &profile,
+                trace::stripe_stream::adaptive::CostLog &costs) -> void {
+  if (!profile.adaptive.has_value() || profile.adaptive->cost_file.empty()) {
+    return;
+  }
+  const auto &cost_file = profile.adaptive->cost_file;
+  try {
+    costs.load(cost_file);
+    costs.save(cost_file);
+    LOG(INFO) << fmt::format("adaptive costs saved to {}",
+                             cost_file.generic_string())
+              << std::endl;
+  } catch (std::exception &e) {
+    LOG(ERROR) << fmt::format("failed to save the adaptive costs: {}",
+                              e.what())
+               << std::endl;
+  }
+}
+
+/// every record of the trace of `profile`, or of its synthetic workload
+auto open_replay_trace(const Profile &profile) -> trace::TraceReaderPtr {
+  if (profile.synthetic.has_value()) {
+    return std::make_unique<trace::SynthTraceReader>(
+        profile.synthetic.value());
+  }
+  return trace::make_replay_trace(profile.trace);
+}
 } // namespace
 
 auto coord::Coordinator::build_data() -> BuildDataResult {
   auto &profile = *profile_.get();
+  trace::set_payload_config({.entropy = profile.payload_entropy,
+                             .seed = trace::DEFAULT_PAYLOAD.seed});
   // open trace and pre-paremerge scheme
   std::unique_ptr<trace::stripe_stream::StripeStreamInterface> stripe_stream{};
+  // owned by stripe_stream, for the merge buffer report
+  const trace::stripe_stream::hybrid::InterLocality *inter_locality{nullptr};
+  // owned by stripe_stream, for the adaptive sizes report
+  const trace::stripe_stream::adaptive::SizeController *size_controller{
+      nullptr};
   constexpr std::size_t TRACE_STEP_BY{256};
-  auto trace_reader = trace::make_azure_trace(profile.trace, TRACE_STEP_BY);
-  if (profile.merge_scheme == MergeScheme::Fixed) {
+  // owned by stripe_stream, for the dedup report
+  const trace::DedupTraceReader *dedup{nullptr};
+  auto trace_reader = open_build_trace(profile, TRACE_STEP_BY, dedup);
+  auto new_encoder = [&profile](meta::EcType ec_type) {
+    return ec::make_encoder(
+        ec_type, profile.ec_k, profile.ec_m, profile.clay_parallel_planes);
+  };
+  const auto pipelined = profile.pipeline_depth != 0;
+  const auto degrade_read =
+      profile.merge_scheme == MergeScheme::InterForDegradeRead ||
+      profile.merge_scheme == MergeScheme::IntraForDegradeRead;
+  const auto parallel_encoded =
+      pipelined && (profile.merge_scheme == MergeScheme::Fixed ||
+                    (profile.merge_scheme == MergeScheme::Baseline &&
+                     !profile.stream_encode));
+  if (pipelined && !degrade_read) {
+    trace_reader = std::make_unique<trace::pipeline::PrefetchTraceReader>(
+        std::move(trace_reader), profile.pipeline_depth);
+  }
+  // merge on a stage thread and encode on the encode threads
+  auto parallel_encode =
+      [&](trace::blob_stream::MergeStreamInterfacePtr merge_stream) {
+        return std::make_unique<trace::pipeline::ParallelEncodeStream>(
+            std::make_unique<trace::pipeline::PrefetchMergeStream>(
+                std::move(merge_stream), profile.pipeline_depth),
+            [&] { return new_encoder(profile.ec_type); },
+            profile.encode_threads,
+            profile.pipeline_depth);
+      };
+  if (parallel_encoded && profile.merge_scheme == MergeScheme::Fixed) {
+    stripe_stream = parallel_encode(
+        std::make_unique<trace::blob_stream::FixedSizeMergeStream>(
+            std::move(trace_reader), profile.merge_size));
+  } else if (parallel_encoded) {
+    stripe_stream =
+        parallel_encode(std::make_unique<trace::blob_stream::BasicMergeStream>(
+            std::move(trace_reader), profile.merge_size));
+  } else if (profile.merge_scheme == MergeScheme::Fixed) {
     auto stream =
         std::make_unique<trace::stripe_stream::baseline::StripeStream>();
-    stream->set_encoder(
-        ec::make_encoder(profile.ec_type, profile.ec_k, profile.ec_m));
+    stream->set_encoder(new_encoder(profile.ec_type));
     auto blobs = trace::blob_stream::MergeStreamInterfacePtr{
         std::make_unique<trace::blob_stream::FixedSizeMergeStream>(
             std::move(trace_reader), profile.merge_size)};
     stream->set_merge_stream(std::move(blobs));
     stripe_stream = std::move(stream);
+  } else if (profile.merge_scheme == MergeScheme::Baseline &&
+             profile.stream_encode) {
+    stripe_stream = std::make_unique<trace::stripe_stream::hybrid::Streaming>(
+        std::move(trace_reader),
+        profile.merge_size,
+        new_encoder(profile.ec_type),
+        new_encoder(profile.ec_type),
+        meta::BlobLayout::Horizontal);
   } else if (profile.merge_scheme == MergeScheme::Baseline) {
     auto stream =
         std::make_unique<trace::stripe_stream::baseline::StripeStream>();
-    stream->set_encoder(
-        ec::make_encoder(profile.ec_type, profile.ec_k, profile.ec_m));
+    stream->set_encoder(new_encoder(profile.ec_type));
     stream->set_merge_stream(
         std::make_unique<trace::blob_stream::BasicMergeStream>(
             std::move(trace_reader), profile.merge_size));
@@ -661,46 +1072,90 @@ auto coord::Coordinator::build_data() -> BuildDataResult {
     auto stream =
         std::make_unique<trace::stripe_stream::partition::StripeStream>(
             profile.partition_size);
-    stream->set_large_blob_encoder(
-        ec::make_encoder(meta::EcType::CLAY, profile.ec_k, profile.ec_m));
-    stream->set_small_blob_encoder(
-        ec::make_encoder(meta::EcType::RS, profile.ec_k, profile.ec_m));
+    stream->set_large_blob_encoder(new_encoder(meta::EcType::CLAY));
+    stream->set_small_blob_encoder(new_encoder(meta::EcType::RS));
     stream->set_merge_stream(
         std::make_unique<trace::blob_stream::BasicMergeStream>(
             std::move(trace_reader), profile.merge_size));
+    if (profile.adaptive.has_value()) {
+      auto measured = trace::stripe_stream::adaptive::CostLog{};
+      try {
+        measured.load(profile.adaptive->cost_file);
+      } catch (std::runtime_error &e) {
+        // nothing is loaded, the sizes are chosen on the modeled costs
+        LOG(ERROR) << fmt::format("failed to load the adaptive costs: {}",
+                                  e.what())
+                   << std::endl;
+      }
+      stream->set_size_controller(
+          std::make_unique<trace::stripe_stream::adaptive::SizeController>(
+              profile.adaptive.value(),
+              profile.ec_k,
+              profile.ec_m,
+              profile.partition_size,
+              profile.merge_size,
+              measured));
+      size_controller = stream->size_controller();
+    }
     stripe_stream = std::move(stream);
+  } else if (profile.merge_scheme == MergeScheme::IntraLocality &&
+             profile.stream_encode) {
+    stripe_stream = std::make_unique<trace::stripe_stream::hybrid::Streaming>(
+        std::move(trace_reader),
+        profile.merge_size,
+        new_encoder(meta::EcType::CLAY),
+        new_encoder(meta::EcType::NSYS),
+        meta::BlobLayout::Vertical);
   } else if (profile.merge_scheme == MergeScheme::IntraLocality) {
     auto stream =
         std::make_unique<trace::stripe_stream::hybrid::SplitBeforeMerge>(
             std::move(trace_reader),
             profile.merge_size,
-            ec::make_encoder(meta::EcType::CLAY, profile.ec_k, profile.ec_m),
-            ec::make_encoder(meta::EcType::NSYS, profile.ec_k, profile.ec_m));
+            new_encoder(meta::EcType::CLAY),
+            new_encoder(meta::EcType::NSYS));
     stripe_stream = std::move(stream);
   } else if (profile.merge_scheme == MergeScheme::InterLocality) {
     auto stream = std::make_unique<trace::stripe_stream::hybrid::InterLocality>(
         std::move(trace_reader),
         profile.merge_size,
-        ec::make_encoder(meta::EcType::CLAY, profile.ec_k, profile.ec_m),
-        ec::make_encoder(meta::EcType::NSYS, profile.ec_k, profile.ec_m),
-        profile.merge_size);
+        new_encoder(meta::EcType::CLAY),
+        new_encoder(meta::EcType::NSYS),
+        profile.merge_size,
+        trace::blob_stream::MergeBufferLimits{
+            .budget = profile.merge_buffer_budget_mb << 20U,
+            .max_age = profile.merge_buffer_max_age});
+    inter_locality = stream.get();
     stripe_stream = std::move(stream);
+  } else if (profile.merge_scheme == MergeScheme::InterForDegradeRead &&
+             profile.synthetic.has_value()) {
+    stripe_stream =
+        std::make_unique<trace::stripe_stream::degrade_read::InterLocality>(
+            new_encoder(profile.ec_type),
+            profile.chunk_size * profile.ec_k,
+            std::move(trace_reader));
   } else if (profile.merge_scheme == MergeScheme::InterForDegradeRead) {
     stripe_stream =
         std::make_unique<trace::stripe_stream::degrade_read::InterLocality>(
-            ec::make_encoder(profile.ec_type, profile.ec_k, profile.ec_m),
+            new_encoder(profile.ec_type),
             profile.chunk_size * profile.ec_k,
             profile.blob_size);
   } else if (profile.merge_scheme == MergeScheme::IntraForDegradeRead) {
     stripe_stream =
         std::make_unique<trace::stripe_stream::degrade_read::IntraLocality>(
-            ec::make_encoder(profile.ec_type, profile.ec_k, profile.ec_m),
+            new_encoder(profile.ec_type),
             profile.chunk_size * profile.ec_k);
   } else {
     throw std::invalid_argument("Unsupported merge scheme");
   }
+  if (pipelined && !parallel_encoded) {
+    // the scheme merges and encodes in one step, run it on a stage thread
+    stripe_stream = std::make_unique<trace::pipeline::PrefetchStripeStream>(
+        std::move(stripe_stream), profile.pipeline_depth);
+  }
 
   // build data and store
+  const auto pool_before = util::chunk_pool().stats();
+  const auto copied_before = ec::encoder::copied_bytes();
   std::size_t load_cnt{0};
   std::size_t stripe_cnt{profile.start_at};
   std::atomic_size_t total_size{0};
@@ -721,6 +1176,8 @@ auto coord::Coordinator::build_data() -> BuildDataResult {
       }
     }
   };
+  // a crash before the first periodic checkpoint recovers from this one
+  meta_core_.checkpoint();
   while (load_cnt < profile.test_load) {
     auto item = trace::stripe_stream::StripeStreamItem{};
     try {
@@ -735,7 +1192,7 @@ auto coord::Coordinator::build_data() -> BuildDataResult {
         throw;
       }
     }
-    auto [blobs, stripe, ec_type, blob_layout] = std::move(item);
+    auto [blobs, stripe, ec_type, blob_layout, tuning] = std::move(item);
     auto stripe_id = meta_core_.next_stripe_id();
     stripe_cnt++;
     auto stripe_size = std::accumulate(
@@ -748,88 +1205,36 @@ auto coord::Coordinator::build_data() -> BuildDataResult {
     stat.count++;
     stat.size += stripe_size;
 
-    auto task = [this,
-                 stripe_id,
-                 blobs = std::move(blobs),
-                 stripe = std::move(stripe),
-                 ec_type,
-                 blob_layout,
-                 &total_size]() {
-      auto &profile = *profile_.get();
-      auto chunk_size = stripe.front().size();
-      // map this stripe to a pg
-      auto pg_id = meta_core_.select_pg(stripe_id);
-      // register the stripe meta data
-      std::vector<meta::ChunkMeta> chunk_meta{};
-      chunk_meta.reserve(profile.ec_k + profile.ec_m);
-      for (meta::ec_param_t i = 0; i < profile.ec_k + profile.ec_m; i++) {
-        chunk_meta.emplace_back(meta::ChunkMeta{
-            .stripe_id = stripe_id,
-            .chunk_index = boost::numeric_cast<meta::chunk_index_t>(i),
-            .size = chunk_size,
-        });
-      }
-      auto stripe_meta_record = meta::StripeMetaRecord{};
-      stripe_meta_record.setStripeId(stripe_id)
-          .setBlobs(blobs)
-          .setChunks(std::move(chunk_meta))
-          .setChunkSize(chunk_size)
-          .setEcKM(profile.ec_k, profile.ec_m)
-          .setPG(pg_id)
-          .setBlobLayout(blob_layout)
-          .setEcType(ec_type);
-      meta_core_.registerStripe(std::move(stripe_meta_record));
-      // distribute the stripe data
-      auto workers = meta_core_.pg_to_worker_nodes(pg_id);
-      auto distIpList = std::vector<meta::ip_t>{};
-      std::transform(workers.cbegin(),
-                     workers.cend(),
-                     std::back_inserter(distIpList),
-                     [&meta_core_ = this->meta_core_](auto worker_id) {
-                       return meta_core_.worker_ip(worker_id);
-                     });
-      std::vector<meta::disk_id_t> diskList = meta_core_.pg_to_disks(pg_id);
-      for (std::size_t i = 0; i < stripe.size(); i++) {
-        std::string listName =
-            comm::make_list_name(stripe_id, i, stripe.at(i).size());
-        const auto &chunk = stripe.at(i);
-        comm_.push_to(distIpList.at(i), listName, chunk);
-        total_size += chunk.size();
-        auto cmd = BlockCommand();
-        cmd.buildType2(boost::numeric_cast<BlockCommand::block_id_t>(i),
-                       stripe_id,
-                       diskList.at(i),
-                       {distIpList.at(i)},
-                       {boost::numeric_cast<BlockCommand::block_id_t>(i)},
-                       0,
-                       stripe.at(i).size(),
-                       profile.ec_k,
-                       profile.ec_m);
-        comm_.push_to(distIpList.at(i), cmd);
-        // LOG(INFO) << fmt::format(
-        //                  "build stripe {} chunk {}, size {},to {}, ec_type:
-        //                  {}", stripe_id, i, stripe.at(i).size(),
-        //                  distIpList.at(i),
-        //                  ec_type)
-        //           << std::endl;
-      }
-      for (std::size_t i = 0; i < (profile.ec_k + profile.ec_m); i++) {
-        auto ack = comm_.pop_from(distIpList.at(i), comm::BUILD_ACK_LIST_KEY);
-        if (ack.as_cstr() != comm::ACK_PAYLOAD) {
-          LOG(ERROR) << fmt::format("ack error: {}", ack.as_cstr())
-                     << std::endl;
-        }
-        // LOG(INFO) << fmt::format("ack received from: {}", distIpList.at(i))
-        //           << std::endl;
-      }
-    };
-    future_queue.emplace(task_pool.submit_task(task));
+    auto task = [store = StoreStripe{.stripe_id = stripe_id,
+                                     .blobs = std::move(blobs),
+                                     .stripe = std::move(stripe),
+                                     .ec_type = ec_type,
+                                     .blob_layout = blob_layout,
+                                     .tuning = tuning,
+                                     .k = profile.ec_k,
+                                     .m = profile.ec_m,
+                                     .meta_core_ref = std::ref(meta_core_),
+                                     .comm_ref = std::ref(comm_)},
+                 &total_size]() { total_size += store(); };
+    // moved, the stripe is never copied on its way to the transport
+    future_queue.emplace(task_pool.submit_task(std::move(task)));
     if (profile.load_type == LoadType::ByStripe) {
       load_cnt++;
     } else {
       load_cnt += stripe_size;
     }
     wait_ack();
+    if (profile.meta_checkpoint_interval != 0 &&
+        (stripe_cnt - profile.start_at) % profile.meta_checkpoint_interval ==
+            0) {
+      auto checkpoint = meta_core_.checkpoint();
+      LOG(INFO) << fmt::format("meta checkpoint {}: replay from stripe {}, "
+                               "{} stripes committed above",
+                               checkpoint.sequence,
+                               checkpoint.replay_from,
+                               checkpoint.committed_above.size())
+                << std::endl;
+    }
     constexpr std::size_t LOG_INTERVAL = 100;
     if (load_cnt % LOG_INTERVAL == 0) {
       LOG(INFO) << fmt::format("stripe num: {}; cur size: {}GB;",
@@ -844,6 +1249,69 @@ auto coord::Coordinator::build_data() -> BuildDataResult {
             << std::endl;
   wait_ack(0);
   LOG(INFO) << "All ack received" << std::endl;
+  {
+    auto commit = meta_core_.commitStats();
+    LOG(INFO) << fmt::format("meta commit: {} stripes in {} groups;",
+                             commit.stripes,
+                             commit.groups)
+              << std::endl;
+    auto pool_after = util::chunk_pool().stats();
+    auto stripes = static_cast<double>(
+        std::max<std::size_t>(stripe_cnt - profile.start_at, 1));
+    LOG(INFO) << fmt::format(
+                     "per stripe: {:.2f} chunk allocations, {:.2f} chunk "
+                     "reuses, {:.0f}B copied by the encoders;",
+                     static_cast<double>(pool_after.allocations -
+                                         pool_before.allocations) /
+                         stripes,
+                     static_cast<double>(pool_after.reuses -
+                                         pool_before.reuses) /
+                         stripes,
+                     static_cast<double>(ec::encoder::copied_bytes() -
+                                         copied_before) /
+                         stripes)
+              << std::endl;
+  }
+  if (inter_locality != nullptr) {
+    auto buffers = inter_locality->merge_buffer_stats();
+    auto histogram = std::string{};
+    for (auto merges : buffers.fill_histogram) {
+      histogram += fmt::format(" {}", merges);
+    }
+    LOG(INFO) << fmt::format(
+                     "merge buffers: {}MB resident, {}MB at peak; flushed {} "
+                     "full, {} over budget, {} by age, {} handed to "
+                     "split-before-merge; merges by tenths of fill:{}",
+                     buffers.resident_bytes >> 20U,
+                     buffers.peak_resident_bytes >> 20U,
+                     buffers.full_flushes,
+                     buffers.budget_flushes,
+                     buffers.age_flushes,
+                     buffers.handed_over,
+                     histogram)
+              << std::endl;
+  }
+  if (size_controller != nullptr) {
+    auto tuning = size_controller->tuning();
+    LOG(INFO) << fmt::format("adaptive sizes: {} epochs, ended at "
+                             "partition_size {}, merge_size {}",
+                             tuning.epoch,
+                             tuning.partition_size,
+                             tuning.merge_size)
+              << std::endl;
+  }
+  if (dedup != nullptr) {
+    auto stats = dedup->stats();
+    LOG(INFO) << fmt::format("dedup: {} blobs, {}MB, {}",
+                             stats.tracked,
+                             stats.bytes >> 20U,
+                             stats.approximate
+                                 ? fmt::format("approximate, false positive "
+                                               "rate {:.2e}",
+                                               stats.false_positive_rate)
+                                 : std::string{"exact"})
+              << std::endl;
+  }
   google::FlushLogFiles(google::GLOG_INFO);
   task_pool.wait();
   return {.stripe_stat = std::move(stripe_stat),
@@ -880,7 +1348,7 @@ auto coord::Coordinator::repair_chunk() -> void {
         meta_core_.pg_to_worker_nodes(meta_core_.select_pg(stripe_id))
             .at(failed_chunk.chunk_index);
     auto ack_ip = RepairChunk{
-        .stripe_meta = std::move(stripe_meta),
+        .stripe_meta_ref = std::move(stripe_meta),
         .failed_chunk = failed_chunk,
         .meta_core_ref = std::ref(meta_core_),
         .comm_ref = std::ref(comm_),
@@ -914,30 +1382,53 @@ auto coord::Coordinator::repair_failure_domain() -> RepairResult {
     }
   };
   std::atomic<std::size_t> total_size{0};
+  std::once_flag first_command{};
+  auto time_to_first_command = std::chrono::milliseconds{0};
+  auto costs = trace::stripe_stream::adaptive::CostLog{};
   for (auto const &repair : repair_meta) {
     const auto pg = repair.pg;
     const auto pg_id = pg.pg_id;
     const auto chunk_index = repair.chunk_index;
     const auto &diskList = meta_core_.pg_to_disks(pg.pg_id);
-    const auto &stripes = repair.stripe_list;
+    // the other PGs may still be loading meanwhile
+    const auto stripes = meta_core_.pgStripes(pg_id);
     for (auto stripe_id : stripes) {
-      auto task = [this, stripe_id, chunk_index, pg_id, &total_size]() {
+      auto task = [this,
+                   stripe_id,
+                   chunk_index,
+                   pg_id,
+                   &total_size,
+                   &first_command,
+                   &time_to_first_command,
+                   &costs]() {
         auto failed_chunk = meta::chunk_id_t{.stripe_id = stripe_id,
                                              .chunk_index = chunk_index};
         auto stripe_repair = meta_core_.chunkRepair(failed_chunk);
+        auto started = std::chrono::steady_clock::now();
         auto node_id = meta_core_.pg_to_worker_nodes(pg_id).at(chunk_index);
         auto ack_ip = RepairChunk{
-            .stripe_meta = std::move(stripe_repair),
+            .stripe_meta_ref = stripe_repair,
             .failed_chunk = failed_chunk,
             .meta_core_ref = std::ref(meta_core_),
             .comm_ref = std::ref(comm_),
         }(RepairManner::Centralized);
+        std::call_once(first_command, [this, &time_to_first_command] {
+          time_to_first_command =
+              std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - launched_at_);
+        });
         auto ack = comm_.pop_from(ack_ip, comm::REPAIR_ACK_LIST_KEY);
         if (ack.as_cstr() != comm::ACK_PAYLOAD) {
           LOG(ERROR) << fmt::format("ack error: {}", ack.as_cstr())
                      << std::endl;
         }
-        total_size += stripe_repair.chunk_size;
+        total_size += stripe_repair->chunk_size;
+        costs.record(trace::stripe_stream::adaptive::CostKind::Repair,
+                     stripe_repair->ec_type,
+                     stripe_repair->k * stripe_repair->chunk_size,
+                     std::chrono::duration<double, std::micro>(
+                         std::chrono::steady_clock::now() - started)
+                         .count());
         // comm_.pop_from(const std::string_view host, const std::string_view
         // key);
       };
@@ -950,7 +1441,12 @@ auto coord::Coordinator::repair_failure_domain() -> RepairResult {
   if (!future_queue.empty()) {
     err::Unreachable();
   }
-  return {.total_size = total_size};
+  LOG(INFO) << fmt::format("time to first repair command: {} ms",
+                           time_to_first_command.count())
+            << std::endl;
+  save_costs(*profile_.get(), costs);
+  return {.total_size = total_size,
+          .time_to_first_command = time_to_first_command};
 }
 auto coord::Coordinator::read() -> ReadResult {
   std::atomic<std::size_t> total_size{0};
@@ -969,58 +1465,75 @@ auto coord::Coordinator::read() -> ReadResult {
       future_queue.pop();
     }
   };
-  // cache the last stripe to avoid reading the same stripe repeatedly
-  auto locality_stripe = std::shared_ptr<const meta::StripeMeta>{};
-  auto blob_opt = meta_core_.next_blobs_record();
-  while (blob_opt.has_value()) {
-    auto blob_meta = meta::BlobMeta{};
-    LOG(INFO) << fmt::format("reading blob id: {}", blob_opt.value())
-              << std::endl;
-    auto stripe_meta_ref = std::shared_ptr<const meta::StripeMeta>{};
+  // the blob log carries the stripe and the extent of each blob, the reads
+  // of a window are planned together once its stripes are looked up with
+  // one store snapshot
+  constexpr std::size_t PREFETCH_WINDOW = 64;
+  auto stripe_ids = std::vector<meta::stripe_id_t>{};
+  stripe_ids.reserve(PREFETCH_WINDOW);
+  while (true) {
+    auto window = std::span<const meta::BlobLogRecord>{};
+    auto stripes = std::vector<std::shared_ptr<const meta::StripeMeta>>{};
     try {
-      blob_meta = meta_core_.blob_meta(blob_opt.value());
-    } catch (meta::NotFound &e) {
-      LOG(WARNING) << fmt::format("blob {} not found", blob_opt.value())
-                   << std::endl;
-      return {.total_size = total_size.load()};
+      window = meta_core_.next_blob_records(PREFETCH_WINDOW);
+      if (window.empty()) {
+        break;
+      }
+      stripe_ids.clear();
+      for (const auto &record : window) {
+        stripe_ids.push_back(record.stripe_id);
+      }
+      stripes = meta_core_.multi_get_stripes(stripe_ids);
     } catch (std::exception &e) {
       LOG(ERROR) << fmt::format("Exception caught: {}", e.what()) << std::endl;
       return {.total_size = total_size.load()};
     }
-    blob_opt = meta_core_.next_blobs_record();
-    if (locality_stripe != nullptr &&
-        locality_stripe->stripe_id == blob_meta.stripe_id) {
-      // this blob is in the same stripe as the previous one
-      stripe_meta_ref = locality_stripe;
-    } else {
-      stripe_meta_ref = std::make_shared<meta::StripeMeta>(
-          meta_core_.stripe_meta(blob_meta.stripe_id));
-      locality_stripe = stripe_meta_ref;
-    }
-    auto task = [blob_meta,
-                 stripe_meta_ref,
-                 &total_size,
-                 &meta_core_ = this->meta_core_,
-                 &comm_ = this->comm_] {
-      auto ack_list = ReadBlob{
-          .blob_meta = blob_meta,
-          .stripe_meta_ref = stripe_meta_ref,
-          .meta_core_ref = std::ref(meta_core_),
-          .comm_ref = std::ref(comm_),
-      }();
-      for (const auto &ip : ack_list) {
-        auto ack = comm_.pop_from(ip, comm::READ_ACK_LIST_KEY);
-        if (ack.as_cstr() != comm::ACK_PAYLOAD) {
-          LOG(ERROR) << fmt::format("ack error: {}", ack.as_cstr())
+    for (std::size_t i = 0; i < window.size(); i++) {
+      auto blob_meta = window[i].blob_meta();
+      LOG(INFO) << fmt::format("reading blob id: {}", blob_meta.blob_id)
+                << std::endl;
+      auto stripe_meta_ref = std::move(stripes[i]);
+      if (stripe_meta_ref == nullptr) {
+        LOG(WARNING) << fmt::format("stripe {} of blob {} not found",
+                                    blob_meta.stripe_id,
+                                    blob_meta.blob_id)
                      << std::endl;
-        }
+        return {.total_size = total_size.load()};
       }
-      total_size += blob_meta.size;
-    };
-    future_queue.emplace(task_pool.submit_task(task));
-    wait_future();
+      auto task = [blob_meta,
+                   stripe_meta_ref,
+                   &total_size,
+                   &meta_core_ = this->meta_core_,
+                   &comm_ = this->comm_] {
+        auto ack_list = ReadBlob{
+            .blob_meta = blob_meta,
+            .stripe_meta_ref = stripe_meta_ref,
+            .meta_core_ref = std::ref(meta_core_),
+            .comm_ref = std::ref(comm_),
+        }();
+        for (const auto &ip : ack_list) {
+          auto ack = comm_.pop_from(ip, comm::READ_ACK_LIST_KEY);
+          if (ack.as_cstr() != comm::ACK_PAYLOAD) {
+            LOG(ERROR) << fmt::format("ack error: {}", ack.as_cstr())
+                       << std::endl;
+          }
+        }
+        total_size += blob_meta.size;
+      };
+      future_queue.emplace(task_pool.submit_task(task));
+      wait_future();
+    }
   }
   wait_future(0);
+  auto cache = meta_core_.cacheStats();
+  LOG(INFO) << fmt::format("meta cache: stripe {} hits / {} misses, "
+                           "blob {} hits / {} misses, {} bytes resident",
+                           cache.stripe_hits,
+                           cache.stripe_misses,
+                           cache.blob_hits,
+                           cache.blob_misses,
+                           cache.resident_bytes)
+            << std::endl;
   return {.total_size = total_size.load()};
 }
 auto coord::Coordinator::degrade_read() -> ReadResult {
@@ -1040,62 +1553,205 @@ auto coord::Coordinator::degrade_read() -> ReadResult {
       future_queue.pop();
     }
   };
-  // cache the last stripe to avoid reading the same stripe repeatedly
-  auto locality_stripe = std::shared_ptr<const meta::StripeMeta>{};
-  auto blob_opt = meta_core_.next_blobs_record();
-  while (blob_opt.has_value()) {
-    auto blob_meta = meta::BlobMeta{};
-    LOG(INFO) << fmt::format("reading blob id: {}", blob_opt.value())
-              << std::endl;
-    auto stripe_meta_ref = std::shared_ptr<const meta::StripeMeta>{};
+  // the blob log carries the stripe and the extent of each blob, the reads
+  // of a window are planned together once its stripes are looked up with
+  // one store snapshot
+  constexpr std::size_t PREFETCH_WINDOW = 64;
+  auto stripe_ids = std::vector<meta::stripe_id_t>{};
+  stripe_ids.reserve(PREFETCH_WINDOW);
+  while (true) {
+    auto window = std::span<const meta::BlobLogRecord>{};
+    auto stripes = std::vector<std::shared_ptr<const meta::StripeMeta>>{};
     try {
-      blob_meta = meta_core_.blob_meta(blob_opt.value());
-    } catch (meta::NotFound &e) {
-      LOG(WARNING) << fmt::format("blob {} not found", blob_opt.value())
-                   << std::endl;
-      return {.total_size = total_size.load()};
+      window = meta_core_.next_blob_records(PREFETCH_WINDOW);
+      if (window.empty()) {
+        break;
+      }
+      stripe_ids.clear();
+      for (const auto &record : window) {
+        stripe_ids.push_back(record.stripe_id);
+      }
+      stripes = meta_core_.multi_get_stripes(stripe_ids);
     } catch (std::exception &e) {
       LOG(ERROR) << fmt::format("Exception caught: {}", e.what()) << std::endl;
       return {.total_size = total_size.load()};
     }
-    blob_opt = meta_core_.next_blobs_record();
-    if (locality_stripe != nullptr &&
-        locality_stripe->stripe_id == blob_meta.stripe_id) {
-      // this blob is in the same stripe as the previous one
-      stripe_meta_ref = locality_stripe;
-    } else {
-      stripe_meta_ref = std::make_shared<meta::StripeMeta>(
-          meta_core_.stripe_meta(blob_meta.stripe_id));
-      locality_stripe = stripe_meta_ref;
-    }
-    auto task = [blob_meta,
-                 stripe_meta_ref,
-                 &total_size,
-                 &meta_core_ = this->meta_core_,
-                 &comm_ = this->comm_] {
-      auto ack_list = DegradeReadBlob{
-          .blob_meta = blob_meta,
-          .stripe_meta_ref = stripe_meta_ref,
-          .meta_core_ref = std::ref(meta_core_),
-          .comm_ref = std::ref(comm_),
-      }();
-      for (const auto &[ip, ack_list_name] : ack_list) {
-        auto ack = comm_.pop_from(ip, ack_list_name);
-        if (ack.as_cstr() != comm::ACK_PAYLOAD) {
-          LOG(ERROR) << fmt::format("ack error: {}", ack.as_cstr())
+    for (std::size_t i = 0; i < window.size(); i++) {
+      auto blob_meta = window[i].blob_meta();
+      LOG(INFO) << fmt::format("reading blob id: {}", blob_meta.blob_id)
+                << std::endl;
+      auto stripe_meta_ref = std::move(stripes[i]);
+      if (stripe_meta_ref == nullptr) {
+        LOG(WARNING) << fmt::format("stripe {} of blob {} not found",
+                                    blob_meta.stripe_id,
+                                    blob_meta.blob_id)
                      << std::endl;
-        }
+        return {.total_size = total_size.load()};
       }
-      total_size += blob_meta.size;
-    };
-    future_queue.emplace(task_pool.submit_task(task));
-    wait_future();
+      auto task = [blob_meta,
+                   stripe_meta_ref,
+                   &total_size,
+                   &meta_core_ = this->meta_core_,
+                   &comm_ = this->comm_] {
+        auto ack_list = DegradeReadBlob{
+            .blob_meta = blob_meta,
+            .stripe_meta_ref = stripe_meta_ref,
+            .meta_core_ref = std::ref(meta_core_),
+            .comm_ref = std::ref(comm_),
+        }();
+        for (const auto &[ip, ack_list_name] : ack_list) {
+          auto ack = comm_.pop_from(ip, ack_list_name);
+          if (ack.as_cstr() != comm::ACK_PAYLOAD) {
+            LOG(ERROR) << fmt::format("ack error: {}", ack.as_cstr())
+                       << std::endl;
+          }
+        }
+        total_size += blob_meta.size;
+      };
+      future_queue.emplace(task_pool.submit_task(task));
+      wait_future();
+    }
   }
   wait_future(0);
+  auto cache = meta_core_.cacheStats();
+  LOG(INFO) << fmt::format("meta cache: stripe {} hits / {} misses, "
+                           "blob {} hits / {} misses, {} bytes resident",
+                           cache.stripe_hits,
+                           cache.stripe_misses,
+                           cache.blob_hits,
+                           cache.blob_misses,
+                           cache.resident_bytes)
+            << std::endl;
   return {.total_size = total_size.load()};
 }
+auto coord::Coordinator::replay() -> ReplayResult {
+  using clock_type = std::chrono::steady_clock;
+  const auto &profile = *profile_.get();
+  const auto &replay_profile = profile.replay_profile();
+  trace::set_payload_config({.entropy = profile.payload_entropy,
+                             .seed = trace::DEFAULT_PAYLOAD.seed});
+  auto trace_reader = open_replay_trace(profile);
+  auto latency = replay::LatencyRecorder{};
+  auto costs = trace::stripe_stream::adaptive::CostLog{};
+  // declared before the pool, which waits for its tasks when destroyed
+  auto runner = ReplayRunner{profile, meta_core_, comm_, latency, costs};
+  BS::thread_pool task_pool{replay_profile.threads};
+  // half a turn of the wheel is scheduled ahead of the clock
+  constexpr std::size_t WHEEL_SLOTS{4096};
+  auto wheel = util::TimerWheel<replay::Op>{WHEEL_SLOTS};
+  const auto horizon = wheel.slots() / 2;
+  const auto tick = std::chrono::microseconds{replay_profile.tick_us};
+  auto gen = std::mt19937_64{replay_profile.seed};
+  auto degrade = std::bernoulli_distribution{replay_profile.degrade_ratio};
+
+  auto records = std::size_t{0};
+  auto pending = std::optional<trace::BlobAccessTrace>{};
+  auto read_next = [&] {
+    pending.reset();
+    if (replay_profile.records != 0 && records == replay_profile.records) {
+      return;
+    }
+    try {
+      pending = trace_reader->next_trace();
+      records++;
+    } catch (const trace::TraceException &e) {
+      if (e.error_enum() != trace::trace_error_e::Exhaust) {
+        throw;
+      }
+    }
+  };
+  read_next();
+  if (!pending.has_value()) {
+    LOG(WARNING) << "nothing to replay" << std::endl;
+    return {.ops = {}, .records = 0, .span = {}, .elapsed = {}};
+  }
+  // the trace time of a record, scaled to the replay
+  const auto first_stamp = pending->time_stamp;
+  auto last_stamp = first_stamp;
+  auto replay_us = [&](std::uint64_t stamp) {
+    auto since = stamp > first_stamp ? stamp - first_stamp : 0;
+    return static_cast<double>(since) *
+           static_cast<double>(replay_profile.time_unit_us) /
+           replay_profile.speedup;
+  };
+  auto tick_of = [&](std::uint64_t stamp) {
+    return static_cast<std::uint64_t>(
+        replay_us(stamp) / static_cast<double>(replay_profile.tick_us));
+  };
+  auto op_of = [&](const trace::BlobAccessTrace &record) {
+    auto kind = record.write && !record.read ? replay::OpKind::Write
+                : degrade(gen)               ? replay::OpKind::DegradeRead
+                                             : replay::OpKind::Read;
+    return replay::Op{.kind = kind,
+                      .blob_id = record.blob_id,
+                      .size = record.size,
+                      .tick = tick_of(record.time_stamp)};
+  };
+
+  const auto start = clock_type::now();
+  auto due_at = [&](std::uint64_t op_tick) {
+    return start + tick * static_cast<std::int64_t>(op_tick);
+  };
+  auto dispatch = [&](replay::Op op) {
+    task_pool.detach_task([&runner, op, scheduled = due_at(op.tick)] {
+      runner.run(op, scheduled);
+    });
+  };
+  while (true) {
+    auto now = static_cast<std::uint64_t>((clock_type::now() - start) / tick);
+    while (pending.has_value() &&
+           tick_of(pending->time_stamp) < now + horizon) {
+      last_stamp = std::max(last_stamp, pending->time_stamp);
+      wheel.schedule(tick_of(pending->time_stamp), op_of(*pending));
+      read_next();
+    }
+    wheel.advance(now, dispatch);
+    if (!pending.has_value() && wheel.empty()) {
+      break;
+    }
+    // sleep to the next tick, or across an idle stretch of the trace
+    auto wake = wheel.empty() ? tick_of(pending->time_stamp) : now + 1;
+    std::this_thread::sleep_until(due_at(wake));
+  }
+  task_pool.wait();
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      clock_type::now() - start);
+
+  auto result = ReplayResult{
+      .ops = {},
+      .records = records,
+      .span = std::chrono::milliseconds{static_cast<std::int64_t>(
+          replay_us(last_stamp) / 1000)}, // NOLINT
+      .elapsed = elapsed};
+  for (auto kind : replay::ALL_OP_KINDS) {
+    auto &ops = result.ops.at(static_cast<std::size_t>(kind));
+    ops = latency.summary(kind);
+    LOG(INFO) << fmt::format("replay {}: {} ops, {} missing, {} failed, "
+                             "p50 {:.0f} us, p99 {:.0f} us, p999 {:.0f} us",
+                             kind,
+                             ops.count,
+                             ops.missing,
+                             ops.failed,
+                             ops.p50_us,
+                             ops.p99_us,
+                             ops.p999_us)
+              << std::endl;
+  }
+  save_costs(profile, costs);
+  return result;
+}
 auto coord::Coordinator::persist() -> void { this->meta_core_.persist(); }
-auto coord::Coordinator::load_meta() -> void { this->meta_core_.load_meta(); }
+auto coord::Coordinator::load_meta() -> void {
+  auto recovered = this->meta_core_.load_meta();
+  LOG(INFO) << fmt::format(
+                   "meta recovered from checkpoint {}, {} stripes replayed "
+                   "from stripe {}, in {} ms",
+                   recovered.sequence,
+                   recovered.tail_stripes,
+                   recovered.replay_from,
+                   recovered.elapsed.count() / 1000) // NOLINT
+            << std::endl;
+}
 auto coord::Coordinator::clear_meta() -> void {
   this->meta_core_.clear_blobs();
 }
\ No newline at end of file
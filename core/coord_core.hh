@@ -4,8 +4,11 @@
 #include "coord_prof.hh"
 #include "meta.hpp"
 #include "meta_core.hpp"
+#include "replay.hh"
 
+#include <array>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <utility>
 namespace coord {
@@ -47,13 +50,29 @@ struct BuildDataResult {
 };
 struct RepairResult {
   std::size_t total_size;
+  /// from the construction of the coordinator to the first repair command
+  /// sent, zero if nothing is repaired
+  std::chrono::milliseconds time_to_first_command;
 };
 struct ReadResult {
   std::size_t total_size;
 };
+struct ReplayResult {
+  /// indexed by `replay::OpKind`
+  std::array<replay::OpLatency, replay::OP_KINDS> ops;
+  /// records of the trace replayed
+  std::size_t records;
+  /// trace time replayed, at the speedup of the profile
+  std::chrono::milliseconds span;
+  /// from the first operation issued to the last one done
+  std::chrono::milliseconds elapsed;
+};
 
 class Coordinator {
 private:
+  /// declared first, taken before the meta data is loaded
+  std::chrono::steady_clock::time_point launched_at_{
+      std::chrono::steady_clock::now()};
   profile_ref_t profile_;
   meta::MetaCore meta_core_;
   comm::CommManager comm_;
@@ -63,6 +82,21 @@ public:
       : profile_{profile_ref}, comm_{profile_ref->workspace_name},
         meta_core_(profile_ref->workspace_name) {
     auto create_new = profile_ref->action == ActionType::BuildData;
+    meta_core_.setCommitPolicy(meta::MetaCommitter::Policy{
+        .max_stripes = profile_->meta_commit_max_stripes,
+        .max_delay = std::chrono::microseconds{
+            profile_->meta_commit_max_delay_us}});
+    // 3/4 of the cache for the stripes, which also carry their blob lists
+    constexpr std::size_t MB = std::size_t{1} << 20;
+    meta_core_.setCacheConfig(meta::MetaCache::Config{
+        .stripe_bytes = profile_->meta_cache_mb * MB / 4 * 3,
+        .blob_bytes = profile_->meta_cache_mb * MB / 4,
+        .shards = meta::MetaCache::DEFAULT_CONFIG.shards});
+    auto store_options = meta::MetaStore::DEFAULT_OPTIONS;
+    store_options.shards = profile_->meta_shards;
+    store_options.block_cache_bytes = profile_->meta_block_cache_mb * MB;
+    store_options.sync_writes = profile_->meta_sync_writes;
+    meta_core_.setStoreOptions(store_options);
     meta_core_.launch(profile_->working_dir, create_new);
     meta_core_.setStripeIdCounter(profile_->start_at);
     for (std::size_t node_id = 0; node_id < profile_->worker_ip.size();
@@ -78,7 +112,8 @@ public:
     case ActionType::RepairChunk:
     case ActionType::RepairFailureDomain:
     case ActionType::Read:
-      meta_core_.load_meta();
+    case ActionType::Replay:
+      load_meta();
       break;
     case ActionType::BuildData:
     case ActionType::DegradeRead:
@@ -91,6 +126,7 @@ public:
   auto repair_failure_domain() -> RepairResult;
   auto read() -> ReadResult;
   auto degrade_read() -> ReadResult;
+  auto replay() -> ReplayResult;
   auto persist() -> void;
   auto load_meta() -> void;
   auto clear_meta() -> void;
@@ -32,6 +32,8 @@ auto coord::from_str<coord::ActionType>(std::string_view str) -> ActionType {
     return ActionType::Read;
   } else if (str == "DegradeRead") {
     return ActionType::DegradeRead;
+  } else if (str == "Replay") {
+    return ActionType::Replay;
   } else {
     throw std::invalid_argument("Invalid ActionType type");
   }
@@ -82,6 +84,8 @@ auto as_str(const coord::ActionType &action) -> std::string_view {
     return "Read";
   case ActionType::DegradeRead:
     return "DegradeRead";
+  case ActionType::Replay:
+    return "Replay";
   default:
     throw std::invalid_argument("Invalid action type");
   }
@@ -163,6 +167,10 @@ auto coord::Profile::build_data_profile() const -> const BuildDataProfile & {
   return std::get<BuildDataProfile>(action_variant_);
 }
 
+auto coord::Profile::replay_profile() const -> const ReplayProfile & {
+  return std::get<ReplayProfile>(action_variant_);
+}
+
 auto validate_profile(const coord::Profile &profile) {
   if (profile.worker_ip.empty()) {
     throw std::invalid_argument("worker_ip is empty");
@@ -179,6 +187,44 @@ auto validate_profile(const coord::Profile &profile) {
   if (profile.pg_num == 0) {
     throw std::invalid_argument("pg_num is 0");
   }
+  if (profile.clay_parallel_planes == 0) {
+    throw std::invalid_argument("clay_parallel_planes is 0");
+  }
+  if (profile.meta_commit_max_stripes == 0) {
+    throw std::invalid_argument("meta_commit_max_stripes is 0");
+  }
+  if (profile.meta_shards == 0) {
+    throw std::invalid_argument("meta_shards is 0");
+  }
+  if (!(profile.payload_entropy >= 0.0 && profile.payload_entropy <= 1.0)) {
+    throw std::invalid_argument("payload_entropy is not in [0, 1]");
+  }
+  if (profile.synthetic.has_value()) {
+    trace::validate_workload(profile.synthetic.value());
+  }
+  if (profile.adaptive.has_value()) {
+    trace::stripe_stream::adaptive::validate_config(profile.adaptive.value());
+    if (profile.action == ActionType::BuildData &&
+        profile.merge_scheme != MergeScheme::Partition) {
+      throw std::invalid_argument(
+          "adaptive sizes only support the Partition merge scheme");
+    }
+  }
+  if (profile.encode_threads == 0) {
+    throw std::invalid_argument("encode_threads is 0");
+  }
+  if (profile.merge_scheme == MergeScheme::InterLocality &&
+      profile.merge_buffer_budget_mb != 0 &&
+      (profile.merge_buffer_budget_mb << 20U) < profile.merge_size) {
+    throw std::invalid_argument("merge_buffer_budget_mb is below merge_size");
+  }
+  if (profile.stream_encode &&
+      !(profile.merge_scheme == MergeScheme::IntraLocality ||
+        (profile.merge_scheme == MergeScheme::Baseline &&
+         profile.ec_type != meta::EcType::CLAY))) {
+    throw std::invalid_argument("stream_encode only supports IntraLocality, "
+                                "or Baseline with RS/NSYS");
+  }
   if (profile.disk_list.size() != profile.worker_ip.size()) {
     throw std::invalid_argument(
         "disk_list size is not equal to worker_ip size");
@@ -210,6 +256,28 @@ auto coord::Profile::ParseToml(const std::filesystem::path &cfg_file)
       meta::string_to_ectype(toml::find<std::string>(data, "ec_type"));
   profile.partition_size =
       toml::find_or<std::size_t>(data, "partition_size", 0);
+  profile.clay_parallel_planes = toml::find_or<std::size_t>(
+      data, "clay_parallel_planes", profile_default::CLAY_PARALLEL_PLANES);
+  profile.meta_commit_max_stripes =
+      toml::find_or<std::size_t>(data,
+                                 "meta_commit_max_stripes",
+                                 profile_default::META_COMMIT_MAX_STRIPES);
+  profile.meta_commit_max_delay_us =
+      toml::find_or<std::size_t>(data,
+                                 "meta_commit_max_delay_us",
+                                 profile_default::META_COMMIT_MAX_DELAY_US);
+  profile.meta_cache_mb = toml::find_or<std::size_t>(
+      data, "meta_cache_mb", profile_default::META_CACHE_MB);
+  profile.meta_shards = toml::find_or<std::size_t>(
+      data, "meta_shards", profile_default::META_SHARDS);
+  profile.meta_block_cache_mb = toml::find_or<std::size_t>(
+      data, "meta_block_cache_mb", profile_default::META_BLOCK_CACHE_MB);
+  profile.meta_sync_writes = toml::find_or<bool>(
+      data, "meta_sync_writes", profile_default::META_SYNC_WRITES);
+  profile.meta_checkpoint_interval =
+      toml::find_or<std::size_t>(data,
+                                 "meta_checkpoint_interval",
+                                 profile_default::META_CHECKPOINT_INTERVAL);
   profile.load_type =
       from_str<LoadType>(toml::find<std::string>(data, "load_type"));
   auto load_f64 = std::double_t{0.0};
@@ -238,13 +306,97 @@ auto coord::Profile::ParseToml(const std::filesystem::path &cfg_file)
 
   profile.start_at =
       toml::find_or<std::size_t>(data, "start_at", profile_default::START_AT);
-  profile.trace = toml::find<std::string>(data, "trace");
+  if (data.contains("synthetic")) {
+    const auto &synth_data = toml::find(data, "synthetic");
+    using size_cdf_t = std::vector<std::pair<std::size_t, double>>;
+    profile.synthetic = trace::SynthWorkload{
+        .records = toml::find_or<std::size_t>(
+            synth_data, "records", profile_default::SYNTH_RECORDS),
+        .users = toml::find_or<std::size_t>(
+            synth_data, "users", profile_default::SYNTH_USERS),
+        .zipf_s = toml::find_or<double>(
+            synth_data, "zipf_s", profile_default::SYNTH_ZIPF_S),
+        .size_mu = toml::find_or<double>(
+            synth_data, "size_mu", profile_default::SYNTH_SIZE_MU),
+        .size_sigma = toml::find_or<double>(
+            synth_data, "size_sigma", profile_default::SYNTH_SIZE_SIGMA),
+        .size_cdf =
+            toml::find_or<size_cdf_t>(synth_data, "size_cdf", size_cdf_t{}),
+        .min_size = toml::find_or<std::size_t>(
+            synth_data, "min_size", profile_default::SYNTH_MIN_SIZE),
+        .max_size = toml::find_or<std::size_t>(
+            synth_data, "max_size", profile_default::SYNTH_MAX_SIZE),
+        .read_ratio = toml::find_or<double>(
+            synth_data, "read_ratio", profile_default::SYNTH_READ_RATIO),
+        .locality = toml::find_or<double>(
+            synth_data, "locality", profile_default::SYNTH_LOCALITY),
+        .user_history =
+            toml::find_or<std::size_t>(synth_data,
+                                       "user_history",
+                                       profile_default::SYNTH_USER_HISTORY),
+        .arrival_rate = toml::find_or<double>(
+            synth_data, "arrival_rate", profile_default::SYNTH_ARRIVAL_RATE),
+        .seed = toml::find_or<std::uint64_t>(
+            synth_data, "seed", profile_default::SYNTH_SEED),
+    };
+    profile.trace = toml::find_or<std::string>(data, "trace", "");
+  } else {
+    profile.trace = toml::find<std::string>(data, "trace");
+  }
   profile.merge_size = toml::find<std::size_t>(data, "merge_size");
   profile.merge_scheme =
       from_str<MergeScheme>(toml::find<std::string>(data, "merge_scheme"));
+  profile.stream_encode = toml::find_or<bool>(data, "stream_encode", false);
+  profile.payload_entropy = toml::find_or<double>(
+      data, "payload_entropy", profile_default::PAYLOAD_ENTROPY);
+  profile.pipeline_depth = toml::find_or<std::size_t>(
+      data, "pipeline_depth", profile_default::PIPELINE_DEPTH);
+  profile.encode_threads = toml::find_or<std::size_t>(
+      data, "encode_threads", profile_default::ENCODE_THREADS);
+  profile.merge_buffer_budget_mb = toml::find_or<std::size_t>(
+      data, "merge_buffer_budget_mb", profile_default::MERGE_BUFFER_BUDGET_MB);
+  profile.merge_buffer_max_age = toml::find_or<std::uint64_t>(
+      data, "merge_buffer_max_age", profile_default::MERGE_BUFFER_MAX_AGE);
+  profile.dedup_budget_mb = toml::find_or<std::size_t>(
+      data, "dedup_budget_mb", profile_default::DEDUP_BUDGET_MB);
+  if (data.contains("adaptive")) {
+    const auto &adaptive_data = toml::find(data, "adaptive");
+    // relative to the workspace, an empty path keeps the modeled costs
+    auto cost_file = toml::find_or<std::string>(
+        adaptive_data,
+        "cost_file",
+        std::string{profile_default::ADAPTIVE_COST_FILE});
+    profile.adaptive = trace::stripe_stream::adaptive::Config{
+        .epoch_blobs =
+            toml::find_or<std::size_t>(adaptive_data,
+                                       "epoch_blobs",
+                                       profile_default::ADAPTIVE_EPOCH_BLOBS),
+        .min_partition_size = toml::find_or<std::size_t>(
+            adaptive_data,
+            "min_partition_size",
+            profile_default::ADAPTIVE_MIN_PARTITION_SIZE),
+        .max_partition_size = toml::find_or<std::size_t>(
+            adaptive_data,
+            "max_partition_size",
+            profile_default::ADAPTIVE_MAX_PARTITION_SIZE),
+        .min_merge_size = toml::find_or<std::size_t>(
+            adaptive_data,
+            "min_merge_size",
+            profile_default::ADAPTIVE_MIN_MERGE_SIZE),
+        .max_merge_size = toml::find_or<std::size_t>(
+            adaptive_data,
+            "max_merge_size",
+            profile_default::ADAPTIVE_MAX_MERGE_SIZE),
+        .cost_file = cost_file.empty() ? std::filesystem::path{}
+                                       : profile.working_dir / cost_file,
+    };
+  }
   if (profile.merge_scheme == MergeScheme::InterForDegradeRead ||
       profile.merge_scheme == MergeScheme::IntraForDegradeRead) {
-    profile.blob_size = toml::find<std::size_t>(data, "blob_size");
+    // the blobs take the sizes of a synthetic trace if there is one
+    profile.blob_size = profile.synthetic.has_value()
+                            ? toml::find_or<std::size_t>(data, "blob_size", 0)
+                            : toml::find<std::size_t>(data, "blob_size");
     profile.chunk_size = toml::find<std::size_t>(data, "chunk_size");
   }
   profile.pg_num = toml::find<std::size_t>(data, "pg_num");
@@ -273,6 +425,41 @@ auto coord::Profile::ParseToml(const std::filesystem::path &cfg_file)
         toml::find<meta::chunk_index_t>(repair_chunk_data, "chunk_index");
     profile.action_variant_ = repair_profile;
   } break;
+  case ActionType::Replay: {
+    // the [replay] table is optional, every key has a default
+    auto replay_data = data.contains("replay") ? toml::find(data, "replay")
+                                               : toml::value(toml::table{});
+    auto replay_profile = ReplayProfile{
+        .speedup = toml::find_or<double>(
+            replay_data, "speedup", profile_default::REPLAY_SPEEDUP),
+        .time_unit_us = toml::find_or<std::uint64_t>(
+            replay_data, "time_unit_us", profile_default::REPLAY_TIME_UNIT_US),
+        .tick_us = toml::find_or<std::uint64_t>(
+            replay_data, "tick_us", profile_default::REPLAY_TICK_US),
+        .threads = toml::find_or<std::size_t>(
+            replay_data, "threads", profile_default::REPLAY_THREADS),
+        .degrade_ratio =
+            toml::find_or<double>(replay_data,
+                                  "degrade_ratio",
+                                  profile_default::REPLAY_DEGRADE_RATIO),
+        .records = toml::find_or<std::size_t>(replay_data, "records", 0),
+        .seed = toml::find_or<std::uint64_t>(
+            replay_data, "seed", profile_default::REPLAY_SEED),
+    };
+    if (!(replay_profile.speedup > 0.0)) {
+      throw std::invalid_argument("replay.speedup is not positive");
+    }
+    if (replay_profile.time_unit_us == 0 || replay_profile.tick_us == 0 ||
+        replay_profile.threads == 0) {
+      throw std::invalid_argument(
+          "replay.time_unit_us, replay.tick_us or replay.threads is 0");
+    }
+    if (!(replay_profile.degrade_ratio >= 0.0 &&
+          replay_profile.degrade_ratio <= 1.0)) {
+      throw std::invalid_argument("replay.degrade_ratio is not in [0, 1]");
+    }
+    profile.action_variant_ = replay_profile;
+  } break;
   default: {
     profile.action_variant_ = std::monostate{};
   }
@@ -287,7 +474,36 @@ auto coord::operator<<(std::ostream &os,
   os << fmt::format("[Info] pg_num: {}\n", profile.pg_num);
   os << fmt::format("[Info] working_dir: {}\n",
                     profile.working_dir.generic_string());
-  os << fmt::format("[Info] trace: {}\n", profile.trace.generic_string());
+  if (const auto &synth = profile.synthetic; synth.has_value()) {
+    os << fmt::format("[Info] trace: synthetic, {} records of {} users, "
+                      "seed {}\n",
+                      synth->records,
+                      synth->users,
+                      synth->seed);
+    os << fmt::format(
+        "[Info] synthetic: zipf_s {}, read_ratio {}, locality {}, "
+        "user_history {}, arrival_rate {}\n",
+        synth->zipf_s,
+        synth->read_ratio,
+        synth->locality,
+        synth->user_history,
+        synth->arrival_rate);
+    if (synth->size_cdf.empty()) {
+      os << fmt::format("[Info] synthetic sizes: lognormal mu {}, sigma {}, "
+                        "in [{}, {}]\n",
+                        synth->size_mu,
+                        synth->size_sigma,
+                        synth->min_size,
+                        synth->max_size);
+    } else {
+      os << fmt::format("[Info] synthetic sizes: {} CDF points, in [{}, {}]\n",
+                        synth->size_cdf.size(),
+                        synth->min_size,
+                        synth->max_size);
+    }
+  } else {
+    os << fmt::format("[Info] trace: {}\n", profile.trace.generic_string());
+  }
   os << fmt::format("[Info] log_file: {}\n", profile.log_file.generic_string());
   os << fmt::format("[Info] ec_k: {}\n", profile.ec_k);
   os << fmt::format("[Info] ec_m: {}\n", profile.ec_m);
@@ -298,10 +514,39 @@ auto coord::operator<<(std::ostream &os,
                       profile.test_load >> 30); // NOLINT
   }
   os << fmt::format("[Info] action: {}\n", profile.action);
+  os << fmt::format("[Info] meta cache: {} MB\n", profile.meta_cache_mb);
+  os << fmt::format("[Info] meta store: {} shards, {} MB block cache, {}\n",
+                    profile.meta_shards,
+                    profile.meta_block_cache_mb,
+                    profile.meta_sync_writes ? "sync" : "no sync");
+  os << fmt::format("[Info] meta checkpoint interval: {} stripes\n",
+                    profile.meta_checkpoint_interval);
+  if (profile.adaptive.has_value()) {
+    const auto &cost_file = profile.adaptive->cost_file;
+    os << fmt::format("[Info] adaptive costs: {}\n",
+                      cost_file.empty() ? std::string{"modeled"}
+                                        : cost_file.generic_string());
+  }
   switch (profile.action) {
   case ActionType::BuildData: {
     os << fmt::format("[Info] start_at: {}\n", profile.start_at);
     os << fmt::format("[Info] merge_scheme: {}\n", profile.merge_scheme);
+    os << fmt::format("[Info] clay_parallel_planes: {}\n",
+                      profile.clay_parallel_planes);
+    os << fmt::format("[Info] stream_encode: {}\n", profile.stream_encode);
+    os << fmt::format("[Info] payload_entropy: {}\n", profile.payload_entropy);
+    os << fmt::format("[Info] pipeline: {} stripes deep, {} encode threads\n",
+                      profile.pipeline_depth,
+                      profile.encode_threads);
+    os << fmt::format("[Info] meta commit: {} stripes or {}us per group\n",
+                      profile.meta_commit_max_stripes,
+                      profile.meta_commit_max_delay_us);
+    if (profile.dedup_budget_mb == 0) {
+      os << "[Info] dedup: exact\n";
+    } else {
+      os << fmt::format("[Info] dedup: exact up to {} MB\n",
+                        profile.dedup_budget_mb);
+    }
     switch (profile.merge_scheme) {
     case MergeScheme::Baseline:
       os << fmt::format("[Info] ec_type: {}\n", profile.ec_type);
@@ -311,6 +556,15 @@ auto coord::operator<<(std::ostream &os,
                         meta::EcType::CLAY,
                         meta::EcType::RS);
       os << fmt::format("[Info] partition_size: {}\n", profile.partition_size);
+      if (const auto &adaptive = profile.adaptive; adaptive.has_value()) {
+        os << fmt::format("[Info] adaptive sizes: partition_size in [{}, {}], "
+                          "merge_size in [{}, {}], every {} blobs\n",
+                          adaptive->min_partition_size,
+                          adaptive->max_partition_size,
+                          adaptive->min_merge_size,
+                          adaptive->max_merge_size,
+                          adaptive->epoch_blobs);
+      }
       break;
     case MergeScheme::IntraLocality:
     case MergeScheme::InterLocality:
@@ -318,12 +572,18 @@ auto coord::operator<<(std::ostream &os,
                         meta::EcType::CLAY,
                         meta::EcType::NSYS);
       os << fmt::format("[Info] merge_size: {}\n", profile.merge_size);
+      os << fmt::format("[Info] merge buffers: {} MB, max age {}\n",
+                        profile.merge_buffer_budget_mb,
+                        profile.merge_buffer_max_age);
       break;
     case MergeScheme::Fixed:
       err::Unimplemented();
     case coord::MergeScheme::InterForDegradeRead:
       os << fmt::format("[Info] ec_type: {}\n", profile.ec_type);
       os << fmt::format("[Info] chunk_size: {}\n", profile.chunk_size);
+      if (!profile.synthetic.has_value()) {
+        os << fmt::format("[Info] blob_size: {}\n", profile.blob_size);
+      }
       break;
     case MergeScheme::IntraForDegradeRead:
       os << fmt::format("[Info] ec_type: {}\n", profile.ec_type);
@@ -346,6 +606,18 @@ auto coord::operator<<(std::ostream &os,
   } break;
   case coord::ActionType::DegradeRead: {
   } break;
+  case coord::ActionType::Replay: {
+    const auto &replay = profile.replay_profile();
+    os << fmt::format("[Info] replay: {}x speed, {}us per time unit, {}us "
+                      "ticks, {} threads\n",
+                      replay.speedup,
+                      replay.time_unit_us,
+                      replay.tick_us,
+                      replay.threads);
+    os << fmt::format("[Info] replay: {} of the reads degraded, {} records\n",
+                      replay.degrade_ratio,
+                      replay.records);
+  } break;
   default:
     err::Unreachable();
   }
@@ -1,9 +1,13 @@
 #pragma once
 
 #include "meta.hpp"
+#include "size_controller.hh"
+#include "synth_trace.hh"
 #include <cstddef>
 #include <cstdint>
 #include <filesystem>
+#include <optional>
+#include <string_view>
 #include <variant>
 namespace coord {
 enum class RepairManner : std::uint8_t {
@@ -17,6 +21,7 @@ enum class ActionType : std::uint8_t {
   RepairFailureDomain,
   Read,
   DegradeRead,
+  Replay,
 };
 
 enum class MergeScheme : std::uint8_t {
@@ -38,6 +43,25 @@ struct FailureDomainRepairProfile {
   meta::disk_id_t failed_disk;
 };
 
+/// replay the trace at the pace of its time stamps, see
+/// `Coordinator::replay`
+struct ReplayProfile {
+  /// the trace runs this many times faster than recorded
+  double speedup;
+  /// microseconds per unit of the trace time stamps
+  std::uint64_t time_unit_us;
+  /// the resolution of the schedule
+  std::uint64_t tick_us;
+  /// operations in flight at most, the later ones wait for a thread
+  std::size_t threads;
+  /// fraction of the reads issued as degraded reads
+  double degrade_ratio;
+  /// records replayed at most, `0` for the whole trace
+  std::size_t records;
+  /// seeds the choice of the degraded reads
+  std::uint64_t seed;
+};
+
 struct BuildDataProfile {
   meta::ec_param_t ec_k;
   meta::ec_param_t ec_m;
@@ -68,6 +92,45 @@ auto format_as(const LoadType &load_type) -> std::string_view;
 
 namespace profile_default {
 inline static constexpr std::size_t START_AT{0};
+inline static constexpr std::size_t CLAY_PARALLEL_PLANES{1};
+inline static constexpr std::size_t META_COMMIT_MAX_STRIPES{64};
+inline static constexpr std::size_t META_COMMIT_MAX_DELAY_US{2000};
+inline static constexpr std::size_t META_CACHE_MB{256};
+inline static constexpr std::size_t META_SHARDS{4};
+inline static constexpr std::size_t META_BLOCK_CACHE_MB{64};
+inline static constexpr bool META_SYNC_WRITES{true};
+inline static constexpr std::size_t META_CHECKPOINT_INTERVAL{16384};
+inline static constexpr double PAYLOAD_ENTROPY{1.0};
+inline static constexpr std::size_t PIPELINE_DEPTH{8};
+inline static constexpr std::size_t ENCODE_THREADS{4};
+inline static constexpr std::size_t MERGE_BUFFER_BUDGET_MB{1024};
+inline static constexpr std::uint64_t MERGE_BUFFER_MAX_AGE{0};
+inline static constexpr double REPLAY_SPEEDUP{1.0};
+inline static constexpr std::uint64_t REPLAY_TIME_UNIT_US{1000};
+inline static constexpr std::uint64_t REPLAY_TICK_US{1000};
+inline static constexpr std::size_t REPLAY_THREADS{64};
+inline static constexpr double REPLAY_DEGRADE_RATIO{0.0};
+inline static constexpr std::uint64_t REPLAY_SEED{0x5eed};
+inline static constexpr std::size_t DEDUP_BUDGET_MB{0};
+inline static constexpr std::size_t SYNTH_RECORDS{1000000};
+inline static constexpr std::size_t SYNTH_USERS{100000};
+inline static constexpr double SYNTH_ZIPF_S{1.0};
+inline static constexpr double SYNTH_SIZE_MU{9.0};
+inline static constexpr double SYNTH_SIZE_SIGMA{1.5};
+inline static constexpr std::size_t SYNTH_MIN_SIZE{1};
+inline static constexpr std::size_t SYNTH_MAX_SIZE{std::size_t{64} << 20};
+inline static constexpr double SYNTH_READ_RATIO{0.5};
+inline static constexpr double SYNTH_LOCALITY{0.3};
+inline static constexpr std::size_t SYNTH_USER_HISTORY{8};
+inline static constexpr double SYNTH_ARRIVAL_RATE{1.0};
+inline static constexpr std::uint64_t SYNTH_SEED{0x5eed};
+inline static constexpr std::size_t ADAPTIVE_EPOCH_BLOBS{65536};
+inline static constexpr std::size_t ADAPTIVE_MIN_PARTITION_SIZE{64 << 10};
+inline static constexpr std::size_t ADAPTIVE_MAX_PARTITION_SIZE{64 << 20};
+inline static constexpr std::size_t ADAPTIVE_MIN_MERGE_SIZE{64 << 10};
+inline static constexpr std::size_t ADAPTIVE_MAX_MERGE_SIZE{16 << 20};
+inline static constexpr std::string_view ADAPTIVE_COST_FILE{
+    "adaptive_costs.txt"};
 }
 // NOLINTBEGIN (cppcoreguidelines-non-private-member-variables-in-classes)
 class Profile {
@@ -88,7 +151,46 @@ public:
   std::size_t chunk_size;
   std::size_t blob_size;
   std::size_t partition_size;
+  std::size_t clay_parallel_planes;
+  bool stream_encode;
+  /// fraction of random bytes in the synthesized blob payloads, the rest is
+  /// zero and compresses away
+  double payload_entropy;
+  /// stripes each stage of the build pipeline works ahead, `0` builds on
+  /// the main thread
+  std::size_t pipeline_depth;
+  /// threads encoding the merges of "Fixed" and "Baseline" in the pipeline
+  std::size_t encode_threads;
+  /// memory of the per-user merge buffers of "InterLocality", in MB, `0`
+  /// for no limit
+  std::size_t merge_buffer_budget_mb;
+  /// trace time a merge buffer of "InterLocality" waits to fill, `0` for
+  /// no limit
+  std::uint64_t merge_buffer_max_age;
+  /// stripe registrations flushed with one database write at most
+  std::size_t meta_commit_max_stripes;
+  /// how long a registration waits for others to join its commit group
+  std::size_t meta_commit_max_delay_us;
+  /// memory of the stripe and blob meta cache, in MB
+  std::size_t meta_cache_mb;
+  /// LevelDB instances of the meta store, fixed when the store is built
+  std::size_t meta_shards;
+  /// LevelDB block cache shared by the shards, in MB
+  std::size_t meta_block_cache_mb;
+  /// sync the meta data commits to disk
+  bool meta_sync_writes;
+  /// stripes between two meta checkpoints of build_data, `0` for none but
+  /// the final one
+  std::size_t meta_checkpoint_interval;
   std::filesystem::path trace;
+  /// memory of the blob ids deduplicating the trace for build_data, in MB,
+  /// `0` to keep them all exactly, see `trace::DedupTraceReader`
+  std::size_t dedup_budget_mb;
+  /// the workload of the [synthetic] table, generated in place of `trace`
+  std::optional<trace::SynthWorkload> synthetic;
+  /// the bounds of the sizes "Partition" chooses per epoch, and the file of
+  /// the costs the other actions measure, of the [adaptive] table
+  std::optional<trace::stripe_stream::adaptive::Config> adaptive;
   std::size_t pg_num;
   ActionType action;
   std::filesystem::path log_file;
@@ -97,7 +199,8 @@ public:
 private:
   using action_variant_t =
       std::variant<std::monostate, ChunkRepairProfile,
-                   FailureDomainRepairProfile, BuildDataProfile>;
+                   FailureDomainRepairProfile, BuildDataProfile,
+                   ReplayProfile>;
   action_variant_t action_variant_{};
 
 public:
@@ -105,6 +208,7 @@ public:
   [[nodiscard]] auto
   failure_domain_repair_profile() const -> const FailureDomainRepairProfile &;
   [[nodiscard]] auto build_data_profile() const -> const BuildDataProfile &;
+  [[nodiscard]] auto replay_profile() const -> const ReplayProfile &;
 
   /// parse the program arguments from the command line
   static auto ParseToml(const std::filesystem::path &cfg_file) -> Profile;
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+/// Open-loop replay of a trace, see `Coordinator::replay`: an operation is
+/// issued at the time stamp of its record, whether or not the earlier ones
+/// have completed.
+namespace coord::replay {
+
+enum class OpKind : std::uint8_t {
+  Read = 0,
+  DegradeRead,
+  Write,
+};
+inline static constexpr std::size_t OP_KINDS{3};
+inline static constexpr std::array<OpKind, OP_KINDS> ALL_OP_KINDS{
+    OpKind::Read, OpKind::DegradeRead, OpKind::Write};
+
+inline auto format_as(OpKind kind) -> std::string_view {
+  switch (kind) {
+  case OpKind::Read:
+    return "Read";
+  case OpKind::DegradeRead:
+    return "DegradeRead";
+  case OpKind::Write:
+    return "Write";
+  default:
+    return "Unknown";
+  }
+}
+
+/// an operation of the trace, due at `tick` of the replay
+struct Op {
+  OpKind kind;
+  std::uint64_t blob_id;
+  std::size_t size;
+  std::uint64_t tick;
+};
+
+/// the operations of one kind, the latencies in microseconds
+/// # Note
+/// the latency of an operation runs from its scheduled time to its last ack,
+/// so the time it waits for a thread counts, the lag runs from its scheduled
+/// time to its start
+struct OpLatency {
+  std::size_t count;
+  std::size_t bytes;
+  /// reads of the blobs not built
+  std::size_t missing;
+  /// operations that threw
+  std::size_t failed;
+  double mean_us;
+  double p50_us;
+  double p90_us;
+  double p99_us;
+  double p999_us;
+  double max_us;
+  double lag_p99_us;
+};
+
+/// Collects the latencies of the operations from the replay threads.
+class LatencyRecorder {
+  using clock_type = std::chrono::steady_clock;
+
+  struct Samples {
+    std::mutex mtx{};
+    std::vector<double> latency_us{};
+    std::vector<double> lag_us{};
+    std::size_t bytes{0};
+    std::size_t missing{0};
+    std::size_t failed{0};
+  };
+  std::array<Samples, OP_KINDS> samples_{};
+
+  auto of(OpKind kind) -> Samples & {
+    return samples_.at(static_cast<std::size_t>(kind));
+  }
+
+  static auto us(clock_type::duration duration) -> double {
+    return std::chrono::duration<double, std::micro>(duration).count();
+  }
+
+  /// the sample at quantile `q` of the sorted `samples`
+  static auto at(const std::vector<double> &samples, double q) -> double {
+    if (samples.empty()) {
+      return 0;
+    }
+    auto i = static_cast<std::size_t>(q * static_cast<double>(samples.size()));
+    return samples.at(std::min(i, samples.size() - 1));
+  }
+
+public:
+  auto record(OpKind kind, clock_type::time_point scheduled,
+              clock_type::time_point started, clock_type::time_point done,
+              std::size_t bytes) -> void {
+    auto &samples = of(kind);
+    auto lock = std::unique_lock{samples.mtx};
+    samples.latency_us.push_back(us(done - scheduled));
+    samples.lag_us.push_back(us(started - scheduled));
+    samples.bytes += bytes;
+  }
+
+  auto missing(OpKind kind) -> void {
+    auto &samples = of(kind);
+    auto lock = std::unique_lock{samples.mtx};
+    samples.missing++;
+  }
+
+  auto failed(OpKind kind) -> void {
+    auto &samples = of(kind);
+    auto lock = std::unique_lock{samples.mtx};
+    samples.failed++;
+  }
+
+  /// # Note
+  /// sorts the samples, call it once the operations are done
+  auto summary(OpKind kind) -> OpLatency {
+    auto &samples = of(kind);
+    auto lock = std::unique_lock{samples.mtx};
+    auto &latency = samples.latency_us;
+    std::sort(latency.begin(), latency.end());
+    std::sort(samples.lag_us.begin(), samples.lag_us.end());
+    auto sum = double{0};
+    for (auto s : latency) {
+      sum += s;
+    }
+    return {.count = latency.size(),
+            .bytes = samples.bytes,
+            .missing = samples.missing,
+            .failed = samples.failed,
+            .mean_us = latency.empty()
+                           ? 0
+                           : sum / static_cast<double>(latency.size()),
+            .p50_us = at(latency, 0.5),     // NOLINT
+            .p90_us = at(latency, 0.9),     // NOLINT
+            .p99_us = at(latency, 0.99),    // NOLINT
+            .p999_us = at(latency, 0.999),  // NOLINT
+            .max_us = latency.empty() ? 0 : latency.back(),
+            .lag_p99_us = at(samples.lag_us, 0.99)}; // NOLINT
+  }
+};
+
+} // namespace coord::replay
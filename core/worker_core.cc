@@ -2,6 +2,7 @@
 
 #include "BlockCommand.hh"
 #include "Command.hh"
+#include "clay_geometry.hh"
 #include "comm.hh"
 #include "erasure_code.hh"
 #include "erasure_code_factory.hpp"
@@ -298,19 +299,8 @@ auto worker::BlockWorkerCtx::doCompute(const command_t &cmd,
       chunks[srcBlockId] = in;
     }
 
-    std::set<int> available;
-    for (int i = 0; i < k + m; i++) {
-      if (i != repairIdx)
-        available.insert(i);
-    }
-
-    std::map<int, std::vector<std::pair<int, int>>> minimum;
-    clay.minimum_to_decode(want_to_read, available, &minimum);
-
-    int repair_sub_chunk_count = 0;
-    for (const auto &p : minimum.begin()->second) {
-      repair_sub_chunk_count += p.second;
-    }
+    int repair_sub_chunk_count =
+        ec::clay_geometry(k, m).repair_sub_chunk_no;
     std::cout << "repair_sub_chunk_count:" << repair_sub_chunk_count
               << std::endl;
 
@@ -491,7 +481,9 @@ auto worker::BlockWorkerCtx::pipe_fetch_write(command_ref cmd) -> void {
   this->detachTask([this, cmd, stream = std::move(stream)]() {
     this->doWrite(*cmd.get(), stream);
     this->getComm().push_to(
-        comm::LOCAL_HOST, comm::BUILD_ACK_LIST_KEY, comm::ACK_PAYLOAD);
+        comm::LOCAL_HOST,
+        comm::make_ack_list_name(comm::BUILD_ACK_LIST_KEY, cmd->getAckTag()),
+        comm::ACK_PAYLOAD);
   });
 };
 auto worker::BlockWorkerCtx::pipe_read_cache_clay(command_ref cmd) -> void {
@@ -521,7 +513,9 @@ auto worker::BlockWorkerCtx::pipe_fetch_compute_write(command_ref cmd) -> void {
     if (perform_read) {
       // read and degrade read
       this->getComm().push_to(
-          comm::LOCAL_HOST, comm::READ_ACK_LIST_KEY, comm::ACK_PAYLOAD);
+          comm::LOCAL_HOST,
+          comm::make_ack_list_name(comm::READ_ACK_LIST_KEY, cmd->getAckTag()),
+          comm::ACK_PAYLOAD);
     }
   });
 
@@ -536,7 +530,10 @@ auto worker::BlockWorkerCtx::pipe_fetch_compute_write(command_ref cmd) -> void {
       //            comm::LOCAL_HOST)
       //     << std::endl;
       this->getComm().push_to(
-          comm::LOCAL_HOST, comm::REPAIR_ACK_LIST_KEY, comm::ACK_PAYLOAD);
+          comm::LOCAL_HOST,
+          comm::make_ack_list_name(comm::REPAIR_ACK_LIST_KEY,
+                                   cmd->getAckTag()),
+          comm::ACK_PAYLOAD);
     });
   }
 };
@@ -0,0 +1,103 @@
+#include "clay_geometry.hh"
+
+#include <limits>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace {
+auto invalid_params(int k, int m, int d, const char *reason)
+    -> std::invalid_argument {
+  return std::invalid_argument{"invalid clay parameters (k=" +
+                               std::to_string(k) + ", m=" + std::to_string(m) +
+                               ", d=" + std::to_string(d) + "): " + reason};
+}
+
+auto checked_pow(int k, int m, int d, int a, int x) -> int {
+  int power = 1;
+  for (int i = 0; i < x; i++) {
+    if (power > std::numeric_limits<int>::max() / a) {
+      throw invalid_params(k, m, d, "too many sub-chunks");
+    }
+    power *= a;
+  }
+  return power;
+}
+
+auto compute_geometry(int k, int m, int d) -> ec::ClayGeometry {
+  if (k < 2 || m < 1) {
+    throw invalid_params(k, m, d, "requires k >= 2 and m >= 1");
+  }
+  if (d < k || d > k + m - 1) {
+    throw invalid_params(k, m, d, "d must be within [k, k + m - 1]");
+  }
+  auto geo = ec::ClayGeometry{};
+  geo.k = k;
+  geo.m = m;
+  geo.d = d;
+  geo.q = d - k + 1;
+  geo.nu = (k + m) % geo.q ? geo.q - (k + m) % geo.q : 0;
+  if (k + m + geo.nu > 254) { // NOLINT
+    throw invalid_params(k, m, d, "k + m + nu exceeds 254");
+  }
+  geo.t = (k + m + geo.nu) / geo.q;
+  geo.sub_chunk_no = checked_pow(k, m, d, geo.q, geo.t);
+  geo.repair_sub_chunk_no = geo.sub_chunk_no / geo.q;
+
+  // same as `ErasureCodeClay::get_repair_subchunks`, parity chunks are shifted
+  // behind the shortened nodes
+  geo.repair_sub_chunks.resize(k + m);
+  for (int chunk = 0; chunk < k + m; chunk++) {
+    const int lost_node = chunk < k ? chunk : chunk + geo.nu;
+    const int y_lost = lost_node / geo.q;
+    const int x_lost = lost_node % geo.q;
+    const int seq_sc_count = checked_pow(k, m, d, geo.q, geo.t - 1 - y_lost);
+    const int num_seq = checked_pow(k, m, d, geo.q, y_lost);
+    auto &runs = geo.repair_sub_chunks[chunk];
+    runs.reserve(num_seq);
+    int index = x_lost * seq_sc_count;
+    for (int ind_seq = 0; ind_seq < num_seq; ind_seq++) {
+      runs.emplace_back(index, seq_sc_count);
+      index += geo.q * seq_sc_count;
+    }
+  }
+  return geo;
+}
+} // namespace
+
+auto ec::ClayGeometry::repair_offsets(int lost_chunk,
+                                      std::size_t sub_chunk_size) const
+    -> std::vector<std::size_t> {
+  auto offsets = std::vector<std::size_t>{};
+  offsets.reserve(repair_sub_chunk_no);
+  for (auto [first, count] : repair_sub_chunks.at(lost_chunk)) {
+    for (int i = 0; i < count; i++) {
+      offsets.push_back(static_cast<std::size_t>(first + i) * sub_chunk_size);
+    }
+  }
+  return offsets;
+}
+
+auto ec::clay_geometry(int k, int m, int d) -> const ClayGeometry & {
+  using key_t = std::tuple<int, int, int>;
+  static std::shared_mutex mtx{};
+  static std::map<key_t, ClayGeometry> table{};
+
+  if (d == 0) {
+    d = k + m - 1;
+  }
+  auto key = key_t{k, m, d};
+  {
+    auto lock = std::shared_lock{mtx};
+    if (auto it = table.find(key); it != table.end()) {
+      return it->second;
+    }
+  }
+  auto geo = compute_geometry(k, m, d);
+  auto lock = std::unique_lock{mtx};
+  // node-based map, references stay valid across later insertions
+  return table.try_emplace(key, std::move(geo)).first->second;
+}
@@ -16,9 +16,11 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <vector>
 
+#include "BS_thread_pool.hpp"
 #include "erasure_code.hh"
 #include "erasure_code_clay.hh"
 #include "erasure_code_factory.hpp"
@@ -41,6 +43,13 @@ static auto pow_int(int a, int x) -> int {
   return power;
 }
 
+/// pool shared by all clay instances to decode independent planes, sized to
+/// the hardware concurrency; `parallel_planes` bounds the share of one call
+static auto plane_pool() -> BS::thread_pool & {
+  static BS::thread_pool pool{};
+  return pool;
+}
+
 template <typename T, typename U>
 constexpr static inline auto
 round_up_to(T n, U d) -> std::make_unsigned_t<std::common_type_t<T, U>> {
@@ -173,6 +182,8 @@ auto ErasureCodeClay::parse(ErasureCodeProfile &profile, ostream *ss) -> int {
   err |= sanity_check_k_m(k, m, ss);
 
   err |= to_int("d", profile, &d, std::to_string(k + m - 1), ss);
+  err |= to_int("parallel_planes", profile, &parallel_planes,
+                DEFAULT_PARALLEL_PLANES, ss);
 
   // check for scalar_mds in profile input
   if (profile.find("scalar_mds") == profile.end() ||
@@ -258,6 +269,13 @@ auto ErasureCodeClay::parse(ErasureCodeProfile &profile, ostream *ss) -> int {
     return err;
   }
 
+  if (parallel_planes < 1) {
+    *ss << "value of parallel_planes " << parallel_planes
+        << " must be at least 1" << std::endl;
+    err = -EINVAL;
+    return err;
+  }
+
   if (mds.profile["plugin"] == "shec") {
     mds.profile["c"] = '2';
     pft.profile["c"] = '2';
@@ -679,45 +697,53 @@ auto ErasureCodeClay::decode_layered(set<int> &erased_chunks,
 
   set_planes_sequential_decoding_order(order.data(), erased_chunks);
 
+  // Planes sharing an intersection score only depend on planes of lower
+  // scores, so each score is processed in three barrier-separated phases:
+  // uncoupling, MDS decoding of the uncoupled planes and re-coupling. Within a
+  // phase every sub-chunk is written by exactly one plane, which keeps the
+  // output identical whether the planes run sequentially or concurrently.
+  std::vector<int> planes;
+  planes.reserve(sub_chunk_no);
   for (int iscore = 0; iscore <= max_iscore; iscore++) {
+    planes.clear();
     for (int z = 0; z < sub_chunk_no; z++) {
       if (order[z] == iscore) {
-        decode_erasures(erased_chunks, z, chunks, sc_size);
+        planes.push_back(z);
       }
     }
 
-    for (int z = 0; z < sub_chunk_no; z++) {
-      if (order[z] == iscore) {
-        get_plane_vector(z, z_vec.data());
-        for (auto node_xy : erased_chunks) {
-          int x = node_xy % q;
-          int y = node_xy / q;
-          int node_sw = y * q + z_vec[y];
-          if (z_vec[y] != x) {
-            if (erased_chunks.count(node_sw) == 0) {
-              recover_type1_erasure(chunks, x, y, z, z_vec.data(), sc_size);
-            } else if (z_vec[y] < x) {
-              EcAssert(erased_chunks.count(node_sw) > 0);
-              EcAssert(z_vec[y] != x);
-              get_coupled_from_uncoupled(
-                  chunks, x, y, z, z_vec.data(), sc_size);
-            }
-          } else {
-            char *C = (*chunks)[node_xy].c_str();
-            char *U = U_buf[node_xy].c_str();
-            memcpy(&C[z * sc_size], &U[z * sc_size], sc_size);
-          }
-        }
-      }
-    } // plane
+    for_each_plane(planes, [&](int z) {
+      uncouple_plane(erased_chunks, z, chunks, sc_size);
+    });
+    for_each_plane(planes, [&](int z) {
+      decode_uncoupled(erased_chunks, z, sc_size);
+    });
+    for_each_plane(planes, [&](int z) {
+      couple_plane(erased_chunks, z, chunks, sc_size);
+    });
   } // iscore, order
 
   return 0;
 }
 
-auto ErasureCodeClay::decode_erasures(const set<int> &erased_chunks, int z,
-                                      map<int, bufferlist> *chunks,
-                                      int sc_size) -> int {
+void ErasureCodeClay::for_each_plane(const std::vector<int> &planes,
+                                     const std::function<void(int)> &fn) {
+  if (parallel_planes <= 1 || planes.size() <= 1) {
+    for (auto z : planes) {
+      fn(z);
+    }
+    return;
+  }
+  auto blocks = std::min<std::size_t>(parallel_planes, planes.size());
+  plane_pool()
+      .submit_loop<std::size_t>(
+          0, planes.size(), [&](std::size_t i) { fn(planes[i]); }, blocks)
+      .get();
+}
+
+void ErasureCodeClay::uncouple_plane(const set<int> &erased_chunks, int z,
+                                     map<int, bufferlist> *chunks,
+                                     int sc_size) {
   // int z_vec[t];
   std::vector<int> z_vec(t);
 
@@ -731,8 +757,8 @@ auto ErasureCodeClay::decode_erasures(const set<int> &erased_chunks, int z,
         if (z_vec[y] < x) {
           get_uncoupled_from_coupled(chunks, x, y, z, z_vec.data(), sc_size);
         } else if (z_vec[y] == x) {
-          char *uncoupled_chunk = U_buf[node_xy].c_str();
-          char *coupled_chunk = (*chunks)[node_xy].c_str();
+          char *uncoupled_chunk = U_buf.at(node_xy).c_str();
+          char *coupled_chunk = chunks->at(node_xy).c_str();
           memcpy(&uncoupled_chunk[z * sc_size],
                  &coupled_chunk[z * sc_size],
                  sc_size);
@@ -744,7 +770,32 @@ auto ErasureCodeClay::decode_erasures(const set<int> &erased_chunks, int z,
       }
     }
   }
-  return decode_uncoupled(erased_chunks, z, sc_size);
+}
+
+void ErasureCodeClay::couple_plane(const set<int> &erased_chunks, int z,
+                                   map<int, bufferlist> *chunks, int sc_size) {
+  // int z_vec[t];
+  std::vector<int> z_vec(t);
+
+  get_plane_vector(z, z_vec.data());
+  for (auto node_xy : erased_chunks) {
+    int x = node_xy % q;
+    int y = node_xy / q;
+    int node_sw = y * q + z_vec[y];
+    if (z_vec[y] != x) {
+      if (erased_chunks.count(node_sw) == 0) {
+        recover_type1_erasure(chunks, x, y, z, z_vec.data(), sc_size);
+      } else if (z_vec[y] < x) {
+        EcAssert(erased_chunks.count(node_sw) > 0);
+        EcAssert(z_vec[y] != x);
+        get_coupled_from_uncoupled(chunks, x, y, z, z_vec.data(), sc_size);
+      }
+    } else {
+      char *C = chunks->at(node_xy).c_str();
+      char *U = U_buf.at(node_xy).c_str();
+      memcpy(&C[z * sc_size], &U[z * sc_size], sc_size);
+    }
+  }
 }
 
 auto ErasureCodeClay::decode_uncoupled(const set<int> &erased_chunks, int z,
@@ -754,10 +805,10 @@ auto ErasureCodeClay::decode_uncoupled(const set<int> &erased_chunks, int z,
 
   for (int i = 0; i < q * t; i++) {
     if (erased_chunks.count(i) == 0) {
-      known_subchunks[i].substr_of(U_buf[i], z * sc_size, sc_size);
+      known_subchunks[i].substr_of(U_buf.at(i), z * sc_size, sc_size);
       all_subchunks[i] = known_subchunks[i];
     } else {
-      all_subchunks[i].substr_of(U_buf[i], z * sc_size, sc_size);
+      all_subchunks[i].substr_of(U_buf.at(i), z * sc_size, sc_size);
     }
     all_subchunks[i].rebuild_aligned_size_and_memory(sc_size, SIMD_ALIGN);
     EcAssert(all_subchunks[i].is_contiguous());
@@ -806,9 +857,9 @@ void ErasureCodeClay::recover_type1_erasure(map<int, bufferlist> *chunks, int x,
   }
 
   erased_chunks.insert(i0);
-  pftsubchunks[i0].substr_of((*chunks)[node_xy], z * sc_size, sc_size);
-  known_subchunks[i1].substr_of((*chunks)[node_sw], z_sw * sc_size, sc_size);
-  known_subchunks[i2].substr_of(U_buf[node_xy], z * sc_size, sc_size);
+  pftsubchunks[i0].substr_of(chunks->at(node_xy), z * sc_size, sc_size);
+  known_subchunks[i1].substr_of(chunks->at(node_sw), z_sw * sc_size, sc_size);
+  known_subchunks[i2].substr_of(U_buf.at(node_xy), z * sc_size, sc_size);
   pftsubchunks[i1] = known_subchunks[i1];
   pftsubchunks[i2] = known_subchunks[i2];
   pftsubchunks[i3].push_back(ptr);
@@ -833,12 +884,12 @@ void ErasureCodeClay::get_coupled_from_uncoupled(map<int, bufferlist> *chunks,
 
   EcAssert(z_vec[y] < x);
   map<int, bufferlist> uncoupled_subchunks;
-  uncoupled_subchunks[2].substr_of(U_buf[node_xy], z * sc_size, sc_size);
-  uncoupled_subchunks[3].substr_of(U_buf[node_sw], z_sw * sc_size, sc_size);
+  uncoupled_subchunks[2].substr_of(U_buf.at(node_xy), z * sc_size, sc_size);
+  uncoupled_subchunks[3].substr_of(U_buf.at(node_sw), z_sw * sc_size, sc_size);
 
   map<int, bufferlist> pftsubchunks;
-  pftsubchunks[0].substr_of((*chunks)[node_xy], z * sc_size, sc_size);
-  pftsubchunks[1].substr_of((*chunks)[node_sw], z_sw * sc_size, sc_size);
+  pftsubchunks[0].substr_of(chunks->at(node_xy), z * sc_size, sc_size);
+  pftsubchunks[1].substr_of(chunks->at(node_sw), z_sw * sc_size, sc_size);
   pftsubchunks[2] = uncoupled_subchunks[2];
   pftsubchunks[3] = uncoupled_subchunks[3];
 
@@ -867,14 +918,14 @@ void ErasureCodeClay::get_uncoupled_from_coupled(map<int, bufferlist> *chunks,
     i3 = 2;
   }
   map<int, bufferlist> coupled_subchunks;
-  coupled_subchunks[i0].substr_of((*chunks)[node_xy], z * sc_size, sc_size);
-  coupled_subchunks[i1].substr_of((*chunks)[node_sw], z_sw * sc_size, sc_size);
+  coupled_subchunks[i0].substr_of(chunks->at(node_xy), z * sc_size, sc_size);
+  coupled_subchunks[i1].substr_of(chunks->at(node_sw), z_sw * sc_size, sc_size);
 
   map<int, bufferlist> pftsubchunks;
   pftsubchunks[0] = coupled_subchunks[0];
   pftsubchunks[1] = coupled_subchunks[1];
-  pftsubchunks[i2].substr_of(U_buf[node_xy], z * sc_size, sc_size);
-  pftsubchunks[i3].substr_of(U_buf[node_sw], z_sw * sc_size, sc_size);
+  pftsubchunks[i2].substr_of(U_buf.at(node_xy), z * sc_size, sc_size);
+  pftsubchunks[i3].substr_of(U_buf.at(node_sw), z_sw * sc_size, sc_size);
   for (int i = 0; i < 3; i++) {
     pftsubchunks[i].rebuild_aligned_size_and_memory(sc_size, SIMD_ALIGN);
   }
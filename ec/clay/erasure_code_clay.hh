@@ -20,15 +20,21 @@
 
 #include "rados/buffer_fwd.h"
 
+#include <functional>
+
 namespace ec {
 class ErasureCodeClay final : public ErasureCode {
 private:
   std::string DEFAULT_K{"4"};
   std::string DEFAULT_M{"2"};
   std::string DEFAULT_W{"8"};
+  std::string DEFAULT_PARALLEL_PLANES{"1"};
   int k = 0, m = 0, d = 0, w = 8;
   int q = 0, t = 0, nu = 0;
   int sub_chunk_no = 0;
+  // number of planes of the same intersection score decoded concurrently,
+  // 1 keeps the original sequential decoding
+  int parallel_planes = 1;
 
   // U_buf is introduced to store the sub-chunks associated with the uncoupled
   std::map<int, ceph::bufferlist> U_buf;
@@ -112,9 +118,14 @@ private:
       const int &lost_node,
       std::vector<std::pair<int, int>> &repair_sub_chunks_ind) const;
 
-  auto decode_erasures(const std::set<int> &erased_chunks, int z,
-                       std::map<int, ceph::bufferlist> *chunks, int sc_size)
-      -> int;
+  void for_each_plane(const std::vector<int> &planes,
+                      const std::function<void(int)> &fn);
+
+  void uncouple_plane(const std::set<int> &erased_chunks, int z,
+                      std::map<int, ceph::bufferlist> *chunks, int sc_size);
+
+  void couple_plane(const std::set<int> &erased_chunks, int z,
+                    std::map<int, ceph::bufferlist> *chunks, int sc_size);
 
   auto decode_uncoupled(const std::set<int> &erased_chunks, int z, int sc_size)
       -> int;
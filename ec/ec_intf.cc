@@ -1,142 +1,152 @@
 #include "ec_intf.hh"
+#include "clay_geometry.hh"
 #include "erasure_code.hh"
 #include "erasure_code_factory.hpp"
 #include "erasure_code_intf.hpp"
 #include "meta.hpp"
+#include "shared_vec_pool.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
 #include <string>
 #include <vector>
 
 using namespace ec;
-void ec::encode(meta::EcType ec_type, int k, int m,
-                const std::vector<char> &raw_data,
-                std::vector<std::vector<char>> &matrix_encoded) {
+namespace {
+std::atomic_size_t copied_bytes_total{0};
+
+auto make_codec(meta::EcType ec_type, ErasureCodeProfile &profile,
+                std::ostringstream &errors) -> ErasureCodeInterfaceRef {
+  switch (ec_type) {
+  case meta::EcType::CLAY:
+    return ErasureCodeClayFactory{}.make(profile, errors);
+  case meta::EcType::RS:
+    return ErasureCodeJerasureFactory{}.make(profile, errors);
+  case meta::EcType::NSYS:
+    return ErasureCodeLonseFactory{}.make(profile, errors);
+  default:
+    throw std::invalid_argument{"unsupported ec type"};
+  }
+}
+
+/// encode straight into pooled chunk buffers
+/// # Note
+/// the data chunks are laid out the way `ErasureCode::encode_prepare` does
+/// (none of the codecs remaps chunks), but in their final buffers, which the
+/// codecs see as static bufferptrs. RS and Clay write the coding chunks in
+/// place; NSYS replaces every chunk with its own buffers, which are copied
+/// back once. The data is gathered from its segments straight into the
+/// chunks.
+auto encode_with_profile(meta::EcType ec_type, int k, int m,
+                         ErasureCodeProfile profile,
+                         const util::GatherList &raw_data)
+    -> std::vector<util::SharedVec> {
   std::ostringstream errors;
-  ErasureCodeProfile profile;
 
   profile["k"] = std::to_string(k);
   profile["m"] = std::to_string(m);
-  // prepare input data bufferlist
-  auto size_in_bytes = raw_data.size();
-  bufferlist in;
-  bufferptr in_ptr(ceph::buffer::create_page_aligned(size_in_bytes));
-  in_ptr.zero();
-  in_ptr.set_length(0);
-  in_ptr.append(raw_data.data(), size_in_bytes);
-  // bufferlist in;
-  in.push_back(in_ptr);
+  auto intf = make_codec(ec_type, profile, errors);
+  auto &codec = dynamic_cast<ErasureCode &>(*intf.get());
 
+  auto blocksize = codec.get_chunk_size(raw_data.size());
+  auto stripe = std::vector<util::SharedVec>(k + m);
+  std::map<int, bufferlist> encoded;
   std::set<int> want_to_encode;
   for (int i = 0; i < k + m; i++) {
+    auto chunk = util::chunk_pool().acquire(blocksize);
+    auto *dst = reinterpret_cast<char *>(chunk.data()); // NOLINT
+    if (i < k) {
+      auto begin = std::min(raw_data.size(), std::size_t{blocksize} * i);
+      auto len = std::min(raw_data.size() - begin, std::size_t{blocksize});
+      raw_data.copy_to(begin, {dst, len});
+      std::memset(dst + len, 0, blocksize - len);
+      copied_bytes_total += len;
+    }
+    encoded[i].push_back(
+        bufferptr(ceph::buffer::create_static(blocksize, dst)));
+    stripe.at(i) = std::move(chunk);
     want_to_encode.insert(i);
   }
 
-  // start to encode
-  if (ec_type == meta::EcType::CLAY) {
-    ErasureCodeInterfaceRef intf =
-        ErasureCodeClayFactory{}.make(profile, errors);
-    auto &clay = dynamic_cast<ErasureCode &>(*intf.get());
-
-    std::map<int, bufferlist> encoded;
-    if (clay.encode(want_to_encode, in, &encoded) != 0) {
-      std::cerr << "Clay encode error" << std::endl;
-    };
-
-    // for Clay, don't need to merge the matrix_row before chunk data
-    for (int i = 0; i < encoded.size(); i++) {
-      std::vector<char> chunk(encoded[i].c_str(),
-                              encoded[i].c_str() + encoded[i].length());
-      matrix_encoded.push_back(chunk);
-    }
-
-  } else if (ec_type == meta::EcType::RS) {
-    ErasureCodeInterfaceRef intf =
-        ErasureCodeJerasureFactory{}.make(profile, errors);
-    auto &jerasure = dynamic_cast<ErasureCode &>(*intf.get());
-
-    std::map<int, bufferlist> encoded;
-    if (jerasure.encode(want_to_encode, in, &encoded) != 0) {
-      std::cerr << "RS encode error" << std::endl;
-    };
-
-    // for RS, don't need to merge the matrix_row before chunk data
-    for (int i = 0; i < encoded.size(); i++) {
-      std::vector<char> chunk(encoded[i].c_str(),
-                              encoded[i].c_str() + encoded[i].length());
-      matrix_encoded.push_back(chunk);
-    }
-
-  } else if (ec_type == meta::EcType::NSYS) {
-    ErasureCodeInterfaceRef intf =
-        ErasureCodeLonseFactory{}.make(profile, errors);
-    auto &NSYS = dynamic_cast<ErasureCode &>(*intf.get());
-
-    std::map<int, bufferlist> encoded;
-    if (NSYS.encode(want_to_encode, in, &encoded) != 0) {
-      std::cerr << "NSYS encode error" << std::endl;
+  if (codec.encode_chunks(want_to_encode, &encoded) != 0) {
+    std::cerr << "encode error: " << errors.str() << std::endl;
+  }
+  for (int i = 0; i < k + m; i++) {
+    auto &out = encoded[i];
+    auto *dst = reinterpret_cast<char *>(stripe.at(i).data()); // NOLINT
+    if (out.is_contiguous() && out.c_str() == dst) {
+      continue;
     }
-    std::vector<std::vector<int>> encode_matrix;
-    NSYS.get_encode_matrix(encode_matrix);
-
-    const int row = encode_matrix.size();    // n*m
-    const int col = encode_matrix[0].size(); // k*m
+    assert(out.length() == blocksize);
+    out.copy(0, blocksize, dst);
+    copied_bytes_total += blocksize;
+  }
+  return stripe;
+}
+} // namespace
 
-    assert(row == (k + m) * m);
-    assert(col == k * m);
+auto ec::encoder::copied_bytes() -> std::size_t { return copied_bytes_total; }
+void ec::encoder::detail::count_copied_bytes(std::size_t bytes) {
+  copied_bytes_total += bytes;
+}
 
-    // TODOfor NSYS, there should be matrix_row before the encoded chunk data
-    for (int i = 0; i < encoded.size(); i++) {
-      std::vector<char> chunk(encoded[i].c_str(),
-                              encoded[i].c_str() + encoded[i].length());
-      matrix_encoded.push_back(chunk);
-    }
-    // for (int i = 0; i < k + m; i++) {
-    //   std::vector<int> matrix_row;
-    //   for (int j = 0; j < m; j++) {
-    //     matrix_row.insert(matrix_row.end(), encode_matrix[i * m + j].begin(),
-    //                       encode_matrix[i * m + j].end());
-    //   }
-    //   std::vector<char> chunk(encoded[i].c_str(),
-    //                           encoded[i].c_str() + encoded[i].length());
-    //   auto matrix_chunk = mergeMatrixChunk(matrix_row, chunk);
-    //   matrix_encoded.push_back(matrix_chunk);
-    // }
+void ec::encode(meta::EcType ec_type, int k, int m,
+                const std::vector<char> &raw_data,
+                std::vector<std::vector<char>> &matrix_encoded) {
+  for (auto &chunk : encode_with_profile(
+           ec_type, k, m, {}, util::GatherList::borrow(raw_data))) {
+    auto bytes = chunk.cspan<char>();
+    matrix_encoded.emplace_back(bytes.begin(), bytes.end());
   }
 }
 
-auto ec::encoder::rs::Encoder::encode(const std::vector<char> &raw_data)
-    -> std::vector<std::vector<char>> {
+auto ec::encoder::rs::Encoder::encode(std::span<const char> raw_data)
+    -> std::vector<util::SharedVec> {
+  return encode(util::GatherList::borrow(raw_data));
+}
+
+auto ec::encoder::rs::Encoder::encode(const util::GatherList &raw_data)
+    -> std::vector<util::SharedVec> {
   auto [k, m] = get_km();
   assert(raw_data.size() % k == 0);
-  auto stripe = std::vector<std::vector<char>>{};
-  stripe.reserve(k + m);
-  ::ec::encode(meta::EcType::RS, k, m, raw_data, stripe);
-  return stripe;
+  auto profile = ErasureCodeProfile{};
+  profile["technique"] = technique_;
+  return encode_with_profile(meta::EcType::RS, k, m, profile, raw_data);
+}
+
+auto ec::encoder::nsys::Encoder::encode(std::span<const char> raw_data)
+    -> std::vector<util::SharedVec> {
+  return encode(util::GatherList::borrow(raw_data));
 }
 
-auto ec::encoder::nsys::Encoder::encode(const std::vector<char> &raw_data)
-    -> std::vector<std::vector<char>> {
+auto ec::encoder::nsys::Encoder::encode(const util::GatherList &raw_data)
+    -> std::vector<util::SharedVec> {
   auto [k, m] = get_km();
   // Modified by Edgar: the `encode` will do the padding automatically
   // assert(raw_data.size() % k == 0);
-  auto stripe = std::vector<std::vector<char>>{};
-  stripe.reserve(k + m);
-  ::ec::encode(meta::EcType::NSYS, k, m, raw_data, stripe);
-  return stripe;
+  return encode_with_profile(meta::EcType::NSYS, k, m, {}, raw_data);
+}
+
+auto ec::encoder::clay::Encoder::encode(std::span<const char> raw_data)
+    -> std::vector<util::SharedVec> {
+  return encode(util::GatherList::borrow(raw_data));
 }
 
-auto ec::encoder::clay::Encoder::encode(const std::vector<char> &raw_data)
-    -> std::vector<std::vector<char>> {
+auto ec::encoder::clay::Encoder::encode(const util::GatherList &raw_data)
+    -> std::vector<util::SharedVec> {
   auto [k, m] = get_km();
   // Modified by Edgar: the `encode` will do the padding automatically
   // assert(raw_data.size() % k == 0);
-  auto stripe = std::vector<std::vector<char>>{};
-  stripe.reserve(k + m);
-  ::ec::encode(meta::EcType::CLAY, k, m, raw_data, stripe);
-  return stripe;
+  auto profile = ErasureCodeProfile{};
+  profile["parallel_planes"] = std::to_string(parallel_planes_);
+  return encode_with_profile(meta::EcType::CLAY, k, m, profile, raw_data);
 }
 
 auto ec::encoder::rs::Encoder::get_sub_chunk_num() -> std::size_t { return 1; }
@@ -145,27 +155,18 @@ auto ec::encoder::nsys::Encoder::get_sub_chunk_num() -> std::size_t {
 }
 auto ec::encoder::clay::Encoder::get_sub_chunk_num() -> std::size_t {
   auto [k, m] = get_km();
-  if (k == 4 && m == 2) {
-    return 8;
-  } else if (k == 6 && m == 3) {
-    return 27;
-  } else if (k == 8 && m == 4) {
-    return 64;
-  } else if (k == 10 && m == 4) {
-    return 256;
-  } else {
-    throw std::runtime_error("Unsupported clay code parameters");
-  }
+  return clay_geometry(k, m).sub_chunk_no;
 }
 auto ec::make_encoder(meta::EcType ec_type, meta::ec_param_t k,
-                      meta::ec_param_t m) -> std::unique_ptr<encoder::Encoder> {
+                      meta::ec_param_t m, std::size_t clay_parallel_planes)
+    -> std::unique_ptr<encoder::Encoder> {
   switch (ec_type) {
   case meta::EcType::RS:
     return std::make_unique<encoder::rs::Encoder>(k, m);
   case meta::EcType::NSYS:
     return std::make_unique<encoder::nsys::Encoder>(k, m);
   case meta::EcType::CLAY:
-    return std::make_unique<encoder::clay::Encoder>(k, m);
+    return std::make_unique<encoder::clay::Encoder>(k, m, clay_parallel_planes);
   default:
     throw std::invalid_argument{"unsupported ec type"};
   }
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace ec {
+
+/// Sub-chunk layout of a Clay code, derived from (k, m, d) alone.
+///
+/// # Note
+/// The layout follows `ErasureCodeClay::parse` and
+/// `ErasureCodeClay::get_repair_subchunks`, so planning code no longer has to
+/// instantiate a codec to learn which sub-chunks a repair reads.
+struct ClayGeometry {
+  int k;
+  int m;
+  int d;
+  /// `q = d - k + 1`, nodes per y-section
+  int q;
+  /// number of y-sections, `(k + m + nu) / q`
+  int t;
+  /// shortened (virtual zero) nodes to make `k + m + nu` a multiple of `q`
+  int nu;
+  /// sub-chunks per chunk, `q ^ t`
+  int sub_chunk_no;
+  /// sub-chunks each helper sends to repair a single chunk, `sub_chunk_no / q`
+  int repair_sub_chunk_no;
+  /// indexed by chunk index in `[0, k + m)`, the `(first, count)` runs of
+  /// sub-chunks read from every helper when the chunk is lost
+  std::vector<std::vector<std::pair<int, int>>> repair_sub_chunks;
+
+  /// byte offsets of the repair sub-chunks of `lost_chunk` within a helper
+  /// chunk, one entry per sub-chunk even if the runs are continuous
+  [[nodiscard]] auto repair_offsets(int lost_chunk,
+                                    std::size_t sub_chunk_size) const
+      -> std::vector<std::size_t>;
+};
+
+/// # Note
+/// The geometry is computed once per (k, m, d) and cached for the lifetime of
+/// the process, the returned reference stays valid.
+///
+/// `d` defaults to `k + m - 1` as in `ErasureCodeClay`.
+///
+/// # Throw
+/// `std::invalid_argument` if (k, m, d) is not a valid Clay code.
+auto clay_geometry(int k, int m, int d = 0) -> const ClayGeometry &;
+
+} // namespace ec
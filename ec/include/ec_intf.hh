@@ -1,10 +1,16 @@
 #pragma once
 
+#include "gather_list.hpp"
 #include "meta.hpp"
+#include "shared_vec.hpp"
 
 #include <boost/numeric/conversion/cast.hpp>
 #include <cassert>
 #include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace ec {
@@ -24,8 +30,15 @@ public:
   Encoder(Encoder &&) = default;
   auto operator=(Encoder &&) -> Encoder & = default;
   virtual ~Encoder() = default;
-  virtual auto encode(const std::vector<char> &raw_data)
-      -> std::vector<std::vector<char>> = 0;
+  /// # Return
+  /// the k + m chunks, backed by buffers of `util::chunk_pool()`
+  virtual auto encode(std::span<const char> raw_data)
+      -> std::vector<util::SharedVec> = 0;
+  /// encode the bytes of the gather list, read in place into the chunks
+  virtual auto encode(const util::GatherList &raw_data)
+      -> std::vector<util::SharedVec> {
+    return encode(raw_data.to_vector());
+  }
   virtual auto get_sub_chunk_num() -> std::size_t = 0;
   virtual auto get_ec_type() -> meta::EcType = 0;
   auto get_km() -> std::pair<meta::ec_param_t, meta::ec_param_t> {
@@ -36,12 +49,22 @@ public:
 
 namespace rs {
 class Encoder : virtual public encoder::Encoder {
+private:
+  std::string technique_;
+
 public:
-  Encoder(meta::ec_param_t k, meta::ec_param_t m)
-      : ec::encoder::Encoder(k, m) {}
+  /// # Note
+  /// `technique` is the jerasure coding technique, e.g. `reed_sol_van` or
+  /// `cauchy_good`, a stripe is only decoded by the technique it is encoded
+  /// with
+  Encoder(meta::ec_param_t k, meta::ec_param_t m,
+          std::string technique = "reed_sol_van")
+      : ec::encoder::Encoder(k, m), technique_(std::move(technique)) {}
 
-  auto encode(const std::vector<char> &raw_data)
-      -> std::vector<std::vector<char>> override;
+  auto encode(std::span<const char> raw_data)
+      -> std::vector<util::SharedVec> override;
+  auto encode(const util::GatherList &raw_data)
+      -> std::vector<util::SharedVec> override;
   auto get_sub_chunk_num() -> std::size_t override;
   auto get_ec_type() -> meta::EcType override;
 };
@@ -51,8 +74,10 @@ class Encoder : virtual public encoder::Encoder {
 public:
   Encoder(meta::ec_param_t k, meta::ec_param_t m)
       : ec::encoder::Encoder(k, m) {}
-  auto encode(const std::vector<char> &raw_data)
-      -> std::vector<std::vector<char>> override;
+  auto encode(std::span<const char> raw_data)
+      -> std::vector<util::SharedVec> override;
+  auto encode(const util::GatherList &raw_data)
+      -> std::vector<util::SharedVec> override;
   auto get_sub_chunk_num() -> std::size_t override;
   auto get_ec_type() -> meta::EcType override;
 };
@@ -60,15 +85,32 @@ public:
 
 namespace clay {
 class Encoder : virtual public encoder::Encoder {
+private:
+  std::size_t parallel_planes_{1};
+
 public:
-  Encoder(meta::ec_param_t k, meta::ec_param_t m)
-      : ec::encoder::Encoder(k, m) {}
-  auto encode(const std::vector<char> &raw_data)
-      -> std::vector<std::vector<char>> override;
+  /// # Note
+  /// `parallel_planes` planes of the same intersection score are encoded
+  /// concurrently on a shared task pool, `1` encodes sequentially. The encoded
+  /// stripe is identical either way.
+  Encoder(meta::ec_param_t k, meta::ec_param_t m,
+          std::size_t parallel_planes = 1)
+      : ec::encoder::Encoder(k, m), parallel_planes_(parallel_planes) {}
+  auto encode(std::span<const char> raw_data)
+      -> std::vector<util::SharedVec> override;
+  auto encode(const util::GatherList &raw_data)
+      -> std::vector<util::SharedVec> override;
   auto get_sub_chunk_num() -> std::size_t override;
   auto get_ec_type() -> meta::EcType override;
 };
 } // namespace clay
+
+/// bytes the encoders copied into chunk buffers since the process started,
+/// including the data chunks themselves
+auto copied_bytes() -> std::size_t;
+namespace detail {
+void count_copied_bytes(std::size_t bytes);
+} // namespace detail
 } // namespace encoder
 /**
  * @description:
@@ -84,6 +126,8 @@ void encode(meta::EcType ec_type, int k, int m,
             std::vector<std::vector<char>> &matrix_encoded);
 
 using encoder_ptr = std::unique_ptr<encoder::Encoder>;
-auto make_encoder(meta::EcType ec_type, meta::ec_param_t k,
-                  meta::ec_param_t m) -> encoder_ptr;
+/// `clay_parallel_planes` only takes effect for Clay, see
+/// `encoder::clay::Encoder`
+auto make_encoder(meta::EcType ec_type, meta::ec_param_t k, meta::ec_param_t m,
+                  std::size_t clay_parallel_planes = 1) -> encoder_ptr;
 } // namespace ec
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "meta.hpp"
+#include "shared_vec.hpp"
+
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace ec::encoder {
+
+/// Encode a stripe incrementally while its blobs are merged.
+///
+/// # Note
+/// - data bytes are written straight into their final chunk buffers and each
+///   append immediately folds the written range into the coding chunks, so the
+///   stripe is complete as soon as the last blob is appended
+/// - only codes that are a plain generator matrix over GF(2^8) are supported:
+///   RS (systematic) and NSYS (every chunk is coded); Clay stripes hold a
+///   single blob and keep using `Encoder`
+/// - the chunk size is fixed up front, the unused tail of the stripe stays
+///   zero as the codecs pad it
+class StreamEncoder {
+private:
+  meta::EcType ec_type_;
+  int k_;
+  int m_;
+  meta::BlobLayout blob_layout_;
+  std::size_t chunk_size_;
+  /// sub-chunks per chunk the generator works on, 1 for RS and m for NSYS
+  int sub_chunk_num_;
+  std::size_t sub_chunk_size_;
+  /// first chunk that is produced by the generator rows, k for systematic
+  int first_coded_chunk_;
+  /// row-major, `(k + m - first_coded_chunk) * sub_chunk_num` rows of
+  /// `k * sub_chunk_num` coefficients
+  std::vector<int> generator_;
+  std::vector<util::SharedVec> chunks_;
+  /// bytes appended so far, in the coordinate of `meta::BlobMeta::offset`
+  std::size_t size_{0};
+
+  void write(int chunk_index, std::size_t offset, const char *data,
+             std::size_t len);
+  void reset();
+
+public:
+  /// `chunk_size` is rounded up to the codec's alignment, see `chunk_size()`
+  StreamEncoder(meta::EcType ec_type, meta::ec_param_t k, meta::ec_param_t m,
+                std::size_t chunk_size, meta::BlobLayout blob_layout);
+
+  /// append one blob to the stripe
+  /// # Note
+  /// - horizontal: the blob continues right after the previous one, crossing
+  ///   chunk boundaries
+  /// - vertical: the blob is split into k equal pieces, piece i goes to chunk
+  ///   i, so its size must be a multiple of k
+  /// # Return
+  /// the offset of the blob, as recorded in `meta::BlobMeta::offset`
+  /// # Throw
+  /// `std::length_error` if the blob does not fit, check with `fits()`
+  auto append(std::span<const char> blob) -> std::size_t;
+
+  /// seal the stripe and start an empty one
+  /// # Return
+  /// the k + m encoded chunks of `chunk_size()` bytes each, backed by buffers
+  /// of `util::chunk_pool()`
+  auto finish() -> std::vector<util::SharedVec>;
+
+  [[nodiscard]] auto fits(std::size_t blob_size) const -> bool {
+    return size_ + blob_size <= capacity();
+  }
+  [[nodiscard]] auto empty() const -> bool { return size_ == 0; }
+  [[nodiscard]] auto size() const -> std::size_t { return size_; }
+  [[nodiscard]] auto capacity() const -> std::size_t {
+    return chunk_size_ * k_;
+  }
+  [[nodiscard]] auto chunk_size() const -> std::size_t { return chunk_size_; }
+  [[nodiscard]] auto get_ec_type() const -> meta::EcType { return ec_type_; }
+  [[nodiscard]] auto get_km() const
+      -> std::pair<meta::ec_param_t, meta::ec_param_t> {
+    return {k_, m_};
+  }
+  [[nodiscard]] auto get_blob_layout() const -> meta::BlobLayout {
+    return blob_layout_;
+  }
+};
+
+} // namespace ec::encoder
@@ -0,0 +1,148 @@
+#include "stream_encoder.hh"
+#include "ec_intf.hh"
+#include "erasure_code.hh"
+#include "erasure_code_factory.hpp"
+#include "erasure_code_intf.hpp"
+#include "shared_vec_pool.hpp"
+
+#include "galois.h"
+#include "reed_sol.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+constexpr int GF_W{8};
+}
+
+ec::encoder::StreamEncoder::StreamEncoder(meta::EcType ec_type,
+                                          meta::ec_param_t k,
+                                          meta::ec_param_t m,
+                                          std::size_t chunk_size,
+                                          meta::BlobLayout blob_layout)
+    : ec_type_(ec_type), k_(k), m_(m), blob_layout_(blob_layout) {
+  if (k <= 0 || m <= 0 || chunk_size == 0) {
+    throw std::invalid_argument("invalid stream encoder parameters");
+  }
+  std::ostringstream errors;
+  ErasureCodeProfile profile;
+  profile["k"] = std::to_string(k);
+  profile["m"] = std::to_string(m);
+
+  switch (ec_type) {
+  case meta::EcType::RS: {
+    // the same matrix as `ErasureCodeJerasureReedSolomonVandermonde`
+    auto intf = ErasureCodeJerasureFactory{}.make(profile, errors);
+    chunk_size_ = intf->get_chunk_size(chunk_size * k);
+    sub_chunk_num_ = 1;
+    first_coded_chunk_ = k;
+    int *matrix = reed_sol_vandermonde_coding_matrix(k, m, GF_W);
+    generator_.assign(matrix, matrix + static_cast<std::size_t>(m) * k);
+    std::free(matrix); // NOLINT
+  } break;
+  case meta::EcType::NSYS: {
+    auto intf = ErasureCodeLonseFactory{}.make(profile, errors);
+    auto &nsys = dynamic_cast<ErasureCode &>(*intf.get());
+    chunk_size_ = nsys.get_chunk_size(chunk_size * k);
+    sub_chunk_num_ = m;
+    first_coded_chunk_ = 0;
+    std::vector<std::vector<int>> encode_matrix;
+    nsys.get_encode_matrix(encode_matrix);
+    generator_.reserve(encode_matrix.size() * k * m);
+    for (const auto &row : encode_matrix) {
+      generator_.insert(generator_.end(), row.begin(), row.end());
+    }
+  } break;
+  default:
+    throw std::invalid_argument(
+        "stream encoder only supports RS and NSYS codes");
+  }
+  sub_chunk_size_ = chunk_size_ / sub_chunk_num_;
+  reset();
+}
+
+void ec::encoder::StreamEncoder::reset() {
+  chunks_.clear();
+  chunks_.reserve(k_ + m_);
+  for (int i = 0; i < k_ + m_; i++) {
+    auto chunk = util::chunk_pool().acquire(chunk_size_);
+    std::memset(chunk.data(), 0, chunk_size_);
+    chunks_.push_back(std::move(chunk));
+  }
+  size_ = 0;
+}
+
+void ec::encoder::StreamEncoder::write(int chunk_index, std::size_t offset,
+                                       const char *data, std::size_t len) {
+  if (first_coded_chunk_ > 0) {
+    // systematic, the data chunk is final
+    std::memcpy(chunks_[chunk_index].span<char>().data() + offset, data, len);
+    detail::count_copied_bytes(len);
+  }
+  const auto cols = static_cast<std::size_t>(k_) * sub_chunk_num_;
+  const auto rows = generator_.size() / cols;
+  while (len > 0) {
+    auto sub_chunk = offset / sub_chunk_size_;
+    auto pos = offset % sub_chunk_size_;
+    auto n = std::min(len, sub_chunk_size_ - pos);
+    auto col = chunk_index * sub_chunk_num_ + sub_chunk;
+    for (std::size_t row = 0; row < rows; row++) {
+      auto coef = generator_[row * cols + col];
+      if (coef == 0) {
+        continue;
+      }
+      auto &coded = chunks_[first_coded_chunk_ + row / sub_chunk_num_];
+      auto *dst = coded.span<char>().data() +
+                  (row % sub_chunk_num_) * sub_chunk_size_ + pos;
+      // `galois_w08_region_multiply` only reads from the source region
+      galois_w08_region_multiply(const_cast<char *>(data), // NOLINT
+                                 coef,
+                                 static_cast<int>(n),
+                                 dst,
+                                 1);
+    }
+    data += n;
+    offset += n;
+    len -= n;
+  }
+}
+
+auto ec::encoder::StreamEncoder::append(std::span<const char> blob)
+    -> std::size_t {
+  if (!fits(blob.size())) {
+    throw std::length_error("blob does not fit in the stripe");
+  }
+  auto offset = size_;
+  if (blob_layout_ == meta::BlobLayout::Horizontal) {
+    auto cur = offset;
+    auto rest = blob;
+    while (!rest.empty()) {
+      auto chunk_index = static_cast<int>(cur / chunk_size_);
+      auto chunk_off = cur % chunk_size_;
+      auto n = std::min(rest.size(), chunk_size_ - chunk_off);
+      write(chunk_index, chunk_off, rest.data(), n);
+      rest = rest.subspan(n);
+      cur += n;
+    }
+  } else {
+    if (blob.size() % k_ != 0) {
+      throw std::invalid_argument("blob not divisible by k");
+    }
+    auto piece = blob.size() / k_;
+    for (int i = 0; i < k_; i++) {
+      write(i, offset / k_, blob.data() + i * piece, piece);
+    }
+  }
+  size_ += blob.size();
+  return offset;
+}
+
+auto ec::encoder::StreamEncoder::finish() -> std::vector<util::SharedVec> {
+  auto stripe = std::move(chunks_);
+  reset();
+  return stripe;
+}
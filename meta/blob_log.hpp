@@ -0,0 +1,364 @@
+#pragma once
+
+#include "meta.hpp"
+#include "meta_exception.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/// An append-only binary log of the registered blobs, in commit order.
+///
+/// The log is a fixed header followed by fixed size records in host byte
+/// order, so that it can be read back by mapping it, without parsing.
+///
+/// ```text
+/// char[8] magic "NCBLOBLG"
+/// u32 version, u32 record size
+/// per blob: u64 blob_id, u64 stripe_id, u64 offset, u64 size
+/// ```
+namespace meta {
+
+struct BlobLogRecord {
+  std::uint64_t blob_id;
+  std::uint64_t stripe_id;
+  /// offset in the merged block
+  std::uint64_t offset;
+  std::uint64_t size;
+
+  static auto of(const BlobMeta &blob) -> BlobLogRecord {
+    return {.blob_id = blob.blob_id,
+            .stripe_id = blob.stripe_id,
+            .offset = blob.offset,
+            .size = blob.size};
+  }
+
+  /// # Note
+  /// the blob index is not logged and left as 0, readers locate a blob by
+  /// its stripe, offset and size
+  [[nodiscard]] auto blob_meta() const -> BlobMeta {
+    auto blob = BlobMeta{};
+    blob.blob_id = blob_id;
+    blob.stripe_id = stripe_id;
+    blob.offset = offset;
+    blob.size = size;
+    return blob;
+  }
+};
+static_assert(std::is_trivially_copyable_v<BlobLogRecord>);
+static_assert(sizeof(BlobLogRecord) == 32);
+
+namespace blob_log {
+
+inline constexpr std::array<char, 8> MAGIC{
+    'N', 'C', 'B', 'L', 'O', 'B', 'L', 'G'};
+inline constexpr std::uint32_t VERSION{1};
+
+struct Header {
+  std::array<char, 8> magic;
+  std::uint32_t version;
+  std::uint32_t record_size;
+};
+static_assert(sizeof(Header) == 16);
+
+inline constexpr Header HEADER{.magic = MAGIC,
+                               .version = VERSION,
+                               .record_size = sizeof(BlobLogRecord)};
+
+inline auto sys_error(const std::string &what) -> Exception {
+  return Exception(what + ", " + std::strerror(errno));
+}
+
+inline void check_header(const Header &header) {
+  if (header.magic != MAGIC) {
+    throw Exception("not a blob log");
+  }
+  if (header.version != VERSION ||
+      header.record_size != sizeof(BlobLogRecord)) {
+    throw Exception("unsupported blob log version " +
+                    std::to_string(header.version));
+  }
+}
+
+/// write all of `data`, retrying short writes
+inline void write_all(int fd, const char *data, std::size_t size) {
+  while (size > 0) {
+    auto written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw sys_error("fail to write the blob log");
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+}
+
+} // namespace blob_log
+
+/// Appends records to a blob log through a buffer.
+/// # Note
+/// - records reach the file when the buffer is full or on `flush`, `clear`
+///   and destruction
+/// - thread safe
+class BlobLogWriter {
+  /// 1 MiB of records
+  static constexpr std::size_t BUFFER_RECORDS{1 << 15};
+
+  std::filesystem::path path_{};
+  int fd_{-1};
+  /// records in the file, without the buffered ones
+  std::size_t written_{0};
+  std::vector<BlobLogRecord> buffer_{};
+  std::mutex mtx_{};
+
+  void flush_locked() {
+    if (buffer_.empty()) {
+      return;
+    }
+    blob_log::write_all(fd_,
+                        reinterpret_cast<const char *>(buffer_.data()),
+                        buffer_.size() * sizeof(BlobLogRecord));
+    written_ += buffer_.size();
+    buffer_.clear();
+  }
+
+  void truncate_locked(std::size_t records) {
+    auto size = sizeof(blob_log::HEADER) + records * sizeof(BlobLogRecord);
+    if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+      throw blob_log::sys_error("fail to truncate the blob log");
+    }
+    written_ = records;
+  }
+
+  void close_locked() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+public:
+  BlobLogWriter() = default;
+  BlobLogWriter(const BlobLogWriter &) = delete;
+  auto operator=(const BlobLogWriter &) -> BlobLogWriter & = delete;
+  BlobLogWriter(BlobLogWriter &&) = delete;
+  auto operator=(BlobLogWriter &&) -> BlobLogWriter & = delete;
+  ~BlobLogWriter() {
+    auto lock = std::lock_guard{mtx_};
+    try {
+      if (fd_ >= 0) {
+        flush_locked();
+      }
+    } catch (...) {
+      // the records of the last buffer are lost
+    }
+    close_locked();
+  }
+
+  /// open the log for appending, an existing log is kept unless `create_new`
+  /// # Note
+  /// a torn last record of an interrupted append is dropped
+  /// # Throw
+  /// `meta::Exception` if the file can not be opened or is not a blob log
+  auto open(const std::filesystem::path &path, bool create_new) -> void {
+    auto lock = std::lock_guard{mtx_};
+    close_locked();
+    buffer_.clear();
+    buffer_.reserve(BUFFER_RECORDS);
+    path_ = path;
+    auto flags = O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC;
+    if (create_new) {
+      flags |= O_TRUNC;
+    }
+    fd_ = ::open(path.c_str(), flags, 0644); // NOLINT
+    if (fd_ < 0) {
+      throw blob_log::sys_error("fail to open blob log " + path.string());
+    }
+    struct stat st {};
+    if (::fstat(fd_, &st) != 0) {
+      throw blob_log::sys_error("fail to stat blob log");
+    }
+    written_ = 0;
+    if (st.st_size == 0) {
+      blob_log::write_all(fd_,
+                          reinterpret_cast<const char *>(&blob_log::HEADER),
+                          sizeof(blob_log::HEADER));
+      return;
+    }
+    auto header = blob_log::Header{};
+    if (::pread(fd_, &header, sizeof(header), 0) != sizeof(header)) {
+      throw Exception("truncated blob log header");
+    }
+    blob_log::check_header(header);
+    auto size = static_cast<std::size_t>(st.st_size);
+    truncate_locked((size - sizeof(header)) / sizeof(BlobLogRecord));
+  }
+
+  [[nodiscard]] auto path() const -> const std::filesystem::path & {
+    return path_;
+  }
+
+  auto append(const BlobLogRecord &record) -> void {
+    auto lock = std::lock_guard{mtx_};
+    buffer_.push_back(record);
+    if (buffer_.size() == BUFFER_RECORDS) {
+      flush_locked();
+    }
+  }
+
+  auto flush() -> void {
+    auto lock = std::lock_guard{mtx_};
+    flush_locked();
+  }
+
+  /// number of records, buffered or written
+  [[nodiscard]] auto size() -> std::size_t {
+    auto lock = std::lock_guard{mtx_};
+    return written_ + buffer_.size();
+  }
+
+  /// drop all the records, buffered or written
+  auto clear() -> void {
+    auto lock = std::lock_guard{mtx_};
+    buffer_.clear();
+    truncate_locked(0);
+  }
+
+  /// keep the first `records` records and drop the others, e.g. to roll the
+  /// log back to a checkpoint
+  /// # Throw
+  /// `meta::Exception` if the log holds fewer records
+  auto truncate(std::size_t records) -> void {
+    auto lock = std::lock_guard{mtx_};
+    flush_locked();
+    if (records > written_) {
+      throw Exception("blob log has " + std::to_string(written_) +
+                      " records, " + std::to_string(records) + " expected");
+    }
+    truncate_locked(records);
+  }
+};
+
+/// Reads the records of a blob log by mapping it.
+/// # Note
+/// - the records appended after opening are not visible, reopen to see them
+/// - the mapping is advised to be read sequentially, and the window after
+///   the one returned by `next_window` is prefetched
+/// - not thread safe
+class BlobLogReader {
+  void *map_{MAP_FAILED};
+  std::size_t map_size_{0};
+  std::span<const BlobLogRecord> records_{};
+  std::size_t cursor_{0};
+
+  /// ask the kernel to read the records [first, first + count) ahead
+  void prefetch(std::size_t first, std::size_t count) const {
+    if (first >= records_.size()) {
+      return;
+    }
+    count = std::min(count, records_.size() - first);
+    static const auto page_size =
+        static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    auto begin = reinterpret_cast<std::uintptr_t>(records_.data() + first);
+    auto end = reinterpret_cast<std::uintptr_t>(records_.data() + first +
+                                                 count);
+    begin -= begin % page_size;
+    // advice only, a failure just loses the prefetch
+    ::madvise(reinterpret_cast<void *>(begin), // NOLINT
+              end - begin,
+              MADV_WILLNEED);
+  }
+
+public:
+  BlobLogReader() = default;
+  BlobLogReader(const BlobLogReader &) = delete;
+  auto operator=(const BlobLogReader &) -> BlobLogReader & = delete;
+  BlobLogReader(BlobLogReader &&) = delete;
+  auto operator=(BlobLogReader &&) -> BlobLogReader & = delete;
+  ~BlobLogReader() { close(); }
+
+  /// map the log and rewind to its first record
+  /// # Throw
+  /// `meta::Exception` if the file can not be mapped or is not a blob log
+  auto open(const std::filesystem::path &path) -> void {
+    close();
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC); // NOLINT
+    if (fd < 0) {
+      throw blob_log::sys_error("fail to open blob log " + path.string());
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw blob_log::sys_error("fail to stat blob log");
+    }
+    auto size = static_cast<std::size_t>(st.st_size);
+    if (size < sizeof(blob_log::Header)) {
+      ::close(fd);
+      throw Exception("truncated blob log header");
+    }
+    map_ = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map_ == MAP_FAILED) {
+      throw blob_log::sys_error("fail to map the blob log");
+    }
+    map_size_ = size;
+    ::madvise(map_, map_size_, MADV_SEQUENTIAL);
+    auto header = blob_log::Header{};
+    std::memcpy(&header, map_, sizeof(header));
+    try {
+      blob_log::check_header(header);
+    } catch (...) {
+      close();
+      throw;
+    }
+    // a torn last record of an interrupted append is ignored
+    auto count = (size - sizeof(header)) / sizeof(BlobLogRecord);
+    records_ = {reinterpret_cast<const BlobLogRecord *>( // NOLINT
+                    static_cast<const char *>(map_) + sizeof(header)),
+                count};
+  }
+
+  auto close() -> void {
+    if (map_ != MAP_FAILED) {
+      ::munmap(map_, map_size_);
+      map_ = MAP_FAILED;
+    }
+    records_ = {};
+    cursor_ = 0;
+  }
+
+  [[nodiscard]] auto is_open() const -> bool { return map_ != MAP_FAILED; }
+  [[nodiscard]] auto size() const -> std::size_t { return records_.size(); }
+  [[nodiscard]] auto remaining() const -> std::size_t {
+    return records_.size() - cursor_;
+  }
+
+  /// the next `max_count` records at most, empty at the end of the log
+  /// # Note
+  /// the span points into the mapping and is valid until the reader is
+  /// reopened or destroyed
+  auto next_window(std::size_t max_count) -> std::span<const BlobLogRecord> {
+    auto window = records_.subspan(cursor_, std::min(max_count, remaining()));
+    cursor_ += window.size();
+    prefetch(cursor_, max_count);
+    return window;
+  }
+};
+
+} // namespace meta
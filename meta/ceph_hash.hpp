@@ -1,5 +1,6 @@
 #pragma once
 #include <cassert>
+#include <cstdint>
 #include <rados/buffer_fwd.h>
 #include <sys/stat.h>
 #define mix(a, b, c)                                                           \
@@ -88,4 +89,14 @@ inline unsigned ceph_str_hash_rjenkins(const char *str, unsigned length) {
   mix(a, b, c);
 
   return c;
-}
\ No newline at end of file
+}
+/// `ceph_str_hash_rjenkins` of the 8 little endian bytes of an integer,
+/// without formatting it or walking the bytes
+inline unsigned ceph_u64_hash_rjenkins(std::uint64_t value) {
+  constexpr __u32 GOLDEN_RATIO = 0x9e3779b9;
+  __u32 a = GOLDEN_RATIO + static_cast<__u32>(value);
+  __u32 b = GOLDEN_RATIO + static_cast<__u32>(value >> 32); // NOLINT
+  __u32 c = sizeof(value);
+  mix(a, b, c);
+  return c;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "meta.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+namespace meta {
+
+/// A consistent snapshot of the state of a `MetaCore`, written together
+/// with the PG map by `MetaCore::checkpoint`.
+/// # Note
+/// stripes are committed out of id order. Every stripe below `replay_from`,
+/// and every stripe of `committed_above`, is in the PG map and in the first
+/// `blob_log_records` records of the blob log. The other stripes found in
+/// the store are replayed from their records on recovery.
+struct Checkpoint {
+  std::uint64_t sequence;
+  /// milliseconds since the epoch
+  std::int64_t created_at;
+  stripe_id_t start_at;
+  stripe_id_t stripe_counter;
+  /// the lowest stripe id that was not committed
+  stripe_id_t replay_from;
+  /// the stripes committed above `replay_from`, ascending
+  std::vector<stripe_id_t> committed_above;
+  std::uint64_t blob_log_records;
+  std::vector<PGMeta> placement;
+
+  MSGPACK_DEFINE(sequence, created_at, start_at, stripe_counter, replay_from,
+                 committed_above, blob_log_records, placement);
+};
+
+/// Tracks the lowest stripe id that is not committed yet. The stripes
+/// committed above it are kept until the ids below them are committed.
+/// # Note
+/// - expects the stripe ids to be allocated contiguously from `reset`, an id
+///   that is neither committed nor abandoned holds the watermark back
+/// - not thread safe
+class CommitWatermark {
+  stripe_id_t low_{0};
+  std::set<stripe_id_t> above_{};
+  /// ids above `low_` that will never be committed, not reported by `above`
+  std::set<stripe_id_t> abandoned_{};
+
+  auto advance() -> void {
+    while (true) {
+      if (!above_.empty() && *above_.begin() == low_) {
+        above_.erase(above_.begin());
+      } else if (!abandoned_.empty() && *abandoned_.begin() == low_) {
+        abandoned_.erase(abandoned_.begin());
+      } else {
+        return;
+      }
+      low_++;
+    }
+  }
+
+public:
+  auto reset(stripe_id_t low) -> void {
+    low_ = low;
+    above_.clear();
+    abandoned_.clear();
+  }
+
+  auto commit(stripe_id_t stripe_id) -> void {
+    if (stripe_id < low_) {
+      return;
+    }
+    abandoned_.erase(stripe_id);
+    above_.insert(stripe_id);
+    advance();
+  }
+
+  /// let the watermark pass an id whose stripe failed to register or store
+  /// # Note
+  /// nothing if the id is committed
+  auto abandon(stripe_id_t stripe_id) -> void {
+    if (stripe_id < low_ || above_.contains(stripe_id)) {
+      return;
+    }
+    abandoned_.insert(stripe_id);
+    advance();
+  }
+
+  [[nodiscard]] auto low() const -> stripe_id_t { return low_; }
+  [[nodiscard]] auto above() const -> std::vector<stripe_id_t> {
+    return {above_.begin(), above_.end()};
+  }
+};
+
+/// what `MetaCore::load_meta` recovered
+struct RecoveryStats {
+  std::uint64_t sequence;
+  stripe_id_t replay_from;
+  /// stripes committed after the checkpoint, replayed from the store
+  std::size_t tail_stripes;
+  std::chrono::microseconds elapsed;
+};
+
+/// what `MetaCore::verify` found in the store
+struct VerifyReport {
+  Checkpoint checkpoint;
+  /// stripes in the persisted PG map
+  std::size_t indexed_stripes;
+  /// stripe records in the store
+  std::size_t stored_stripes;
+  /// stored and not indexed, at or above `replay_from`, replayed on recovery
+  std::size_t tail_stripes;
+  /// stored and not indexed below `replay_from`, lost on recovery
+  std::size_t unindexed_stripes;
+  /// indexed without a stripe record
+  std::size_t missing_stripes;
+  /// stored in the partition of another PG
+  std::size_t misplaced_stripes;
+  /// records that do not decode or carry another stripe id
+  std::size_t corrupt_stripes;
+  /// one past the largest stored stripe id, `0` if there is none
+  stripe_id_t stored_end;
+  std::size_t blob_log_records;
+
+  [[nodiscard]] auto ok() const -> bool {
+    return unindexed_stripes == 0 && missing_stripes == 0 &&
+           misplaced_stripes == 0 && corrupt_stripes == 0 &&
+           blob_log_records >= checkpoint.blob_log_records;
+  }
+};
+
+} // namespace meta
@@ -79,6 +79,18 @@ inline auto format_as(const BlobLayout &layout) -> std::string_view {
     return {"Vertical"};
   }
 };
+/// the merge sizes a stripe is built with, chosen per epoch by the adaptive
+/// size controller
+/// # Note
+/// epoch `0` is a build with the fixed sizes of the profile, which are not
+/// recorded
+struct StripeTuning {
+  std::uint32_t epoch;
+  std::size_t partition_size;
+  std::size_t merge_size;
+
+  MSGPACK_DEFINE(epoch, partition_size, merge_size);
+};
 struct StripeMeta {
   stripe_id_t stripe_id;
   ec_param_t k;
@@ -88,9 +100,10 @@ struct StripeMeta {
   std::size_t chunk_size;
   std::vector<BlobMeta> blobs;
   std::vector<ChunkMeta> chunks;
+  StripeTuning tuning;
 
   MSGPACK_DEFINE(stripe_id, k, m, ec_type, blob_layout, chunk_size, blobs,
-                 chunks);
+                 chunks, tuning);
 };
 
 /// type alias for chunk
@@ -135,6 +148,12 @@ struct BlobMeta {
 
   MSGPACK_DEFINE(blob_id, stripe_id, blob_index, size, offset);
 };
+/// the record of a blob, its size and offset are kept by the stripe only
+struct BlobRef {
+  stripe_id_t stripe_id;
+  /// position of the blob in `StripeMeta::blobs`
+  blob_index_t position;
+};
 
 /// type alias for PG
 struct PGMeta;
@@ -144,6 +163,8 @@ struct PGMeta {
   ec_param_t k;
   ec_param_t m;
   std::vector<disk_id_t> disk_list;
+
+  MSGPACK_DEFINE(pg_id, k, m, disk_list);
 };
 
 enum class MetaType : std::uint8_t {
@@ -155,9 +176,72 @@ enum class MetaType : std::uint8_t {
   Chunk = 5,
   PG_MAP = 6,
   STRIPE_RANGE = 7,
+  /// a segment of the stripes of a PG, see `PGToStripeMap`
+  PG_SEGMENT = 8,
+  /// the latest checkpoint of a core, see `Checkpoint`
+  CHECKPOINT = 9,
 };
-/// key for the meta data entry
-using key_t = std::array<char, sizeof(MetaType) + sizeof(std::size_t)>;
+/// key for the meta data entry, laid out as
+/// ```text
+/// u8 type, u32 partition and u64 id big endian, u8 sub index
+/// ```
+/// so that the keys sort by type, partition, id and sub index.
+/// # Note
+/// - the partition of a stripe or chunk key is the PG of the stripe, which
+///   keeps the stripes of a PG contiguous, and decides the store shard of
+///   the key, see `MetaStore`
+/// - the sub index tells apart the entries of one id, e.g. the chunks of a
+///   stripe, it is `0` for the other entries
+/// - the checkpoint and the PG map are in the `ROOT_PARTITION`, so that
+///   they are in one shard and written together
+using key_t = std::array<char, sizeof(MetaType) + sizeof(std::uint32_t) +
+                                   sizeof(std::uint64_t) +
+                                   sizeof(std::uint8_t)>;
+using partition_t = std::uint32_t;
+inline constexpr partition_t ROOT_PARTITION{0};
+
+inline auto make_key(MetaType type, partition_t partition, std::uint64_t id,
+                     std::uint8_t sub = 0) -> key_t {
+  auto key = key_t{};
+  key[0] = static_cast<char>(type);
+  for (std::size_t i = 0; i < sizeof(partition); i++) {
+    key[sizeof(type) + i] =
+        static_cast<char>(partition >> (8 * (sizeof(partition) - 1 - i)));
+  }
+  for (std::size_t i = 0; i < sizeof(id); i++) {
+    key[sizeof(type) + sizeof(partition) + i] =
+        static_cast<char>(id >> (8 * (sizeof(id) - 1 - i)));
+  }
+  key.back() = static_cast<char>(sub);
+  return key;
+}
+
+inline auto key_type(const key_t &key) -> MetaType {
+  return static_cast<MetaType>(key[0]);
+}
+
+inline auto key_partition(const key_t &key) -> partition_t {
+  partition_t partition{0};
+  for (std::size_t i = 0; i < sizeof(partition); i++) {
+    partition = (partition << 8) | // NOLINT
+                static_cast<std::uint8_t>(key[sizeof(MetaType) + i]);
+  }
+  return partition;
+}
+
+inline auto key_id(const key_t &key) -> std::uint64_t {
+  std::uint64_t id{0};
+  for (std::size_t i = 0; i < sizeof(id); i++) {
+    id = (id << 8) | // NOLINT
+         static_cast<std::uint8_t>(
+             key[sizeof(MetaType) + sizeof(partition_t) + i]);
+  }
+  return id;
+}
+
+inline auto key_sub(const key_t &key) -> std::uint8_t {
+  return static_cast<std::uint8_t>(key.back());
+}
 
 } // namespace meta
 
@@ -0,0 +1,213 @@
+#pragma once
+
+#include "meta.hpp"
+#include "meta_exception.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace meta {
+
+namespace detail {
+/// One shard of a size bounded LRU.
+/// # Note
+/// - `V` is expected to be cheap to copy, e.g. a `shared_ptr` or a POD
+/// - an entry larger than the capacity of the shard is not cached
+template <typename K, typename V> class LruShard {
+  struct Entry {
+    K key;
+    V value;
+    std::size_t bytes;
+  };
+  using list_t = std::list<Entry>;
+
+  std::mutex mtx_{};
+  list_t lru_{};
+  std::unordered_map<K, typename list_t::iterator> index_{};
+  std::size_t bytes_{0};
+  std::size_t capacity_;
+
+public:
+  explicit LruShard(std::size_t capacity) : capacity_{capacity} {}
+
+  auto get(const K &key) -> std::optional<V> {
+    auto lock = std::lock_guard{mtx_};
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return std::nullopt;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->value;
+  }
+
+  /// insert or replace an entry
+  /// # Return
+  /// the number of evicted entries
+  auto put(const K &key, V value, std::size_t bytes) -> std::size_t {
+    auto lock = std::lock_guard{mtx_};
+    if (auto it = index_.find(key); it != index_.end()) {
+      bytes_ -= it->second->bytes;
+      lru_.erase(it->second);
+      index_.erase(it);
+    }
+    if (bytes > capacity_) {
+      return 0;
+    }
+    std::size_t evicted{0};
+    while (bytes_ + bytes > capacity_) {
+      auto &victim = lru_.back();
+      bytes_ -= victim.bytes;
+      index_.erase(victim.key);
+      lru_.pop_back();
+      evicted++;
+    }
+    lru_.push_front(
+        Entry{.key = key, .value = std::move(value), .bytes = bytes});
+    index_.emplace(key, lru_.begin());
+    bytes_ += bytes;
+    return evicted;
+  }
+
+  [[nodiscard]] auto resident_bytes() -> std::size_t {
+    auto lock = std::lock_guard{mtx_};
+    return bytes_;
+  }
+};
+} // namespace detail
+
+/// MetaCache keeps the recently used stripe and blob meta data in memory, in
+/// front of the `MetaStore`.
+/// # Note
+/// - stripes are cached as immutable `shared_ptr<const StripeMeta>`, so a
+///   hit hands out a reference instead of a deserialized copy
+/// - both maps are sharded by id and bounded by an approximate number of
+///   resident bytes, see `resident_size`
+/// - thread safe
+class MetaCache {
+public:
+  struct Config {
+    /// byte budget of the stripe meta data
+    std::size_t stripe_bytes;
+    /// byte budget of the blob meta data
+    std::size_t blob_bytes;
+    /// number of shards of each map
+    std::size_t shards;
+  };
+  static constexpr Config DEFAULT_CONFIG{
+      .stripe_bytes = std::size_t{192} << 20,
+      .blob_bytes = std::size_t{64} << 20,
+      .shards = 16,
+  };
+
+  struct Stats {
+    std::size_t stripe_hits;
+    std::size_t stripe_misses;
+    std::size_t blob_hits;
+    std::size_t blob_misses;
+    std::size_t evictions;
+    std::size_t resident_bytes;
+  };
+
+  /// approximate memory held by a cached entry
+  static auto resident_size(const StripeMeta &stripe) -> std::size_t {
+    return sizeof(StripeMeta) + stripe.blobs.size() * sizeof(BlobMeta) +
+           stripe.chunks.size() * sizeof(ChunkMeta);
+  }
+  static auto resident_size(const BlobMeta & /*blob*/) -> std::size_t {
+    return sizeof(BlobMeta);
+  }
+
+private:
+  using stripe_shard_t =
+      detail::LruShard<stripe_id_t, std::shared_ptr<const StripeMeta>>;
+  using blob_shard_t = detail::LruShard<blob_id_t, BlobMeta>;
+
+  std::vector<std::unique_ptr<stripe_shard_t>> stripe_shards_{};
+  std::vector<std::unique_ptr<blob_shard_t>> blob_shards_{};
+  std::atomic_size_t stripe_hits_{0};
+  std::atomic_size_t stripe_misses_{0};
+  std::atomic_size_t blob_hits_{0};
+  std::atomic_size_t blob_misses_{0};
+  std::atomic_size_t evictions_{0};
+
+  template <typename Shards, typename K>
+  static auto shard_of(Shards &shards, const K &key) -> auto & {
+    return *shards[std::hash<K>{}(key) % shards.size()];
+  }
+
+public:
+  explicit MetaCache(Config config = DEFAULT_CONFIG) {
+    if (config.shards == 0) {
+      throw Exception("meta cache needs at least one shard");
+    }
+    stripe_shards_.reserve(config.shards);
+    blob_shards_.reserve(config.shards);
+    for (std::size_t i = 0; i < config.shards; i++) {
+      stripe_shards_.push_back(std::make_unique<stripe_shard_t>(
+          config.stripe_bytes / config.shards));
+      blob_shards_.push_back(
+          std::make_unique<blob_shard_t>(config.blob_bytes / config.shards));
+    }
+  }
+
+  /// # Return
+  /// the cached stripe, or `nullptr` on a miss
+  auto get_stripe(stripe_id_t stripe_id) -> std::shared_ptr<const StripeMeta> {
+    auto stripe = shard_of(stripe_shards_, stripe_id).get(stripe_id);
+    if (stripe.has_value()) {
+      stripe_hits_++;
+      return std::move(stripe).value();
+    }
+    stripe_misses_++;
+    return nullptr;
+  }
+
+  /// insert or replace a stripe, evicting the least recently used ones
+  auto put_stripe(std::shared_ptr<const StripeMeta> stripe) -> void {
+    auto stripe_id = stripe->stripe_id;
+    auto bytes = resident_size(*stripe);
+    evictions_ += shard_of(stripe_shards_, stripe_id)
+                      .put(stripe_id, std::move(stripe), bytes);
+  }
+
+  auto get_blob(blob_id_t blob_id) -> std::optional<BlobMeta> {
+    auto blob = shard_of(blob_shards_, blob_id).get(blob_id);
+    if (blob.has_value()) {
+      blob_hits_++;
+    } else {
+      blob_misses_++;
+    }
+    return blob;
+  }
+
+  auto put_blob(const BlobMeta &blob) -> void {
+    evictions_ += shard_of(blob_shards_, blob.blob_id)
+                      .put(blob.blob_id, blob, resident_size(blob));
+  }
+
+  [[nodiscard]] auto stats() -> Stats {
+    std::size_t resident_bytes{0};
+    for (auto &shard : stripe_shards_) {
+      resident_bytes += shard->resident_bytes();
+    }
+    for (auto &shard : blob_shards_) {
+      resident_bytes += shard->resident_bytes();
+    }
+    return {.stripe_hits = stripe_hits_.load(),
+            .stripe_misses = stripe_misses_.load(),
+            .blob_hits = blob_hits_.load(),
+            .blob_misses = blob_misses_.load(),
+            .evictions = evictions_.load(),
+            .resident_bytes = resident_bytes};
+  }
+};
+
+} // namespace meta
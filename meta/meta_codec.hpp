@@ -0,0 +1,315 @@
+#pragma once
+
+#include "meta.hpp"
+#include "meta_exception.hpp"
+#include "serde.hpp"
+#include "span.hpp"
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// Binary encoding of the per-stripe meta data records.
+///
+/// Every record starts with a format byte, followed by little endian base
+/// 128 varints. A stripe record of format 1 is laid out as
+///
+/// ```text
+/// u8 format
+/// varint stripe_id, k, m
+/// u8 ec_type, blob_layout
+/// varint chunk_size
+/// [format 2] varint tuning epoch, partition_size, merge_size
+/// varint blob count
+///   per blob: varint blob_id, zigzag (blob_index - position),
+///             varint size, zigzag (offset - end of the previous blob)
+/// varint chunk count
+///   per chunk: u8 chunk_index, zigzag (size - chunk_size)
+/// ```
+///
+/// The stripe id of the blobs and chunks is the one of the stripe and is not
+/// repeated. A blob record is a `BlobRef` and only points into its stripe.
+///
+/// A stripe built with adaptive merge sizes is of format 2, which adds its
+/// `StripeTuning`; the others stay of format 1, so the records of the stores
+/// built before read the same.
+namespace meta::codec {
+
+inline constexpr std::uint8_t FORMAT_V1{0x01};
+inline constexpr std::uint8_t FORMAT_V2{0x02};
+
+class Writer {
+  std::string &out_;
+
+public:
+  explicit Writer(std::string &out) : out_{out} {}
+
+  void u8(std::uint8_t value) { out_.push_back(static_cast<char>(value)); }
+
+  void varint(std::uint64_t value) {
+    constexpr std::uint64_t LOW_BITS{0x7f};
+    constexpr std::uint64_t MORE{0x80};
+    while (value >= MORE) {
+      out_.push_back(static_cast<char>((value & LOW_BITS) | MORE));
+      value >>= 7;
+    }
+    out_.push_back(static_cast<char>(value));
+  }
+
+  /// a difference of two unsigned values, small in magnitude in both
+  /// directions
+  void zigzag(std::uint64_t lhs, std::uint64_t rhs) {
+    auto delta = static_cast<std::int64_t>(lhs - rhs);
+    varint((static_cast<std::uint64_t>(delta) << 1) ^
+           static_cast<std::uint64_t>(delta >> 63)); // NOLINT
+  }
+};
+
+class Reader {
+  util::bytes_span buf_;
+  std::size_t pos_{0};
+
+public:
+  explicit Reader(util::bytes_span buf) : buf_{buf} {}
+
+  [[nodiscard]] auto position() const -> std::size_t { return pos_; }
+  [[nodiscard]] auto done() const -> bool { return pos_ == buf_.size(); }
+
+  auto u8() -> std::uint8_t {
+    if (pos_ == buf_.size()) {
+      throw Exception("truncated meta record");
+    }
+    return static_cast<std::uint8_t>(buf_[pos_++]);
+  }
+
+  auto varint() -> std::uint64_t {
+    constexpr std::uint8_t LOW_BITS{0x7f};
+    constexpr std::uint8_t MORE{0x80};
+    std::uint64_t value{0};
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      auto byte = u8();
+      value |= static_cast<std::uint64_t>(byte & LOW_BITS) << shift;
+      if ((byte & MORE) == 0) {
+        return value;
+      }
+    }
+    throw Exception("malformed varint in meta record");
+  }
+
+  /// inverse of `Writer::zigzag`, returns `lhs` given `rhs`
+  auto zigzag(std::uint64_t rhs) -> std::uint64_t {
+    auto raw = varint();
+    auto delta = (raw >> 1) ^ (~(raw & 1) + 1);
+    return rhs + delta;
+  }
+};
+
+/// # Return
+/// the format of the record, at most `latest`
+inline auto check_format(Reader &reader, std::uint8_t latest = FORMAT_V1)
+    -> std::uint8_t {
+  auto format = reader.u8();
+  if (format < FORMAT_V1 || format > latest) {
+    throw Exception("unsupported meta record format " +
+                    std::to_string(format));
+  }
+  return format;
+}
+
+inline auto read_ec_type(Reader &reader) -> EcType {
+  auto ec_type = reader.u8();
+  if (ec_type > static_cast<std::uint8_t>(EcType::CLAY)) {
+    throw Exception("unknown ec type " + std::to_string(ec_type));
+  }
+  return static_cast<EcType>(ec_type);
+}
+
+inline auto read_blob_layout(Reader &reader) -> BlobLayout {
+  auto layout = reader.u8();
+  if (layout > static_cast<std::uint8_t>(BlobLayout::Vertical)) {
+    throw Exception("unknown blob layout " + std::to_string(layout));
+  }
+  return static_cast<BlobLayout>(layout);
+}
+
+inline void encode(const StripeMeta &stripe, std::string &out) {
+  auto writer = Writer{out};
+  auto tuned = stripe.tuning.epoch != 0;
+  writer.u8(tuned ? FORMAT_V2 : FORMAT_V1);
+  writer.varint(stripe.stripe_id);
+  writer.varint(boost::numeric_cast<std::uint64_t>(stripe.k));
+  writer.varint(boost::numeric_cast<std::uint64_t>(stripe.m));
+  writer.u8(static_cast<std::uint8_t>(stripe.ec_type));
+  writer.u8(static_cast<std::uint8_t>(stripe.blob_layout));
+  writer.varint(stripe.chunk_size);
+  if (tuned) {
+    writer.varint(stripe.tuning.epoch);
+    writer.varint(stripe.tuning.partition_size);
+    writer.varint(stripe.tuning.merge_size);
+  }
+  writer.varint(stripe.blobs.size());
+  std::size_t blob_end{0};
+  for (std::size_t i = 0; i < stripe.blobs.size(); i++) {
+    const auto &blob = stripe.blobs[i];
+    if (blob.stripe_id != stripe.stripe_id) {
+      throw Exception("blob is not in the encoded stripe");
+    }
+    writer.varint(blob.blob_id);
+    writer.zigzag(blob.blob_index, i);
+    writer.varint(blob.size);
+    writer.zigzag(blob.offset, blob_end);
+    blob_end = blob.offset + blob.size;
+  }
+  writer.varint(stripe.chunks.size());
+  for (const auto &chunk : stripe.chunks) {
+    if (chunk.stripe_id != stripe.stripe_id) {
+      throw Exception("chunk is not in the encoded stripe");
+    }
+    writer.u8(chunk.chunk_index);
+    writer.zigzag(chunk.size, stripe.chunk_size);
+  }
+}
+
+inline void encode(const BlobRef &ref, std::string &out) {
+  auto writer = Writer{out};
+  writer.u8(FORMAT_V1);
+  writer.varint(ref.stripe_id);
+  writer.varint(ref.position);
+}
+
+inline void decode(util::bytes_span buf, BlobRef &ref) {
+  auto reader = Reader{buf};
+  check_format(reader);
+  ref.stripe_id = reader.varint();
+  ref.position = boost::numeric_cast<blob_index_t>(reader.varint());
+}
+
+/// A stripe record decoded on demand.
+/// # Note
+/// - only the fixed header is decoded on construction, a blob is decoded by
+///   scanning the blobs before it, the chunks are only decoded by
+///   `materialize`
+/// - the view does not own the record
+class StripeView {
+  util::bytes_span buf_;
+  /// the header, without blobs and chunks
+  StripeMeta header_{};
+  std::size_t blob_count_{};
+  /// where the blob list starts in `buf_`
+  std::size_t blobs_at_{};
+
+  struct BlobCursor {
+    Reader reader;
+    std::size_t position;
+    std::size_t blob_end;
+  };
+
+  auto blob_cursor() const -> BlobCursor {
+    return {.reader = Reader{buf_.subspan(blobs_at_)},
+            .position = 0,
+            .blob_end = 0};
+  }
+
+  auto next_blob(BlobCursor &cursor) const -> BlobMeta {
+    auto &reader = cursor.reader;
+    auto blob = BlobMeta{};
+    blob.blob_id = reader.varint();
+    blob.stripe_id = header_.stripe_id;
+    blob.blob_index =
+        boost::numeric_cast<blob_index_t>(reader.zigzag(cursor.position));
+    blob.size = reader.varint();
+    blob.offset = reader.zigzag(cursor.blob_end);
+    cursor.blob_end = blob.offset + blob.size;
+    cursor.position++;
+    return blob;
+  }
+
+public:
+  /// # Throw
+  /// `meta::Exception` if the record is truncated, of an unknown format, or
+  /// of an unknown EC type or blob layout
+  explicit StripeView(util::bytes_span buf) : buf_{buf} {
+    auto reader = Reader{buf_};
+    auto format = check_format(reader, FORMAT_V2);
+    header_.stripe_id = reader.varint();
+    header_.k = boost::numeric_cast<ec_param_t>(reader.varint());
+    header_.m = boost::numeric_cast<ec_param_t>(reader.varint());
+    header_.ec_type = read_ec_type(reader);
+    header_.blob_layout = read_blob_layout(reader);
+    header_.chunk_size = reader.varint();
+    if (format == FORMAT_V2) {
+      header_.tuning.epoch =
+          boost::numeric_cast<std::uint32_t>(reader.varint());
+      header_.tuning.partition_size = reader.varint();
+      header_.tuning.merge_size = reader.varint();
+    }
+    blob_count_ = reader.varint();
+    blobs_at_ = reader.position();
+  }
+
+  /// the stripe without its blobs and chunks
+  [[nodiscard]] auto header() const -> const StripeMeta & { return header_; }
+  [[nodiscard]] auto blob_count() const -> std::size_t { return blob_count_; }
+
+  /// the blob at `position` of the blob list
+  [[nodiscard]] auto blob(std::size_t position) const -> BlobMeta {
+    if (position >= blob_count_) {
+      throw Exception("blob position out of the stripe");
+    }
+    auto cursor = blob_cursor();
+    auto blob = next_blob(cursor);
+    while (cursor.position <= position) {
+      blob = next_blob(cursor);
+    }
+    return blob;
+  }
+
+  [[nodiscard]] auto materialize() const -> StripeMeta {
+    auto stripe = header_;
+    stripe.blobs.reserve(blob_count_);
+    auto cursor = blob_cursor();
+    for (std::size_t i = 0; i < blob_count_; i++) {
+      stripe.blobs.push_back(next_blob(cursor));
+    }
+    auto &reader = cursor.reader;
+    auto chunk_count = reader.varint();
+    stripe.chunks.reserve(chunk_count);
+    for (std::size_t i = 0; i < chunk_count; i++) {
+      auto chunk = ChunkMeta{};
+      chunk.stripe_id = stripe.stripe_id;
+      chunk.chunk_index = reader.u8();
+      chunk.size = reader.zigzag(stripe.chunk_size);
+      stripe.chunks.push_back(chunk);
+    }
+    if (!reader.done()) {
+      throw Exception("trailing bytes in stripe record");
+    }
+    return stripe;
+  }
+};
+
+inline void decode(util::bytes_span buf, StripeMeta &stripe) {
+  stripe = StripeView{buf}.materialize();
+}
+
+} // namespace meta::codec
+
+namespace serde {
+template <>
+inline void serialize(const meta::StripeMeta &obj, std::string &buf) {
+  meta::codec::encode(obj, buf);
+}
+template <>
+inline void deserialize(util::bytes_span buf, meta::StripeMeta &obj) {
+  meta::codec::decode(buf, obj);
+}
+template <> inline void serialize(const meta::BlobRef &obj, std::string &buf) {
+  meta::codec::encode(obj, buf);
+}
+template <>
+inline void deserialize(util::bytes_span buf, meta::BlobRef &obj) {
+  meta::codec::decode(buf, obj);
+}
+} // namespace serde
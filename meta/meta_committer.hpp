@@ -0,0 +1,191 @@
+#pragma once
+
+#include "meta.hpp"
+#include "meta_store.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace meta {
+
+/// MetaCommitter owns the write path of the metadata store: write batches
+/// submitted by concurrent stripe registrations are grouped and flushed with
+/// a single database write.
+/// # Note
+/// - a group is flushed once it holds `max_stripes` registrations or its
+///   first registration has waited for `max_delay`, whichever comes first
+/// - the PG map, the blob records and the meta cache are only updated on the
+///   commit thread, after the group is durable, in submission order
+/// - the stripes of a group whose write fails are passed to `on_abort` on
+///   the commit thread
+class MetaCommitter {
+public:
+  struct Policy {
+    std::size_t max_stripes;
+    std::chrono::microseconds max_delay;
+  };
+  /// called on the commit thread with each committed stripe
+  using on_commit_t =
+      std::function<void(const std::shared_ptr<const StripeMeta> &)>;
+  /// called on the commit thread with each stripe whose write failed
+  using on_abort_t = on_commit_t;
+
+  struct Stats {
+    std::size_t groups;
+    std::size_t stripes;
+  };
+
+private:
+  struct Request {
+    MetaWriteBatch batch;
+    std::shared_ptr<const StripeMeta> stripe;
+    std::promise<stripe_id_t> done;
+  };
+
+  MetaStore &store_;
+  Policy policy_;
+  on_commit_t on_commit_;
+  on_abort_t on_abort_;
+
+  std::mutex mtx_{};
+  std::condition_variable pending_cv_{};
+  std::condition_variable idle_cv_{};
+  std::vector<Request> pending_{};
+  bool committing_{false};
+  bool stop_{false};
+  Stats stats_{0, 0};
+  std::thread worker_{};
+
+  void run() {
+    auto group = std::vector<Request>{};
+    auto lock = std::unique_lock<std::mutex>{mtx_};
+    while (true) {
+      pending_cv_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+      if (pending_.empty()) {
+        // stopped and drained
+        return;
+      }
+      // let the group fill up until it is full or old enough
+      pending_cv_.wait_for(lock, policy_.max_delay, [this] {
+        return stop_ || pending_.size() >= policy_.max_stripes;
+      });
+      std::swap(group, pending_);
+      committing_ = true;
+      lock.unlock();
+
+      commit(group);
+      group.clear();
+
+      lock.lock();
+      committing_ = false;
+      if (pending_.empty()) {
+        idle_cv_.notify_all();
+      }
+    }
+  }
+
+  void commit(std::vector<Request> &group) {
+    auto batches = std::vector<MetaWriteBatch *>{};
+    batches.reserve(group.size());
+    for (auto &request : group) {
+      batches.push_back(&request.batch);
+    }
+    try {
+      store_.write(batches);
+    } catch (...) {
+      auto error = std::current_exception();
+      for (auto &request : group) {
+        if (on_abort_) {
+          on_abort_(request.stripe);
+        }
+        request.done.set_exception(error);
+      }
+      return;
+    }
+    for (auto &request : group) {
+      try {
+        if (on_commit_) {
+          on_commit_(request.stripe);
+        }
+        request.done.set_value(request.stripe->stripe_id);
+      } catch (...) {
+        request.done.set_exception(std::current_exception());
+      }
+    }
+    auto lock = std::lock_guard<std::mutex>{mtx_};
+    stats_.groups++;
+    stats_.stripes += group.size();
+  }
+
+public:
+  MetaCommitter(MetaStore &store, Policy policy, on_commit_t on_commit,
+                on_abort_t on_abort = {})
+      : store_{store}, policy_{policy}, on_commit_{std::move(on_commit)},
+        on_abort_{std::move(on_abort)} {
+    if (policy_.max_stripes == 0) {
+      throw Exception("max_stripes of a commit group is 0");
+    }
+    worker_ = std::thread([this] { run(); });
+  }
+  MetaCommitter(const MetaCommitter &) = delete;
+  auto operator=(const MetaCommitter &) -> MetaCommitter & = delete;
+  MetaCommitter(MetaCommitter &&) = delete;
+  auto operator=(MetaCommitter &&) -> MetaCommitter & = delete;
+  /// commit the pending registrations and stop
+  ~MetaCommitter() {
+    {
+      auto lock = std::lock_guard<std::mutex>{mtx_};
+      stop_ = true;
+    }
+    pending_cv_.notify_all();
+    worker_.join();
+  }
+
+  /// queue a stripe registration
+  /// # Return
+  /// a future that becomes ready with the id of `stripe` once the batch is
+  /// written, and durable unless the store is opened without
+  /// `MetaStore::Options::sync_writes`, or holds the exception of the failed
+  /// write
+  auto submit(MetaWriteBatch batch, std::shared_ptr<const StripeMeta> stripe)
+      -> std::future<stripe_id_t> {
+    auto request = Request{
+        .batch = std::move(batch), .stripe = std::move(stripe), .done = {}};
+    auto future = request.done.get_future();
+    auto notify = false;
+    {
+      auto lock = std::lock_guard<std::mutex>{mtx_};
+      if (stop_) {
+        throw Exception("metadata committer is stopped");
+      }
+      pending_.push_back(std::move(request));
+      notify = pending_.size() == 1 || pending_.size() >= policy_.max_stripes;
+    }
+    if (notify) {
+      pending_cv_.notify_one();
+    }
+    return future;
+  }
+
+  /// block until every submitted registration is committed
+  void wait_idle() {
+    auto lock = std::unique_lock<std::mutex>{mtx_};
+    idle_cv_.wait(lock, [this] { return pending_.empty() && !committing_; });
+  }
+
+  [[nodiscard]] auto stats() -> Stats {
+    auto lock = std::lock_guard<std::mutex>{mtx_};
+    return stats_;
+  }
+};
+
+} // namespace meta
@@ -1,8 +1,14 @@
 #pragma once
 
+#include "blob_log.hpp"
 #include "ceph_hash.hpp"
+#include "checkpoint.hpp"
 #include "meta.hpp"
+#include "meta_cache.hpp"
+#include "meta_codec.hpp"
+#include "meta_committer.hpp"
 #include "meta_store.hpp"
+#include "placement.hpp"
 
 #include <boost/numeric/conversion/cast.hpp>
 // #include <glog/logging.h>
@@ -10,20 +16,28 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <filesystem>
-#include <fstream>
 #include <functional>
+#include <future>
 #include <iterator>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <random>
+#include <span>
 #include <string>
 #include <sys/types.h>
+#include <thread>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -66,6 +80,8 @@ private:
   std::vector<meta::BlobMeta> blobs;
   /// PG id to which this stripe belongs
   std::optional<pg_id_t> pg_id;
+  /// the merge sizes the stripe is built with, if chosen adaptively
+  std::optional<StripeTuning> tuning;
 
 public:
   /// Setters for StripeMetaRecord
@@ -112,39 +128,10 @@ public:
     this->pg_id = pgId;
     return *this;
   }
-};
-
-class BlobRecorder {
-  std::filesystem::path path_{};
-  std::fstream file_{};
-
-public:
-  auto open(const std::filesystem::path &path, bool create_new) -> void {
-    path_ = path;
-    auto stat = std::ios::out | std::ios::in;
-    if (create_new) {
-      stat |= std::ios::trunc;
-    }
-    file_.open(path.generic_string(), stat);
-    if (!file_.is_open()) {
-      throw std::runtime_error("failed to open blob record file");
-    }
-  }
-
-  auto clear() -> void {
-    // remove the content of the file
-    file_.close();
-    file_.open(path_.generic_string(),
-               std::ios::out | std::ios::in | std::ios::trunc);
-  }
-
-  auto put_record(meta::blob_id_t blob_id) { file_ << blob_id << '\n'; }
-  auto next_record() -> std::optional<meta::blob_id_t> {
-    meta::blob_id_t blob_id{};
-    if (file_ >> blob_id) {
-      return blob_id;
-    }
-    return std::nullopt;
+  /// Set the merge sizes of the stripe and return a reference to self
+  auto setTuning(StripeTuning tuning) -> StripeMetaRecord & {
+    this->tuning = tuning;
+    return *this;
   }
 };
 
@@ -154,7 +141,13 @@ private:
   MetaStore metaStore_{};
   meta::stripe_id_t start_at{0};
   std::atomic<meta::stripe_id_t> stripe_id_counter_{start_at};
-  BlobRecorder blobRecorder_{};
+  BlobLogWriter blobLog_{};
+  /// opened by the first `next_blob_records` after `launch` or `clear_blobs`
+  BlobLogReader blobLogReader_{};
+  /// orders the commits against `checkpoint`, guards `watermark_`
+  std::mutex commit_mtx_{};
+  CommitWatermark watermark_{};
+  std::uint64_t checkpoint_seq_{0};
 
   std::string core_name_{};
   std::size_t _pg_num{};
@@ -164,39 +157,269 @@ private:
   std::map<node_id_t, ip_t> worker_to_ip_{};
   std::map<node_id_t, std::vector<disk_id_t>> node_to_disk_{};
   std::map<disk_id_t, node_id_t> disk_to_node_{};
-
+  /// resolved from `pg_` whenever the PGs are registered or replaced
+  std::shared_ptr<const PlacementTable> placement_{
+      std::make_shared<const PlacementTable>()};
+  MetaCommitter::Policy commit_policy_{
+      .max_stripes = 64, .max_delay = std::chrono::milliseconds{2}};
+  std::unique_ptr<MetaCache> cache_{std::make_unique<MetaCache>()};
+  MetaStore::Options store_options_{MetaStore::DEFAULT_OPTIONS};
+  /// declared last, it writes to the store and the blob log until it is
+  /// destroyed
+  std::unique_ptr<MetaCommitter> committer_{};
+
+  /// a key of an entry without a PG, spread over the partitions by the hash
+  /// of the value
   template <typename I>
   static auto make_prefixed_key(MetaType type, I value) -> meta::key_t {
     static_assert(is_hashable<I>::value, "template type is not hashable");
-    auto key = key_t{};
-    std::memcpy(key.data(), &type, sizeof(type));
     auto value_hash = std::hash<I>{}(value);
-    std::memcpy(key.data() + sizeof(type), &value_hash, sizeof(value_hash));
-    return key;
+    return make_key(type, ceph_u64_hash_rjenkins(value_hash), value_hash);
+  }
+
+  /// the stripes, and the chunks of a stripe, are ordered in their PG
+  auto stripe_key(stripe_id_t stripe_id) const -> meta::key_t {
+    return make_key(MetaType::Stripe, select_pg(stripe_id), stripe_id);
+  }
+  /// the chunk index is the sub index of the key, see `key_t`
+  auto chunk_key(chunk_id_t chunk_id) const -> meta::key_t {
+    return make_key(MetaType::Chunk,
+                    select_pg(chunk_id.stripe_id),
+                    chunk_id.stripe_id,
+                    chunk_id.chunk_index);
+  }
+
+  /// the checkpoint and the PG map manifest of the core
+  auto root_key(MetaType type) const -> meta::key_t {
+    return make_key(
+        type, ROOT_PARTITION, std::hash<std::string>{}(core_name_));
+  }
+
+  /// # Note
+  /// - a store holds the meta data of a single core, the segments are not
+  ///   keyed by the core name
+  /// - the segments are in the root partition with the manifest, ordered by
+  ///   PG, the tail segment last
+  static auto pg_segment_key() -> PGToStripeMap::segment_key_fn {
+    constexpr unsigned SEGMENT_BITS = 32;
+    constexpr std::uint64_t SEGMENT_MASK =
+        (std::uint64_t{1} << SEGMENT_BITS) - 1;
+    return [](pg_id_t pg_id, std::size_t segment) {
+      return make_key(MetaType::PG_SEGMENT,
+                      ROOT_PARTITION,
+                      (std::uint64_t{pg_id} << SEGMENT_BITS) |
+                          (segment & SEGMENT_MASK));
+    };
+  }
+
+  auto placement_list() const -> std::vector<PGMeta> {
+    auto placement = std::vector<PGMeta>{};
+    placement.reserve(pg_.size());
+    for (const auto &[pg_id, pg_meta] : pg_) {
+      placement.push_back(pg_meta);
+    }
+    return placement;
+  }
+
+  /// the stored stripes at or above the checkpoint that it does not cover,
+  /// in id order
+  auto scan_tail(const Checkpoint &checkpoint) -> std::vector<StripeMeta> {
+    auto covered = std::unordered_set<stripe_id_t>(
+        checkpoint.committed_above.begin(), checkpoint.committed_above.end());
+    auto tail = std::vector<StripeMeta>{};
+    for (std::size_t pg = 0; pg < placement_->pg_count(); pg++) {
+      metaStore_.scanRaw(MetaType::Stripe,
+                         static_cast<partition_t>(pg),
+                         checkpoint.replay_from,
+                         std::numeric_limits<std::uint64_t>::max(),
+                         [&](const meta::key_t &key, util::bytes_span value) {
+                           if (!covered.contains(key_id(key))) {
+                             tail.push_back(
+                                 codec::StripeView{value}.materialize());
+                           }
+                           return true;
+                         });
+    }
+    std::sort(tail.begin(), tail.end(), [](const auto &a, const auto &b) {
+      return a.stripe_id < b.stripe_id;
+    });
+    return tail;
   }
 
 public:
   MetaCore() = delete;
   MetaCore(std::string core_name) : core_name_{std::move(core_name)} {}
 
+  /// Write a checkpoint of the meta data: the stripe counter, the
+  /// placement, the PG map and the position of the blob log.
+  /// # Note
+  /// - the registrations go on meanwhile, the stripes committed after the
+  ///   commit state is taken are replayed on recovery, see `Checkpoint`
+  /// - the checkpoint and the PG map are written in one batch to the root
+  ///   partition, a crash leaves either the new or the previous checkpoint
+  /// - not thread safe with itself
+  auto checkpoint() -> Checkpoint {
+    auto checkpoint = Checkpoint{};
+    {
+      auto lock = std::lock_guard{commit_mtx_};
+      blobLog_.flush();
+      checkpoint.blob_log_records = blobLog_.size();
+      checkpoint.replay_from = watermark_.low();
+      checkpoint.committed_above = watermark_.above();
+    }
+    checkpoint.sequence = ++checkpoint_seq_;
+    checkpoint.created_at =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    checkpoint.start_at = start_at;
+    checkpoint.stripe_counter = stripe_id_counter_;
+    checkpoint.placement = placement_list();
+    auto batch = metaStore_.getWriteBatch();
+    batch.putMeta(root_key(MetaType::CHECKPOINT), checkpoint);
+    metaStore_.persist_pg_map(
+        batch, root_key(MetaType::PG_MAP), pg_segment_key());
+    return checkpoint;
+  }
+
+  /// a checkpoint once the pending registrations are committed, so that
+  /// nothing is left to replay
   auto persist() -> void {
-    auto name_hash = std::hash<std::string>{}(core_name_);
-    auto key = make_prefixed_key(meta::MetaType::PG_MAP, name_hash);
-    metaStore_.persist_pg_map_as(key);
-    key = make_prefixed_key(MetaType::STRIPE_RANGE, name_hash);
-    std::array<meta::stripe_id_t, 2> range = {start_at, stripe_id_counter_};
-    metaStore_.putMeta(key, range);
+    if (committer_) {
+      committer_->wait_idle();
+    }
+    checkpoint();
+  }
+
+  /// Recover the persisted meta data from the latest checkpoint.
+  /// # Note
+  /// - the persisted placement replaces the one of `registerPG`
+  /// - the stripes stored after the checkpoint are replayed from their
+  ///   records: one range scan per PG from `Checkpoint::replay_from`, they
+  ///   are added to the PG map and the blob log is rolled back to the
+  ///   checkpoint and appended with their blobs, in stripe id order
+  /// - the PG map is loaded by `threads` loaders in the background, see
+  ///   `PGToStripeMap::load`, only the PGs with replayed stripes are waited
+  ///   for
+  /// - call it before any registration
+  /// # Throw
+  /// `meta::NotFound` if there is no checkpoint, `meta::Exception` if the
+  /// blob log is shorter than the checkpoint
+  auto load_meta(std::size_t threads = std::thread::hardware_concurrency())
+      -> RecoveryStats {
+    auto started = std::chrono::steady_clock::now();
+    auto checkpoint = Checkpoint{};
+    metaStore_.getMeta(root_key(MetaType::CHECKPOINT), checkpoint);
+    if (!checkpoint.placement.empty()) {
+      usePlacement(checkpoint.placement);
+    }
+    metaStore_.load_pg_map(
+        root_key(MetaType::PG_MAP), pg_segment_key(), threads);
+    auto tail = scan_tail(checkpoint);
+    for (const auto &stripe : tail) {
+      metaStore_.addStripeToPG(select_pg(stripe.stripe_id), stripe.stripe_id);
+    }
+    auto counter = checkpoint.stripe_counter;
+    if (!tail.empty()) {
+      counter = std::max(counter, tail.back().stripe_id + 1);
+    }
+    {
+      auto lock = std::lock_guard{commit_mtx_};
+      blobLogReader_.close();
+      blobLog_.truncate(checkpoint.blob_log_records);
+      for (const auto &stripe : tail) {
+        for (const auto &blob : stripe.blobs) {
+          blobLog_.append(BlobLogRecord::of(blob));
+        }
+      }
+      blobLog_.flush();
+      // the stripes that were in flight at the crash are lost
+      watermark_.reset(counter);
+    }
+    start_at = checkpoint.start_at;
+    stripe_id_counter_ = counter;
+    checkpoint_seq_ = checkpoint.sequence;
+    return RecoveryStats{
+        .sequence = checkpoint.sequence,
+        .replay_from = checkpoint.replay_from,
+        .tail_stripes = tail.size(),
+        .elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started)};
   }
 
-  auto load_meta() -> void {
-    auto hash = std::hash<std::string>{}(core_name_);
-    auto key = make_prefixed_key(meta::MetaType::PG_MAP, hash);
-    metaStore_.load_pg_map_from(key);
-    key = make_prefixed_key(meta::MetaType::STRIPE_RANGE, hash);
-    std::array<meta::stripe_id_t, 2> range{};
-    metaStore_.getMeta(key, range);
-    this->start_at = range[0];
-    this->stripe_id_counter_ = range[1];
+  /// Check the persisted meta data against the latest checkpoint: every
+  /// stripe record is read and matched with the persisted PG map.
+  /// # Note
+  /// meant for offline maintenance, call it after `launch` and
+  /// `registerPG` instead of `load_meta`
+  /// # Throw
+  /// `meta::NotFound` if there is no checkpoint
+  auto verify(std::size_t threads = std::thread::hardware_concurrency())
+      -> VerifyReport {
+    auto report = VerifyReport{};
+    metaStore_.getMeta(root_key(MetaType::CHECKPOINT), report.checkpoint);
+    const auto &checkpoint = report.checkpoint;
+    if (!checkpoint.placement.empty()) {
+      usePlacement(checkpoint.placement);
+    }
+    metaStore_.load_pg_map(
+        root_key(MetaType::PG_MAP), pg_segment_key(), threads);
+    for (std::size_t pg = 0; pg < placement_->pg_count(); pg++) {
+      auto pg_id = static_cast<pg_id_t>(pg);
+      auto indexed = pgStripes(pg_id);
+      report.indexed_stripes += indexed.size();
+      auto next = indexed.begin();
+      metaStore_.scanRaw(
+          MetaType::Stripe,
+          pg_id,
+          0,
+          std::numeric_limits<std::uint64_t>::max(),
+          [&](const meta::key_t &key, util::bytes_span value) {
+            auto stripe_id = key_id(key);
+            report.stored_stripes++;
+            report.stored_end = std::max(report.stored_end, stripe_id + 1);
+            for (; next != indexed.end() && *next < stripe_id; ++next) {
+              report.missing_stripes++;
+            }
+            if (next != indexed.end() && *next == stripe_id) {
+              ++next;
+            } else if (stripe_id >= checkpoint.replay_from) {
+              report.tail_stripes++;
+            } else {
+              report.unindexed_stripes++;
+            }
+            if (select_pg(stripe_id) != pg_id) {
+              report.misplaced_stripes++;
+            }
+            try {
+              if (codec::StripeView{value}.materialize().stripe_id !=
+                  stripe_id) {
+                report.corrupt_stripes++;
+              }
+            } catch (Exception &) {
+              report.corrupt_stripes++;
+            }
+            return true;
+          });
+      for (; next != indexed.end(); ++next) {
+        report.missing_stripes++;
+      }
+    }
+    report.blob_log_records = blobLog_.size();
+    return report;
+  }
+
+  /// Fold the stripes to replay into a new checkpoint, and compact the
+  /// store, so that the next recovery has nothing to replay.
+  /// # Note
+  /// meant for offline maintenance, call it after `launch` and
+  /// `registerPG` instead of `load_meta`
+  auto compact(std::size_t threads = std::thread::hardware_concurrency())
+      -> Checkpoint {
+    load_meta(threads);
+    auto checkpoint = this->checkpoint();
+    metaStore_.compact();
+    return checkpoint;
   }
 
   auto launch(const std::filesystem::path &path, bool create_new) -> void {
@@ -214,19 +437,87 @@ public:
         throw meta::Exception(e.what());
       }
     }
-    metaStore_.open(path.generic_string());
-    blobRecorder_.open(path / "blob_record", create_new);
+    metaStore_.open(path.generic_string(), store_options_);
+    blobLog_.open(path / "blob_log", create_new);
+    blobLogReader_.close();
+    committer_ = std::make_unique<MetaCommitter>(
+        metaStore_, commit_policy_, [this](const auto &stripe) {
+          {
+            auto lock = std::lock_guard{commit_mtx_};
+            for (const auto &blob : stripe->blobs) {
+              blobLog_.append(BlobLogRecord::of(blob));
+            }
+            watermark_.commit(stripe->stripe_id);
+          }
+          for (const auto &blob : stripe->blobs) {
+            cache_->put_blob(blob);
+          }
+          cache_->put_stripe(stripe);
+        },
+        [this](const auto &stripe) { abandonStripe(stripe->stripe_id); });
+  }
+
+  /// group commit policy of `registerStripe`, takes effect on `launch`
+  auto setCommitPolicy(MetaCommitter::Policy policy) -> void {
+    commit_policy_ = policy;
+  }
+
+  [[nodiscard]] auto commitStats() -> MetaCommitter::Stats {
+    return committer_ ? committer_->stats() : MetaCommitter::Stats{0, 0};
   }
 
-  auto clear_blobs() -> void { blobRecorder_.clear(); }
+  /// shards, block cache and bloom filters of the store, takes effect on
+  /// `launch`
+  auto setStoreOptions(MetaStore::Options options) -> void {
+    store_options_ = options;
+  }
+
+  /// capacity of the meta cache, drops the cached entries
+  /// # Note
+  /// not thread safe, call it before `launch`
+  auto setCacheConfig(MetaCache::Config config) -> void {
+    cache_ = std::make_unique<MetaCache>(config);
+  }
 
-  auto next_blobs_record() -> std::optional<meta::blob_id_t> {
-    return blobRecorder_.next_record();
+  [[nodiscard]] auto cacheStats() -> MetaCache::Stats {
+    return cache_->stats();
+  }
+
+  auto clear_blobs() -> void {
+    if (committer_) {
+      committer_->wait_idle();
+    }
+    auto lock = std::lock_guard{commit_mtx_};
+    blobLogReader_.close();
+    blobLog_.clear();
+  }
+
+  /// The next window of the blob log, in commit order.
+  /// # Note
+  /// - the log is mapped on the first call, the blobs committed after it are
+  ///   not visible until `clear_blobs`
+  /// - the records carry the stripe and the extent of the blobs, the blob
+  ///   records of the store are not looked up
+  /// - not thread safe, the span is valid until `clear_blobs`
+  /// # Return
+  /// at most `max_count` records, empty at the end of the log
+  auto next_blob_records(std::size_t max_count)
+      -> std::span<const BlobLogRecord> {
+    if (!blobLogReader_.is_open()) {
+      if (committer_) {
+        committer_->wait_idle();
+      }
+      blobLog_.flush();
+      blobLogReader_.open(blobLog_.path());
+    }
+    return blobLogReader_.next_window(max_count);
   }
 
   auto setStripeIdCounter(meta::stripe_id_t counter) {
     start_at = counter;
     stripe_id_counter_ = counter;
+    auto lock = std::lock_guard{commit_mtx_};
+    watermark_.reset(counter);
   }
 
   auto registerDisk(DiskMeta disk) {
@@ -234,6 +525,10 @@ public:
     disk_to_node_[disk.id] = disk.node_id;
   }
 
+  /// place the PGs on the registered disks
+  /// # Note
+  /// the disks and workers are expected to be registered before, the
+  /// placement table is resolved from them
   auto registerPG(std::size_t pg_num, ec_param_t k, ec_param_t m) {
     _pg_num = pg_num;
     _k = k;
@@ -252,7 +547,6 @@ public:
       numbers[i] = i;
     }
 
-    srand((unsigned)time(0));
     for (std::size_t i = 0; i < _pg_num; i++) {
       auto pg_id = meta::pg_id_t(i);
       auto pg_meta = PGMeta{};
@@ -265,15 +559,43 @@ public:
       // random select k+m nodes
       for (std::size_t j = 0; j < _k + _m; j++) {
         auto node = nodes.at(numbers[j]);
-        // random select a disk from each node
+        // random select a disk from each node, from the same seeded engine
+        // so that the placement only depends on the cluster layout
         auto &disks = node_to_disk_.at(node);
-        auto disk_idx = rand() % disks.size();
+        auto disk_idx = gen() % disks.size();
         auto disk_id = disks[disk_idx];
         pg_meta.disk_list.push_back(disk_id);
       }
 
       pg_[pg_id] = pg_meta;
     }
+    placement_ = std::make_shared<const PlacementTable>(
+        pg_, disk_to_node_, worker_to_ip_);
+  }
+
+  /// replace the placement with a persisted one
+  /// # Throw
+  /// `meta::Exception` if it does not match the registered PGs and disks
+  auto usePlacement(std::vector<PGMeta> placement) -> void {
+    if (placement.size() != _pg_num) {
+      throw meta::Exception("persisted placement has a different pg_num");
+    }
+    auto pgs = std::map<pg_id_t, PGMeta>{};
+    for (auto &pg_meta : placement) {
+      if (pg_meta.k != _k || pg_meta.m != _m) {
+        throw meta::Exception("persisted placement has a different k, m");
+      }
+      for (auto disk_id : pg_meta.disk_list) {
+        if (!disk_to_node_.contains(disk_id)) {
+          throw meta::Exception("persisted placement has an unknown disk");
+        }
+      }
+      auto pg_id = pg_meta.pg_id;
+      pgs[pg_id] = std::move(pg_meta);
+    }
+    placement_ = std::make_shared<const PlacementTable>(
+        pgs, disk_to_node_, worker_to_ip_);
+    pg_ = std::move(pgs);
   }
 
   auto registerWorker(node_id_t worker_id, ip_t ip) {
@@ -283,50 +605,36 @@ public:
   auto next_stripe_id() -> stripe_id_t { return stripe_id_counter_++; }
   auto current_stripe_id() const -> stripe_id_t { return stripe_id_counter_; }
 
-  auto select_pg(meta::stripe_id_t stripe_id) -> meta::pg_id_t {
-    auto s = std::to_string(stripe_id);
-    auto pg_id = ceph_str_hash_rjenkins(s.c_str(), s.size()) % _pg_num;
-    return pg_id;
+  /// # Note
+  /// the stripe id is hashed as an integer, see `PlacementTable::select_pg`
+  auto select_pg(meta::stripe_id_t stripe_id) const -> meta::pg_id_t {
+    return placement_->select_pg(stripe_id);
   }
 
-  auto pg_to_worker_nodes(meta::pg_id_t pg_id) -> std::vector<node_id_t> {
-    if (pg_.find(pg_id) == pg_.end()) {
-      throw meta::Exception("pg_id not found");
-    }
-    auto &disks = pg_[pg_id].disk_list;
-    auto nodes = std::vector<node_id_t>{};
-    nodes.reserve(disks.size());
-    std::transform(disks.cbegin(),
-                   disks.cend(),
-                   std::back_inserter(nodes),
-                   [&disk_to_node_ = this->disk_to_node_](auto &disk_id) {
-                     return disk_to_node_.at(disk_id);
-                   });
-    return nodes;
-  }
-
-  auto pg_to_worker_ip(meta::pg_id_t pg_id) -> std::vector<ip_t> {
-    if (pg_.find(pg_id) == pg_.end()) {
-      throw meta::Exception("pg_id not found");
-    }
-    auto &disks = pg_[pg_id].disk_list;
-    auto ips = std::vector<ip_t>{};
-    ips.reserve(disks.size());
-    std::transform(disks.cbegin(),
-                   disks.cend(),
-                   std::back_inserter(ips),
-                   [this](auto &disk_id) {
-                     return worker_to_ip_.at(disk_to_node_.at(disk_id));
-                   });
-    return ips;
+  /// the resolved placement of a PG
+  /// # Note
+  /// valid until the PGs are registered again or `usePlacement`
+  auto placement(meta::pg_id_t pg_id) const -> const PGPlacement & {
+    return placement_->pg(pg_id);
+  }
+
+  auto placementTable() const -> std::shared_ptr<const PlacementTable> {
+    return placement_;
+  }
+
+  auto pg_to_worker_nodes(meta::pg_id_t pg_id) const
+      -> const std::vector<node_id_t> & {
+    return placement_->pg(pg_id).nodes;
+  }
+
+  auto pg_to_worker_ip(meta::pg_id_t pg_id) const
+      -> const std::vector<ip_t> & {
+    return placement_->pg(pg_id).ips;
   }
 
   auto
   pg_to_disks(meta::pg_id_t pg_id) const -> const std::vector<disk_id_t> & {
-    if (pg_.find(pg_id) == pg_.end()) {
-      throw meta::Exception("pg_id not found");
-    }
-    return pg_.at(pg_id).disk_list;
+    return placement_->pg(pg_id).disks;
   }
 
   auto worker_ip(node_id_t worker_id) const -> const ip_t & {
@@ -336,11 +644,30 @@ public:
     return worker_to_ip_.at(worker_id);
   }
 
+  /// Give up a stripe id that will never be committed, e.g. of a stripe
+  /// that failed to register or to store, so that the checkpoints do not
+  /// wait for it.
+  /// # Note
+  /// nothing if the stripe is committed, see `CommitWatermark::abandon`
+  auto abandonStripe(stripe_id_t stripe_id) -> void {
+    auto lock = std::lock_guard{commit_mtx_};
+    watermark_.abandon(stripe_id);
+  }
+
   /// Make meta data for a stripe and its blobs, and register them to the
   /// store
+  /// # Note
+  /// The meta data is serialized by the caller and committed together with
+  /// other registrations, see `MetaCommitter`. The stripe is visible in the
+  /// PG map and the blob records once the future is ready.
   /// # Return
-  /// id for this stripe
-  auto registerStripe(StripeMetaRecord record) -> stripe_id_t {
+  /// a future of the id for this stripe, ready when the meta data is written,
+  /// see `MetaCommitter::submit`
+  /// # Throw
+  /// `meta::Exception` if the record is incomplete, write errors are
+  /// reported through the future. The stripe id is abandoned either way,
+  /// see `abandonStripe`
+  auto registerStripe(StripeMetaRecord record) -> std::future<stripe_id_t> {
     // get a write batch
     auto batch = metaStore_.getWriteBatch();
     // make stripe meta data
@@ -351,96 +678,114 @@ public:
     } else {
       stripe_meta.stripe_id = stripe_id_counter_++;
     }
-    // ec k and m
-    if (!record.ec_km.has_value()) {
-      throw meta::Exception("ec_km is required to register a stripe");
-    }
-    std::tie(stripe_meta.k, stripe_meta.m) = record.ec_km.value();
-    // ec type
-    if (!record.ec_type.has_value()) {
-      throw meta::Exception("ec_type is required to register a stripe");
-    }
-    stripe_meta.ec_type = record.ec_type.value();
-    // blob layout
-    if (!record.blob_layout.has_value()) {
-      throw meta::Exception("blob_layout is required to register a stripe");
-    }
-    stripe_meta.blob_layout = record.blob_layout.value();
-    // chunk size
-    if (!record.chunk_size.has_value()) {
-      throw meta::Exception("chunk_size is required to register a stripe");
-    }
-    stripe_meta.chunk_size = record.chunk_size.value();
-    // blobs
-    if (record.blobs.empty()) {
-      throw meta::Exception("blob list is required to register a stripe");
-    }
-    std::for_each_n(record.blobs.begin(),
-                    record.blobs.size(),
-                    [stripe_id = stripe_meta.stripe_id](auto &blob) {
-                      blob.stripe_id = stripe_id;
-                    });
-    stripe_meta.blobs = std::move(record.blobs);
-    // chunks
-    if (record.chunks.empty()) {
-      throw meta::Exception("chunk list is required to register a stripe");
-    }
-    std::for_each_n(record.chunks.begin(),
-                    record.chunks.size(),
-                    [stripe_id = stripe_meta.stripe_id](auto &chunk) {
-                      chunk.stripe_id = stripe_id;
-                    });
-    stripe_meta.chunks = std::move(record.chunks);
-    // pg
-    if (!record.pg_id.has_value()) {
-      throw meta::Exception("pg_id is required to register a stripe");
-    }
-    batch.putStripeToPG(stripe_meta.stripe_id, record.pg_id.value());
-
-    // make key for the stripe
-    auto stripe_id_key =
-        make_prefixed_key(meta::MetaType::Stripe, stripe_meta.stripe_id);
-    // write the stripe meta to the batch
-    batch.putMeta(stripe_id_key, stripe_meta);
-
-    // make blobs meta data and write
-    for (const auto &blob : stripe_meta.blobs) {
-      auto blob_id = blob.blob_id;
-      auto blob_id_key = make_prefixed_key(meta::MetaType::Blob, blob_id);
-      batch.putMeta(blob_id_key, blob);
-      blobRecorder_.put_record(blob_id);
-    }
+    // the id is given up if the stripe is not handed to the committer
+    const auto stripe_id = stripe_meta.stripe_id;
+    try {
+      // ec k and m
+      if (!record.ec_km.has_value()) {
+        throw meta::Exception("ec_km is required to register a stripe");
+      }
+      std::tie(stripe_meta.k, stripe_meta.m) = record.ec_km.value();
+      // ec type
+      if (!record.ec_type.has_value()) {
+        throw meta::Exception("ec_type is required to register a stripe");
+      }
+      stripe_meta.ec_type = record.ec_type.value();
+      // blob layout
+      if (!record.blob_layout.has_value()) {
+        throw meta::Exception("blob_layout is required to register a stripe");
+      }
+      stripe_meta.blob_layout = record.blob_layout.value();
+      // chunk size
+      if (!record.chunk_size.has_value()) {
+        throw meta::Exception("chunk_size is required to register a stripe");
+      }
+      stripe_meta.chunk_size = record.chunk_size.value();
+      // blobs
+      if (record.blobs.empty()) {
+        throw meta::Exception("blob list is required to register a stripe");
+      }
+      std::for_each_n(record.blobs.begin(),
+                      record.blobs.size(),
+                      [stripe_id = stripe_meta.stripe_id](auto &blob) {
+                        blob.stripe_id = stripe_id;
+                      });
+      stripe_meta.blobs = std::move(record.blobs);
+      // chunks
+      if (record.chunks.empty()) {
+        throw meta::Exception("chunk list is required to register a stripe");
+      }
+      std::for_each_n(record.chunks.begin(),
+                      record.chunks.size(),
+                      [stripe_id = stripe_meta.stripe_id](auto &chunk) {
+                        chunk.stripe_id = stripe_id;
+                      });
+      stripe_meta.chunks = std::move(record.chunks);
+      // pg
+      if (!record.pg_id.has_value()) {
+        throw meta::Exception("pg_id is required to register a stripe");
+      }
+      batch.putStripeToPG(stripe_meta.stripe_id, record.pg_id.value());
+      // merge sizes, recorded if chosen adaptively
+      if (record.tuning.has_value()) {
+        stripe_meta.tuning = record.tuning.value();
+      }
 
-    // make chunk meta data and write
-    for (std::size_t i = 0; i < record.chunks.size(); i++) {
-      auto &chunk = record.chunks[i];
-      auto chunk_index = boost::numeric_cast<meta::chunk_index_t>(i);
-      auto chunk_id = meta::chunk_id_t{.stripe_id = stripe_meta.stripe_id,
-                                       .chunk_index = chunk_index};
-      auto chunk_id_key = make_prefixed_key(meta::MetaType::Chunk, chunk_id);
-      batch.putMeta(chunk_id_key, chunk);
-    }
+      // make key for the stripe
+      auto stripe_id_key = stripe_key(stripe_meta.stripe_id);
+      // write the stripe meta to the batch
+      batch.putMeta(stripe_id_key, stripe_meta);
+
+      // make blobs meta data and write, a blob record only points into the
+      // stripe record
+      for (std::size_t i = 0; i < stripe_meta.blobs.size(); i++) {
+        const auto &blob = stripe_meta.blobs[i];
+        auto blob_id_key =
+            make_prefixed_key(meta::MetaType::Blob, blob.blob_id);
+        batch.putMeta(
+            blob_id_key,
+            BlobRef{.stripe_id = stripe_meta.stripe_id,
+                    .position = boost::numeric_cast<blob_index_t>(i)});
+      }
+
+      // make chunk meta data and write
+      for (std::size_t i = 0; i < stripe_meta.chunks.size(); i++) {
+        const auto &chunk = stripe_meta.chunks[i];
+        auto chunk_index = boost::numeric_cast<meta::chunk_index_t>(i);
+        auto chunk_id = meta::chunk_id_t{.stripe_id = stripe_meta.stripe_id,
+                                         .chunk_index = chunk_index};
+        auto chunk_id_key = chunk_key(chunk_id);
+        batch.putMeta(chunk_id_key, chunk);
+      }
 
-    // flush batch to the store
-    batch.flush();
-    return stripe_meta.stripe_id;
+      // hand the batch over to the committer
+      if (!committer_) {
+        throw meta::Exception("meta core is not launched");
+      }
+      // the committed stripe is shared with the cache
+      return committer_->submit(
+          std::move(batch),
+          std::make_shared<const StripeMeta>(std::move(stripe_meta)));
+    } catch (...) {
+      abandonStripe(stripe_id);
+      throw;
+    }
   };
 
   /// Get the repairing meta data from a failed chunk
-  auto chunkRepair(meta::chunk_id_t chunk_id) -> StripeMeta {
-    auto stripe_id = chunk_id.stripe_id;
-    auto stripe_id_key = make_prefixed_key(meta::MetaType::Stripe, stripe_id);
-    auto stripe_meta = meta::StripeMeta{};
-    metaStore_.getMeta(stripe_id_key, stripe_meta);
-    return stripe_meta;
+  auto chunkRepair(meta::chunk_id_t chunk_id)
+      -> std::shared_ptr<const StripeMeta> {
+    return stripe_meta(chunk_id.stripe_id);
   }
 
   struct DiskRepairMeta {
     PGMeta pg;
     chunk_index_t chunk_index;
-    std::vector<stripe_id_t> stripe_list;
   };
   /// Get the repairing meta data from a failed disk
+  /// # Note
+  /// the stripes of each PG are fetched separately with `pgStripes`, so the
+  /// repair of a PG can start while the others are still being loaded
   auto diskRepair(disk_id_t disk_id) -> std::vector<DiskRepairMeta> {
     auto target = std::vector<DiskRepairMeta>{};
     for (auto &[pg_id, pg_meta] : pg_) {
@@ -451,45 +796,103 @@ public:
           target.emplace_back(DiskRepairMeta{
               .pg = pg_meta,
               .chunk_index = boost::numeric_cast<chunk_index_t>(i),
-              .stripe_list = {},
           });
           break;
         }
       }
     }
-    // get the stripe list for each disk repair meta
-    for (auto &disk_repair_meta : target) {
-      disk_repair_meta.stripe_list =
-          std::move(metaStore_.getPGStripes(disk_repair_meta.pg.pg_id))
-              .value_or(std::vector<meta::stripe_id_t>{});
-    }
-    auto result = std::vector<DiskRepairMeta>{};
-    std::copy_if(target.begin(),
-                 target.end(),
-                 std::back_inserter(result),
-                 [](auto &disk_repair_meta) {
-                   return !disk_repair_meta.stripe_list.empty();
-                 });
-    return result;
+    return target;
+  }
+
+  /// The stripes of a PG.
+  /// # Note
+  /// - shares the sealed blocks with the PG map, iterate it to stream the
+  ///   stripes
+  /// - waits for the PG, or loads it in this thread, if the PG map is still
+  ///   being loaded
+  auto pgStripes(pg_id_t pg_id) -> StripeIdSet {
+    return metaStore_.getPGStripes(pg_id).value_or(StripeIdSet{});
   }
 
+  /// # Note
+  /// on a miss of both caches, only the stripe record up to the blob is
+  /// decoded, see `codec::StripeView`
   auto blob_meta(meta::blob_id_t blob_id) -> meta::BlobMeta {
+    if (auto cached = cache_->get_blob(blob_id); cached.has_value()) {
+      return cached.value();
+    }
     auto blob_id_key = make_prefixed_key(meta::MetaType::Blob, blob_id);
+    auto ref = BlobRef{};
+    metaStore_.getMeta(blob_id_key, ref);
     auto blob_meta = meta::BlobMeta{};
-    metaStore_.getMeta(blob_id_key, blob_meta);
-    // auto stripe_meta = meta::StripeMeta{};
-    // auto stripe_id_key =
-    //     make_prefixed_key(meta::MetaType::Stripe, blob_meta.stripe_id);
-    // metaStore_.getMeta(stripe_id_key, stripe_meta);
-    // return {blob_meta, std::move(stripe_meta)};
+    if (auto stripe = cache_->get_stripe(ref.stripe_id); stripe != nullptr) {
+      blob_meta = stripe->blobs.at(ref.position);
+    } else {
+      auto stripe_id_key = stripe_key(ref.stripe_id);
+      auto raw_stripe = metaStore_.getRaw(stripe_id_key);
+      blob_meta = codec::StripeView{{raw_stripe.data(), raw_stripe.size()}}
+                      .blob(ref.position);
+    }
+    cache_->put_blob(blob_meta);
     return blob_meta;
   }
 
-  auto stripe_meta(meta::stripe_id_t stripe_id) -> meta::StripeMeta {
-    auto stripe_id_key = make_prefixed_key(meta::MetaType::Stripe, stripe_id);
+  /// # Note
+  /// the stripe is shared with the meta cache and must not be modified
+  auto stripe_meta(meta::stripe_id_t stripe_id)
+      -> std::shared_ptr<const StripeMeta> {
+    if (auto cached = cache_->get_stripe(stripe_id); cached != nullptr) {
+      return cached;
+    }
+    auto stripe_id_key = stripe_key(stripe_id);
     auto stripe_meta = meta::StripeMeta{};
     metaStore_.getMeta(stripe_id_key, stripe_meta);
-    return stripe_meta;
+    auto stripe = std::make_shared<const StripeMeta>(std::move(stripe_meta));
+    cache_->put_stripe(stripe);
+    return stripe;
+  }
+
+  /// Look up a batch of stripes, e.g. the stripes of a window of the blob
+  /// log.
+  /// # Note
+  /// the missed stripes are read from one snapshot of the store and cached, a
+  /// stripe id repeated in the batch is looked up once
+  /// # Return
+  /// one stripe per id, in order, `nullptr` if it is not registered
+  auto multi_get_stripes(std::span<const stripe_id_t> stripe_ids)
+      -> std::vector<std::shared_ptr<const StripeMeta>> {
+    auto stripes =
+        std::unordered_map<stripe_id_t, std::shared_ptr<const StripeMeta>>{};
+    auto missed_keys = std::vector<meta::key_t>{};
+    auto missed_ids = std::vector<stripe_id_t>{};
+    for (auto stripe_id : stripe_ids) {
+      if (stripes.contains(stripe_id)) {
+        continue;
+      }
+      auto cached = cache_->get_stripe(stripe_id);
+      if (cached == nullptr) {
+        missed_keys.push_back(stripe_key(stripe_id));
+        missed_ids.push_back(stripe_id);
+      }
+      stripes.emplace(stripe_id, std::move(cached));
+    }
+    if (!missed_keys.empty()) {
+      auto fetched = metaStore_.multiGetMeta<StripeMeta>(missed_keys);
+      for (std::size_t j = 0; j < fetched.size(); j++) {
+        if (fetched[j].has_value()) {
+          auto stripe = std::make_shared<const StripeMeta>(
+              std::move(fetched[j]).value());
+          cache_->put_stripe(stripe);
+          stripes[missed_ids[j]] = std::move(stripe);
+        }
+      }
+    }
+    auto located = std::vector<std::shared_ptr<const StripeMeta>>{};
+    located.reserve(stripe_ids.size());
+    for (auto stripe_id : stripe_ids) {
+      located.push_back(stripes.at(stripe_id));
+    }
+    return located;
   }
 };
 
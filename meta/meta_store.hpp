@@ -1,25 +1,41 @@
 #pragma once
 
 #include "meta.hpp"
+#include "meta_codec.hpp"
 #include "meta_exception.hpp"
 #include "serde.hpp"
 #include "span.hpp"
+#include "stripe_index.hpp"
 
 #include <algorithm>
 #include <boost/compute/detail/lru_cache.hpp>
 #include <fmt/format.h>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <iterator>
+#include <leveldb/cache.h>
 #include <leveldb/db.h>
+#include <leveldb/filter_policy.h>
+#include <leveldb/iterator.h>
 #include <leveldb/options.h>
 #include <leveldb/write_batch.h>
 
+#include <limits>
 #include <map>
 #include <memory>
 #include <msgpack/adaptor/define_decl.hpp>
 #include <mutex>
 #include <optional>
-#include <set>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -27,25 +43,94 @@ namespace meta {
 
 class MetaStore;
 
+/// the shard of a key among `shards` shards, by the partition of the key
+inline auto key_shard(const key_t &key, std::size_t shards) -> std::size_t {
+  return key_partition(key) % shards;
+}
+
+/// ShardWriter writes the batches of one shard on its own thread, so that
+/// the shards of a commit are written in parallel.
+/// # Note
+/// the queued writes are done before the writer is destroyed
+class ShardWriter {
+public:
+  using write_t = std::packaged_task<leveldb::Status()>;
+
+private:
+  std::mutex mtx_{};
+  std::condition_variable cv_{};
+  std::deque<write_t> queue_{};
+  bool stop_{false};
+  std::thread worker_{};
+
+  void run() {
+    auto lock = std::unique_lock<std::mutex>{mtx_};
+    while (true) {
+      cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        // stopped and drained
+        return;
+      }
+      auto write = std::move(queue_.front());
+      queue_.pop_front();
+      lock.unlock();
+      write();
+      lock.lock();
+    }
+  }
+
+public:
+  ShardWriter() : worker_([this] { run(); }) {}
+  ShardWriter(const ShardWriter &) = delete;
+  auto operator=(const ShardWriter &) -> ShardWriter & = delete;
+  ShardWriter(ShardWriter &&) = delete;
+  auto operator=(ShardWriter &&) -> ShardWriter & = delete;
+  ~ShardWriter() {
+    {
+      auto lock = std::lock_guard<std::mutex>{mtx_};
+      stop_ = true;
+    }
+    cv_.notify_one();
+    worker_.join();
+  }
+
+  /// # Return
+  /// the status of the write once it is done
+  auto submit(write_t write) -> std::future<leveldb::Status> {
+    auto done = write.get_future();
+    {
+      auto lock = std::lock_guard<std::mutex>{mtx_};
+      queue_.push_back(std::move(write));
+    }
+    cv_.notify_one();
+    return done;
+  }
+};
+
 class MetaWriteBatch {
 private:
   friend class MetaStore;
-  leveldb::WriteBatch batch_{};
+  /// one batch per shard of the store
+  std::vector<leveldb::WriteBatch> shard_batches_;
   std::vector<std::pair<meta::pg_id_t, meta::stripe_id_t>> stripe_to_pg_map_;
   MetaStore &store_;
 
-  MetaWriteBatch(MetaStore &store) : store_{store} {}
+  MetaWriteBatch(MetaStore &store, std::size_t shards)
+      : shard_batches_(shards), store_{store} {}
 
 public:
   template <typename T> void putMeta(meta::key_t key, const T &value) {
-    auto ser_key = leveldb::Slice{key.data(), key.size()};
-    std::stringstream ser_buf{};
+    // the batch copies the value, the buffer is reused
+    auto &ser_buf = serde::scratch_buffer();
     serde::serialize(value, ser_buf);
-    auto ser_str = std::move(ser_buf).str();
-    auto ser_val = leveldb::Slice{ser_str};
-    batch_.Put(ser_key, ser_val);
+    putRaw(key, ser_buf);
   };
 
+  void putRaw(const meta::key_t &key, const std::string &value) {
+    shard_batches_[key_shard(key, shard_batches_.size())].Put(
+        leveldb::Slice{key.data(), key.size()}, leveldb::Slice{value});
+  }
+
   void putStripeToPG(meta::stripe_id_t stripe_id, meta::pg_id_t pg_id) {
     stripe_to_pg_map_.emplace_back(pg_id, stripe_id);
   };
@@ -54,103 +139,371 @@ public:
 };
 
 /// record the stripes that belong to a PG
+/// # Note
+/// - the stripes of each PG are kept in a compact `StripeIdSet`, which is
+///   persisted incrementally, one segment per sealed block
+/// - a persisted map is loaded lazily: `load` only reads the manifest and
+///   starts background loaders, a PG that is accessed before its loader got
+///   to it is loaded by the accessing thread
 class PGToStripeMap {
-  using pg_map_t = std::map<pg_id_t, std::set<stripe_id_t>>;
+  using pg_map_t = std::map<pg_id_t, StripeIdSet>;
   using mutex_t = std::mutex;
 
 public:
-  auto getPGMap() const -> const pg_map_t & { return pg_to_stripe_map_; };
-  auto getPGMap() -> pg_map_t & { return pg_to_stripe_map_; };
-  auto getPGStripes(meta::pg_id_t pg_id) const
-      -> std::optional<std::vector<stripe_id_t>> {
-    auto lock = std::lock_guard<mutex_t>{store_mtx_};
-    auto &pg_map = getPGMap();
-    if (pg_map.find(pg_id) == pg_map.end()) {
+  /// the key of a segment of a PG, `TAIL_SEGMENT` for the tail
+  using segment_key_fn =
+      std::function<meta::key_t(meta::pg_id_t, std::size_t)>;
+  /// read a persisted value, throws `NotFound` if it is missing
+  using get_fn = std::function<std::string(const meta::key_t &)>;
+  static constexpr std::size_t TAIL_SEGMENT{~std::size_t{0}};
+
+  PGToStripeMap() = default;
+  PGToStripeMap(const PGToStripeMap &) = delete;
+  auto operator=(const PGToStripeMap &) -> PGToStripeMap & = delete;
+  PGToStripeMap(PGToStripeMap &&) = delete;
+  auto operator=(PGToStripeMap &&) -> PGToStripeMap & = delete;
+  ~PGToStripeMap() = default;
+
+  auto add(meta::pg_id_t pg_id, meta::stripe_id_t stripe_id) -> void {
+    auto lock = std::unique_lock<mutex_t>{store_mtx_};
+    ensure_loaded(lock, pg_id);
+    pg_to_stripe_map_[pg_id].insert(stripe_id);
+  }
+
+  /// a copy of the stripes of a PG to iterate without holding the map
+  /// # Note
+  /// - the copy shares the sealed blocks with the map
+  /// - waits for the PG if it is being loaded
+  auto getPGStripes(meta::pg_id_t pg_id) -> std::optional<StripeIdSet> {
+    auto lock = std::unique_lock<mutex_t>{store_mtx_};
+    ensure_loaded(lock, pg_id);
+    auto it = pg_to_stripe_map_.find(pg_id);
+    if (it == pg_to_stripe_map_.end()) {
       return std::nullopt;
     }
-    auto &pg = getPGMap().at(pg_id);
-    auto target = std::vector<stripe_id_t>{};
-    target.reserve(target.size());
-    std::copy(pg.cbegin(), pg.cend(), std::back_inserter(target));
-    return target;
+    return it->second;
   }
 
-  auto serialize(std::ostream &stream) const -> void {
-    auto lock = std::lock_guard<mutex_t>{store_mtx_};
-    serde::serialize(pg_to_stripe_map_, stream);
-  };
+  /// write the segments changed since the last call, the tails, and the
+  /// manifest of segment counts to the batch
+  /// # Return
+  /// a commit function that marks the segments as persisted, to call once
+  /// the batch is written
+  auto persist(MetaWriteBatch &batch, meta::key_t manifest_key,
+               const segment_key_fn &segment_key) -> std::function<void()> {
+    auto lock = std::unique_lock<mutex_t>{store_mtx_};
+    wait_loaded(lock);
+    auto manifest = std::vector<std::pair<pg_id_t, std::uint64_t>>{};
+    // segment count and rewrite count of each PG as written
+    auto persisted =
+        std::vector<std::tuple<pg_id_t, std::size_t, std::size_t>>{};
+    for (const auto &[pg_id, stripes] : pg_to_stripe_map_) {
+      for (auto i = stripes.first_dirty_segment(); i < stripes.segment_count();
+           i++) {
+        batch.putRaw(segment_key(pg_id, i), stripes.segment(i));
+      }
+      batch.putRaw(segment_key(pg_id, TAIL_SEGMENT), stripes.tail_segment());
+      manifest.emplace_back(pg_id, stripes.segment_count());
+      persisted.emplace_back(
+          pg_id, stripes.segment_count(), stripes.rewrites());
+    }
+    auto &manifest_buf = serde::scratch_buffer();
+    serde::serialize(manifest, manifest_buf);
+    batch.putRaw(manifest_key, manifest_buf);
+    return [this, persisted = std::move(persisted)] {
+      auto lock = std::lock_guard<mutex_t>{store_mtx_};
+      for (const auto &[pg_id, segments, rewrites] : persisted) {
+        auto &stripes = pg_to_stripe_map_.at(pg_id);
+        // blocks sealed or rewritten meanwhile stay dirty
+        if (stripes.rewrites() == rewrites) {
+          stripes.mark_persisted(segments);
+        }
+      }
+    };
+  }
 
-  auto deserialize(util::bytes_span buf) -> void {
-    auto lock = std::lock_guard<mutex_t>{store_mtx_};
-    auto obj = pg_map_t{};
-    serde::deserialize(buf, obj);
-    this->pg_to_stripe_map_ = std::move(obj);
-  };
+  /// replace the map with the persisted one
+  /// # Note
+  /// - returns once the manifest is read, the PGs are loaded in the
+  ///   background by `threads` loaders, in ascending PG order
+  /// - `get` is called by the loaders until the map is destroyed
+  /// # Throw
+  /// `NotFound` if the manifest is missing, a missing segment is reported
+  /// when its PG is accessed
+  auto load(get_fn get, meta::key_t manifest_key, segment_key_fn segment_key,
+            std::size_t threads) -> void {
+    auto manifest = std::vector<std::pair<pg_id_t, std::uint64_t>>{};
+    auto raw_manifest = get(manifest_key);
+    serde::deserialize({raw_manifest.data(), raw_manifest.size()}, manifest);
+    {
+      auto lock = std::unique_lock<mutex_t>{store_mtx_};
+      wait_loaded(lock);
+      pg_to_stripe_map_.clear();
+      for (const auto &[pg_id, segment_count] : manifest) {
+        pending_.emplace(pg_id,
+                         PendingPG{.segment_count = segment_count,
+                                   .claimed = false,
+                                   .error = nullptr});
+      }
+      get_ = std::move(get);
+      segment_key_ = std::move(segment_key);
+    }
+    if (manifest.empty()) {
+      return;
+    }
+    threads = std::clamp<std::size_t>(threads, 1, manifest.size());
+    for (std::size_t i = 0; i < threads; i++) {
+      loaders_.emplace_back([this](const std::stop_token &stop) {
+        auto lock = std::unique_lock<mutex_t>{store_mtx_};
+        while (!stop.stop_requested()) {
+          auto it = std::find_if(pending_.begin(),
+                                 pending_.end(),
+                                 [](auto &pg) { return !pg.second.claimed; });
+          if (it == pending_.end()) {
+            return;
+          }
+          try {
+            load_pg(lock, it->first);
+          } catch (...) {
+            // kept for the thread accessing the PG
+          }
+        }
+      });
+    }
+  }
 
 private:
+  struct PendingPG {
+    std::size_t segment_count;
+    bool claimed;
+    std::exception_ptr error;
+  };
+
   pg_map_t pg_to_stripe_map_{};
   mutable mutex_t store_mtx_{};
-  MSGPACK_DEFINE(pg_to_stripe_map_);
-};
-} // namespace meta
+  /// PGs of a persisted map that are not loaded yet
+  std::map<pg_id_t, PendingPG> pending_{};
+  std::condition_variable loaded_cv_{};
+  get_fn get_{};
+  segment_key_fn segment_key_{};
+  /// declared last, they are stopped and joined first
+  std::vector<std::jthread> loaders_{};
 
-namespace serde {
-template <>
-inline void serialize(const meta::PGToStripeMap &obj, std::ostream &stream) {
-  obj.serialize(stream);
-};
-template <>
-inline void deserialize(util::bytes_span buf, meta::PGToStripeMap &obj) {
-  obj.deserialize(buf);
+  /// load an unclaimed PG, the lock is released meanwhile
+  void load_pg(std::unique_lock<mutex_t> &lock, pg_id_t pg_id) {
+    auto &pending = pending_.at(pg_id);
+    pending.claimed = true;
+    auto segment_count = pending.segment_count;
+    lock.unlock();
+    auto stripes = std::optional<StripeIdSet>{};
+    auto error = std::exception_ptr{};
+    try {
+      auto segments = std::vector<std::string>{};
+      segments.reserve(segment_count);
+      for (std::size_t i = 0; i < segment_count; i++) {
+        segments.push_back(get_(segment_key_(pg_id, i)));
+      }
+      stripes = StripeIdSet::from_segments(
+          segments, get_(segment_key_(pg_id, TAIL_SEGMENT)));
+    } catch (...) {
+      error = std::current_exception();
+    }
+    lock.lock();
+    if (error) {
+      // the PG stays pending, every access rethrows
+      pending_.at(pg_id).error = error;
+    } else {
+      pg_to_stripe_map_.emplace(pg_id, std::move(stripes).value());
+      pending_.erase(pg_id);
+    }
+    loaded_cv_.notify_all();
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  /// make sure a PG of a persisted map is loaded, load it in this thread if
+  /// no loader has claimed it yet
+  void ensure_loaded(std::unique_lock<mutex_t> &lock, pg_id_t pg_id) {
+    while (true) {
+      auto it = pending_.find(pg_id);
+      if (it == pending_.end()) {
+        return;
+      }
+      if (it->second.error) {
+        std::rethrow_exception(it->second.error);
+      }
+      if (!it->second.claimed) {
+        load_pg(lock, pg_id);
+        return;
+      }
+      loaded_cv_.wait(lock);
+    }
+  }
+
+  void wait_loaded(std::unique_lock<mutex_t> &lock) {
+    while (!pending_.empty()) {
+      ensure_loaded(lock, pending_.begin()->first);
+    }
+  }
 };
-} // namespace serde
+} // namespace meta
 
 namespace meta {
 /// MetaStore is a class that stores the metadata to a database backend.
 /// # Note
-/// MetaStore can be shared by multiple threads.
-/// But the concurrent write is not guaranteed to be serialized.
+/// - the entries are sharded over several LevelDB instances by the
+///   partition of their keys, the stripes and chunks of a PG are kept in the
+///   same shard, in key order
+/// - the shards share a block cache and a bloom filter policy
+/// - the shards of a write are written in parallel, each by its own
+///   `ShardWriter`
+/// - MetaStore can be shared by multiple threads, but the concurrent write
+///   is not guaranteed to be serialized
 class MetaStore {
+public:
+  struct Options {
+    /// fixed when the store is created
+    std::size_t shards;
+    /// shared by all the shards
+    std::size_t block_cache_bytes;
+    /// `0` disables the bloom filters
+    int bloom_bits_per_key;
+    /// memtable size of each shard
+    std::size_t write_buffer_bytes;
+    /// sync each write to disk, a group commit shares one sync among its
+    /// batches
+    bool sync_writes;
+  };
+  static constexpr Options DEFAULT_OPTIONS{
+      .shards = 4,
+      .block_cache_bytes = std::size_t{64} << 20,
+      .bloom_bits_per_key = 10,
+      .write_buffer_bytes = std::size_t{16} << 20,
+      .sync_writes = true,
+  };
+
 private:
   friend class MetaWriteBatch;
   using database_ptr = std::unique_ptr<leveldb::DB>;
   using mutex_t = std::mutex;
-  database_ptr db_;
+  // declared before the shards, which use them until they are closed
+  std::unique_ptr<const leveldb::FilterPolicy> filter_policy_{};
+  std::unique_ptr<leveldb::Cache> block_cache_{};
+  std::vector<database_ptr> shards_{};
+  leveldb::WriteOptions write_options_{};
+  /// declared after the shards, its loaders read them until it is destroyed
   PGToStripeMap pg_to_stripe_map_{};
+  /// one per shard if there are several, declared after the shards, they
+  /// write to them until they are destroyed
+  std::vector<std::unique_ptr<ShardWriter>> writers_{};
 
-  [[nodiscard]] auto getDB() const -> const leveldb::DB & {
-    return *db_.get();
-  };
-  auto getDB() -> leveldb::DB & { return *db_.get(); };
+  auto shard(const meta::key_t &key) -> leveldb::DB & {
+    if (shards_.empty()) {
+      throw Exception("database is not opened");
+    }
+    return *shards_[key_shard(key, shards_.size())];
+  }
+
+  static auto shard_path(const std::filesystem::path &path, std::size_t i)
+      -> std::filesystem::path {
+    return path / fmt::format("shard-{:02}", i);
+  }
+
+  /// number of shards of the store at `path`, `0` if there is none
+  static auto count_shards(const std::filesystem::path &path)
+      -> std::size_t {
+    std::size_t shards{0};
+    while (std::filesystem::exists(shard_path(path, shards))) {
+      shards++;
+    }
+    return shards;
+  }
 
 public:
   MetaStore() = default;
 
-  auto persist_pg_map_as(meta::key_t key) { putMeta(key, pg_to_stripe_map_); }
-  auto load_pg_map_from(meta::key_t key) { getMeta(key, pg_to_stripe_map_); }
+  /// Persist the PG map together with the entries of `batch`, only the
+  /// segments changed since the last call are rewritten. See
+  /// `PGToStripeMap::persist`.
+  /// # Note
+  /// the write is atomic if the keys of `batch` and the PG map are all in
+  /// one shard
+  auto persist_pg_map(MetaWriteBatch &batch, meta::key_t manifest_key,
+                      const PGToStripeMap::segment_key_fn &segment_key) {
+    auto mark_persisted =
+        pg_to_stripe_map_.persist(batch, manifest_key, segment_key);
+    batch.flush();
+    mark_persisted();
+  }
+  /// Load the PG map in the background, see `PGToStripeMap::load`.
+  auto load_pg_map(meta::key_t manifest_key,
+                   PGToStripeMap::segment_key_fn segment_key,
+                   std::size_t threads) {
+    pg_to_stripe_map_.load(
+        [this](const meta::key_t &key) { return getRaw(key); },
+        manifest_key,
+        std::move(segment_key),
+        threads);
+  }
 
-  /// Open the database at the given path.
-  void open(const std::string &path) {
-    leveldb::Options options;
-    options.create_if_missing = true;
-    leveldb::DB *db{};
-    auto status = leveldb::DB::Open(options, path, &db);
-    if (!status.ok()) {
-      throw Exception("fail to open database, " + status.ToString());
+  /// Open the database at the given path, one directory per shard.
+  /// # Throw
+  /// `Exception` if the store at `path` has a different number of shards
+  void open(const std::string &path, Options options = DEFAULT_OPTIONS) {
+    if (options.shards == 0) {
+      throw Exception("meta store needs at least one shard");
+    }
+    auto existing = count_shards(path);
+    if (existing != 0 && existing != options.shards) {
+      throw Exception(fmt::format(
+          "meta store has {} shards, {} configured", existing, options.shards));
+    }
+    writers_.clear();
+    shards_.clear();
+    if (options.bloom_bits_per_key > 0) {
+      filter_policy_.reset(
+          leveldb::NewBloomFilterPolicy(options.bloom_bits_per_key));
+    } else {
+      filter_policy_.reset();
+    }
+    block_cache_.reset(leveldb::NewLRUCache(options.block_cache_bytes));
+    auto db_options = leveldb::Options{};
+    db_options.create_if_missing = true;
+    db_options.block_cache = block_cache_.get();
+    db_options.filter_policy = filter_policy_.get();
+    db_options.write_buffer_size = options.write_buffer_bytes;
+    write_options_.sync = options.sync_writes;
+    for (std::size_t i = 0; i < options.shards; i++) {
+      leveldb::DB *db{};
+      auto status =
+          leveldb::DB::Open(db_options, shard_path(path, i).string(), &db);
+      if (!status.ok()) {
+        shards_.clear();
+        throw Exception("fail to open database, " + status.ToString());
+      }
+      shards_.emplace_back(db);
+    }
+    if (shards_.size() > 1) {
+      for (std::size_t i = 0; i < shards_.size(); i++) {
+        writers_.push_back(std::make_unique<ShardWriter>());
+      }
     }
-    db_.reset(db);
   };
 
+  [[nodiscard]] auto shard_count() const -> std::size_t {
+    return shards_.size();
+  }
+
   /// Put the key-value pair to the database.
   /// # Note
   /// Use MetaWriteBatch for batch write.
   template <typename T> void putMeta(meta::key_t key, const T &value) {
     auto ser_key = leveldb::Slice{key.data(), key.size()};
-    std::stringstream ser_buf{};
+    auto &ser_buf = serde::scratch_buffer();
     serde::serialize(value, ser_buf);
-    auto ser_str = std::move(ser_buf).str();
-    auto ser_val = leveldb::Slice{ser_str};
-    auto status = getDB().Put(leveldb::WriteOptions(), ser_key, ser_val);
+    auto status = shard(key).Put(
+        leveldb::WriteOptions(), ser_key, leveldb::Slice{ser_buf});
     if (!status.ok()) {
       throw Exception("fail to put key-value pair, " + status.ToString());
     }
@@ -158,38 +511,207 @@ public:
 
   /// Get the value from the database.
   template <typename T> void getMeta(meta::key_t key, T &value) {
+    auto raw_value = getRaw(key);
+    serde::deserialize({raw_value.data(), raw_value.size()}, value);
+  };
+
+  /// Get the serialized value from the database, e.g. to decode it lazily.
+  auto getRaw(meta::key_t key) -> std::string {
     auto ser_key = leveldb::Slice{key.data(), static_cast<size_t>(key.size())};
     std::string raw_value{};
-    auto status = getDB().Get(leveldb::ReadOptions{}, ser_key, &raw_value);
+    auto status = shard(key).Get(leveldb::ReadOptions{}, ser_key, &raw_value);
     if (status.ok()) {
-      serde::deserialize({raw_value.data(), raw_value.size()}, value);
-      return;
+      return raw_value;
     }
     if (status.IsNotFound()) {
       throw NotFound(fmt::format("key not found"));
     } else {
       throw Exception("fail to get key-value pair, " + status.ToString());
     }
-  };
+  }
 
-  auto getPGStripes(meta::pg_id_t pg_id) const
-      -> std::optional<std::vector<stripe_id_t>> {
+  /// Get the values of several keys, from one snapshot of each shard.
+  /// # Return
+  /// one value per key, `std::nullopt` for the keys that are not found
+  /// # Throw
+  /// `Exception` if a read fails
+  template <typename T>
+  auto multiGetMeta(std::span<const meta::key_t> keys)
+      -> std::vector<std::optional<T>> {
+    auto snapshots = std::vector<const leveldb::Snapshot *>(shards_.size());
+    auto values = std::vector<std::optional<T>>(keys.size());
+    auto raw_value = std::string{};
+    auto status = leveldb::Status{};
+    for (std::size_t i = 0; i < keys.size() && status.ok(); i++) {
+      auto &db = shard(keys[i]);
+      auto &snapshot = snapshots[key_shard(keys[i], shards_.size())];
+      if (snapshot == nullptr) {
+        snapshot = db.GetSnapshot();
+      }
+      auto options = leveldb::ReadOptions{};
+      options.snapshot = snapshot;
+      auto ser_key = leveldb::Slice{keys[i].data(), keys[i].size()};
+      status = db.Get(options, ser_key, &raw_value);
+      if (status.ok()) {
+        values[i].emplace();
+        serde::deserialize({raw_value.data(), raw_value.size()}, *values[i]);
+      } else if (status.IsNotFound()) {
+        status = leveldb::Status{};
+      }
+    }
+    for (std::size_t i = 0; i < snapshots.size(); i++) {
+      if (snapshots[i] != nullptr) {
+        shards_[i]->ReleaseSnapshot(snapshots[i]);
+      }
+    }
+    if (!status.ok()) {
+      throw Exception("fail to get key-value pairs, " + status.ToString());
+    }
+    return values;
+  }
+
+  /// Visit the entries of a type in a partition with an id in
+  /// [first, last], of any sub index, in key order, e.g. the stripes of a
+  /// PG.
+  /// # Note
+  /// reads one snapshot of the shard of the partition, stops once `visit`
+  /// returns false
+  /// # Throw
+  /// `Exception` if the iteration fails
+  void scanRaw(
+      MetaType type, partition_t partition, std::uint64_t first,
+      std::uint64_t last,
+      const std::function<bool(const meta::key_t &, util::bytes_span)> &visit) {
+    auto begin = make_key(type, partition, first);
+    auto end = make_key(
+        type, partition, last, std::numeric_limits<std::uint8_t>::max());
+    auto &db = shard(begin);
+    auto options = leveldb::ReadOptions{};
+    // a scan should not evict the blocks of the point lookups
+    options.fill_cache = false;
+    auto it = std::unique_ptr<leveldb::Iterator>{db.NewIterator(options)};
+    auto key = meta::key_t{};
+    for (it->Seek(leveldb::Slice{begin.data(), begin.size()}); it->Valid();
+         it->Next()) {
+      auto raw_key = it->key();
+      if (raw_key.size() != key.size()) {
+        throw Exception("malformed key in meta store");
+      }
+      std::copy_n(raw_key.data(), key.size(), key.begin());
+      // bytewise, as the keys are ordered by LevelDB
+      if (std::memcmp(key.data(), end.data(), key.size()) > 0) {
+        break;
+      }
+      auto value = it->value();
+      if (!visit(key, {value.data(), value.size()})) {
+        break;
+      }
+    }
+    if (!it->status().ok()) {
+      throw Exception("fail to scan the meta store, " +
+                      it->status().ToString());
+    }
+  }
+
+  auto getPGStripes(meta::pg_id_t pg_id) -> std::optional<StripeIdSet> {
     return pg_to_stripe_map_.getPGStripes(pg_id);
   }
 
+  /// add a stripe that is already written to the PG map, e.g. on recovery
+  void addStripeToPG(meta::pg_id_t pg_id, meta::stripe_id_t stripe_id) {
+    pg_to_stripe_map_.add(pg_id, stripe_id);
+  }
+
+  /// Compact every shard, dropping the overwritten and deleted entries.
+  /// # Note
+  /// blocks until the compaction is done, meant for offline maintenance
+  void compact() {
+    for (auto &db : shards_) {
+      db->CompactRange(nullptr, nullptr);
+    }
+  }
+
   /// Get a write batch.
-  auto getWriteBatch() -> MetaWriteBatch { return MetaWriteBatch{*this}; };
+  auto getWriteBatch() -> MetaWriteBatch {
+    return MetaWriteBatch{*this, shards_.size()};
+  };
+
+  /// Flush several write batches, with a single database write per shard.
+  /// # Note
+  /// - the shards are written in parallel, the first one by the calling
+  ///   thread, a failed write may leave the other shards written
+  /// - the PG map is updated only after all the writes succeed
+  void write(std::span<MetaWriteBatch *const> batches);
 };
 
 inline void MetaWriteBatch::flush() {
-  auto status = store_.getDB().Write(leveldb::WriteOptions{}, &batch_);
+  auto *self = this;
+  store_.write({&self, 1});
+}
+
+inline void MetaStore::write(std::span<MetaWriteBatch *const> batches) {
+  if (batches.empty()) {
+    return;
+  }
+  static const auto EMPTY_BATCH_SIZE = leveldb::WriteBatch{}.ApproximateSize();
+  auto dirty = std::vector<std::size_t>{};
+  for (std::size_t i = 0; i < shards_.size(); i++) {
+    if (std::any_of(batches.begin(), batches.end(), [&](auto *batch) {
+          return batch->shard_batches_.at(i).ApproximateSize() >
+                 EMPTY_BATCH_SIZE;
+        })) {
+      dirty.push_back(i);
+    }
+  }
+  // the batches of a shard are merged by the thread that writes them
+  auto write_shard = [this, batches](std::size_t i) {
+    if (batches.size() == 1) {
+      return shards_[i]->Write(write_options_,
+                               &batches.front()->shard_batches_.at(i));
+    }
+    auto merged = leveldb::WriteBatch{};
+    for (auto *batch : batches) {
+      merged.Append(batch->shard_batches_.at(i));
+    }
+    return shards_[i]->Write(write_options_, &merged);
+  };
+  auto written = std::vector<std::future<leveldb::Status>>{};
+  auto status = leveldb::Status{};
+  auto error = std::exception_ptr{};
+  try {
+    for (std::size_t j = 1; j < dirty.size(); j++) {
+      auto i = dirty[j];
+      written.push_back(writers_.at(i)->submit(ShardWriter::write_t{
+          [&write_shard, i] { return write_shard(i); }}));
+    }
+    if (!dirty.empty()) {
+      status = write_shard(dirty.front());
+    }
+  } catch (...) {
+    error = std::current_exception();
+  }
+  // wait for every shard, the batches are borrowed until then
+  for (auto &done : written) {
+    try {
+      auto shard_status = done.get();
+      if (status.ok()) {
+        status = shard_status;
+      }
+    } catch (...) {
+      error = error ? error : std::current_exception();
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
   if (!status.ok()) {
     throw Exception("fail to flush write batch, " + status.ToString());
   }
-  for (auto &[pg_id, stripe_id] : stripe_to_pg_map_) {
-    auto &pg_map = store_.pg_to_stripe_map_.getPGMap()[pg_id];
-    pg_map.emplace(stripe_id);
+  for (auto *batch : batches) {
+    for (auto &[pg_id, stripe_id] : batch->stripe_to_pg_map_) {
+      pg_to_stripe_map_.add(pg_id, stripe_id);
+    }
   }
 }
 
-} // namespace meta
\ No newline at end of file
+} // namespace meta
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "ceph_hash.hpp"
+#include "meta.hpp"
+#include "meta_exception.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace meta {
+
+/// index of a worker endpoint in a `PlacementTable`
+using endpoint_id_t = std::uint32_t;
+
+/// where the chunks of the stripes of a PG are placed, one entry per chunk
+struct PGPlacement {
+  pg_id_t pg_id;
+  std::vector<disk_id_t> disks;
+  std::vector<node_id_t> nodes;
+  /// interned endpoints, compare and index by them instead of the IPs
+  std::vector<endpoint_id_t> endpoints;
+  std::vector<ip_t> ips;
+};
+
+/// An immutable table of the placement of every PG, indexed by PG id.
+/// # Note
+/// - the nodes and IPs of the disks are resolved once on construction,
+///   lookups neither allocate nor search
+/// - the IP of each worker is interned once, the endpoints of the PGs refer
+///   to it by index
+class PlacementTable {
+  std::vector<PGPlacement> pgs_{};
+  std::vector<ip_t> endpoints_{};
+
+public:
+  PlacementTable() = default;
+
+  /// # Throw
+  /// `meta::Exception` if the PG ids are not 0..pg_num-1, or a disk or its
+  /// worker is not registered
+  PlacementTable(const std::map<pg_id_t, PGMeta> &pgs,
+                 const std::map<disk_id_t, node_id_t> &disk_to_node,
+                 const std::map<node_id_t, ip_t> &worker_to_ip) {
+    auto interned = std::unordered_map<node_id_t, endpoint_id_t>{};
+    auto intern = [&](node_id_t node) {
+      auto [it, inserted] = interned.try_emplace(
+          node, static_cast<endpoint_id_t>(endpoints_.size()));
+      if (inserted) {
+        auto ip = worker_to_ip.find(node);
+        if (ip == worker_to_ip.end()) {
+          throw Exception("placement refers to an unregistered worker");
+        }
+        endpoints_.push_back(ip->second);
+      }
+      return it->second;
+    };
+    pgs_.reserve(pgs.size());
+    for (const auto &[pg_id, pg_meta] : pgs) {
+      if (pg_id != pgs_.size()) {
+        throw Exception("placement PG ids are not contiguous");
+      }
+      auto placement = PGPlacement{.pg_id = pg_id,
+                                   .disks = pg_meta.disk_list,
+                                   .nodes = {},
+                                   .endpoints = {},
+                                   .ips = {}};
+      for (auto disk_id : pg_meta.disk_list) {
+        auto node = disk_to_node.find(disk_id);
+        if (node == disk_to_node.end()) {
+          throw Exception("placement refers to an unregistered disk");
+        }
+        auto endpoint = intern(node->second);
+        placement.nodes.push_back(node->second);
+        placement.endpoints.push_back(endpoint);
+        placement.ips.push_back(endpoints_[endpoint]);
+      }
+      pgs_.push_back(std::move(placement));
+    }
+  }
+
+  [[nodiscard]] auto pg_count() const -> std::size_t { return pgs_.size(); }
+
+  /// # Throw
+  /// `meta::Exception` if the PG is not in the table
+  [[nodiscard]] auto pg(pg_id_t pg_id) const -> const PGPlacement & {
+    if (pg_id >= pgs_.size()) {
+      throw Exception("pg_id not found");
+    }
+    return pgs_[pg_id];
+  }
+
+  [[nodiscard]] auto endpoint_count() const -> std::size_t {
+    return endpoints_.size();
+  }
+  [[nodiscard]] auto endpoint(endpoint_id_t id) const -> const ip_t & {
+    return endpoints_.at(id);
+  }
+
+  /// the PG of a stripe, the stripe id is hashed as an integer
+  /// # Throw
+  /// `meta::Exception` if the table is empty
+  [[nodiscard]] auto select_pg(stripe_id_t stripe_id) const -> pg_id_t {
+    if (pgs_.empty()) {
+      throw Exception("no PG is registered");
+    }
+    return static_cast<pg_id_t>(ceph_u64_hash_rjenkins(stripe_id) %
+                                pgs_.size());
+  }
+};
+
+} // namespace meta
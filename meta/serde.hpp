@@ -4,9 +4,32 @@
 
 #include <msgpack.hpp>
 
+#include <cstddef>
+#include <string>
+
 namespace serde {
-template <typename T> void serialize(const T &obj, std::ostream &stream) {
-  msgpack::pack(stream, obj);
+/// a msgpack output stream appending to a string
+class StringSink {
+  std::string &buf_;
+
+public:
+  explicit StringSink(std::string &buf) : buf_{buf} {}
+  void write(const char *data, std::size_t size) { buf_.append(data, size); }
+};
+
+/// a buffer reused by the serializations of the calling thread
+/// # Note
+/// the content is cleared on each call, copy it out before the next one
+inline auto scratch_buffer() -> std::string & {
+  thread_local auto buf = std::string{};
+  buf.clear();
+  return buf;
+}
+
+/// append the serialized `obj` to `buf`
+template <typename T> void serialize(const T &obj, std::string &buf) {
+  auto sink = StringSink{buf};
+  msgpack::pack(sink, obj);
 };
 
 template <typename T> void deserialize(util::bytes_span buf, T &obj) {
@@ -14,4 +37,4 @@ template <typename T> void deserialize(util::bytes_span buf, T &obj) {
   msgpack::object obj_ = oh.get();
   obj_.convert(obj);
 };
-} // namespace serde
\ No newline at end of file
+} // namespace serde
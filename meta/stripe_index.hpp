@@ -0,0 +1,292 @@
+#pragma once
+
+#include "meta.hpp"
+#include "meta_codec.hpp"
+#include "meta_exception.hpp"
+#include "span.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace meta {
+
+/// A compact set of stripe ids, e.g. the stripes of a PG.
+///
+/// The ids are kept in sorted blocks of delta coded varints, which takes one
+/// or two bytes per id for the ids of a PG, plus a short sorted tail of the
+/// latest ids that is sealed into a block once it is full.
+/// # Note
+/// - sealed blocks are immutable and shared between copies, so copying a set
+///   to iterate it costs one pointer per block
+/// - ids are expected to arrive roughly in ascending order, an id below the
+///   tail is inserted by re-encoding the block it falls in
+/// - not thread safe
+class StripeIdSet {
+public:
+  static constexpr std::size_t BLOCK_SIZE{256};
+
+  /// an immutable run of ascending ids
+  struct Block {
+    stripe_id_t first;
+    stripe_id_t last;
+    std::size_t count;
+    /// varint deltas of the ids after `first`
+    std::string deltas;
+  };
+
+  class const_iterator {
+    friend class StripeIdSet;
+    const StripeIdSet *set_{nullptr};
+    std::size_t block_{0};
+    /// index in the current block, or in the tail after the last block
+    std::size_t index_{0};
+    std::size_t delta_pos_{0};
+    stripe_id_t value_{0};
+
+    const_iterator(const StripeIdSet *set, std::size_t block)
+        : set_{set}, block_{block} {
+      load();
+    }
+
+    /// point at the first id of `block_`
+    void load() {
+      index_ = 0;
+      delta_pos_ = 0;
+      if (block_ < set_->blocks_.size()) {
+        value_ = set_->blocks_[block_]->first;
+      } else if (!set_->tail_.empty()) {
+        value_ = set_->tail_.front();
+      }
+    }
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = stripe_id_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const stripe_id_t *;
+    using reference = const stripe_id_t &;
+
+    const_iterator() = default;
+
+    auto operator*() const -> reference { return value_; }
+
+    auto operator++() -> const_iterator & {
+      index_++;
+      if (block_ < set_->blocks_.size()) {
+        const auto &block = *set_->blocks_[block_];
+        if (index_ < block.count) {
+          auto reader = codec::Reader{
+              util::bytes_span{block.deltas}.subspan(delta_pos_)};
+          value_ += reader.varint();
+          delta_pos_ += reader.position();
+        } else {
+          block_++;
+          load();
+        }
+      } else if (index_ < set_->tail_.size()) {
+        value_ = set_->tail_[index_];
+      }
+      return *this;
+    }
+    auto operator++(int) -> const_iterator {
+      auto old = *this;
+      ++*this;
+      return old;
+    }
+
+    auto operator==(const const_iterator &rhs) const -> bool {
+      return block_ == rhs.block_ && index_ == rhs.index_;
+    }
+  };
+
+private:
+  std::vector<std::shared_ptr<const Block>> blocks_{};
+  std::vector<stripe_id_t> tail_{};
+  std::size_t size_{0};
+  /// blocks before it are unchanged since `mark_persisted`
+  std::size_t first_dirty_{0};
+  /// number of sealed blocks re-encoded so far
+  std::size_t rewrites_{0};
+
+  static auto encode_block(std::span<const stripe_id_t> ids)
+      -> std::shared_ptr<const Block> {
+    auto block = std::make_shared<Block>();
+    block->first = ids.front();
+    block->last = ids.back();
+    block->count = ids.size();
+    auto writer = codec::Writer{block->deltas};
+    for (std::size_t i = 1; i < ids.size(); i++) {
+      writer.varint(ids[i] - ids[i - 1]);
+    }
+    return block;
+  }
+
+  static auto decode_block(const Block &block) -> std::vector<stripe_id_t> {
+    auto ids = std::vector<stripe_id_t>{};
+    ids.reserve(block.count);
+    ids.push_back(block.first);
+    auto reader = codec::Reader{block.deltas};
+    for (std::size_t i = 1; i < block.count; i++) {
+      ids.push_back(ids.back() + reader.varint());
+    }
+    return ids;
+  }
+
+  /// insert an id that is not above the last sealed block
+  auto insert_sealed(stripe_id_t stripe_id) -> bool {
+    // the last block whose first id is not above `stripe_id`, or the first
+    auto it = std::upper_bound(
+        blocks_.begin(),
+        blocks_.end(),
+        stripe_id,
+        [](stripe_id_t id, const auto &block) { return id < block->first; });
+    if (it != blocks_.begin()) {
+      --it;
+    }
+    auto ids = decode_block(**it);
+    auto pos = std::lower_bound(ids.begin(), ids.end(), stripe_id);
+    if (pos != ids.end() && *pos == stripe_id) {
+      return false;
+    }
+    ids.insert(pos, stripe_id);
+    *it = encode_block(ids);
+    rewrites_++;
+    first_dirty_ = std::min(
+        first_dirty_, static_cast<std::size_t>(it - blocks_.begin()));
+    return true;
+  }
+
+public:
+  /// # Return
+  /// whether the id is newly inserted
+  auto insert(stripe_id_t stripe_id) -> bool {
+    if (!blocks_.empty() && stripe_id <= blocks_.back()->last) {
+      if (!insert_sealed(stripe_id)) {
+        return false;
+      }
+      size_++;
+      return true;
+    }
+    auto pos = std::lower_bound(tail_.begin(), tail_.end(), stripe_id);
+    if (pos != tail_.end() && *pos == stripe_id) {
+      return false;
+    }
+    tail_.insert(pos, stripe_id);
+    size_++;
+    if (tail_.size() == BLOCK_SIZE) {
+      blocks_.push_back(encode_block(tail_));
+      tail_.clear();
+    }
+    return true;
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t { return size_; }
+  [[nodiscard]] auto empty() const -> bool { return size_ == 0; }
+
+  [[nodiscard]] auto begin() const -> const_iterator {
+    return const_iterator{this, 0};
+  }
+  [[nodiscard]] auto end() const -> const_iterator {
+    auto it = const_iterator{};
+    it.set_ = this;
+    it.block_ = blocks_.size();
+    it.index_ = tail_.size();
+    return it;
+  }
+
+  /// bytes held by the set, without the allocator overhead
+  [[nodiscard]] auto memory_usage() const -> std::size_t {
+    auto bytes = sizeof(*this) + tail_.capacity() * sizeof(stripe_id_t) +
+                 blocks_.capacity() * sizeof(blocks_.front());
+    for (const auto &block : blocks_) {
+      bytes += sizeof(Block) + block->deltas.capacity();
+    }
+    return bytes;
+  }
+
+  /// # Segments
+  /// A set is persisted as one segment per sealed block, numbered from 0,
+  /// and a tail segment. Both are encoded as
+  /// `varint count, varint first id, varint deltas...`.
+  [[nodiscard]] auto segment_count() const -> std::size_t {
+    return blocks_.size();
+  }
+  /// sealed blocks changed since the last `mark_persisted`, [first, count)
+  [[nodiscard]] auto first_dirty_segment() const -> std::size_t {
+    return first_dirty_;
+  }
+  /// changes whenever a sealed block is re-encoded
+  [[nodiscard]] auto rewrites() const -> std::size_t { return rewrites_; }
+  /// the first `segments` blocks are persisted
+  auto mark_persisted(std::size_t segments) -> void {
+    first_dirty_ = segments;
+  }
+
+  [[nodiscard]] auto segment(std::size_t index) const -> std::string {
+    const auto &block = *blocks_.at(index);
+    auto buf = std::string{};
+    auto writer = codec::Writer{buf};
+    writer.varint(block.count);
+    writer.varint(block.first);
+    buf += block.deltas;
+    return buf;
+  }
+  [[nodiscard]] auto tail_segment() const -> std::string {
+    auto buf = std::string{};
+    auto writer = codec::Writer{buf};
+    writer.varint(tail_.size());
+    if (!tail_.empty()) {
+      writer.varint(tail_.front());
+      for (std::size_t i = 1; i < tail_.size(); i++) {
+        writer.varint(tail_[i] - tail_[i - 1]);
+      }
+    }
+    return buf;
+  }
+
+  /// rebuild a set from its segments, in order, followed by its tail
+  /// # Throw
+  /// `meta::Exception` if a segment is malformed
+  static auto from_segments(std::span<const std::string> segments,
+                            const std::string &tail) -> StripeIdSet {
+    auto set = StripeIdSet{};
+    auto ids = std::vector<stripe_id_t>{};
+    auto decode = [&ids](const std::string &segment) {
+      ids.clear();
+      auto reader = codec::Reader{segment};
+      auto count = reader.varint();
+      if (count == 0) {
+        return;
+      }
+      ids.push_back(reader.varint());
+      for (std::size_t i = 1; i < count; i++) {
+        ids.push_back(ids.back() + reader.varint());
+      }
+      if (!reader.done()) {
+        throw Exception("trailing bytes in PG segment");
+      }
+    };
+    for (const auto &segment : segments) {
+      decode(segment);
+      if (ids.empty()) {
+        throw Exception("empty PG segment");
+      }
+      set.blocks_.push_back(encode_block(ids));
+      set.size_ += ids.size();
+    }
+    decode(tail);
+    set.tail_ = ids;
+    set.size_ += ids.size();
+    set.mark_persisted(set.blocks_.size());
+    return set;
+  }
+};
+
+} // namespace meta
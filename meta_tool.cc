@@ -0,0 +1,139 @@
+
+#include "coord_prof.hh"
+#include "meta.hpp"
+#include "meta_core.hpp"
+#include "meta_exception.hpp"
+#include "toml11/exception.hpp"
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace {
+
+/// the meta core of the coordinator of `profile`, launched on its working
+/// directory without recovering it
+auto open_meta(const coord::Profile &profile)
+    -> std::unique_ptr<meta::MetaCore> {
+  auto core = std::make_unique<meta::MetaCore>(profile.workspace_name);
+  constexpr std::size_t MB = std::size_t{1} << 20;
+  auto store_options = meta::MetaStore::DEFAULT_OPTIONS;
+  store_options.shards = profile.meta_shards;
+  store_options.block_cache_bytes = profile.meta_block_cache_mb * MB;
+  store_options.sync_writes = profile.meta_sync_writes;
+  core->setStoreOptions(store_options);
+  core->launch(profile.working_dir, false);
+  for (std::size_t node_id = 0; node_id < profile.worker_ip.size();
+       node_id++) {
+    for (auto disk_id : profile.disk_list[node_id]) {
+      core->registerDisk(meta::DiskMeta{.id = disk_id, .node_id = node_id});
+    }
+    core->registerWorker(node_id, profile.worker_ip.at(node_id));
+  }
+  core->registerPG(profile.pg_num, profile.ec_k, profile.ec_m);
+  return core;
+}
+
+auto print_checkpoint(const meta::Checkpoint &checkpoint) {
+  std::cout << fmt::format(
+      "[Info] checkpoint {}: stripes [{}, {}), replay from {}, "
+      "{} committed above, {} blob log records\n",
+      checkpoint.sequence,
+      checkpoint.start_at,
+      checkpoint.stripe_counter,
+      checkpoint.replay_from,
+      checkpoint.committed_above.size(),
+      checkpoint.blob_log_records);
+}
+
+auto verify(meta::MetaCore &core) -> int {
+  auto report = core.verify();
+  print_checkpoint(report.checkpoint);
+  std::cout << fmt::format(
+      "[Info] stripes: {} stored, {} indexed, {} to replay\n",
+      report.stored_stripes,
+      report.indexed_stripes,
+      report.tail_stripes);
+  std::cout << fmt::format("[Info] blob log: {} records\n",
+                           report.blob_log_records);
+  if (report.ok()) {
+    std::cout << "[Info] meta data is consistent" << std::endl;
+    return EXIT_SUCCESS;
+  }
+  std::cout << fmt::format(
+                   "[Error] {} unindexed, {} missing, {} misplaced and {} "
+                   "corrupt stripes, blob log {} records short\n",
+                   report.unindexed_stripes,
+                   report.missing_stripes,
+                   report.misplaced_stripes,
+                   report.corrupt_stripes,
+                   report.blob_log_records <
+                           report.checkpoint.blob_log_records
+                       ? report.checkpoint.blob_log_records -
+                             report.blob_log_records
+                       : 0)
+            << std::flush;
+  return EXIT_FAILURE;
+}
+
+auto compact(meta::MetaCore &core) -> int {
+  auto started = std::chrono::steady_clock::now();
+  auto checkpoint = core.compact();
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - started);
+  print_checkpoint(checkpoint);
+  std::cout << fmt::format("[Info] compacted in {} ms", elapsed.count())
+            << std::endl;
+  return EXIT_SUCCESS;
+}
+
+} // namespace
+
+/// Offline maintenance of the meta data of a coordinator, run it while the
+/// coordinator is stopped.
+/// - verify: check the stripe records against the latest checkpoint
+/// - compact: fold the stripes to replay into a new checkpoint, and compact
+///   the store
+auto main(int argc, char *argv[]) -> int {
+  if (argc != 3) {
+    std::cerr << fmt::format("Usage: {} <verify|compact> <coord_cfg.toml>",
+                             argv[0]) // NOLINT
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  auto command = std::string_view{argv[1]}; // NOLINT
+  if (command != "verify" && command != "compact") {
+    std::cerr << fmt::format("[Error] unknown command {}", command)
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  auto profile = coord::Profile{};
+  try {
+    profile = coord::Profile::ParseToml(argv[2]); // NOLINT
+  } catch (toml::exception &e) {
+    std::cerr << "[Error] toml syntax error: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception &e) {
+    std::cerr << "[Error] failed to parse toml: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    auto core = open_meta(profile);
+    return command == "verify" ? verify(*core) : compact(*core);
+  } catch (meta::NotFound &e) {
+    std::cerr << "[Error] no checkpoint found: " << e.what() << std::endl;
+  } catch (std::exception &e) {
+    std::cerr << "[Error] " << e.what() << std::endl;
+  }
+  return EXIT_FAILURE;
+}
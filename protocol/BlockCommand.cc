@@ -5,6 +5,7 @@
 #include <span>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 BlockCommand::BlockCommand() {
@@ -135,6 +136,12 @@ BlockCommand::getClayOffsetList() const {
   return _clayOffsetList;
 }
 
+const std::string &BlockCommand::getAckTag() const { return _ackTag; }
+
+void BlockCommand::setAckTag(std::string ackTag) {
+  _ackTag = std::move(ackTag);
+}
+
 std::string BlockCommand::serialize() const {
   msgpack::sbuffer sbuf;
   msgpack::packer<msgpack::sbuffer> pk(&sbuf);
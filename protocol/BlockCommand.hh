@@ -17,6 +17,7 @@
 #include <memory>
 #include <msgpack.hpp>
 #include <span>
+#include <string>
 #include <string_view>
 
 #define READANDCACHEBLOCK 0
@@ -68,9 +69,14 @@ public:
 
   // concatenate type2
 
+  /// tells apart the acks of concurrent operations, the worker acks to the
+  /// shared list of the command kind if it is empty, see
+  /// `comm::make_ack_list_name`
+  std::string _ackTag;
+
   MSGPACK_DEFINE(_commandType, _blockId, _offset, _size, _computeType,
                  _srcIpList, _srcBlockIdList, _destBlockId, _blockNum, _k, _m,
-                 _clayOffsetList, _stripeId, _diskId);
+                 _clayOffsetList, _stripeId, _diskId, _ackTag);
 
   BlockCommand();
   explicit BlockCommand(std::string_view reqStr);
@@ -90,6 +96,8 @@ public:
   [[nodiscard]] auto getDestBlockId() const -> block_id_t;
   [[nodiscard]] auto getBlockNum() const -> std::size_t;
   [[nodiscard]] auto getClayOffsetList() const -> const std::vector<offset_t> &;
+  [[nodiscard]] auto getAckTag() const -> const std::string &;
+  void setAckTag(std::string ackTag);
 
   // read and cache
   void buildType0(block_id_t blockId, offset_t offset, size_t size,
@@ -35,6 +35,15 @@ inline auto make_list_name(meta::stripe_id_t stripe_id,
   //                 std::to_string(srcBlockIdList.at(i));
   return fmt::format("stripeid_{}blockid_{}sz_{}", stripe_id, chunk_idx, size);
 }
+/// the ack list of an operation tagged `tag`, the shared list `key` of its
+/// kind if `tag` is empty
+inline auto make_ack_list_name(std::string_view key,
+                               std::string_view tag) -> std::string {
+  if (tag.empty()) {
+    return std::string{key};
+  }
+  return fmt::format("{}_{}", key, tag);
+}
 inline auto
 make_subchunk_list_name(meta::stripe_id_t stripe_id,
                         Command::shard_id_t shard_id,
@@ -197,6 +206,10 @@ public:
             {reinterpret_cast<const std::byte *>(data.data()), // NOLINT
              data.size()});
   }
+  auto push_to(const std::string_view host, const std::string_view key,
+               const util::SharedVec &data) -> void {
+    push_to(host, key, data.as_cbytes());
+  }
   auto push_to(const std::string_view host, const std::string_view key,
                const std::string_view data) -> void {
     push_to(host,
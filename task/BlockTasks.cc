@@ -1,5 +1,6 @@
 #include "BlockCommand.hh"
 #include "Tasks.hh"
+#include "clay_geometry.hh"
 #include "ec_intf.hh"
 #include "erasure_code.hh"
 #include "erasure_code_factory.hpp"
@@ -97,38 +98,13 @@ auto genCLAYRead(int stripeId, int distBlockId, int k, int m, int size,
                  const std::vector<std::string> &ipList,
                  std::vector<std::string> &distIpList)
     -> std::vector<BlockCommand> {
-  vector<BlockCommand::offset_t> clayOffsetList;
-  int d = k + m - 1;
-  int q = d - k + 1;
-
-  std::ostringstream errors;
-  ErasureCodeProfile profile;
-  profile["k"] = std::to_string(k);
-  profile["m"] = std::to_string(m);
-  ErasureCodeInterfaceRef intf = ErasureCodeClayFactory{}.make(profile, errors);
-  auto &clay = dynamic_cast<ErasureCode &>(*intf.get());
-
-  int avail[k + m];
-  for (int i = 0; i < k + m; i++)
-    avail[i] = i;
-
-  set<int> want_to_read;
-  want_to_read.insert(distBlockId);
-  set<int> available(avail, avail + k + m);
-  available.erase(distBlockId);
-  map<int, vector<pair<int, int>>> minimum;
-  clay.minimum_to_decode(want_to_read, available, &minimum);
-
-  for (auto p : minimum.begin()->second) {
-    // one seperate offset for each subchunk, even if it's continuous
-    // the offset is the address offset for subchunk
-    for (int i = 0; i < p.second; i++) {
-      clayOffsetList.push_back((p.first + i) * size);
-    }
-  }
+  // every helper sends the same sub-chunks, one seperate offset for each
+  // subchunk, even if it's continuous
+  const auto &geometry = ec::clay_geometry(k, m);
+  vector<BlockCommand::offset_t> clayOffsetList =
+      geometry.repair_offsets(distBlockId, size);
   for (auto &off : clayOffsetList) {
-    if (off + size >
-        size * ec::encoder::clay::Encoder{k, m}.get_sub_chunk_num()) {
+    if (off + size > static_cast<std::size_t>(size) * geometry.sub_chunk_no) {
       throw std::invalid_argument("offset out of range");
     }
   }
@@ -212,38 +188,13 @@ auto genClayCentRepairTaskList(
     const std::vector<meta::disk_id_t> &diskList,
     const std::vector<std::string> &ipList,
     std::vector<std::string> &distIpList) -> std::vector<BlockCommand> {
-  vector<BlockCommand::offset_t> clayOffsetList;
-  int d = k + m - 1;
-  int q = d - k + 1;
-
-  std::ostringstream errors;
-  ErasureCodeProfile profile;
-  profile["k"] = std::to_string(k);
-  profile["m"] = std::to_string(m);
-  ErasureCodeInterfaceRef intf = ErasureCodeClayFactory{}.make(profile, errors);
-  auto &clay = dynamic_cast<ErasureCode &>(*intf.get());
-
-  int avail[k + m];
-  for (int i = 0; i < k + m; i++)
-    avail[i] = i;
-
-  set<int> want_to_read;
-  want_to_read.insert(distBlockId);
-  set<int> available(avail, avail + k + m);
-  available.erase(distBlockId);
-  map<int, vector<pair<int, int>>> minimum;
-  clay.minimum_to_decode(want_to_read, available, &minimum);
-
-  for (auto p : minimum.begin()->second) {
-    // one seperate offset for each subchunk, even if it's continuous
-    // the offset is the address offset for subchunk
-    for (int i = 0; i < p.second; i++) {
-      clayOffsetList.push_back((p.first + i) * size);
-    }
-  }
+  // every helper sends the same sub-chunks, one seperate offset for each
+  // subchunk, even if it's continuous
+  const auto &geometry = ec::clay_geometry(k, m);
+  vector<BlockCommand::offset_t> clayOffsetList =
+      geometry.repair_offsets(distBlockId, size);
   for (auto &off : clayOffsetList) {
-    if (off + size >
-        size * ec::encoder::clay::Encoder{k, m}.get_sub_chunk_num()) {
+    if (off + size > static_cast<std::size_t>(size) * geometry.sub_chunk_no) {
       throw std::invalid_argument("offset out of range");
     }
   }
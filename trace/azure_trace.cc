@@ -1,29 +1,69 @@
 #include "azure_trace.hh"
+#include "binary_trace.hh"
+#include "payload.hh"
+
+#include <fmt/format.h>
+#include <glog/logging.h>
 
 #include <algorithm>
 #include <cstddef>
 #include <exception>
 #include <iterator>
-#include <random>
+#include <memory>
 #include <string>
 #include <utility>
 
+void trace::DedupTraceReader::BlobIdTracker::to_approximate() {
+  approx_ = std::make_unique<BlockedBloomFilter>(budget_);
+  exact_.for_each([this](meta::blob_id_t blob_id) {
+    approx_->insert(flat_hash::hash_of(blob_id));
+  });
+  exact_.clear();
+  bytes_.store(approx_->bytes(), std::memory_order_relaxed);
+  false_positive_rate_.store(approx_->false_positive_rate(),
+                             std::memory_order_relaxed);
+  approximate_.store(true, std::memory_order_relaxed);
+  LOG(WARNING) << fmt::format("dedup: {} blobs over the budget of {} MB, the "
+                              "later blobs are deduplicated approximately, "
+                              "false positive rate {:.2e}",
+                              tracked_.load(std::memory_order_relaxed),
+                              budget_ >> 20U,
+                              approx_->false_positive_rate())
+               << std::endl;
+}
 auto trace::DedupTraceReader::BlobIdTracker::track(const BlobAccessTrace &trace)
     -> bool {
-  return tracker_.insert(trace.blob_id).second;
+  if (approx_ == nullptr && budget_ != 0 && exact_.bytes_to_grow() > budget_) {
+    to_approximate();
+  }
+  if (approx_ == nullptr) {
+    if (!exact_.insert(trace.blob_id)) {
+      return false;
+    }
+    bytes_.store(exact_.bytes(), std::memory_order_relaxed);
+  } else {
+    if (!approx_->insert(flat_hash::hash_of(trace.blob_id))) {
+      return false;
+    }
+    // the estimate moves slowly, refresh it now and then
+    constexpr std::size_t REFRESH_MASK{4095};
+    if ((tracked_.load(std::memory_order_relaxed) & REFRESH_MASK) == 0) {
+      false_positive_rate_.store(approx_->false_positive_rate(),
+                                 std::memory_order_relaxed);
+    }
+  }
+  tracked_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+auto trace::DedupTraceReader::BlobIdTracker::stats() const -> DedupStats {
+  return {.tracked = tracked_.load(std::memory_order_relaxed),
+          .bytes = bytes_.load(std::memory_order_relaxed),
+          .approximate = approximate_.load(std::memory_order_relaxed),
+          .false_positive_rate =
+              false_positive_rate_.load(std::memory_order_relaxed)};
 }
 auto trace::make_rand_data(const BlobAccessTrace &trace) -> std::vector<char> {
-  std::vector<char> data{};
-  data.reserve(trace.size);
-  // generate random data
-  constexpr std::size_t RAND_SEED{0x9b648};
-  thread_local std::mt19937 gen(RAND_SEED);
-  thread_local std::uniform_int_distribution<int> dis{};
-
-  std::generate_n(std::back_inserter(data), trace.size, [&]() {
-    return static_cast<char>(dis(gen));
-  });
-  return data;
+  return make_payload(trace.blob_id, trace.size);
 }
 auto trace::AzureTraceReader::next_trace() -> BlobAccessTrace {
   try {
@@ -48,3 +88,34 @@ auto trace::TraceException::what() const noexcept -> const char * {
   return azure_trace_rs::err_to_str(err_).data();
 }
 auto trace::TraceException::error_enum() const -> trace_error_e { return err_; }
+auto trace::make_azure_trace(const std::filesystem::path &trace_file,
+                             std::size_t step_by, std::size_t dedup_budget,
+                             const DedupTraceReader **dedup)
+    -> TraceReaderPtr {
+  // `StepByTraceReader` skips `step_by` records before each one
+  if (binary_trace::is_binary_trace(trace_file)) {
+    return std::make_unique<MappedTraceReader>(
+        std::make_shared<const BinaryTrace>(trace_file),
+        true,
+        step_by > 1 ? step_by + 1 : 1);
+  }
+  auto trace = std::make_unique<AzureTraceReader>(trace_file);
+  auto deduped =
+      std::make_unique<DedupTraceReader>(std::move(trace), dedup_budget);
+  if (dedup != nullptr) {
+    *dedup = deduped.get();
+  }
+  if (step_by > 1) {
+    return std::make_unique<StepByTraceReader>(std::move(deduped), step_by);
+  } else {
+    return deduped;
+  }
+}
+auto trace::make_replay_trace(const std::filesystem::path &trace_file)
+    -> TraceReaderPtr {
+  if (binary_trace::is_binary_trace(trace_file)) {
+    return std::make_unique<MappedTraceReader>(
+        std::make_shared<const BinaryTrace>(trace_file), false, 1);
+  }
+  return std::make_unique<AzureTraceReader>(trace_file);
+}
@@ -1,12 +1,13 @@
 #pragma once
 
 #include "azure_trace.rs.h"
+#include "blob_filter.hpp"
 #include "meta.hpp"
 
+#include <atomic>
 #include <exception>
 #include <filesystem>
 #include <memory>
-#include <unordered_set>
 #include <vector>
 
 namespace trace {
@@ -49,25 +50,56 @@ public:
   [[nodiscard]] auto next_trace() -> BlobAccessTrace override;
 };
 
+/// the payload of the blob of `trace`, see `make_payload`
 auto make_rand_data(const BlobAccessTrace &trace) -> std::vector<char>;
 
+/// the memory of a `DedupTraceReader`
+struct DedupStats {
+  /// blobs passed on
+  std::size_t tracked;
+  std::size_t bytes;
+  /// whether the blobs are tracked by a Bloom filter, which drops the first
+  /// access of a blob with its false positive rate
+  bool approximate;
+  double false_positive_rate;
+};
+
+/// Passes on the first access of each blob.
+/// # Note
+/// the blob ids are kept exactly, in a `BlobIdSet`, until the set would grow
+/// over the budget; then they move to a `BlockedBloomFilter` of the budget,
+/// and the later blobs are dropped with its false positive rate, a repeated
+/// access is never passed on
 class DedupTraceReader : virtual public TraceReader {
   class BlobIdTracker {
   private:
-    std::unordered_set<meta::blob_id_t> tracker_{};
+    std::size_t budget_;
+    BlobIdSet exact_{};
+    std::unique_ptr<BlockedBloomFilter> approx_{};
+    /// published for `stats`, the trace may be read on a pipeline stage
+    std::atomic<std::size_t> tracked_{0};
+    std::atomic<std::size_t> bytes_{0};
+    std::atomic<double> false_positive_rate_{0};
+    std::atomic<bool> approximate_{false};
+
+    void to_approximate();
 
   public:
+    explicit BlobIdTracker(std::size_t budget) : budget_(budget) {}
     // track this blob, and return true if this blob is not tracked before
     auto track(const BlobAccessTrace &trace) -> bool;
+    [[nodiscard]] auto stats() const -> DedupStats;
   };
 
 private:
-  BlobIdTracker blob_tracker_{};
+  BlobIdTracker blob_tracker_;
   std::unique_ptr<TraceReader> trace_reader_;
 
 public:
-  DedupTraceReader(std::unique_ptr<TraceReader> trace_reader)
-      : trace_reader_(std::move(trace_reader)) {}
+  /// `budget` bytes for the blob ids, `0` to keep them all exactly
+  DedupTraceReader(std::unique_ptr<TraceReader> trace_reader,
+                   std::size_t budget = 0)
+      : blob_tracker_(budget), trace_reader_(std::move(trace_reader)) {}
 
   [[nodiscard]] auto next_trace() -> BlobAccessTrace override {
     while (true) {
@@ -77,6 +109,12 @@ public:
       }
     }
   };
+
+  /// # Note
+  /// thread safe, e.g. while a pipeline stage reads the trace
+  [[nodiscard]] auto stats() const -> DedupStats {
+    return blob_tracker_.stats();
+  }
 };
 
 class StepByTraceReader : virtual public TraceReader {
@@ -96,15 +134,21 @@ public:
   };
 };
 
-inline auto make_azure_trace(const std::filesystem::path &trace_file,
-                             std::size_t step_by) -> TraceReaderPtr {
-  auto trace = std::make_unique<AzureTraceReader>(trace_file);
-  auto dedup = std::make_unique<DedupTraceReader>(std::move(trace));
-  if (step_by > 1) {
-    return std::make_unique<StepByTraceReader>(std::move(dedup), step_by);
-  } else {
-    return dedup;
-  }
-}
+/// Open a trace, deduplicated by blob and stepped by `step_by`.
+/// # Note
+/// - a trace converted by `BinaryTraceWriter` is mapped, see
+///   `MappedTraceReader`, and deduplicated by its index of first accesses
+/// - other files are parsed as Azure CSV and deduplicated by a
+///   `DedupTraceReader` of `dedup_budget` bytes, which is set to `dedup` if
+///   it is not null, e.g. to report its memory
+auto make_azure_trace(const std::filesystem::path &trace_file,
+                      std::size_t step_by, std::size_t dedup_budget = 0,
+                      const DedupTraceReader **dedup = nullptr)
+    -> TraceReaderPtr;
+
+/// Open a trace with all of its records, e.g. every access of a blob for a
+/// replay, a converted trace is mapped as in `make_azure_trace`.
+auto make_replay_trace(const std::filesystem::path &trace_file)
+    -> TraceReaderPtr;
 
 } // namespace trace
\ No newline at end of file
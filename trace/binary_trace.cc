@@ -0,0 +1,258 @@
+#include "binary_trace.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using trace::binary_trace::COLUMN_COUNT;
+using trace::binary_trace::Header;
+
+/// the spool of the first access index, after the columns
+constexpr std::size_t FIRST_ACCESS_SPOOL{COLUMN_COUNT};
+constexpr std::size_t ALIGN{8};
+
+auto column_width(std::size_t column) -> std::size_t {
+  return column < trace::binary_trace::BlobType ? sizeof(std::uint64_t)
+                                                : sizeof(std::uint8_t);
+}
+
+auto align_up(std::uint64_t offset) -> std::uint64_t {
+  return (offset + ALIGN - 1) / ALIGN * ALIGN;
+}
+
+template <typename T> void spool(std::FILE *file, T value) {
+  if (std::fwrite(&value, sizeof(value), 1, file) != 1) {
+    throw trace::TraceException(trace::trace_error_e::Io);
+  }
+}
+
+} // namespace
+
+auto trace::binary_trace::is_binary_trace(const std::filesystem::path &path)
+    -> bool {
+  auto file = std::ifstream{path, std::ios::binary};
+  auto magic = MAGIC;
+  if (!file.read(magic.data(), magic.size())) {
+    return false;
+  }
+  return magic == MAGIC;
+}
+
+auto trace::BinaryTraceWriter::spool_path(std::size_t i) const
+    -> std::filesystem::path {
+  auto spool = path_;
+  spool += ".spool" + std::to_string(i);
+  return spool;
+}
+
+void trace::BinaryTraceWriter::close_spools() {
+  for (std::size_t i = 0; i < spools_.size(); i++) {
+    if (spools_[i] != nullptr) {
+      std::fclose(spools_[i]);
+      spools_[i] = nullptr;
+      std::error_code ec{};
+      std::filesystem::remove(spool_path(i), ec);
+    }
+  }
+}
+
+trace::BinaryTraceWriter::BinaryTraceWriter(std::filesystem::path path)
+    : path_{std::move(path)} {
+  constexpr std::size_t SPOOL_BUFFER{std::size_t{1} << 20};
+  for (std::size_t i = 0; i < spools_.size(); i++) {
+    spools_[i] = std::fopen(spool_path(i).c_str(), "w+b");
+    if (spools_[i] == nullptr) {
+      close_spools();
+      throw TraceException(trace_error_e::Io);
+    }
+    std::setvbuf(spools_[i], nullptr, _IOFBF, SPOOL_BUFFER);
+  }
+}
+
+trace::BinaryTraceWriter::~BinaryTraceWriter() { close_spools(); }
+
+void trace::BinaryTraceWriter::append(const BlobAccessTrace &trace) {
+  using namespace binary_trace;
+  if (trace.size == 0) {
+    return;
+  }
+  spool<std::uint64_t>(spools_[TimeStamp], trace.time_stamp);
+  spool<std::uint64_t>(spools_[Region], trace.region_id);
+  spool<std::uint64_t>(spools_[User], trace.user_id);
+  spool<std::uint64_t>(spools_[App], trace.app_id);
+  spool<std::uint64_t>(spools_[Func], trace.func_id);
+  spool<std::uint64_t>(spools_[BlobId], trace.blob_id);
+  spool<std::uint64_t>(spools_[VersionTag], trace.version_tag);
+  spool<std::uint64_t>(spools_[Size], trace.size);
+  spool(spools_[BlobType], static_cast<std::uint8_t>(trace.blob_type));
+  spool(spools_[Flags],
+        static_cast<std::uint8_t>((trace.read ? READ_FLAG : 0) |
+                                  (trace.write ? WRITE_FLAG : 0)));
+  if (seen_.insert(trace.blob_id)) {
+    spool<std::uint64_t>(spools_[FIRST_ACCESS_SPOOL], rows_);
+    first_access_rows_++;
+  }
+  rows_++;
+}
+
+auto trace::BinaryTraceWriter::finish() -> std::uint64_t {
+  using namespace binary_trace;
+  auto header = Header{};
+  header.magic = MAGIC;
+  header.version = VERSION;
+  header.columns = COLUMN_COUNT;
+  header.rows = rows_;
+  header.first_access_rows = first_access_rows_;
+  auto offset = align_up(sizeof(Header));
+  for (std::size_t i = 0; i < COLUMN_COUNT; i++) {
+    header.column_offset[i] = offset;
+    offset = align_up(offset + rows_ * column_width(i));
+  }
+  header.first_access_offset = offset;
+
+  auto tmp_path = path_;
+  tmp_path += ".tmp";
+  auto *out = std::fopen(tmp_path.c_str(), "wb");
+  if (out == nullptr) {
+    throw TraceException(trace_error_e::Io);
+  }
+  auto written = std::uint64_t{0};
+  auto write = [&](const void *data, std::size_t size) {
+    if (std::fwrite(data, 1, size, out) != size) {
+      std::fclose(out);
+      throw TraceException(trace_error_e::Io);
+    }
+    written += size;
+  };
+  auto pad = [&] {
+    constexpr std::array<char, ALIGN> ZEROS{};
+    write(ZEROS.data(), align_up(written) - written);
+  };
+  write(&header, sizeof(header));
+  pad();
+  auto buffer = std::vector<char>(std::size_t{1} << 20); // NOLINT
+  for (auto *spool : spools_) {
+    if (std::fflush(spool) != 0) {
+      std::fclose(out);
+      throw TraceException(trace_error_e::Io);
+    }
+    std::rewind(spool);
+    std::size_t read{0};
+    while ((read = std::fread(buffer.data(), 1, buffer.size(), spool)) > 0) {
+      write(buffer.data(), read);
+    }
+    pad();
+  }
+  if (std::fclose(out) != 0) {
+    throw TraceException(trace_error_e::Io);
+  }
+  std::error_code ec{};
+  std::filesystem::rename(tmp_path, path_, ec);
+  if (ec) {
+    throw TraceException(trace_error_e::Io);
+  }
+  close_spools();
+  return rows_;
+}
+
+trace::BinaryTrace::BinaryTrace(const std::filesystem::path &path)
+    : map_{MAP_FAILED} {
+  using namespace binary_trace;
+  auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC); // NOLINT
+  if (fd < 0) {
+    throw TraceException(trace_error_e::Io);
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw TraceException(trace_error_e::Io);
+  }
+  map_size_ = static_cast<std::size_t>(st.st_size);
+  if (map_size_ < sizeof(Header)) {
+    ::close(fd);
+    throw TraceException(trace_error_e::BadRecord);
+  }
+  map_ = ::mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map_ == MAP_FAILED) {
+    throw TraceException(trace_error_e::Io);
+  }
+  const auto *base = static_cast<const char *>(map_);
+  std::memcpy(&header_, base, sizeof(header_));
+  auto fits = [&](std::uint64_t offset, std::uint64_t size) {
+    return offset % ALIGN == 0 && offset <= map_size_ &&
+           size <= map_size_ - offset;
+  };
+  auto valid = header_.magic == MAGIC && header_.version == VERSION &&
+               header_.columns == COLUMN_COUNT &&
+               fits(header_.first_access_offset,
+                    header_.first_access_rows * sizeof(std::uint64_t));
+  for (std::size_t i = 0; valid && i < COLUMN_COUNT; i++) {
+    valid = fits(header_.column_offset[i], header_.rows * column_width(i));
+  }
+  if (!valid) {
+    ::munmap(map_, map_size_);
+    throw TraceException(trace_error_e::BadRecord);
+  }
+  for (std::size_t i = 0; i < u64_columns_.size(); i++) {
+    u64_columns_[i] = reinterpret_cast<const std::uint64_t *>( // NOLINT
+        base + header_.column_offset[i]);
+  }
+  blob_types_ = reinterpret_cast<const std::uint8_t *>( // NOLINT
+      base + header_.column_offset[BlobType]);
+  flags_ = reinterpret_cast<const std::uint8_t *>( // NOLINT
+      base + header_.column_offset[Flags]);
+  first_access_ = {reinterpret_cast<const std::uint64_t *>( // NOLINT
+                       base + header_.first_access_offset),
+                   header_.first_access_rows};
+}
+
+trace::BinaryTrace::~BinaryTrace() {
+  if (map_ != MAP_FAILED) {
+    ::munmap(map_, map_size_);
+  }
+}
+
+auto trace::BinaryTrace::record(std::uint64_t row) const -> BlobAccessTrace {
+  using namespace binary_trace;
+  auto flags = flags_[row];
+  return BlobAccessTrace{
+      .time_stamp = u64_columns_[TimeStamp][row],
+      .region_id = u64_columns_[Region][row],
+      .user_id = u64_columns_[User][row],
+      .app_id = u64_columns_[App][row],
+      .func_id = u64_columns_[Func][row],
+      .blob_id = u64_columns_[BlobId][row],
+      .blob_type = static_cast<azure_trace_rs::BlobType>(blob_types_[row]),
+      .version_tag = u64_columns_[VersionTag][row],
+      .size = u64_columns_[Size][row],
+      .read = (flags & READ_FLAG) != 0,
+      .write = (flags & WRITE_FLAG) != 0,
+  };
+}
+
+trace::MappedTraceReader::MappedTraceReader(
+    std::shared_ptr<const BinaryTrace> trace, bool dedup, std::size_t stride)
+    : trace_{std::move(trace)}, dedup_{dedup},
+      stride_{std::max<std::uint64_t>(stride, 1)} {}
+
+auto trace::MappedTraceReader::next_trace() -> BlobAccessTrace {
+  auto count = dedup_ ? trace_->first_access().size() : trace_->rows();
+  auto index = next_ + stride_ - 1;
+  if (index >= count) {
+    next_ = count;
+    throw TraceException(trace_error_e::Exhaust);
+  }
+  next_ += stride_;
+  return trace_->record(dedup_ ? trace_->first_access()[index] : index);
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "azure_trace.hh"
+#include "meta.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+/// A preconverted blob access trace, in fixed width columns that are mapped
+/// and read by row index.
+///
+/// ```text
+/// char[8] magic "NCBTRACE", u32 version, u32 column count
+/// u64 rows, u64 first access rows
+/// u64 offset of each column, u64 offset of the first access index
+/// the columns, each 8-byte aligned, in host byte order:
+///   u64 time_stamp, region_id, user_id, app_id, func_id, blob_id,
+///   version_tag, size
+///   u8 blob_type, u8 flags (bit 0 read, bit 1 write)
+/// u64 first access index: the rows that access their blob for the first
+/// time, ascending
+/// ```
+///
+/// The records of size 0, which `AzureTraceReader` skips, are not converted.
+namespace trace {
+
+namespace binary_trace {
+
+inline constexpr std::array<char, 8> MAGIC{
+    'N', 'C', 'B', 'T', 'R', 'A', 'C', 'E'};
+inline constexpr std::uint32_t VERSION{1};
+
+enum Column : std::uint32_t {
+  TimeStamp,
+  Region,
+  User,
+  App,
+  Func,
+  BlobId,
+  VersionTag,
+  Size,
+  /// the columns before are u64, the ones after are u8
+  BlobType,
+  Flags,
+  COLUMN_COUNT,
+};
+
+inline constexpr std::uint8_t READ_FLAG{1};
+inline constexpr std::uint8_t WRITE_FLAG{2};
+
+struct Header {
+  std::array<char, 8> magic;
+  std::uint32_t version;
+  std::uint32_t columns;
+  std::uint64_t rows;
+  std::uint64_t first_access_rows;
+  std::array<std::uint64_t, COLUMN_COUNT> column_offset;
+  std::uint64_t first_access_offset;
+};
+
+/// whether the file starts with the magic of a converted trace
+auto is_binary_trace(const std::filesystem::path &path) -> bool;
+
+} // namespace binary_trace
+
+/// Converts a trace to the binary format, e.g. the records of an
+/// `AzureTraceReader`.
+/// # Note
+/// the columns are spooled to temporary files next to the output, and
+/// concatenated by `finish`
+class BinaryTraceWriter {
+  std::filesystem::path path_;
+  std::array<std::FILE *, binary_trace::COLUMN_COUNT + 1> spools_{};
+  BlobIdSet seen_{};
+  std::uint64_t rows_{0};
+  std::uint64_t first_access_rows_{0};
+
+  [[nodiscard]] auto spool_path(std::size_t i) const -> std::filesystem::path;
+  void close_spools();
+
+public:
+  /// # Throw
+  /// `TraceException` of `Io` if a spool can not be created
+  explicit BinaryTraceWriter(std::filesystem::path path);
+  BinaryTraceWriter(const BinaryTraceWriter &) = delete;
+  auto operator=(const BinaryTraceWriter &) -> BinaryTraceWriter & = delete;
+  BinaryTraceWriter(BinaryTraceWriter &&) = delete;
+  auto operator=(BinaryTraceWriter &&) -> BinaryTraceWriter & = delete;
+  ~BinaryTraceWriter();
+
+  /// records of size 0 are dropped
+  void append(const BlobAccessTrace &trace);
+
+  /// write the trace file, replacing the output atomically
+  /// # Return
+  /// the number of rows
+  /// # Throw
+  /// `TraceException` of `Io` if a write fails
+  auto finish() -> std::uint64_t;
+};
+
+/// A mapped binary trace, a record is decoded by its row without allocation.
+class BinaryTrace {
+  void *map_;
+  std::size_t map_size_{0};
+  binary_trace::Header header_{};
+  std::array<const std::uint64_t *, binary_trace::BlobType> u64_columns_{};
+  const std::uint8_t *blob_types_{};
+  const std::uint8_t *flags_{};
+  std::span<const std::uint64_t> first_access_{};
+
+public:
+  /// # Throw
+  /// `TraceException` of `Io` if the file can not be mapped, of `BadRecord`
+  /// if it is not a binary trace
+  explicit BinaryTrace(const std::filesystem::path &path);
+  BinaryTrace(const BinaryTrace &) = delete;
+  auto operator=(const BinaryTrace &) -> BinaryTrace & = delete;
+  BinaryTrace(BinaryTrace &&) = delete;
+  auto operator=(BinaryTrace &&) -> BinaryTrace & = delete;
+  ~BinaryTrace();
+
+  [[nodiscard]] auto rows() const -> std::uint64_t { return header_.rows; }
+  /// the rows that access their blob for the first time
+  [[nodiscard]] auto first_access() const -> std::span<const std::uint64_t> {
+    return first_access_;
+  }
+
+  /// # Note
+  /// the row is expected to be below `rows`
+  [[nodiscard]] auto record(std::uint64_t row) const -> BlobAccessTrace;
+};
+
+/// Reads a `BinaryTrace` in order, deduplication and stepping are index
+/// arithmetic instead of reading and dropping records.
+/// # Note
+/// - with `dedup`, only the first access of each blob is read, as
+///   `DedupTraceReader` does
+/// - each call advances `stride` records and returns the last of them, a
+///   stride of `n + 1` matches `StepByTraceReader` with a step of `n`
+class MappedTraceReader : virtual public TraceReader {
+  std::shared_ptr<const BinaryTrace> trace_;
+  bool dedup_;
+  std::uint64_t stride_;
+  std::uint64_t next_{0};
+
+public:
+  MappedTraceReader(std::shared_ptr<const BinaryTrace> trace, bool dedup,
+                    std::size_t stride);
+
+  /// # Throw
+  /// `TraceException` of `Exhaust` at the end of the trace
+  [[nodiscard]] auto next_trace() -> BlobAccessTrace override;
+};
+
+} // namespace trace
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "flat_hash_map.hpp"
+#include "meta.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Compact sets of the blob ids of a trace, for deduplicating traces of
+/// hundreds of millions of blobs.
+namespace trace {
+
+/// An exact set of blob ids, stored inline in one open addressing array.
+/// # Note
+/// 8 bytes per slot at a load of 3/8 to 3/4, about 11 to 21 bytes per id,
+/// against the 40 or more of a node of `std::unordered_set`
+class BlobIdSet {
+  /// marks an empty slot, the id itself is tracked by `has_empty_key_`
+  inline static constexpr meta::blob_id_t EMPTY{~meta::blob_id_t{0}};
+
+  std::vector<meta::blob_id_t> slots_{};
+  std::size_t mask_{0};
+  std::size_t size_{0};
+  bool has_empty_key_{false};
+
+  auto slot_of(meta::blob_id_t blob_id) const -> std::size_t {
+    auto slot = flat_hash::hash_of(blob_id) & mask_;
+    while (slots_[slot] != EMPTY && slots_[slot] != blob_id) {
+      slot = (slot + 1) & mask_;
+    }
+    return slot;
+  }
+
+  auto rehash(std::size_t slots) -> void {
+    auto old = std::vector<meta::blob_id_t>(slots, EMPTY);
+    old.swap(slots_);
+    mask_ = slots - 1;
+    for (auto blob_id : old) {
+      if (blob_id != EMPTY) {
+        slots_[slot_of(blob_id)] = blob_id;
+      }
+    }
+  }
+
+public:
+  inline static constexpr std::size_t MIN_SLOTS{16};
+
+  BlobIdSet() { rehash(MIN_SLOTS); }
+
+  [[nodiscard]] auto size() const -> std::size_t { return size_; }
+  [[nodiscard]] auto bytes() const -> std::size_t {
+    return slots_.capacity() * sizeof(meta::blob_id_t);
+  }
+  /// the bytes once the next insert grows the set
+  [[nodiscard]] auto bytes_to_grow() const -> std::size_t {
+    return needs_growth() ? bytes() * 2 : bytes();
+  }
+
+  [[nodiscard]] auto needs_growth() const -> bool {
+    return (size_ + 1) * 4 > slots_.size() * 3;
+  }
+
+  [[nodiscard]] auto contains(meta::blob_id_t blob_id) const -> bool {
+    if (blob_id == EMPTY) {
+      return has_empty_key_;
+    }
+    return slots_[slot_of(blob_id)] == blob_id;
+  }
+
+  /// # Return
+  /// true if the id is not in the set before
+  auto insert(meta::blob_id_t blob_id) -> bool {
+    if (blob_id == EMPTY) {
+      auto fresh = !has_empty_key_;
+      has_empty_key_ = true;
+      size_ += fresh ? 1 : 0;
+      return fresh;
+    }
+    auto slot = slot_of(blob_id);
+    if (slots_[slot] == blob_id) {
+      return false;
+    }
+    if (needs_growth()) {
+      rehash(slots_.size() * 2);
+      slot = slot_of(blob_id);
+    }
+    slots_[slot] = blob_id;
+    size_++;
+    return true;
+  }
+
+  template <class F> auto for_each(F &&f) const -> void {
+    if (has_empty_key_) {
+      f(EMPTY);
+    }
+    for (auto blob_id : slots_) {
+      if (blob_id != EMPTY) {
+        f(blob_id);
+      }
+    }
+  }
+
+  /// empty the set and release its memory
+  auto clear() -> void {
+    slots_ = {};
+    size_ = 0;
+    has_empty_key_ = false;
+    rehash(MIN_SLOTS);
+  }
+};
+
+/// A Bloom filter whose probes of a key fall in one cache line, so an insert
+/// or a lookup misses the cache once.
+/// # Note
+/// - a key not inserted is reported as inserted with the false positive
+///   rate, an inserted key is never reported as new
+/// - at 10 bits per key the false positive rate is about 1%
+class BlockedBloomFilter {
+  inline static constexpr std::size_t BLOCK_WORDS{8};
+  inline static constexpr std::size_t BLOCK_BITS{BLOCK_WORDS * 64};
+  /// probes of 9 bits each, taken from one 64-bit hash
+  inline static constexpr std::size_t PROBES{7};
+
+  std::vector<std::uint64_t> words_;
+  std::size_t blocks_;
+  std::size_t set_bits_{0};
+
+public:
+  /// a filter of at most `bytes` bytes, one block at least
+  explicit BlockedBloomFilter(std::size_t bytes)
+      : blocks_(std::max<std::size_t>(bytes / (BLOCK_WORDS * 8), 1)) {
+    words_.assign(blocks_ * BLOCK_WORDS, 0);
+  }
+
+  [[nodiscard]] auto bytes() const -> std::size_t {
+    return words_.size() * sizeof(std::uint64_t);
+  }
+
+  /// # Return
+  /// true if `hash` is not in the filter before, up to a false positive
+  auto insert(std::uint64_t hash) -> bool {
+    auto *block = words_.data() + (hash % blocks_) * BLOCK_WORDS; // NOLINT
+    // the block is picked by the hash, the bits in it by a remix of it
+    auto probes = flat_hash::hash_of(hash);
+    auto fresh = false;
+    for (std::size_t i = 0; i < PROBES; i++) {
+      auto bit = (probes >> (i * 9)) & (BLOCK_BITS - 1);
+      auto mask = std::uint64_t{1} << (bit % 64);
+      auto &word = block[bit / 64]; // NOLINT
+      if ((word & mask) == 0) {
+        word |= mask;
+        set_bits_++;
+        fresh = true;
+      }
+    }
+    return fresh;
+  }
+
+  /// the estimated false positive rate at the current fill
+  [[nodiscard]] auto false_positive_rate() const -> double {
+    auto fill = static_cast<double>(set_bits_) /
+                static_cast<double>(words_.size() * 64);
+    auto rate = double{1};
+    for (std::size_t i = 0; i < PROBES; i++) {
+      rate *= fill;
+    }
+    return rate;
+  }
+};
+
+} // namespace trace
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace flat_hash {
+
+/// spreads sequential keys, e.g. user ids, over the table
+template <class Key> auto hash_of(const Key &key) -> std::uint64_t {
+  auto z = static_cast<std::uint64_t>(std::hash<Key>{}(key));
+  z = (z ^ (z >> 30U)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27U)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31U);
+}
+
+/// A linear probing table of indices into an external array of entries.
+/// # Note
+/// - the entries are stored densely by the owner, the table only maps a key
+///   to its entry index, so erasing keeps the entries compact
+/// - deletion shifts the following probes back instead of leaving
+///   tombstones, lookups never scan deleted slots
+class ProbeTable {
+public:
+  using index_t = std::uint32_t;
+  inline static constexpr index_t EMPTY{std::numeric_limits<index_t>::max()};
+
+private:
+  std::vector<index_t> slots_{};
+  std::size_t mask_{0};
+
+public:
+  [[nodiscard]] auto slots() const -> std::size_t { return slots_.size(); }
+
+  /// the slot of the entry of `hash` whose key satisfies `equal`, or the
+  /// empty slot that ends its probe
+  template <class Equal>
+  [[nodiscard]] auto probe(std::uint64_t hash, Equal &&equal) const
+      -> std::size_t {
+    for (auto slot = hash & mask_;; slot = (slot + 1) & mask_) {
+      auto index = slots_[slot];
+      if (index == EMPTY || equal(index)) {
+        return slot;
+      }
+    }
+  }
+
+  [[nodiscard]] auto at(std::size_t slot) const -> index_t {
+    return slots_[slot];
+  }
+  auto set(std::size_t slot, index_t index) -> void { slots_[slot] = index; }
+
+  /// empty `slot`, moving back the entries probed past it
+  /// # Note
+  /// `hash_at(index)` is the hash of the key of entry `index`
+  template <class HashAt> auto erase(std::size_t slot, HashAt &&hash_at) {
+    slots_[slot] = EMPTY;
+    for (auto next = (slot + 1) & mask_; slots_[next] != EMPTY;
+         next = (next + 1) & mask_) {
+      auto home = hash_at(slots_[next]) & mask_;
+      // move the entry back if its home is not in (slot, next]
+      if (((next - home) & mask_) >= ((next - slot) & mask_)) {
+        slots_[slot] = slots_[next];
+        slots_[next] = EMPTY;
+        slot = next;
+      }
+    }
+  }
+
+  /// rebuild with room for `capacity` entries below a load of 1/2, and
+  /// insert the entries [0, entries)
+  template <class HashAt>
+  auto rehash(std::size_t capacity, std::size_t entries, HashAt &&hash_at)
+      -> void {
+    auto slots = std::bit_ceil(std::max<std::size_t>(capacity * 2, 16));
+    slots_.assign(slots, EMPTY);
+    mask_ = slots - 1;
+    for (std::size_t i = 0; i < entries; i++) {
+      auto slot = probe(hash_at(i), [](index_t) { return false; });
+      slots_[slot] = static_cast<index_t>(i);
+    }
+  }
+
+  [[nodiscard]] auto needs_growth(std::size_t entries) const -> bool {
+    // keep the load at most 3/4
+    return (entries + 1) * 4 > slots_.size() * 3;
+  }
+};
+
+/// An open addressing hash map with its entries in one dense vector.
+/// # Note
+/// - references and iterators are invalidated by `try_emplace` and `erase`
+/// - the entries are iterated in insertion order, until an erase moves the
+///   last entry into the erased place
+template <class Key, class Value> class FlatHashMap {
+public:
+  using value_type = std::pair<Key, Value>;
+
+private:
+  std::vector<value_type> entries_{};
+  std::vector<std::uint64_t> hashes_{};
+  ProbeTable table_{};
+
+  auto find_slot(const Key &key, std::uint64_t hash) const -> std::size_t {
+    return table_.probe(hash, [&](ProbeTable::index_t index) {
+      return hashes_[index] == hash && entries_[index].first == key;
+    });
+  }
+
+  auto hash_at() const {
+    return [this](std::size_t index) { return hashes_[index]; };
+  }
+
+public:
+  FlatHashMap() { table_.rehash(0, 0, hash_at()); }
+
+  [[nodiscard]] auto size() const -> std::size_t { return entries_.size(); }
+  [[nodiscard]] auto empty() const -> bool { return entries_.empty(); }
+  auto begin() { return entries_.begin(); }
+  auto end() { return entries_.end(); }
+  auto begin() const { return entries_.cbegin(); }
+  auto end() const { return entries_.cend(); }
+
+  auto find(const Key &key) -> Value * {
+    auto index = table_.at(find_slot(key, hash_of(key)));
+    return index == ProbeTable::EMPTY ? nullptr : &entries_[index].second;
+  }
+
+  [[nodiscard]] auto contains(const Key &key) const -> bool {
+    return table_.at(find_slot(key, hash_of(key))) != ProbeTable::EMPTY;
+  }
+
+  /// the value of `key`, constructed from `args` if there is none
+  template <class... Args>
+  auto try_emplace(const Key &key, Args &&...args) -> Value & {
+    auto hash = hash_of(key);
+    auto slot = find_slot(key, hash);
+    if (auto index = table_.at(slot); index != ProbeTable::EMPTY) {
+      return entries_[index].second;
+    }
+    if (table_.needs_growth(entries_.size())) {
+      table_.rehash(entries_.size() * 2, entries_.size(), hash_at());
+      slot = find_slot(key, hash);
+    }
+    table_.set(slot, static_cast<ProbeTable::index_t>(entries_.size()));
+    entries_.emplace_back(std::piecewise_construct,
+                          std::forward_as_tuple(key),
+                          std::forward_as_tuple(std::forward<Args>(args)...));
+    hashes_.push_back(hash);
+    return entries_.back().second;
+  }
+
+  auto erase(const Key &key) -> bool {
+    auto slot = find_slot(key, hash_of(key));
+    auto index = table_.at(slot);
+    if (index == ProbeTable::EMPTY) {
+      return false;
+    }
+    table_.erase(slot, hash_at());
+    auto last = static_cast<ProbeTable::index_t>(entries_.size() - 1);
+    if (index != last) {
+      // move the last entry into the hole and repoint its slot
+      auto last_slot = find_slot(entries_[last].first, hashes_[last]);
+      entries_[index] = std::move(entries_[last]);
+      hashes_[index] = hashes_[last];
+      table_.set(last_slot, index);
+    }
+    entries_.pop_back();
+    hashes_.pop_back();
+    return true;
+  }
+
+  auto clear() -> void {
+    entries_.clear();
+    hashes_.clear();
+    table_.rehash(0, 0, hash_at());
+  }
+};
+
+} // namespace flat_hash
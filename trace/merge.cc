@@ -8,35 +8,34 @@
  * 进行设置: https://github.com/OBKoro1/koro1FileHeader/wiki/%E9%85%8D%E7%BD%AE
  */
 #include "merge.hh"
-#include <algorithm>
 #include <cstddef>
-#include <iterator>
 #include <optional>
 #include <utility>
-#include <vector>
 
-auto trace::ChunkMerge::merge_stream(boost::span<char> in)
-    -> std::pair<std::size_t, std::optional<std::vector<char>>> {
-  if (in.size() == 0) {
+auto trace::ChunkMerge::merge_stream(util::GatherList in)
+    -> std::pair<std::size_t, std::optional<util::GatherList>> {
+  if (in.empty()) {
     return {buffer.size(), std::nullopt};
   }
 
-  std::vector<char> input(in.begin(), in.end());
   size_t offset = buffer.size();
-  // buffer.insert(buffer.end(), input.begin(), input.end());
-  std::copy(in.cbegin(), in.cend(), std::back_inserter(buffer));
+  buffer.append(in);
   if (buffer.size() >= chunk_size) {
     auto chunk = flush_buffer();
-    return {offset, chunk};
+    return {offset, std::move(chunk)};
   } else {
     return {offset, std::nullopt};
   }
 }
 
-auto trace::ChunkMerge::flush_buffer() -> std::vector<char> {
-  auto chunk = std::move(buffer);
-  // reserve 108% of the chunk size
-  buffer.reserve(chunk_size * 108 / 100); // NOLINT
-  return chunk;
+auto trace::ChunkMerge::flush_buffer() -> util::GatherList {
+  return std::exchange(buffer, util::GatherList{});
 }
 auto trace::ChunkMerge::merge_size() const -> std::size_t { return chunk_size; }
+auto trace::ChunkMerge::set_merge_size(std::size_t merge_size) -> void {
+  chunk_size = merge_size;
+}
+
+auto trace::ChunkMerge::buffered_size() const -> std::size_t {
+  return buffer.size();
+}
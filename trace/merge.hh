@@ -8,14 +8,15 @@
  * @Description: 这是默认设置,请设置`customMade`, 打开koroFileHeader查看配置
  * 进行设置: https://github.com/OBKoro1/koro1FileHeader/wiki/%E9%85%8D%E7%BD%AE
  */
+#include "gather_list.hpp"
 #include "utils.hpp"
-#include <boost/core/span.hpp>
 #include <cstddef>
 #include <optional>
 #include <utility>
-#include <vector>
 
 namespace trace {
+/// Merges blobs by reference: the merge is a gather list of the blob
+/// buffers, which are neither copied nor moved until they are encoded.
 class ChunkMerge {
 public:
 public:
@@ -24,16 +25,24 @@ public:
   auto operator=(const ChunkMerge &) -> ChunkMerge & = default;
   ChunkMerge(ChunkMerge &&) = default;
   auto operator=(ChunkMerge &&) -> ChunkMerge & = default;
-  ~ChunkMerge() { flush_buffer(); }
+  ~ChunkMerge() = default;
 
   ChunkMerge(std::size_t chunk_size) : chunk_size(chunk_size) {}
-  auto merge_stream(boost::span<char> in)
-      -> std::pair<std::size_t, std::optional<std::vector<char>>>;
-  auto flush_buffer() -> std::vector<char>;
+  /// append a blob to the merge
+  /// # Return
+  /// the offset of the blob in the merge, and the merge once it reaches the
+  /// chunk size
+  auto merge_stream(util::GatherList in)
+      -> std::pair<std::size_t, std::optional<util::GatherList>>;
+  auto flush_buffer() -> util::GatherList;
   [[nodiscard]] auto merge_size() const -> std::size_t;
+  /// the merge under way is emitted at the new size, by the next blob
+  auto set_merge_size(std::size_t merge_size) -> void;
+  /// the bytes merged and not emitted yet
+  [[nodiscard]] auto buffered_size() const -> std::size_t;
 
 private:
   std::size_t chunk_size = 4 * MB;
-  vector<char> buffer{};
+  util::GatherList buffer{};
 };
 } // namespace trace
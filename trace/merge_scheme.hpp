@@ -3,20 +3,31 @@
 #include "azure_trace.hh"
 #include "ec_intf.hh"
 #include "exception.hpp"
+#include "flat_hash_map.hpp"
+#include "gather_list.hpp"
 #include "merge.hh"
 #include "meta.hpp"
+#include "payload.hh"
+#include "shared_vec.hpp"
+#include "size_controller.hh"
 #include "size_lru_cache.hpp"
+#include "stream_encoder.hh"
 
 #include <boost/numeric/conversion/cast.hpp>
 #include <glog/logging.h>
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <queue>
-#include <random>
 #include <stdexcept>
 #include <utility>
 #include <vector>
@@ -28,6 +39,38 @@ inline static auto minimal_merge_size(meta::EcType ec_type, meta::ec_param_t k,
   return k * MIN_CHUNK_SIZE;
 }
 
+/// zero bytes that pad `size` to a multiple of `atomic_size`
+inline auto padding(std::size_t size, std::size_t atomic_size)
+    -> std::size_t {
+  return (size + atomic_size - 1) / atomic_size * atomic_size - size;
+}
+
+/// rearrange merged blobs for the vertical layout: the i-th of the `k` equal
+/// parts of every blob, for i in [0, k), by reference to the merged bytes
+/// # Throw
+/// `std::out_of_range` if a blob is out of the merge
+inline auto split_vertical(const util::GatherList &raw_data,
+                           const std::vector<meta::BlobMeta> &blobs,
+                           std::size_t k) -> util::GatherList {
+  auto parts = std::vector<util::GatherList>{};
+  parts.reserve(blobs.size());
+  for (const auto &j : blobs) {
+    auto size = j.size / k * k;
+    if (j.offset > raw_data.size() || size > raw_data.size() - j.offset) {
+      throw std::out_of_range("blob offset out of range");
+    }
+    parts.push_back(raw_data.slice(j.offset, size));
+  }
+  auto rearrange = util::GatherList{};
+  for (std::size_t i = 0; i < k; ++i) {
+    for (std::size_t b = 0; b < blobs.size(); b++) {
+      auto size = blobs[b].size / k;
+      rearrange.append(parts[b].slice(i * size, size));
+    }
+  }
+  return rearrange;
+}
+
 namespace blob_stream {
 struct MergeStreamInterface {
   inline static constexpr std::size_t EXTRA_SMALL_SIZE{32};
@@ -38,9 +81,16 @@ struct MergeStreamInterface {
   MergeStreamInterface(MergeStreamInterface &&) = default;
   auto operator=(MergeStreamInterface &&) -> MergeStreamInterface & = default;
   virtual ~MergeStreamInterface() = default;
-  virtual auto
-  next_merge() -> std::pair<std::vector<meta::BlobMeta>, std::vector<char>> = 0;
+  /// the blobs of a merge, and its bytes by reference to the blob buffers
+  using merge_t = std::pair<std::vector<meta::BlobMeta>, util::GatherList>;
+  virtual auto next_merge() -> merge_t = 0;
   virtual auto merge_size() const -> std::size_t = 0;
+  /// change the merge size from the next merge on
+  /// # Return
+  /// false if the stream merges to a fixed size and is not changed
+  virtual auto set_merge_size(std::size_t /*merge_size*/) -> bool {
+    return false;
+  }
 };
 
 using MergeStreamInterfacePtr = std::unique_ptr<MergeStreamInterface>;
@@ -60,12 +110,7 @@ public:
     return merge_size_;
   }
 
-  auto next_merge()
-      -> std::pair<std::vector<meta::BlobMeta>, std::vector<char>> override {
-    thread_local std::random_device rd{};
-    thread_local std::mt19937 gen(rd());
-    thread_local std::uniform_int_distribution<char> dis{};
-    auto rand_gen = [&]() { return static_cast<char>(dis(gen)); };
+  auto next_merge() -> merge_t override {
     while (true) {
       auto trace = trace_reader_->next_trace();
       if (trace.size < EXTRA_SMALL_SIZE) {
@@ -76,7 +121,7 @@ public:
       if (trace.size > merge_size()) {
         // this blob is too large to merge, emit directly
         trace.size = merge_size();
-        auto data = make_rand_data(trace);
+        auto data = util::GatherList{make_rand_data(trace)};
         return std::make_pair(
             std::vector<meta::BlobMeta>{meta::BlobMeta{.blob_id = trace.blob_id,
                                                        .stripe_id = 0,
@@ -90,21 +135,22 @@ public:
         auto offset = buf_.size();
         auto blob_index =
             boost::numeric_cast<meta::blob_index_t>(blobs_.size());
-        std::generate_n(std::back_inserter(buf_), trace.size, rand_gen);
+        append_payload(trace.blob_id, trace.size, buf_);
         blobs_.push_back(meta::BlobMeta{.blob_id = trace.blob_id,
                                         .stripe_id = 0,
                                         .blob_index = blob_index,
                                         .size = trace.size,
                                         .offset = offset});
-        auto buf = std::move(buf_);
+        auto buf = util::GatherList{std::move(buf_)};
+        buf_ = {};
         buf_.reserve(merge_size());
-        return std::make_pair(std::move(blobs_), buf);
+        return std::make_pair(std::move(blobs_), std::move(buf));
       } else {
         // merge the blob to the buffer
         auto off = buf_.size();
         auto blob_index =
             boost::numeric_cast<meta::blob_index_t>(blobs_.size());
-        std::generate_n(std::back_inserter(buf_), trace.size, rand_gen);
+        append_payload(trace.blob_id, trace.size, buf_);
         blobs_.push_back(meta::BlobMeta{.blob_id = trace.blob_id,
                                         .stripe_id = 0,
                                         .blob_index = 0,
@@ -128,8 +174,7 @@ public:
   /// emit on each merge, so merge size is 0
   [[nodiscard]] auto merge_size() const -> std::size_t override { return 0; }
 
-  auto next_merge()
-      -> std::pair<std::vector<meta::BlobMeta>, std::vector<char>> override {
+  auto next_merge() -> merge_t override {
     while (true) {
       auto trace = azure_trace_->next_trace();
       if (trace.size < EXTRA_SMALL_SIZE) {
@@ -143,7 +188,7 @@ public:
                                                      .blob_index = 0,
                                                      .size = trace.size,
                                                      .offset = 0}},
-          make_rand_data(trace));
+          util::GatherList{make_rand_data(trace)});
     }
   }
 };
@@ -170,9 +215,12 @@ public:
   [[nodiscard]] auto merge_size() const -> std::size_t override {
     return chunk_merge_.merge_size();
   }
+  auto set_merge_size(std::size_t merge_size) -> bool override {
+    chunk_merge_.set_merge_size(merge_size);
+    return true;
+  }
 
-  auto next_merge()
-      -> std::pair<std::vector<meta::BlobMeta>, std::vector<char>> override {
+  auto next_merge() -> merge_t override {
     try {
       // iterate the trace until exhaust
       while (true) {
@@ -182,7 +230,7 @@ public:
           continue;
         }
         // this is a new blob, merge
-        auto data = make_rand_data(trace);
+        auto data = util::GatherList{make_rand_data(trace)};
         if (trace.size > merge_size()) {
           // this blob is too large to merge, emit directly
           return std::make_pair(std::vector<meta::BlobMeta>{meta::BlobMeta{
@@ -193,7 +241,7 @@ public:
                                     .offset = 0}},
                                 std::move(data));
         }
-        auto [off, merged] = chunk_merge_.merge_stream(data);
+        auto [off, merged] = chunk_merge_.merge_stream(std::move(data));
         auto blob_index =
             boost::numeric_cast<meta::blob_index_t>(blobs_.size());
         blobs_.push_back(meta::BlobMeta{.blob_id = trace.blob_id,
@@ -221,18 +269,79 @@ public:
   }
 };
 
+/// the limits of the per-user merge buffers of `InterLocalityMergeStream`,
+/// `0` for no limit
+struct MergeBufferLimits {
+  /// bytes in all the buffers
+  std::size_t budget{0};
+  /// how long a buffer waits for more blobs after its first one, in the
+  /// unit of the trace time stamps
+  std::uint64_t max_age{0};
+};
+
+/// the per-user merge buffers of `InterLocalityMergeStream`, and how full
+/// the merges it emits are
+struct MergeBufferStats {
+  inline static constexpr std::size_t FILL_BUCKETS{10};
+  /// bytes in the buffers
+  std::size_t resident_bytes{0};
+  std::size_t peak_resident_bytes{0};
+  /// buffers emitted because they are full, over the budget or too old
+  std::size_t full_flushes{0};
+  std::size_t budget_flushes{0};
+  std::size_t age_flushes{0};
+  /// buffers flushed early whose blobs went to split-before-merge
+  std::size_t handed_over{0};
+  /// merges by the bytes of their blobs over the merge size, in tenths, the
+  /// last bucket also counts the overfull ones, large blobs are excluded
+  std::array<std::size_t, FILL_BUCKETS> fill_histogram{};
+};
+
 // emit the merged blobs when the merge buffer is full
 // # Note
 // - the blobs are not necessarily emitted in the order of arrival
 // - if a blob is larger than the merge buffer size,
 //   it will be not merged and emitted immediately
 // - if the merge buffer of any id is full, it will be emitted immediately
+// - over the byte budget the fullest buffers are flushed, and a buffer is
+//   flushed once older than the max age; a flushed buffer at least half
+//   full is emitted as is, the blobs of an emptier one are merged again
+//   with split-before-merge
 class InterLocalityMergeStream : virtual public MergeStreamInterface {
 private:
+  enum class Flush : std::uint8_t { Budget, Age, Exhaust };
+
+  struct UserBuffer {
+    std::vector<meta::BlobMeta> blobs{};
+    trace::ChunkMerge chunk_merge;
+    /// time stamp of the first blob
+    std::uint64_t created_at;
+    /// tells the buffer from the earlier ones of the same user
+    std::uint64_t generation;
+
+    UserBuffer(std::size_t merge_size, std::uint64_t created_at,
+               std::uint64_t generation)
+        : chunk_merge(merge_size), created_at(created_at),
+          generation(generation) {}
+  };
+
+  struct Created {
+    std::uint64_t created_at;
+    std::uint64_t user_id;
+    std::uint64_t generation;
+  };
+
   std::size_t merge_size_{};
-  std::map<std::uint64_t,
-           std::pair<std::vector<meta::BlobMeta>, trace::ChunkMerge>>
-      merge_map_{};
+  MergeBufferLimits limits_{};
+  /// the merge buffers of the users with locality, a buffer is dropped once
+  /// it is emitted
+  flat_hash::FlatHashMap<std::uint64_t, UserBuffer> merge_map_{};
+  /// the buffers by age, the oldest first, with a max age only; the entries
+  /// of the buffers emitted meanwhile are skipped
+  std::deque<Created> created_{};
+  std::uint64_t next_generation_{0};
+  /// time stamp of the current trace
+  std::uint64_t now_{0};
   // size_lru_cache::lru_cache<std::uint64_t> blob_lru_cache_;
   size_lru_cache::lru_cache<std::uint64_t> blob_lru_cache_;
   // the split-before-merge chunk merge, for the blobs that has no locality
@@ -245,17 +354,214 @@ private:
   /// log the offset of each blob under merging
   // std::vector<meta::BlobMeta> blobs_{};
   TraceReaderPtr azure_trace_;
+  /// the merges to return, with their locality
+  std::deque<std::pair<merge_t, bool>> ready_{};
+  /// updated by `next_merge`, and published with every merge
+  MergeBufferStats stats_{};
+  mutable std::mutex published_mtx_{};
+  MergeBufferStats published_{};
 
   int hit_cnt = 0;
   int miss_cnt = 0;
   bool last_merge_has_locality_{false};
+  bool exhausted_{false};
+
+  auto emit(merge_t merge, bool locality) -> void {
+    const auto &[blobs, data] = merge;
+    if (blobs.size() != 1 || data.size() <= merge_size_) {
+      auto bytes = std::size_t{0};
+      for (const auto &blob : blobs) {
+        bytes += blob.size;
+      }
+      auto bucket = bytes * MergeBufferStats::FILL_BUCKETS / merge_size_;
+      stats_.fill_histogram.at(
+          std::min(bucket, MergeBufferStats::FILL_BUCKETS - 1))++;
+    }
+    ready_.emplace_back(std::move(merge), locality);
+    auto lock = std::unique_lock{published_mtx_};
+    published_ = stats_;
+  }
+
+  /// emit the split-before-merge buffer
+  auto flush_split_before() -> void {
+    auto rearrange = split_vertical(
+        s_b_m_chunk_merge_.flush_buffer(), s_b_m_blobs_, atomic_size_);
+    emit({std::exchange(s_b_m_blobs_, {}), std::move(rearrange)}, false);
+  }
+
+  auto merge_split_before(meta::blob_id_t blob_id, util::GatherList data)
+      -> void {
+    // do the padding for each blob
+    data.append_zeros(padding(data.size(), atomic_size_));
+    auto padded_size = data.size();
+    auto [off, merged] = s_b_m_chunk_merge_.merge_stream(std::move(data));
+    auto blob_index =
+        boost::numeric_cast<meta::blob_index_t>(s_b_m_blobs_.size());
+    s_b_m_blobs_.push_back(meta::BlobMeta{.blob_id = blob_id,
+                                          .stripe_id = 0,
+                                          .blob_index = blob_index,
+                                          .size = padded_size,
+                                          .offset = off});
+    if (merged.has_value()) {
+      // the merge buffer is full, emit the merged data
+      // rearrange the data for the split-before-merge
+      for (const auto &j : s_b_m_blobs_) {
+        if (j.size % atomic_size_ != 0) {
+          throw std::runtime_error("blob not divisible by k");
+        }
+      }
+      auto rearrange = split_vertical(
+          std::move(merged).value(), s_b_m_blobs_, atomic_size_);
+      emit({std::exchange(s_b_m_blobs_, {}), std::move(rearrange)}, false);
+    }
+  }
+
+  auto merge_locality(const BlobAccessTrace &trace, util::GatherList data)
+      -> void {
+    auto *buffer = merge_map_.find(trace.user_id);
+    if (buffer == nullptr) {
+      buffer = &merge_map_.try_emplace(
+          trace.user_id, merge_size_, now_, next_generation_);
+      if (limits_.max_age != 0) {
+        created_.push_back({.created_at = now_,
+                            .user_id = trace.user_id,
+                            .generation = next_generation_});
+      }
+      next_generation_++;
+    }
+    auto size = data.size();
+    auto [off, merged] = buffer->chunk_merge.merge_stream(std::move(data));
+    auto blob_index =
+        boost::numeric_cast<meta::blob_index_t>(buffer->blobs.size());
+    buffer->blobs.push_back(meta::BlobMeta{.blob_id = trace.blob_id,
+                                           .stripe_id = 0,
+                                           .blob_index = blob_index,
+                                           .size = trace.size,
+                                           .offset = off});
+    stats_.resident_bytes += size;
+    if (merged.has_value()) {
+      LOG(INFO) << "hit cnt ratio:" << hit_rate() << std::endl;
+      // the any of the merge buffers is full, emit the merged data
+      stats_.resident_bytes -= merged->size();
+      stats_.full_flushes++;
+      auto blobs = std::move(buffer->blobs);
+      merge_map_.erase(trace.user_id);
+      emit({std::move(blobs), std::move(merged).value()}, true);
+      return;
+    }
+    if (limits_.budget != 0 && stats_.resident_bytes > limits_.budget) {
+      // flush the fullest buffers down to 7/8 of the budget, so that one
+      // scan of the buffers serves many flushes
+      auto fullest = std::vector<std::pair<std::size_t, std::uint64_t>>{};
+      fullest.reserve(merge_map_.size());
+      for (const auto &[user_id, buffer] : merge_map_) {
+        fullest.emplace_back(buffer.chunk_merge.buffered_size(), user_id);
+      }
+      std::sort(fullest.begin(), fullest.end(), std::greater<>{});
+      for (auto [size, user_id] : fullest) {
+        if (stats_.resident_bytes <= limits_.budget - limits_.budget / 8) {
+          break;
+        }
+        flush(user_id, Flush::Budget);
+      }
+    }
+    stats_.peak_resident_bytes =
+        std::max(stats_.peak_resident_bytes, stats_.resident_bytes);
+  }
+
+  /// emit the buffer of `user_id` before it is full
+  /// # Note
+  /// a buffer less than half full is not worth a stripe with locality, its
+  /// blobs are merged again with split-before-merge
+  auto flush(std::uint64_t user_id, Flush reason) -> void {
+    auto *buffer = merge_map_.find(user_id);
+    auto blobs = std::move(buffer->blobs);
+    auto data = buffer->chunk_merge.flush_buffer();
+    merge_map_.erase(user_id);
+    stats_.resident_bytes -= data.size();
+    if (reason == Flush::Budget) {
+      stats_.budget_flushes++;
+    } else if (reason == Flush::Age) {
+      stats_.age_flushes++;
+    }
+    if (data.size() * 2 >= merge_size_) {
+      emit({std::move(blobs), std::move(data)}, true);
+      return;
+    }
+    stats_.handed_over++;
+    for (const auto &blob : blobs) {
+      merge_split_before(blob.blob_id, data.slice(blob.offset, blob.size));
+    }
+  }
+
+  /// flush the buffers older than the max age
+  /// # Note
+  /// the trace is in time order, so are the buffers
+  auto expire() -> void {
+    while (!created_.empty() &&
+           created_.front().created_at + limits_.max_age < now_) {
+      auto created = created_.front();
+      created_.pop_front();
+      const auto *buffer = merge_map_.find(created.user_id);
+      if (buffer != nullptr && buffer->generation == created.generation) {
+        flush(created.user_id, Flush::Age);
+      }
+    }
+  }
+
+  auto add(const BlobAccessTrace &trace) -> void {
+    now_ = trace.time_stamp;
+    expire();
+    auto contains = blob_lru_cache_.contains(trace.user_id);
+    if (trace.size <= blob_lru_cache_.capacity()) {
+
+      auto blob_size = trace.size;
+      if (blob_size <= merge_size_ && !contains) {
+        // padding for split-before-merge
+        blob_size =
+            (blob_size + atomic_size_ - 1) / atomic_size_ * atomic_size_;
+      }
+      blob_lru_cache_.insert(trace.user_id, blob_size);
+    }
+
+    if (trace.size < EXTRA_SMALL_SIZE) {
+      // the blob is too small, skip
+      return;
+    }
+    // this is a new blob, merge
+    auto data = util::GatherList{make_rand_data(trace)};
+    if (trace.size > merge_size()) {
+      // this blob is too large to merge, emit directly
+      emit({std::vector<meta::BlobMeta>{meta::BlobMeta{
+                .blob_id = trace.blob_id,
+                .stripe_id = 0,
+                .blob_index = 0,
+                .size = trace.size,
+                .offset = 0}},
+            std::move(data)},
+           false);
+      return;
+    }
+
+    // small blob
+    if (contains) {
+      // has locality, merge-before-split
+      hit_cnt++;
+      merge_locality(trace, std::move(data));
+    } else {
+      // has no locality, split-before-merge
+      miss_cnt++;
+      merge_split_before(trace.blob_id, std::move(data));
+    }
+  }
 
 public:
   InterLocalityMergeStream(TraceReaderPtr trace_reader, std::size_t merge_size,
-                           std::size_t lru_cache_size, std::size_t atomic_size)
+                           std::size_t lru_cache_size, std::size_t atomic_size,
+                           MergeBufferLimits limits = {})
       : azure_trace_(std::move(trace_reader)), merge_size_(merge_size),
-        s_b_m_chunk_merge_(merge_size), blob_lru_cache_(lru_cache_size),
-        atomic_size_(atomic_size) {}
+        limits_(limits), s_b_m_chunk_merge_(merge_size),
+        blob_lru_cache_(lru_cache_size), atomic_size_(atomic_size) {}
 
   [[nodiscard]] auto merge_size() const -> std::size_t override {
     return merge_size_;
@@ -263,130 +569,47 @@ public:
 
   auto last_merge_locality() const -> bool { return last_merge_has_locality_; }
 
-  auto next_merge()
-      -> std::pair<std::vector<meta::BlobMeta>, std::vector<char>> override {
-    try {
-      // iterate the trace until exhaust
-      while (true) {
-        auto trace = azure_trace_->next_trace();
-        auto contains = blob_lru_cache_.contains(trace.user_id);
-        if (trace.size <= blob_lru_cache_.capacity()) {
-
-          auto blob_size = trace.size;
-          if (blob_size <= merge_size_ && !contains) {
-            // padding for split-before-merge
-            blob_size =
-                (blob_size + atomic_size_ - 1) / atomic_size_ * atomic_size_;
-          }
-          blob_lru_cache_.insert(trace.user_id, blob_size);
-        }
-
-        if (trace.size < EXTRA_SMALL_SIZE) {
-          // the blob is too small, skip
+  auto next_merge() -> merge_t override {
+    // iterate the trace until a merge is ready
+    while (ready_.empty()) {
+      if (!exhausted_) {
+        try {
+          add(azure_trace_->next_trace());
           continue;
-        }
-        // this is a new blob, merge
-        auto data = make_rand_data(trace);
-        if (trace.size > merge_size()) {
-          // this blob is too large to merge, emit directly
-          return std::make_pair(std::vector<meta::BlobMeta>{meta::BlobMeta{
-                                    .blob_id = trace.blob_id,
-                                    .stripe_id = 0,
-                                    .blob_index = 0,
-                                    .size = trace.size,
-                                    .offset = 0}},
-                                std::move(data));
-        }
-
-        // small blob
-        if (contains) {
-          // has locality, merge-before-split
-          hit_cnt++;
-          if (merge_map_.find(trace.user_id) == merge_map_.end()) {
-            merge_map_.emplace(trace.user_id,
-                               std::make_pair(std::vector<meta::BlobMeta>(),
-                                              trace::ChunkMerge(merge_size_)));
-          }
-          auto &[blobs, chunk_merge] = merge_map_[trace.user_id];
-          auto [off, merged] = chunk_merge.merge_stream(data);
-          auto blob_index =
-              boost::numeric_cast<meta::blob_index_t>(blobs.size());
-          blobs.push_back(meta::BlobMeta{.blob_id = trace.blob_id,
-                                         .stripe_id = 0,
-                                         .blob_index = blob_index,
-                                         .size = trace.size,
-                                         .offset = off});
-          if (merged.has_value()) {
-            LOG(INFO) << "hit cnt ratio:" << hit_rate() << std::endl;
-            // the any of the merge buffers is full, emit the merged data
-            last_merge_has_locality_ = true;
-            return std::make_pair(std::move(blobs), std::move(merged).value());
-          }
-        } else {
-          // has no locality, split-before-merge
-          // do the padding for each blob
-          miss_cnt++;
-          data.resize((data.size() + atomic_size_ - 1) / atomic_size_ *
-                      atomic_size_);
-          auto [off, merged] = s_b_m_chunk_merge_.merge_stream(data);
-          auto blob_index =
-              boost::numeric_cast<meta::blob_index_t>(s_b_m_blobs_.size());
-          s_b_m_blobs_.push_back(meta::BlobMeta{.blob_id = trace.blob_id,
-                                                .stripe_id = 0,
-                                                .blob_index = blob_index,
-                                                .size = data.size(),
-                                                .offset = off});
-          if (merged.has_value()) {
-            // the merge buffer is full, emit the merged data
-            auto raw_data = std::move(merged).value();
-            // rearrange the data for the split-before-merge
-            auto rearrange = std::vector<char>{};
-            rearrange.reserve(raw_data.size());
-            auto k = atomic_size_;
-            for (meta::ec_param_t i = 0; i < k; ++i) {
-              for (const auto &j : s_b_m_blobs_) {
-                if (j.size % k != 0) {
-                  throw std::runtime_error("blob not divisible by k");
-                }
-                auto offset = j.offset + i * (j.size / k);
-                auto size = j.size / k;
-                if (offset > raw_data.size() ||
-                    offset + size > raw_data.size()) {
-                  throw std::out_of_range("blob offset out of range");
-                }
-                auto begin =
-                    raw_data.begin() +
-                    boost::numeric_cast<decltype(raw_data)::difference_type>(
-                        offset);
-                std::copy_n(begin, size, std::back_inserter(rearrange));
-              }
-            }
-            last_merge_has_locality_ = false;
-            return std::make_pair(std::move(s_b_m_blobs_),
-                                  std::move(rearrange));
+        } catch (const TraceException &e) {
+          if (e.error_enum() != trace_error_e::Exhaust) {
+            throw;
           }
+          exhausted_ = true;
         }
       }
-    } catch (const TraceException &e) {
-      if (e.error_enum() == trace_error_e::Exhaust) {
-        // handle the under-merging data
-        if (merge_map_.empty()) {
-          throw;
-        }
-        // flush each of the buffer in merge_map_ one by one
-        auto [blobs, chunk_merge] = merge_map_.begin()->second;
-        auto merge = chunk_merge.flush_buffer();
-        merge_map_.erase(merge_map_.begin());
-        return std::make_pair(std::move(blobs), std::move(merge));
+      // handle the under-merging data: flush each of the buffer in
+      // merge_map_ one by one, the latest first, then the split-before-merge
+      // buffer
+      if (!merge_map_.empty()) {
+        flush(std::prev(merge_map_.end())->first, Flush::Exhaust);
+      } else if (!s_b_m_blobs_.empty()) {
+        flush_split_before();
       } else {
-        throw;
+        throw TraceException(trace_error_e::Exhaust);
       }
     }
+    auto [merge, locality] = std::move(ready_.front());
+    ready_.pop_front();
+    last_merge_has_locality_ = locality;
+    return std::move(merge);
   }
 
   [[nodiscard]] auto hit_rate() const -> double {
     return static_cast<double>(hit_cnt) / (hit_cnt + miss_cnt);
   }
+
+  /// # Note
+  /// safe to call from another thread, as of the last merge emitted
+  [[nodiscard]] auto merge_buffer_stats() const -> MergeBufferStats {
+    auto lock = std::unique_lock{published_mtx_};
+    return published_;
+  }
 };
 
 class PaddingMergeStream : virtual public MergeStreamInterface {
@@ -408,8 +631,7 @@ public:
     return chunk_merge_.merge_size();
   }
 
-  auto next_merge()
-      -> std::pair<std::vector<meta::BlobMeta>, std::vector<char>> override {
+  auto next_merge() -> merge_t override {
     try {
       // iterate the trace until exhaust
       while (true) {
@@ -419,7 +641,7 @@ public:
           continue;
         }
         // this is a new blob, merge
-        auto data = make_rand_data(trace);
+        auto data = util::GatherList{make_rand_data(trace)};
 
         if (trace.size > merge_size()) {
           // this blob is too large to merge, emit directly
@@ -433,16 +655,16 @@ public:
         }
 
         // do the padding for each small blob
-        data.resize((data.size() + atomic_size_ - 1) / atomic_size_ *
-                    atomic_size_);
+        data.append_zeros(padding(data.size(), atomic_size_));
+        auto padded_size = data.size();
 
-        auto [off, merged] = chunk_merge_.merge_stream(data);
+        auto [off, merged] = chunk_merge_.merge_stream(std::move(data));
         auto blob_index =
             boost::numeric_cast<meta::blob_index_t>(blobs_.size());
         blobs_.push_back(meta::BlobMeta{.blob_id = trace.blob_id,
                                         .stripe_id = 0,
                                         .blob_index = blob_index,
-                                        .size = data.size(),
+                                        .size = padded_size,
                                         .offset = off});
         if (merged.has_value()) {
           // the merge buffer is full, emit the merged data
@@ -481,9 +703,12 @@ namespace stripe_stream {
 
 struct StripeStreamItem {
   std::vector<meta::BlobMeta> blobs;
-  std::vector<std::vector<char>> stripe;
+  /// pooled chunk buffers, pass them on by moving or copying the handles
+  std::vector<util::SharedVec> stripe;
   meta::EcType ec_type;
   meta::BlobLayout blob_layout;
+  /// the merge sizes the stripe is built with, epoch `0` if they are fixed
+  meta::StripeTuning tuning{};
 };
 
 struct StripeStreamInterface {
@@ -498,6 +723,19 @@ struct StripeStreamInterface {
 };
 
 namespace baseline {
+/// pad the merged data to a multiple of k and encode it to one stripe
+inline auto encode_merge(ec::encoder::Encoder &encoder,
+                         std::vector<meta::BlobMeta> blobs,
+                         util::GatherList raw_data) -> StripeStreamItem {
+  auto k = static_cast<std::size_t>(encoder.get_km().first);
+  raw_data.append_zeros((raw_data.size() + k) / k * k - raw_data.size());
+  auto stripe = encoder.encode(raw_data);
+  return StripeStreamItem{.blobs = std::move(blobs),
+                          .stripe = std::move(stripe),
+                          .ec_type = encoder.get_ec_type(),
+                          .blob_layout = meta::BlobLayout::Horizontal};
+}
+
 /// apply one erasure codes for all the stripes
 class StripeStream : virtual public StripeStreamInterface {
 private:
@@ -521,14 +759,7 @@ public:
   /// the next encoded stripe merged from the following chunks
   auto next_stripe() -> StripeStreamItem override {
     auto [blobs, raw_data] = merge_stream_->next_merge();
-    // padding the raw data
-    auto k = encoder_->get_km().first;
-    raw_data.resize((raw_data.size() + k) / k * k);
-    auto stripe = encoder_->encode(raw_data);
-    return StripeStreamItem{.blobs = std::move(blobs),
-                            .stripe = std::move(stripe),
-                            .ec_type = encoder_->get_ec_type(),
-                            .blob_layout = meta::BlobLayout::Horizontal};
+    return encode_merge(*encoder_, std::move(blobs), std::move(raw_data));
   }
 };
 
@@ -545,25 +776,25 @@ private:
   std::size_t blob_cnt_{};
   std::size_t partition_size_{};
   std::queue<StripeStreamItem> remaining_stripe_{};
+  /// chooses the partition size and the merge size per epoch, if set
+  adaptive::SizeControllerPtr size_controller_{};
+  meta::StripeTuning tuning_{};
 
-  /// parition the range [begin, end) recursively
+  /// parition the range [begin, data.size()) recursively
   /// # example
   /// a 10.6M blob with 2MB partition size
   /// will be partitioned to { 8MB + 2MB + 0.6MB }
-  auto partition(std::vector<char>::const_iterator &begin,
-                 const std::vector<char>::const_iterator &end,
+  auto partition(const util::GatherList &data, std::size_t &begin,
                  std::size_t partition_size) {
-    if (std::distance(begin, end) < partition_size) {
+    if (data.size() - begin < partition_size) {
       return;
     }
-    partition(begin, end, partition_size * 2);
-    if (std::distance(begin, end) < partition_size) {
+    partition(data, begin, partition_size * 2);
+    if (data.size() - begin < partition_size) {
       // the size left is smaller than the partition size
       return;
     }
-    auto advance =
-        boost::numeric_cast<std::vector<char>::difference_type>(partition_size);
-    auto raw_data = std::vector<char>{begin, begin + advance};
+    auto raw_data = data.slice(begin, partition_size);
     auto stripe = large_blob_encoder_->encode(raw_data);
     remaining_stripe_.push(
         StripeStreamItem{.blobs = {meta::BlobMeta{.blob_id = blob_cnt_++,
@@ -573,11 +804,62 @@ private:
                                                   .offset = 0}},
                          .stripe = std::move(stripe),
                          .ec_type = large_blob_encoder_->get_ec_type(),
-                         .blob_layout = meta::BlobLayout::Horizontal});
-    begin += advance;
+                         .blob_layout = meta::BlobLayout::Horizontal,
+                         .tuning = tuning_});
+    begin += partition_size;
     return;
   }
 
+  /// take the sizes of the current epoch of the controller
+  auto apply_tuning() -> void {
+    tuning_ = size_controller_->tuning();
+    partition_size_ = tuning_.partition_size;
+    if (!merge_stream_->set_merge_size(tuning_.merge_size)) {
+      tuning_.merge_size = merge_stream_->merge_size();
+    }
+  }
+
+  auto encode_merge(std::vector<meta::BlobMeta> blobs,
+                    util::GatherList raw_data) -> StripeStreamItem {
+    if (raw_data.size() >= partition_size_) {
+      // large blob, do partition
+      auto k = static_cast<std::size_t>(large_blob_encoder_->get_km().first);
+      raw_data.append_zeros((raw_data.size() + k) / k * k - raw_data.size());
+      // partition the large data
+      auto cur_off = std::size_t{0};
+      partition(raw_data, cur_off, partition_size_);
+      if (cur_off < raw_data.size()) {
+        auto small_partition =
+            raw_data.slice(cur_off, raw_data.size() - cur_off);
+        auto stripe = small_blob_encoder_->encode(small_partition);
+        remaining_stripe_.push(StripeStreamItem{
+            .blobs = {meta::BlobMeta{.blob_id = blob_cnt_++,
+                                     .stripe_id = 0,
+                                     .blob_index = 0,
+                                     .size = small_partition.size(),
+                                     .offset = 0}},
+            .stripe = std::move(stripe),
+            .ec_type = small_blob_encoder_->get_ec_type(),
+            .blob_layout = meta::BlobLayout::Horizontal,
+            .tuning = tuning_});
+      }
+
+      auto item = std::move(remaining_stripe_.front());
+      remaining_stripe_.pop();
+      return item;
+    } else {
+      // small blob
+      auto k = static_cast<std::size_t>(small_blob_encoder_->get_km().first);
+      raw_data.append_zeros((raw_data.size() + k) / k * k - raw_data.size());
+      auto stripe = small_blob_encoder_->encode(raw_data);
+      return StripeStreamItem{.blobs = std::move(blobs),
+                              .stripe = std::move(stripe),
+                              .ec_type = small_blob_encoder_->get_ec_type(),
+                              .blob_layout = meta::BlobLayout::Horizontal,
+                              .tuning = tuning_};
+    }
+  }
+
 public:
   StripeStream(std::size_t partition_size) : partition_size_(partition_size) {};
 
@@ -595,6 +877,22 @@ public:
       -> void {
     small_blob_encoder_ = std::move(encoder);
   }
+
+  /// choose the partition size and the merge size per epoch of blobs, and
+  /// record them in the stripes, see `adaptive::SizeController`
+  /// # Note
+  /// set it after the merge stream, the merge size of a stream that merges
+  /// to a fixed size is kept
+  auto set_size_controller(adaptive::SizeControllerPtr controller) -> void {
+    size_controller_ = std::move(controller);
+    apply_tuning();
+  }
+
+  [[nodiscard]] auto size_controller() const
+      -> const adaptive::SizeController * {
+    return size_controller_.get();
+  }
+
   /// merge the following chunks
   /// # Return
   /// the next encoded stripe merged from the following chunks
@@ -605,40 +903,18 @@ public:
       return item;
     }
     auto [blobs, raw_data] = merge_stream_->next_merge();
-    if (raw_data.size() >= partition_size_) {
-      // large blob, do partition
-      auto k = large_blob_encoder_->get_km().first;
-      raw_data.resize((raw_data.size() + k) / k * k);
-      // partition the large data
-      auto cur_off = raw_data.cbegin();
-      partition(cur_off, raw_data.cend(), partition_size_);
-      if (std::distance(cur_off, raw_data.cend()) > 0) {
-        auto small_partition = std::vector<char>{cur_off, raw_data.cend()};
-        auto stripe = small_blob_encoder_->encode(small_partition);
-        remaining_stripe_.push(StripeStreamItem{
-            .blobs = {meta::BlobMeta{.blob_id = blob_cnt_++,
-                                     .stripe_id = 0,
-                                     .blob_index = 0,
-                                     .size = small_partition.size(),
-                                     .offset = 0}},
-            .stripe = std::move(stripe),
-            .ec_type = small_blob_encoder_->get_ec_type(),
-            .blob_layout = meta::BlobLayout::Horizontal});
+    auto epoch_ended = false;
+    if (size_controller_ != nullptr) {
+      for (const auto &blob : blobs) {
+        epoch_ended = size_controller_->observe(blob.size) || epoch_ended;
       }
-
-      auto item = std::move(remaining_stripe_.front());
-      remaining_stripe_.pop();
-      return item;
-    } else {
-      // small blob
-      auto k = small_blob_encoder_->get_km().first;
-      raw_data.resize((raw_data.size() + k) / k * k);
-      auto stripe = small_blob_encoder_->encode(raw_data);
-      return StripeStreamItem{.blobs = std::move(blobs),
-                              .stripe = std::move(stripe),
-                              .ec_type = small_blob_encoder_->get_ec_type(),
-                              .blob_layout = meta::BlobLayout::Horizontal};
     }
+    auto item = encode_merge(std::move(blobs), std::move(raw_data));
+    // the merge is of the epoch before, the next one takes the new sizes
+    if (epoch_ended) {
+      apply_tuning();
+    }
+    return item;
   }
 };
 } // namespace partition
@@ -684,25 +960,8 @@ public:
               .ec_type = large_blob_encoder_->get_ec_type()};
     } else {
       // merged small blobs
-      auto rearrange = std::vector<char>{};
-      rearrange.reserve(raw_data.size());
-      auto k = small_blob_encoder_->get_km().first;
-      for (meta::ec_param_t i = 0; i < k; ++i) {
-        for (const auto &j : blobs) {
-          // if (j.size % k != 0) {
-          //   throw std::runtime_error("blob not divisible by k");
-          // }
-          auto offset = j.offset + i * (j.size / k);
-          auto size = j.size / k;
-          if (offset > raw_data.size() || offset + size > raw_data.size()) {
-            throw std::out_of_range("blob offset out of range");
-          }
-          auto begin =
-              raw_data.begin() +
-              boost::numeric_cast<decltype(raw_data)::difference_type>(offset);
-          std::copy_n(begin, size, std::back_inserter(rearrange));
-        }
-      }
+      auto k = static_cast<std::size_t>(small_blob_encoder_->get_km().first);
+      auto rearrange = split_vertical(raw_data, blobs, k);
       auto stripe = small_blob_encoder_->encode(rearrange);
       return {.blobs = std::move(blobs),
               .stripe = std::move(stripe),
@@ -767,9 +1026,10 @@ public:
   InterLocality(TraceReaderPtr trace_reader, std::size_t merge_size,
                 std::unique_ptr<ec::encoder::Encoder> large_blob_encoder,
                 std::unique_ptr<ec::encoder::Encoder> small_blob_encoder,
-                std::size_t lru_cache_size)
+                std::size_t lru_cache_size,
+                blob_stream::MergeBufferLimits limits = {})
       : merge_stream_(std::move(trace_reader), merge_size, lru_cache_size,
-                      small_blob_encoder->get_km().first),
+                      small_blob_encoder->get_km().first, limits),
         large_blob_encoder_(std::move(large_blob_encoder)),
         small_blob_encoder_(std::move(small_blob_encoder)) {}
 
@@ -808,6 +1068,111 @@ public:
   }
 
   auto hit_rate() const -> double { return merge_stream_.hit_rate(); }
+  [[nodiscard]] auto merge_buffer_stats() const
+      -> blob_stream::MergeBufferStats {
+    return merge_stream_.merge_buffer_stats();
+  }
+};
+
+/// merge the small blobs straight into an incrementally encoded stripe,
+/// apply the large blob encoder for the large blob
+/// # Note
+/// - unlike the merge streams, a stripe never overflows `merge_size`: when the
+///   next blob does not fit, the stripe is sealed with a zero-padded tail and
+///   the blob starts the next stripe
+/// - with vertical layout each small blob is padded to a multiple of k, as in
+///   `SplitBeforeMerge`
+class Streaming : virtual public StripeStreamInterface {
+private:
+  TraceReaderPtr trace_reader_;
+  std::size_t merge_size_;
+  ec::encoder_ptr large_blob_encoder_{};
+  ec::encoder::StreamEncoder stripe_encoder_;
+  /// blobs of the stripe under encoding
+  std::vector<meta::BlobMeta> blobs_{};
+  /// the stripe sealed by a blob that does not fit
+  std::optional<StripeStreamItem> sealed_{};
+
+  auto seal() -> StripeStreamItem {
+    return {.blobs = std::move(blobs_),
+            .stripe = stripe_encoder_.finish(),
+            .ec_type = stripe_encoder_.get_ec_type(),
+            .blob_layout = stripe_encoder_.get_blob_layout()};
+  }
+
+public:
+  Streaming(TraceReaderPtr trace_reader, std::size_t merge_size,
+            std::unique_ptr<ec::encoder::Encoder> large_blob_encoder,
+            const std::unique_ptr<ec::encoder::Encoder> &small_blob_encoder,
+            meta::BlobLayout blob_layout)
+      : trace_reader_(std::move(trace_reader)), merge_size_(merge_size),
+        large_blob_encoder_(std::move(large_blob_encoder)),
+        stripe_encoder_(
+            small_blob_encoder->get_ec_type(),
+            small_blob_encoder->get_km().first,
+            small_blob_encoder->get_km().second,
+            (merge_size + small_blob_encoder->get_km().first - 1) /
+                small_blob_encoder->get_km().first,
+            blob_layout) {}
+
+  auto next_stripe() -> StripeStreamItem override {
+    if (sealed_.has_value()) {
+      auto item = std::move(sealed_).value();
+      sealed_.reset();
+      return item;
+    }
+    try {
+      while (true) {
+        auto trace = trace_reader_->next_trace();
+        if (trace.size < blob_stream::MergeStreamInterface::EXTRA_SMALL_SIZE) {
+          // the blob is too small, skip
+          continue;
+        }
+        auto data = make_rand_data(trace);
+        if (trace.size > merge_size_) {
+          // large blob, encode directly
+          auto stripe = large_blob_encoder_->encode(data);
+          return {.blobs = {meta::BlobMeta{.blob_id = trace.blob_id,
+                                           .stripe_id = 0,
+                                           .blob_index = 0,
+                                           .size = trace.size,
+                                           .offset = 0}},
+                  .stripe = std::move(stripe),
+                  .ec_type = large_blob_encoder_->get_ec_type(),
+                  .blob_layout = meta::BlobLayout::Horizontal};
+        }
+        if (stripe_encoder_.get_blob_layout() == meta::BlobLayout::Vertical) {
+          auto k = stripe_encoder_.get_km().first;
+          data.resize((data.size() + k - 1) / k * k);
+        }
+        if (!stripe_encoder_.fits(data.size())) {
+          sealed_ = seal();
+        }
+        auto off = stripe_encoder_.append(data);
+        auto blob_index =
+            boost::numeric_cast<meta::blob_index_t>(blobs_.size());
+        blobs_.push_back(meta::BlobMeta{.blob_id = trace.blob_id,
+                                        .stripe_id = 0,
+                                        .blob_index = blob_index,
+                                        .size = data.size(),
+                                        .offset = off});
+        if (sealed_.has_value()) {
+          auto item = std::move(sealed_).value();
+          sealed_.reset();
+          return item;
+        }
+        if (stripe_encoder_.size() == stripe_encoder_.capacity()) {
+          return seal();
+        }
+      }
+    } catch (const TraceException &e) {
+      if (e.error_enum() == trace_error_e::Exhaust && !blobs_.empty()) {
+        // handle the under-encoding stripe
+        return seal();
+      }
+      throw;
+    }
+  }
 };
 
 } // namespace hybrid
@@ -832,14 +1197,7 @@ public:
     }
   }
   auto next_stripe() -> StripeStreamItem override {
-    auto raw_data = std::vector<char>{};
-    constexpr std::size_t RAND_SEED{0x9b648};
-    raw_data.reserve(block_size_);
-    std::generate_n(std::back_inserter(raw_data), block_size_, [] {
-      thread_local auto gen = std::mt19937(RAND_SEED);
-      thread_local auto dist = std::uniform_int_distribution<char>{};
-      return dist(gen);
-    });
+    auto raw_data = make_payload(cur_blob_id_, block_size_);
     auto stripe = encoder_->encode(raw_data);
     auto blobs =
         std::vector<meta::BlobMeta>{meta::BlobMeta{.blob_id = cur_blob_id_++,
@@ -854,9 +1212,8 @@ public:
   }
 };
 
-/// all the blobs are the same size,
-/// all the chunks are the same size,
-/// and a stripe has several blobs
+/// all the chunks are the same size, and a stripe has several blobs: all of
+/// the same size, or of the sizes of the records of a trace
 /// # Note
 /// currently only support NSYS
 class InterLocality : virtual public StripeStreamInterface {
@@ -865,6 +1222,78 @@ private:
   std::size_t blob_size_{};
   meta::blob_id_t cur_blob_id_{};
   ec::encoder_ptr encoder_{};
+  /// the blob sizes, if not the fixed `blob_size_`
+  TraceReaderPtr size_trace_{};
+  /// the record of the blob that did not fit in the last stripe
+  std::optional<BlobAccessTrace> carried_{};
+  /// the blobs of the records built so far, by id, to their sizes, a record
+  /// that reads a built blob adds no blob
+  flat_hash::FlatHashMap<meta::blob_id_t, std::size_t> built_{};
+
+  auto fixed_size_blobs(std::vector<char> &raw_data)
+      -> std::vector<meta::BlobMeta> {
+    auto num_of_blobs = block_size_ / blob_size_;
+    for (std::size_t i = 0; i < num_of_blobs; i++) {
+      append_payload(cur_blob_id_ + i, blob_size_, raw_data);
+    }
+    auto blobs = std::vector<meta::BlobMeta>{};
+    blobs.reserve(num_of_blobs);
+    for (std::size_t i = 0; i < num_of_blobs; i++) {
+      blobs.emplace_back(meta::BlobMeta{
+          .blob_id = cur_blob_id_++,
+          .stripe_id = 0,
+          .blob_index = boost::numeric_cast<meta::blob_index_t>(i),
+          .size = blob_size_,
+          .offset = i * blob_size_});
+    }
+    return blobs;
+  }
+
+  /// the blobs of the next records that fit in a block, each aligned to k so
+  /// a blob starts at a sub-chunk boundary, and the rest of the block is
+  /// zero
+  /// # Note
+  /// a blob keeps the id of its record, so a replay of the same trace reads
+  /// the blob each record names
+  auto traced_size_blobs(std::vector<char> &raw_data)
+      -> std::vector<meta::BlobMeta> {
+    auto k = static_cast<std::size_t>(encoder_->get_km().first);
+    auto blobs = std::vector<meta::BlobMeta>{};
+    while (true) {
+      if (!carried_.has_value()) {
+        try {
+          carried_ = size_trace_->next_trace();
+        } catch (const TraceException &e) {
+          if (e.error_enum() == trace_error_e::Exhaust && !blobs.empty()) {
+            break;
+          }
+          throw;
+        }
+        if (built_.contains(carried_->blob_id)) {
+          carried_.reset();
+          continue;
+        }
+      }
+      const auto &record = carried_.value();
+      auto size = std::min(record.size, block_size_);
+      auto aligned = (size + k - 1) / k * k;
+      if (raw_data.size() + aligned > block_size_) {
+        break;
+      }
+      blobs.emplace_back(meta::BlobMeta{
+          .blob_id = record.blob_id,
+          .stripe_id = 0,
+          .blob_index = boost::numeric_cast<meta::blob_index_t>(blobs.size()),
+          .size = size,
+          .offset = raw_data.size()});
+      append_payload(record.blob_id, size, raw_data);
+      built_.try_emplace(record.blob_id, size);
+      raw_data.resize(raw_data.size() + aligned - size);
+      carried_.reset();
+    }
+    raw_data.resize(block_size_);
+    return blobs;
+  }
 
 public:
   InterLocality(ec::encoder_ptr encoder, std::size_t block_size,
@@ -879,27 +1308,26 @@ public:
     }
   }
 
+  /// the blob sizes are those of the records of `size_trace`, e.g. a
+  /// synthetic trace, a blob larger than a block is cut to the block
+  InterLocality(ec::encoder_ptr encoder, std::size_t block_size,
+                TraceReaderPtr size_trace)
+      : block_size_(block_size), encoder_(std::move(encoder)),
+        size_trace_(std::move(size_trace)) {
+    if (encoder_->get_ec_type() != meta::EcType::NSYS) {
+      err::Unimplemented("interlocality for degrade read only suppurt nsys");
+    }
+    if (block_size % encoder_->get_km().first != 0) {
+      throw std::runtime_error("block size not divisible by k");
+    }
+  }
+
   auto next_stripe() -> StripeStreamItem override {
     auto raw_data = std::vector<char>{};
-    constexpr std::size_t RAND_SEED{0x9b648};
     raw_data.reserve(block_size_);
-    std::generate_n(std::back_inserter(raw_data), block_size_, [] {
-      thread_local auto gen = std::mt19937(RAND_SEED);
-      thread_local auto dist = std::uniform_int_distribution<char>{};
-      return dist(gen);
-    });
+    auto blobs = size_trace_ == nullptr ? fixed_size_blobs(raw_data)
+                                        : traced_size_blobs(raw_data);
     auto stripe = encoder_->encode(raw_data);
-    auto blobs = std::vector<meta::BlobMeta>{};
-    auto num_of_blobs = block_size_ / blob_size_;
-    blobs.reserve(num_of_blobs);
-    for (std::size_t i = 0; i < num_of_blobs; i++) {
-      blobs.emplace_back(meta::BlobMeta{
-          .blob_id = cur_blob_id_++,
-          .stripe_id = 0,
-          .blob_index = boost::numeric_cast<meta::blob_index_t>(i),
-          .size = blob_size_,
-          .offset = i * blob_size_});
-    }
     return {.blobs = std::move(blobs),
             .stripe = std::move(stripe),
             .ec_type = encoder_->get_ec_type(),
@@ -0,0 +1,98 @@
+#include "payload.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::uint64_t GOLDEN{0x9e3779b97f4a7c15};
+constexpr std::size_t WORD{sizeof(std::uint64_t)};
+constexpr std::size_t BLOCK{256};
+
+auto mix(std::uint64_t z) -> std::uint64_t {
+  z = (z ^ (z >> 30U)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27U)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31U);
+}
+
+auto random_bytes_of(double entropy) -> std::size_t {
+  return static_cast<std::size_t>(entropy * BLOCK) / WORD * WORD;
+}
+
+trace::PayloadConfig config{trace::DEFAULT_PAYLOAD};
+/// random bytes at the start of each block
+std::size_t random_bytes{random_bytes_of(trace::DEFAULT_PAYLOAD.entropy)};
+
+/// the word at `index` of the payload keyed by `key`
+auto word_at(std::uint64_t key, std::uint64_t index) -> std::uint64_t {
+  if (index * WORD % BLOCK >= random_bytes) {
+    return 0;
+  }
+  return mix(key + index * GOLDEN);
+}
+
+} // namespace
+
+void trace::set_payload_config(PayloadConfig payload) {
+  if (!(payload.entropy >= 0 && payload.entropy <= 1)) {
+    throw std::invalid_argument("payload entropy not in [0, 1]");
+  }
+  config = payload;
+  random_bytes = random_bytes_of(payload.entropy);
+}
+
+auto trace::payload_config() -> PayloadConfig { return config; }
+
+void trace::fill_payload(meta::blob_id_t blob_id, std::span<char> out,
+                         std::size_t offset) {
+  auto key = mix(config.seed ^ mix(blob_id));
+  auto *dst = out.data();
+  auto remain = out.size();
+  auto index = std::uint64_t{offset / WORD};
+
+  // the head, up to the next word boundary
+  if (auto skip = offset % WORD; skip != 0 && remain > 0) {
+    auto word = word_at(key, index++);
+    auto len = std::min(WORD - skip, remain);
+    std::memcpy(dst, reinterpret_cast<char *>(&word) + skip, len); // NOLINT
+    dst += len; // NOLINT
+    remain -= len;
+  }
+
+  auto words = remain / WORD;
+  if (random_bytes == BLOCK) {
+    for (std::size_t i = 0; i < words; i++) {
+      auto word = mix(key + (index + i) * GOLDEN);
+      std::memcpy(dst + i * WORD, &word, WORD); // NOLINT
+    }
+  } else {
+    for (std::size_t i = 0; i < words; i++) {
+      auto word = word_at(key, index + i);
+      std::memcpy(dst + i * WORD, &word, WORD); // NOLINT
+    }
+  }
+  index += words;
+  dst += words * WORD; // NOLINT
+  remain -= words * WORD;
+
+  // the tail, a partial word
+  if (remain > 0) {
+    auto word = word_at(key, index);
+    std::memcpy(dst, &word, remain);
+  }
+}
+
+auto trace::make_payload(meta::blob_id_t blob_id, std::size_t size)
+    -> std::vector<char> {
+  auto data = std::vector<char>{};
+  append_payload(blob_id, size, data);
+  return data;
+}
+
+void trace::append_payload(meta::blob_id_t blob_id, std::size_t size,
+                           std::vector<char> &buf) {
+  auto offset = buf.size();
+  buf.resize(offset + size);
+  fill_payload(blob_id, std::span{buf}.subspan(offset));
+}
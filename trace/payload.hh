@@ -0,0 +1,51 @@
+#pragma once
+
+#include "meta.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/// Synthesized blob payloads, a pure function of the blob id and the byte
+/// offset, so a blob, or any slice of it, can be regenerated to verify a read.
+///
+/// Each 8-byte word is the SplitMix64 output of its position in the blob,
+/// there is no state carried from word to word, and a buffer is filled with
+/// independent multiplications that the compiler unrolls and vectorizes.
+///
+/// The entropy is the fraction of random bytes in each 256-byte block, the
+/// rest of the block is zero. An entropy of 1 gives incompressible data, an
+/// entropy of 0.5 data that compresses to about half.
+namespace trace {
+
+struct PayloadConfig {
+  /// in [0, 1], rounded down to whole words of each block
+  double entropy;
+  /// the payloads of two seeds are unrelated
+  std::uint64_t seed;
+};
+
+inline constexpr PayloadConfig DEFAULT_PAYLOAD{.entropy = 1.0,
+                                               .seed = 0x9b648};
+
+/// # Note
+/// not thread safe, set it before any payload is generated
+/// # Throw
+/// `std::invalid_argument` if the entropy is not in [0, 1]
+void set_payload_config(PayloadConfig config);
+[[nodiscard]] auto payload_config() -> PayloadConfig;
+
+/// fill `out` with the payload bytes of `blob_id` starting at `offset`
+void fill_payload(meta::blob_id_t blob_id, std::span<char> out,
+                  std::size_t offset = 0);
+
+/// the first `size` payload bytes of `blob_id`
+auto make_payload(meta::blob_id_t blob_id, std::size_t size)
+    -> std::vector<char>;
+
+/// append the first `size` payload bytes of `blob_id` to `buf`
+void append_payload(meta::blob_id_t blob_id, std::size_t size,
+                    std::vector<char> &buf);
+
+} // namespace trace
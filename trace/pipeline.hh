@@ -0,0 +1,275 @@
+#pragma once
+
+#include "BlockingQueue.hh"
+#include "azure_trace.hh"
+#include "ec_intf.hh"
+#include "merge_scheme.hpp"
+#include "meta.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/// Stages that move the production of stripes off the thread of
+/// `Coordinator::build_data`:
+///
+/// ```text
+/// trace decode -> merge and payload synthesis -> encode -> distribute
+/// PrefetchTraceReader  PrefetchMergeStream  ParallelEncodeStream
+/// ```
+///
+/// Every stage is bounded and emits in the order of its input, so the
+/// stripes come out in the order of the sequential streams and are given the
+/// same stripe ids. A stage wraps the interface it implements, and the
+/// stripe streams that merge and encode in one step run as a whole in a
+/// `PrefetchStripeStream`.
+namespace trace::pipeline {
+
+/// Runs `produce` on its own thread, at most `depth` results ahead of the
+/// consumer.
+/// # Note
+/// the first exception of `produce`, e.g. the `Exhaust` at the end of the
+/// trace, ends the stage and is rethrown by every later `next`
+template <typename T> class Prefetcher {
+  using result_t = std::variant<T, std::exception_ptr>;
+  BlockingQueue<result_t> queue_;
+  std::exception_ptr error_{};
+  std::thread thread_{};
+
+public:
+  Prefetcher(std::function<T()> produce, std::size_t depth)
+      : queue_(std::max<std::size_t>(depth, 1)) {
+    thread_ = std::thread([this, produce = std::move(produce)] {
+      while (true) {
+        try {
+          if (!queue_.push(produce())) {
+            return;
+          }
+        } catch (...) {
+          queue_.push(std::current_exception());
+          queue_.close();
+          return;
+        }
+      }
+    });
+  }
+  Prefetcher(const Prefetcher &) = delete;
+  auto operator=(const Prefetcher &) -> Prefetcher & = delete;
+  Prefetcher(Prefetcher &&) = delete;
+  auto operator=(Prefetcher &&) -> Prefetcher & = delete;
+  /// stops the producer after the result it is producing
+  ~Prefetcher() {
+    queue_.close();
+    thread_.join();
+  }
+
+  auto next() -> T {
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+    auto result = queue_.pop();
+    if (!result.has_value()) {
+      error_ = std::make_exception_ptr(std::runtime_error("stage closed"));
+      std::rethrow_exception(error_);
+    }
+    if (auto *error = std::get_if<std::exception_ptr>(&result.value())) {
+      error_ = *error;
+      std::rethrow_exception(error_);
+    }
+    return std::get<T>(std::move(result).value());
+  }
+};
+
+/// Decodes the trace on its own thread, in batches of `batch` records.
+class PrefetchTraceReader : virtual public TraceReader {
+  TraceReaderPtr trace_reader_;
+  std::vector<BlobAccessTrace> batch_{};
+  std::size_t next_{0};
+  Prefetcher<std::vector<BlobAccessTrace>> prefetcher_;
+
+public:
+  inline static constexpr std::size_t DEFAULT_BATCH{256};
+
+  PrefetchTraceReader(TraceReaderPtr trace_reader, std::size_t depth,
+                      std::size_t batch = DEFAULT_BATCH)
+      : trace_reader_(std::move(trace_reader)),
+        prefetcher_(
+            [this, batch] {
+              auto records = std::vector<BlobAccessTrace>{};
+              records.reserve(batch);
+              try {
+                while (records.size() < batch) {
+                  records.push_back(trace_reader_->next_trace());
+                }
+              } catch (const TraceException &e) {
+                // hand over the records read before the end of the trace
+                if (e.error_enum() != trace_error_e::Exhaust ||
+                    records.empty()) {
+                  throw;
+                }
+              }
+              return records;
+            },
+            depth) {}
+
+  [[nodiscard]] auto next_trace() -> BlobAccessTrace override {
+    if (next_ == batch_.size()) {
+      batch_ = prefetcher_.next();
+      next_ = 0;
+    }
+    return batch_[next_++];
+  }
+};
+
+/// Merges the blobs and synthesizes their payloads on its own thread.
+class PrefetchMergeStream : virtual public blob_stream::MergeStreamInterface {
+  blob_stream::MergeStreamInterfacePtr merge_stream_;
+  std::size_t merge_size_;
+  Prefetcher<merge_t> prefetcher_;
+
+public:
+  PrefetchMergeStream(blob_stream::MergeStreamInterfacePtr merge_stream,
+                      std::size_t depth)
+      : merge_stream_(std::move(merge_stream)),
+        merge_size_(merge_stream_->merge_size()),
+        prefetcher_([this] { return merge_stream_->next_merge(); }, depth) {}
+
+  auto next_merge() -> merge_t override { return prefetcher_.next(); }
+  [[nodiscard]] auto merge_size() const -> std::size_t override {
+    return merge_size_;
+  }
+};
+
+/// Runs a whole stripe stream on its own thread, for the schemes that merge
+/// and encode in one step.
+class PrefetchStripeStream
+    : virtual public stripe_stream::StripeStreamInterface {
+  std::unique_ptr<stripe_stream::StripeStreamInterface> stripe_stream_;
+  Prefetcher<stripe_stream::StripeStreamItem> prefetcher_;
+
+public:
+  PrefetchStripeStream(
+      std::unique_ptr<stripe_stream::StripeStreamInterface> stripe_stream,
+      std::size_t depth)
+      : stripe_stream_(std::move(stripe_stream)),
+        prefetcher_([this] { return stripe_stream_->next_stripe(); }, depth) {
+  }
+
+  auto next_stripe() -> stripe_stream::StripeStreamItem override {
+    return prefetcher_.next();
+  }
+};
+
+/// Encodes the merges of a merge stream on `threads` threads, each with its
+/// own encoder, as `baseline::StripeStream` does on one.
+/// # Note
+/// up to `depth` merges are encoded ahead, the stripes are returned in the
+/// order of the merges
+class ParallelEncodeStream
+    : virtual public stripe_stream::StripeStreamInterface {
+  blob_stream::MergeStreamInterfacePtr merge_stream_;
+  std::size_t depth_;
+  std::mutex encoders_mtx_{};
+  std::vector<ec::encoder_ptr> encoders_{};
+  std::deque<std::future<stripe_stream::StripeStreamItem>> encoding_{};
+  bool exhausted_{false};
+  std::exception_ptr error_{};
+  std::vector<std::jthread> threads_{};
+  BlockingQueue<std::packaged_task<stripe_stream::StripeStreamItem()>>
+      jobs_;
+
+  auto acquire() -> ec::encoder_ptr {
+    auto lock = std::unique_lock{encoders_mtx_};
+    auto encoder = std::move(encoders_.back());
+    encoders_.pop_back();
+    return encoder;
+  }
+
+  auto release(ec::encoder_ptr encoder) -> void {
+    auto lock = std::unique_lock{encoders_mtx_};
+    encoders_.push_back(std::move(encoder));
+  }
+
+  /// submit the next merge, or record why there is none
+  auto submit() -> void {
+    auto merge = decltype(merge_stream_->next_merge()){};
+    try {
+      merge = merge_stream_->next_merge();
+    } catch (...) {
+      exhausted_ = true;
+      error_ = std::current_exception();
+      return;
+    }
+    auto job = std::packaged_task<stripe_stream::StripeStreamItem()>(
+        [this, merge = std::move(merge)]() mutable {
+          auto encoder = acquire();
+          try {
+            auto item = stripe_stream::baseline::encode_merge(
+                *encoder, std::move(merge.first), std::move(merge.second));
+            release(std::move(encoder));
+            return item;
+          } catch (...) {
+            release(std::move(encoder));
+            throw;
+          }
+        });
+    encoding_.push_back(job.get_future());
+    jobs_.push(std::move(job));
+  }
+
+public:
+  /// # Note
+  /// `make_encoder` is called once per thread
+  ParallelEncodeStream(blob_stream::MergeStreamInterfacePtr merge_stream,
+                       const std::function<ec::encoder_ptr()> &make_encoder,
+                       std::size_t threads, std::size_t depth)
+      : merge_stream_(std::move(merge_stream)),
+        depth_(std::max<std::size_t>(depth, 1)), jobs_(depth_) {
+    threads = std::max<std::size_t>(threads, 1);
+    for (std::size_t i = 0; i < threads; i++) {
+      encoders_.emplace_back(make_encoder());
+    }
+    for (std::size_t i = 0; i < threads; i++) {
+      threads_.emplace_back([this] {
+        while (auto job = jobs_.pop()) {
+          (*job)();
+        }
+      });
+    }
+  }
+  ParallelEncodeStream(const ParallelEncodeStream &) = delete;
+  auto
+  operator=(const ParallelEncodeStream &) -> ParallelEncodeStream & = delete;
+  ParallelEncodeStream(ParallelEncodeStream &&) = delete;
+  auto operator=(ParallelEncodeStream &&) -> ParallelEncodeStream & = delete;
+  ~ParallelEncodeStream() override {
+    // the threads finish the jobs queued and exit
+    jobs_.close();
+    threads_.clear();
+  }
+
+  auto next_stripe() -> stripe_stream::StripeStreamItem override {
+    while (!exhausted_ && encoding_.size() < depth_) {
+      submit();
+    }
+    if (encoding_.empty()) {
+      std::rethrow_exception(error_);
+    }
+    auto stripe = std::move(encoding_.front());
+    encoding_.pop_front();
+    return stripe.get();
+  }
+};
+
+} // namespace trace::pipeline
@@ -0,0 +1,426 @@
+#include "size_controller.hh"
+
+#include <fmt/format.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using trace::stripe_stream::adaptive::COST_KINDS;
+using trace::stripe_stream::adaptive::CostKind;
+using trace::stripe_stream::adaptive::EC_TYPES;
+using trace::stripe_stream::adaptive::LinearCost;
+
+constexpr double MIB{1 << 20};
+
+/// the model the costs start at: a seek per chunk read, and the bytes at the
+/// bandwidth of a disk
+constexpr double IO_US{200};
+/// a seek within a chunk, between the sub-chunks a CLAY repair reads
+constexpr double FRAGMENT_US{20};
+constexpr double US_PER_MIB{5000};
+/// the model weighs as much as this many measured operations of each size
+constexpr double PRIOR_SAMPLES{4};
+constexpr std::array<double, 2> PRIOR_SIZES{64 << 10, 16 << 20};
+/// the share of each kind of operation before any is measured, weighing as
+/// much as this many measured operations
+constexpr std::array<double, COST_KINDS> PRIOR_MIX{0.9, 0.05, 0.05};
+constexpr double PRIOR_OPERATIONS{100};
+/// the sizes change if they cut the cost by this fraction at least
+constexpr double HYSTERESIS{0.02};
+
+auto kind_at(std::size_t i) -> CostKind { return static_cast<CostKind>(i); }
+auto ec_type_at(std::size_t i) -> meta::EcType {
+  return static_cast<meta::EcType>(i);
+}
+auto index_of(meta::EcType ec_type) -> std::size_t {
+  auto i = static_cast<std::size_t>(ec_type);
+  if (i >= EC_TYPES) {
+    throw std::out_of_range("ec type out of the cost table");
+  }
+  return i;
+}
+
+/// the modeled cost of an operation on `bytes`
+/// # Note
+/// a CLAY repair reads a 1/q of a chunk, in sub-chunks, from each of the
+/// d = k + m - 1 helpers, with q = m; the rest read or decode k chunks
+auto modeled(CostKind kind, meta::EcType ec_type, meta::ec_param_t k,
+             meta::ec_param_t m, double bytes) -> double {
+  auto ks = static_cast<double>(k);
+  if (kind == CostKind::Read) {
+    return IO_US + bytes / MIB * US_PER_MIB;
+  }
+  if (kind == CostKind::Repair && ec_type == meta::EcType::CLAY) {
+    auto q = static_cast<double>(m);
+    auto d = ks + q - 1;
+    auto alpha = std::pow(q, std::ceil((ks + q) / q));
+    auto fixed = d * (IO_US + (alpha / q - 1) * FRAGMENT_US);
+    return fixed + d / (q * ks) * bytes / MIB * US_PER_MIB;
+  }
+  return ks * IO_US + bytes / MIB * US_PER_MIB;
+}
+
+/// the sizes of the powers of two in [min, max], and the bounds
+auto candidates(std::size_t min, std::size_t max) -> std::vector<std::size_t> {
+  auto sizes = std::vector<std::size_t>{min};
+  for (auto size = std::bit_ceil(min); size < max && size != 0; size <<= 1U) {
+    if (size > min) {
+      sizes.push_back(size);
+    }
+  }
+  if (max > min) {
+    sizes.push_back(max);
+  }
+  return sizes;
+}
+
+} // namespace
+
+void trace::stripe_stream::adaptive::validate_config(const Config &config) {
+  if (config.epoch_blobs == 0) {
+    throw std::invalid_argument("adaptive epoch_blobs is 0");
+  }
+  if (config.min_partition_size == 0 ||
+      config.min_partition_size > config.max_partition_size) {
+    throw std::invalid_argument(
+        "adaptive partition sizes not in [1, max_partition_size]");
+  }
+  if (config.min_merge_size == 0 ||
+      config.min_merge_size > config.max_merge_size) {
+    throw std::invalid_argument(
+        "adaptive merge sizes not in [1, max_merge_size]");
+  }
+}
+
+auto trace::stripe_stream::adaptive::LinearCost::add(std::size_t bytes,
+                                                     double us, double weight)
+    -> void {
+  auto x = static_cast<double>(bytes) / MIB;
+  n_ += weight;
+  x_ += weight * x;
+  y_ += weight * us;
+  xx_ += weight * x * x;
+  xy_ += weight * x * us;
+}
+
+auto trace::stripe_stream::adaptive::LinearCost::add(const LinearCost &other)
+    -> void {
+  n_ += other.n_;
+  x_ += other.x_;
+  y_ += other.y_;
+  xx_ += other.xx_;
+  xy_ += other.xy_;
+}
+
+auto trace::stripe_stream::adaptive::LinearCost::fit() const
+    -> std::pair<double, double> {
+  if (n_ <= 0) {
+    return {0, 0};
+  }
+  auto mean = y_ / n_;
+  auto spread = n_ * xx_ - x_ * x_;
+  // a single size, or sizes too close to tell a slope
+  if (spread <= std::numeric_limits<double>::epsilon() * n_ * xx_) {
+    return {mean, 0};
+  }
+  auto per_mib = (n_ * xy_ - x_ * y_) / spread;
+  auto fixed = (y_ - per_mib * x_) / n_;
+  if (per_mib < 0) {
+    return {mean, 0};
+  }
+  if (fixed < 0) {
+    // through the origin
+    return {0, xy_ / xx_};
+  }
+  return {fixed, per_mib};
+}
+
+auto trace::stripe_stream::adaptive::CostLog::record(CostKind kind,
+                                                     meta::EcType ec_type,
+                                                     std::size_t bytes,
+                                                     double us) -> void {
+  auto lock = std::unique_lock{mtx_};
+  costs_.at(static_cast<std::size_t>(kind))
+      .at(index_of(ec_type))
+      .add(bytes, us);
+}
+
+auto trace::stripe_stream::adaptive::CostLog::cost(CostKind kind,
+                                                   meta::EcType ec_type) const
+    -> LinearCost {
+  auto lock = std::unique_lock{mtx_};
+  return costs_.at(static_cast<std::size_t>(kind)).at(index_of(ec_type));
+}
+
+auto trace::stripe_stream::adaptive::CostLog::operations(CostKind kind) const
+    -> double {
+  auto lock = std::unique_lock{mtx_};
+  auto operations = double{0};
+  for (const auto &cost : costs_.at(static_cast<std::size_t>(kind))) {
+    operations += cost.samples();
+  }
+  return operations;
+}
+
+/// one line per kind and EC type measured:
+/// `<kind> <ec type> <weight> <MiB> <us> <MiB^2> <MiB * us>`
+auto trace::stripe_stream::adaptive::CostLog::load(
+    const std::filesystem::path &path) -> void {
+  auto in = std::ifstream{path};
+  if (!in.is_open()) {
+    return;
+  }
+  auto loaded = decltype(costs_){};
+  auto kind_name = std::string{};
+  auto ec_type_name = std::string{};
+  auto sums = std::array<double, 5>{};
+  while (in >> kind_name >> ec_type_name >> sums[0] >> sums[1] >> sums[2] >>
+         sums[3] >> sums[4]) {
+    auto kind = COST_KINDS;
+    auto ec_type = EC_TYPES;
+    for (std::size_t i = 0; i < COST_KINDS; i++) {
+      kind = format_as(kind_at(i)) == kind_name ? i : kind;
+    }
+    for (std::size_t i = 0; i < EC_TYPES; i++) {
+      ec_type = meta::ec_type_to_string(ec_type_at(i)) == ec_type_name
+                    ? i
+                    : ec_type;
+    }
+    if (kind == COST_KINDS || ec_type == EC_TYPES) {
+      throw std::runtime_error(fmt::format("unknown cost {} of {} in {}",
+                                           kind_name,
+                                           ec_type_name,
+                                           path.string()));
+    }
+    loaded.at(kind).at(ec_type).add(
+        LinearCost{sums[0], sums[1], sums[2], sums[3], sums[4]});
+  }
+  if (!in.eof()) {
+    throw std::runtime_error(
+        fmt::format("malformed cost file {}", path.string()));
+  }
+  auto lock = std::unique_lock{mtx_};
+  for (std::size_t i = 0; i < COST_KINDS; i++) {
+    for (std::size_t j = 0; j < EC_TYPES; j++) {
+      costs_.at(i).at(j).add(loaded.at(i).at(j));
+    }
+  }
+}
+
+auto trace::stripe_stream::adaptive::CostLog::save(
+    const std::filesystem::path &path) const -> void {
+  auto tmp_path = path;
+  tmp_path += ".tmp";
+  {
+    auto out = std::ofstream{tmp_path, std::ios::trunc};
+    auto lock = std::unique_lock{mtx_};
+    for (std::size_t i = 0; i < COST_KINDS; i++) {
+      for (std::size_t j = 0; j < EC_TYPES; j++) {
+        const auto &cost = costs_.at(i).at(j);
+        if (cost.samples() == 0) {
+          continue;
+        }
+        auto [n, x, y, xx, xy] = cost.sums();
+        out << fmt::format("{} {} {} {} {} {} {}\n",
+                           format_as(kind_at(i)),
+                           meta::ec_type_to_string(ec_type_at(j)),
+                           n,
+                           x,
+                           y,
+                           xx,
+                           xy);
+      }
+    }
+    out.close();
+    if (out.fail()) {
+      throw std::runtime_error(
+          fmt::format("failed to write cost file {}", tmp_path.string()));
+    }
+  }
+  auto ec = std::error_code{};
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) {
+    throw std::runtime_error(fmt::format(
+        "failed to write cost file {}: {}", path.string(), ec.message()));
+  }
+}
+
+trace::stripe_stream::adaptive::SizeController::SizeController(
+    Config config, meta::ec_param_t k, meta::ec_param_t m,
+    std::size_t partition_size, std::size_t merge_size,
+    const CostLog &measured)
+    : config_{(validate_config(config), std::move(config))} {
+  auto operations = double{0};
+  for (std::size_t i = 0; i < COST_KINDS; i++) {
+    for (std::size_t j = 0; j < EC_TYPES; j++) {
+      auto cost = measured.cost(kind_at(i), ec_type_at(j));
+      for (auto size : PRIOR_SIZES) {
+        cost.add(static_cast<std::size_t>(size),
+                 modeled(kind_at(i), ec_type_at(j), k, m, size),
+                 PRIOR_SAMPLES);
+      }
+      fits_.at(i).at(j) = cost.fit();
+    }
+    mix_.at(i) = measured.operations(kind_at(i)) +
+                 PRIOR_MIX.at(i) * PRIOR_OPERATIONS;
+    operations += mix_.at(i);
+  }
+  for (auto &share : mix_) {
+    share /= operations;
+  }
+  tuning_ = meta::StripeTuning{
+      .epoch = 1,
+      .partition_size = std::clamp(partition_size,
+                                   config_.min_partition_size,
+                                   config_.max_partition_size),
+      .merge_size = std::clamp(
+          merge_size, config_.min_merge_size, config_.max_merge_size)};
+  LOG(INFO) << fmt::format(
+                   "adaptive sizes: start at partition_size {}, merge_size "
+                   "{}; {:.0f} operations measured, weighted {:.3f} read, "
+                   "{:.3f} degraded read, {:.3f} repair",
+                   tuning_.partition_size,
+                   tuning_.merge_size,
+                   operations - PRIOR_OPERATIONS,
+                   mix(CostKind::Read),
+                   mix(CostKind::DegradeRead),
+                   mix(CostKind::Repair))
+            << std::endl;
+}
+
+auto trace::stripe_stream::adaptive::SizeController::cost_of(
+    CostKind kind, meta::EcType ec_type, double bytes) const -> double {
+  auto [fixed, per_mib] =
+      fits_.at(static_cast<std::size_t>(kind)).at(index_of(ec_type));
+  return fixed + per_mib * bytes / MIB;
+}
+
+auto trace::stripe_stream::adaptive::SizeController::blob_cost(
+    double size, std::size_t partition_size, std::size_t merge_size) const
+    -> double {
+  using enum CostKind;
+  using meta::EcType;
+  auto weighted = [this](double read, double degrade, double repair) {
+    return mix(Read) * read + mix(DegradeRead) * degrade +
+           mix(Repair) * repair;
+  };
+  // a blob above the merge size is merged alone
+  auto alone = size > static_cast<double>(merge_size);
+  auto merged = alone ? size : static_cast<double>(merge_size);
+  auto large = static_cast<double>(partition_size);
+  if (merged < large) {
+    // one RS stripe
+    return weighted(cost_of(Read, EcType::RS, size),
+                    cost_of(DegradeRead, EcType::RS, merged),
+                    cost_of(Repair, EcType::RS, merged) * size / merged);
+  }
+  // CLAY stripes of the power of two multiples of the partition size, the
+  // rest is a RS stripe
+  auto units = static_cast<std::uint64_t>(merged / large);
+  auto pieces = static_cast<double>(std::popcount(units));
+  auto piece = static_cast<double>(units) * large / pieces;
+  auto rest = merged - static_cast<double>(units) * large;
+  auto rest_cost = [&](CostKind kind) {
+    return rest > 0 ? cost_of(kind, EcType::RS, rest) : 0;
+  };
+  auto repair = pieces * cost_of(Repair, EcType::CLAY, piece) +
+                rest_cost(Repair);
+  // a blob merged alone decodes all its stripes, a merged one the piece it
+  // is in
+  auto degrade = alone ? pieces * cost_of(DegradeRead, EcType::CLAY, piece) +
+                             rest_cost(DegradeRead)
+                       : cost_of(DegradeRead, EcType::CLAY, piece);
+  return weighted(cost_of(Read, EcType::CLAY, size),
+                  degrade,
+                  repair * size / merged);
+}
+
+auto trace::stripe_stream::adaptive::SizeController::expected_cost(
+    std::size_t partition_size, std::size_t merge_size) const -> double {
+  auto blobs = double{0};
+  auto cost = double{0};
+  for (std::size_t i = 0; i < SIZE_BUCKETS; i++) {
+    if (counts_.at(i) == 0) {
+      continue;
+    }
+    auto size = bytes_.at(i) / counts_.at(i);
+    blobs += counts_.at(i);
+    cost += counts_.at(i) * blob_cost(size, partition_size, merge_size);
+  }
+  return blobs == 0 ? 0 : cost / blobs;
+}
+
+auto trace::stripe_stream::adaptive::SizeController::choose() -> void {
+  auto current = tuning();
+  auto best = current;
+  auto current_cost =
+      expected_cost(current.partition_size, current.merge_size);
+  auto best_cost = current_cost;
+  for (auto partition_size : candidates(config_.min_partition_size,
+                                        config_.max_partition_size)) {
+    for (auto merge_size :
+         candidates(config_.min_merge_size, config_.max_merge_size)) {
+      auto cost = expected_cost(partition_size, merge_size);
+      if (cost < best_cost) {
+        best_cost = cost;
+        best.partition_size = partition_size;
+        best.merge_size = merge_size;
+      }
+    }
+  }
+  if (best_cost > current_cost * (1 - HYSTERESIS)) {
+    best = current;
+    best_cost = current_cost;
+  }
+  best.epoch = current.epoch + 1;
+  {
+    auto lock = std::unique_lock{mtx_};
+    tuning_ = best;
+  }
+  LOG(INFO) << fmt::format("adaptive sizes, epoch {}: partition_size {}, "
+                           "merge_size {}, {:.0f}us per access, {:.0f}us "
+                           "before",
+                           best.epoch,
+                           best.partition_size,
+                           best.merge_size,
+                           best_cost,
+                           current_cost)
+            << std::endl;
+  // the older epochs fade
+  for (std::size_t i = 0; i < SIZE_BUCKETS; i++) {
+    counts_.at(i) /= 2;
+    bytes_.at(i) /= 2;
+  }
+}
+
+auto trace::stripe_stream::adaptive::SizeController::observe(
+    std::size_t blob_size) -> bool {
+  auto bucket = static_cast<std::size_t>(std::bit_width(blob_size));
+  counts_.at(bucket) += 1;
+  bytes_.at(bucket) += static_cast<double>(blob_size);
+  if (++epoch_seen_ < config_.epoch_blobs) {
+    return false;
+  }
+  epoch_seen_ = 0;
+  choose();
+  return true;
+}
+
+auto trace::stripe_stream::adaptive::SizeController::tuning() const
+    -> meta::StripeTuning {
+  auto lock = std::unique_lock{mtx_};
+  return tuning_;
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "meta.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <utility>
+
+/// Online choice of the partition size and the merge size of the
+/// "Partition" scheme, from the blob sizes of the trace and the costs of the
+/// reads and repairs measured by the earlier runs.
+///
+/// A blob is costed where the sizes put it: a blob above the merge size is
+/// encoded on its own, by CLAY in the pieces of the partition size, and by RS
+/// below the partition size; the blobs up to the merge size share a merge of
+/// the merge size. An access reads the blob or, at the share of the degraded
+/// reads, decodes the stripes of the blob; a repair rebuilds a chunk of a
+/// stripe and is charged to the blobs of the stripe by size. Every epoch the
+/// controller takes the sizes of the least expected cost per access for the
+/// blobs seen, the older epochs weighing half as much each.
+namespace trace::stripe_stream::adaptive {
+
+enum class CostKind : std::uint8_t {
+  Read = 0,
+  DegradeRead,
+  Repair,
+};
+inline static constexpr std::size_t COST_KINDS{3};
+inline static constexpr std::size_t EC_TYPES{3};
+
+inline auto format_as(CostKind kind) -> std::string_view {
+  switch (kind) {
+  case CostKind::Read:
+    return "Read";
+  case CostKind::DegradeRead:
+    return "DegradeRead";
+  case CostKind::Repair:
+    return "Repair";
+  default:
+    return "Unknown";
+  }
+}
+
+struct Config {
+  /// blobs between two choices of the sizes
+  std::size_t epoch_blobs;
+  /// the sizes are chosen in [min, max]
+  std::size_t min_partition_size;
+  std::size_t max_partition_size;
+  std::size_t min_merge_size;
+  std::size_t max_merge_size;
+  /// the costs measured by the reads and the repairs, loaded by a build and
+  /// extended by the other actions; empty to use the modeled costs only
+  std::filesystem::path cost_file;
+};
+
+/// # Throw
+/// `std::invalid_argument` if a bound is `0` or above its max, or the epoch
+/// is empty
+void validate_config(const Config &config);
+
+/// The cost of an operation in microseconds, linear in the bytes it covers,
+/// fitted by weighted least squares.
+class LinearCost {
+  /// the sums of the weights, the MiB, the costs, and their products
+  double n_{0};
+  double x_{0};
+  double y_{0};
+  double xx_{0};
+  double xy_{0};
+
+public:
+  LinearCost() = default;
+  LinearCost(double n, double x, double y, double xx, double xy)
+      : n_{n}, x_{x}, y_{y}, xx_{xx}, xy_{xy} {}
+
+  auto add(std::size_t bytes, double us, double weight = 1) -> void;
+  auto add(const LinearCost &other) -> void;
+
+  [[nodiscard]] auto samples() const -> double { return n_; }
+  [[nodiscard]] auto sums() const -> std::array<double, 5> {
+    return {n_, x_, y_, xx_, xy_};
+  }
+  /// the fixed cost and the cost per MiB, neither negative
+  /// # Note
+  /// the cost per MiB is `0` until two sizes are sampled
+  [[nodiscard]] auto fit() const -> std::pair<double, double>;
+};
+
+/// The costs measured per kind of operation and EC type, recorded from the
+/// operation threads.
+class CostLog {
+  mutable std::mutex mtx_{};
+  std::array<std::array<LinearCost, EC_TYPES>, COST_KINDS> costs_{};
+
+public:
+  /// an operation on `bytes` of a stripe of `ec_type` took `us`
+  /// # Note
+  /// the bytes of a read are of the blob, the bytes of a degraded read or a
+  /// repair are the data of the stripe decoded
+  auto record(CostKind kind, meta::EcType ec_type, std::size_t bytes,
+              double us) -> void;
+  [[nodiscard]] auto cost(CostKind kind, meta::EcType ec_type) const
+      -> LinearCost;
+  /// operations recorded of `kind`, of any EC type
+  [[nodiscard]] auto operations(CostKind kind) const -> double;
+
+  /// add the costs saved in `path`, nothing if the file does not exist
+  /// # Throw
+  /// `std::runtime_error` if the file is malformed
+  auto load(const std::filesystem::path &path) -> void;
+  /// # Throw
+  /// `std::runtime_error` if the file cannot be written
+  auto save(const std::filesystem::path &path) const -> void;
+};
+
+/// Chooses the partition size and the merge size per epoch, see the
+/// namespace.
+/// # Note
+/// - the costs of a kind and EC type start at a model of the stripe layout
+///   and the measured ones take over as they accumulate
+/// - `observe` is called by the stripe stream, `tuning` may be called from
+///   any thread
+class SizeController {
+  /// blobs by the bit width of their size
+  inline static constexpr std::size_t SIZE_BUCKETS{65};
+
+  Config config_;
+  /// the fixed cost and the cost per MiB, fitted on the costs modeled for
+  /// the EC parameters and the measured ones
+  std::array<std::array<std::pair<double, double>, EC_TYPES>, COST_KINDS>
+      fits_{};
+  /// the share of the accesses and repairs of each kind
+  std::array<double, COST_KINDS> mix_{};
+  std::array<double, SIZE_BUCKETS> counts_{};
+  std::array<double, SIZE_BUCKETS> bytes_{};
+  std::size_t epoch_seen_{0};
+  mutable std::mutex mtx_{};
+  meta::StripeTuning tuning_{};
+
+  [[nodiscard]] auto cost_of(CostKind kind, meta::EcType ec_type,
+                             double bytes) const -> double;
+  /// expected cost of an access of a blob of `size`
+  [[nodiscard]] auto blob_cost(double size, std::size_t partition_size,
+                               std::size_t merge_size) const -> double;
+  auto choose() -> void;
+
+public:
+  /// start at the sizes of the profile, clamped to the bounds
+  /// # Throw
+  /// `std::invalid_argument`, see `validate_config`
+  SizeController(Config config, meta::ec_param_t k, meta::ec_param_t m,
+                 std::size_t partition_size, std::size_t merge_size,
+                 const CostLog &measured);
+
+  /// count a blob of the current epoch
+  /// # Return
+  /// true if the blob ends the epoch and the sizes are chosen again
+  auto observe(std::size_t blob_size) -> bool;
+
+  /// the sizes of the current epoch, numbered from `1`
+  [[nodiscard]] auto tuning() const -> meta::StripeTuning;
+  /// expected cost per access in microseconds at the given sizes, for the
+  /// blobs seen
+  [[nodiscard]] auto expected_cost(std::size_t partition_size,
+                                   std::size_t merge_size) const -> double;
+  /// the share of the operations of `kind` the costs are weighted by
+  [[nodiscard]] auto mix(CostKind kind) const -> double {
+    return mix_.at(static_cast<std::size_t>(kind));
+  }
+};
+
+using SizeControllerPtr = std::unique_ptr<SizeController>;
+
+} // namespace trace::stripe_stream::adaptive
@@ -6,30 +6,105 @@
 // http://www.boost.org/LICENSE_1_0.txt
 //
 // See http://boostorg.github.com/compute for more information.
+//
+// Modified: the items are kept densely and indexed by an open addressing table.
 //---------------------------------------------------------------------------//
 
 #ifndef SIZE_LRU_CACHE_HPP
 #define SIZE_LRU_CACHE_HPP
 
-#include <cstddef>
-#include <iostream>
-#include <list>
-#include <map>
-#include <utility>
+#include "flat_hash_map.hpp"
 
 #include <boost/optional.hpp>
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 namespace size_lru_cache {
-// a cache which evicts the least recently used item when it is full
+/// a cache which evicts the least recently used items when the size of its
+/// items exceeds the capacity
+/// # Note
+/// - the items are kept densely in one vector and linked by index into the
+///   recency list, a key is found through an open addressing table of
+///   indices, nothing is allocated per item
+/// - `contains` and `insert` leave the recency of a cached item as is, only
+///   `get` refreshes it
 template <class Key> class lru_cache {
 public:
   typedef Key key_type;
   typedef size_t size_type;
-  typedef std::list<key_type> list_type;
-  typedef std::map<key_type, std::pair<size_type, typename list_type::iterator>>
-      map_type;
 
-  lru_cache(size_t capacity) : m_capacity(capacity) {}
+private:
+  using index_t = flat_hash::ProbeTable::index_t;
+  inline static constexpr index_t NIL{flat_hash::ProbeTable::EMPTY};
+
+  struct Node {
+    key_type key;
+    size_type size;
+    std::uint64_t hash;
+    /// towards the most recently used item
+    index_t prev;
+    /// towards the least recently used item
+    index_t next;
+  };
+
+  std::vector<Node> m_nodes{};
+  flat_hash::ProbeTable m_table{};
+  index_t m_head{NIL};
+  index_t m_tail{NIL};
+  size_t m_capacity;
+  size_t m_size_ = 0;
+
+  auto hash_at() const {
+    return [this](std::size_t index) { return m_nodes[index].hash; };
+  }
+
+  auto find_slot(const key_type &key, std::uint64_t hash) const
+      -> std::size_t {
+    return m_table.probe(hash, [&](index_t index) {
+      return m_nodes[index].hash == hash && m_nodes[index].key == key;
+    });
+  }
+
+  void unlink(index_t index) {
+    auto &node = m_nodes[index];
+    (node.prev == NIL ? m_head : m_nodes[node.prev].next) = node.next;
+    (node.next == NIL ? m_tail : m_nodes[node.next].prev) = node.prev;
+  }
+
+  void push_front(index_t index) {
+    auto &node = m_nodes[index];
+    node.prev = NIL;
+    node.next = m_head;
+    (m_head == NIL ? m_tail : m_nodes[m_head].prev) = index;
+    m_head = index;
+  }
+
+  void evict() {
+    // evict item from the end of most recently used list
+    auto index = m_tail;
+    m_size_ -= m_nodes[index].size;
+    unlink(index);
+    m_table.erase(find_slot(m_nodes[index].key, m_nodes[index].hash),
+                  hash_at());
+    auto last = static_cast<index_t>(m_nodes.size() - 1);
+    if (index != last) {
+      // move the last node into the hole, and repoint its slot and links
+      auto slot = find_slot(m_nodes[last].key, m_nodes[last].hash);
+      m_nodes[index] = m_nodes[last];
+      m_table.set(slot, index);
+      auto &node = m_nodes[index];
+      (node.prev == NIL ? m_head : m_nodes[node.prev].next) = index;
+      (node.next == NIL ? m_tail : m_nodes[node.next].prev) = index;
+    }
+    m_nodes.pop_back();
+  }
+
+public:
+  lru_cache(size_t capacity) : m_capacity(capacity) {
+    m_table.rehash(0, 0, hash_at());
+  }
 
   ~lru_cache() {}
 
@@ -37,79 +112,60 @@ public:
 
   size_t capacity() const { return m_capacity; }
 
-  bool empty() const { return m_map.empty(); }
+  /// the number of items
+  size_t count() const { return m_nodes.size(); }
 
-  bool contains(const key_type &key) { return m_map.find(key) != m_map.end(); }
+  bool empty() const { return m_nodes.empty(); }
+
+  bool contains(const key_type &key) const {
+    return m_table.at(find_slot(key, flat_hash::hash_of(key))) != NIL;
+  }
 
   void insert(const key_type &key, const size_type &size) {
-    typename map_type::iterator i = m_map.find(key);
-    if (i == m_map.end()) {
-      // insert item into the cache, but first check if it is full
-      m_size_ += size;
-      while (m_size_ > m_capacity) {
-        // cache is full, evict the least recently used item
-        evict();
-      }
-
-      // insert the new item
-      m_list.push_front(key);
-      m_map[key] = std::make_pair(size, m_list.begin());
+    auto hash = flat_hash::hash_of(key);
+    if (m_table.at(find_slot(key, hash)) != NIL) {
+      return;
     }
+    // insert item into the cache, but first check if it is full
+    m_size_ += size;
+    while (m_size_ > m_capacity && !m_nodes.empty()) {
+      // cache is full, evict the least recently used item
+      evict();
+    }
+    if (m_table.needs_growth(m_nodes.size())) {
+      m_table.rehash(m_nodes.size() * 2, m_nodes.size(), hash_at());
+    }
+
+    // insert the new item
+    auto index = static_cast<index_t>(m_nodes.size());
+    m_nodes.push_back(Node{
+        .key = key, .size = size, .hash = hash, .prev = NIL, .next = NIL});
+    m_table.set(find_slot(key, hash), index);
+    push_front(index);
   }
 
   boost::optional<size_type> get(const key_type &key) {
     // lookup value in the cache
-    typename map_type::iterator i = m_map.find(key);
-    if (i == m_map.end()) {
+    auto index = m_table.at(find_slot(key, flat_hash::hash_of(key)));
+    if (index == NIL) {
       // value not in cache
       return boost::none;
     }
-
-    // return the value, but first update its place in the most
-    // recently used list
-    typename list_type::iterator j = i->second.second;
-    if (j != m_list.begin()) {
-      // move item to the front of the most recently used list
-      m_list.erase(j);
-      m_list.push_front(key);
-
-      // update iterator in map
-      j = m_list.begin();
-      const size_type &value = i->second.first;
-      m_map[key] = std::make_pair(value, j);
-
-      // return the value
-      return value;
-    } else {
-      // the item is already at the front of the most recently
-      // used list so just return it
-      return i->second.first;
+    // move item to the front of the most recently used list
+    if (index != m_head) {
+      unlink(index);
+      push_front(index);
     }
+    return m_nodes[index].size;
   }
 
   void clear() {
-    m_map.clear();
-    m_list.clear();
-  }
-
-private:
-  void evict() {
-    // evict item from the end of most recently used list
-    typename list_type::iterator i = --m_list.end();
-    // std::cout << "evicting " << *i << std::endl;
-
-    auto size = m_map.find(*i)->second.first;
-    m_size_ -= size;
-
-    m_map.erase(*i);
-    m_list.erase(i);
+    m_nodes.clear();
+    m_table.rehash(0, 0, hash_at());
+    m_head = NIL;
+    m_tail = NIL;
+    m_size_ = 0;
   }
-
-private:
-  map_type m_map;
-  list_type m_list;
-  size_t m_capacity;
-  size_t m_size_ = 0;
 };
 } // namespace size_lru_cache
 
@@ -0,0 +1,194 @@
+#include "synth_trace.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <numbers>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr std::uint64_t GOLDEN{0x9e3779b97f4a7c15};
+
+auto mix(std::uint64_t z) -> std::uint64_t {
+  z = (z ^ (z >> 30U)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27U)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31U);
+}
+
+auto zipf_weights(const trace::SynthWorkload &workload)
+    -> std::vector<double> {
+  auto weights = std::vector<double>(workload.users);
+  for (std::size_t i = 0; i < weights.size(); i++) {
+    weights[i] = 1 / std::pow(static_cast<double>(i + 1), workload.zipf_s);
+  }
+  return weights;
+}
+
+auto in_unit(double x) -> bool { return x >= 0 && x <= 1; }
+
+} // namespace
+
+void trace::validate_workload(const SynthWorkload &workload) {
+  if (workload.users == 0 ||
+      workload.users > std::numeric_limits<std::uint32_t>::max()) {
+    throw std::invalid_argument("synthetic users not in [1, 2^32)");
+  }
+  if (!(workload.zipf_s >= 0) || !(workload.size_sigma >= 0)) {
+    throw std::invalid_argument("synthetic zipf_s or size_sigma is negative");
+  }
+  if (workload.min_size == 0 || workload.min_size > workload.max_size) {
+    throw std::invalid_argument("synthetic sizes not in [1, max_size]");
+  }
+  if (!in_unit(workload.read_ratio) || !in_unit(workload.locality)) {
+    throw std::invalid_argument(
+        "synthetic read_ratio or locality not in [0, 1]");
+  }
+  if (workload.read_ratio > 0 && workload.user_history == 0) {
+    throw std::invalid_argument("synthetic reads need a user_history");
+  }
+  if (!(workload.arrival_rate > 0)) {
+    throw std::invalid_argument("synthetic arrival_rate is not positive");
+  }
+  const auto &cdf = workload.size_cdf;
+  for (std::size_t i = 0; i < cdf.size(); i++) {
+    auto [size, fraction] = cdf[i];
+    auto ascending = i == 0 || (size > cdf[i - 1].first &&
+                                fraction >= cdf[i - 1].second);
+    if (size == 0 || !in_unit(fraction) || !ascending) {
+      throw std::invalid_argument(
+          "synthetic size_cdf is not ascending in (0, 1]");
+    }
+  }
+  if (!cdf.empty() && cdf.back().second != 1) {
+    throw std::invalid_argument("synthetic size_cdf does not end at 1");
+  }
+}
+
+trace::SynthTraceReader::AliasTable::AliasTable(
+    const std::vector<double> &weights)
+    : prob_(weights.size()), alias_(weights.size()) {
+  auto n = weights.size();
+  auto sum = double{0};
+  for (auto w : weights) {
+    sum += w;
+  }
+  auto small = std::vector<std::uint32_t>{};
+  auto large = std::vector<std::uint32_t>{};
+  for (std::size_t i = 0; i < n; i++) {
+    prob_[i] = weights[i] * static_cast<double>(n) / sum;
+    (prob_[i] < 1 ? small : large).push_back(static_cast<std::uint32_t>(i));
+  }
+  while (!small.empty() && !large.empty()) {
+    auto s = small.back();
+    small.pop_back();
+    auto l = large.back();
+    alias_[s] = l;
+    prob_[l] -= 1 - prob_[s];
+    if (prob_[l] < 1) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // the rounding leftovers of either list are certain
+  for (auto i : small) {
+    prob_[i] = 1;
+  }
+  for (auto i : large) {
+    prob_[i] = 1;
+  }
+}
+
+auto trace::SynthTraceReader::AliasTable::draw(double u) const
+    -> std::size_t {
+  auto scaled = u * static_cast<double>(prob_.size());
+  auto i = std::min(static_cast<std::size_t>(scaled), prob_.size() - 1);
+  return scaled - static_cast<double>(i) < prob_[i] ? i : alias_[i];
+}
+
+trace::SynthTraceReader::SynthTraceReader(SynthWorkload workload)
+    : workload_{(validate_workload(workload), std::move(workload))},
+      users_{zipf_weights(workload_)}, state_{mix(workload_.seed)},
+      history_(workload_.users * workload_.user_history),
+      history_len_(workload_.users), history_head_(workload_.users) {}
+
+auto trace::SynthTraceReader::uniform() -> double {
+  state_ += GOLDEN;
+  constexpr double TO_UNIT{0x1.0p-53};
+  return static_cast<double>(mix(state_) >> 11U) * TO_UNIT;
+}
+
+auto trace::SynthTraceReader::next_size() -> std::size_t {
+  const auto &cdf = workload_.size_cdf;
+  auto size = double{0};
+  if (cdf.empty()) {
+    // Box-Muller, the first uniform kept off zero
+    auto r = std::sqrt(-2 * std::log(1 - uniform()));
+    auto z = r * std::cos(2 * std::numbers::pi * uniform());
+    size = std::exp(workload_.size_mu + workload_.size_sigma * z);
+  } else {
+    auto u = uniform();
+    auto it = std::lower_bound(
+        cdf.begin(), cdf.end(), u, [](const auto &point, double fraction) {
+          return point.second < fraction;
+        });
+    it = std::min(it, std::prev(cdf.end()));
+    if (it == cdf.begin()) {
+      size = static_cast<double>(it->first);
+    } else {
+      auto [lo_size, lo] = *std::prev(it);
+      auto [hi_size, hi] = *it;
+      auto t = (u - lo) / (hi - lo);
+      auto log_lo = std::log(static_cast<double>(lo_size));
+      auto log_hi = std::log(static_cast<double>(hi_size));
+      size = std::exp(log_lo + t * (log_hi - log_lo));
+    }
+  }
+  // clamped before the cast, an unbounded size may not fit
+  return static_cast<std::size_t>(
+      std::clamp(size,
+                 static_cast<double>(workload_.min_size),
+                 static_cast<double>(workload_.max_size)));
+}
+
+auto trace::SynthTraceReader::next_trace() -> BlobAccessTrace {
+  if (generated_ == workload_.records) {
+    throw TraceException(trace_error_e::Exhaust);
+  }
+  generated_++;
+  time_ -= std::log(1 - uniform()) / workload_.arrival_rate;
+  if (uniform() >= workload_.locality) {
+    user_ = users_.draw(uniform());
+  }
+  auto trace = BlobAccessTrace{};
+  trace.time_stamp = static_cast<std::uint64_t>(time_);
+  trace.user_id = user_ + 1;
+  trace.blob_type = azure_trace_rs::BlobType::Other;
+  auto depth = workload_.user_history;
+  auto *recent = history_.data() + user_ * depth; // NOLINT
+  auto &len = history_len_[user_];
+  auto &head = history_head_[user_];
+  // a user without a blob yet writes one
+  if (len > 0 && uniform() < workload_.read_ratio) {
+    auto back = static_cast<std::size_t>(uniform() * len) + 1;
+    const auto &written = recent[(head + depth - back) % depth]; // NOLINT
+    trace.blob_id = written.blob_id;
+    trace.size = written.size;
+    trace.read = true;
+    return trace;
+  }
+  trace.blob_id = next_blob_id_++;
+  trace.size = next_size();
+  trace.write = true;
+  if (depth > 0) {
+    recent[head] = Written{trace.blob_id, trace.size}; // NOLINT
+    head = static_cast<std::uint32_t>((head + 1) % depth);
+    len = static_cast<std::uint32_t>(std::min<std::size_t>(len + 1, depth));
+  }
+  return trace;
+}
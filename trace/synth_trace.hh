@@ -0,0 +1,100 @@
+#pragma once
+
+#include "azure_trace.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/// Synthetic blob access traces, drawn from parameterized distributions
+/// instead of read from the Azure CSV, to explore the merge schemes at any
+/// scale.
+///
+/// A record is a write of a new blob, or a read of one of the blobs its user
+/// wrote recently. The users are Zipf distributed, and a record keeps the
+/// user of the record before with the probability of `locality`, which gives
+/// the runs of accesses per user the locality schemes merge.
+///
+/// The stream is a pure function of the workload and its seed: the draws
+/// come from a SplitMix64 counter, and the distributions are sampled by
+/// inversion and alias tables of our own, not by `<random>`, whose
+/// distributions differ across standard libraries.
+namespace trace {
+
+struct SynthWorkload {
+  /// records generated before `Exhaust`
+  std::size_t records;
+  std::size_t users;
+  /// skew of the user popularity, `0` is uniform
+  double zipf_s;
+  /// log of the blob sizes in bytes is normal with these mean and deviation
+  double size_mu;
+  double size_sigma;
+  /// empirical CDF of the blob sizes as (size, cumulative fraction) points
+  /// of ascending size, the last fraction is 1; overrides the lognormal
+  /// sizes if not empty
+  /// # Note
+  /// sizes between two points are interpolated on the log scale
+  std::vector<std::pair<std::size_t, double>> size_cdf;
+  /// the sizes are clamped to [min_size, max_size]
+  std::size_t min_size;
+  std::size_t max_size;
+  /// fraction of the records that read a blob, the others write one
+  double read_ratio;
+  /// probability that a record has the user of the record before
+  double locality;
+  /// blobs of a user the reads draw from, the most recently written
+  std::size_t user_history;
+  /// mean records per unit of the time stamps, the arrivals are Poisson
+  double arrival_rate;
+  std::uint64_t seed;
+};
+
+/// # Throw
+/// `std::invalid_argument` if the workload cannot be generated, e.g. no
+/// users or an unsorted size CDF
+void validate_workload(const SynthWorkload &workload);
+
+class SynthTraceReader : virtual public TraceReader {
+  /// Vose's alias table, O(1) draws from a discrete distribution
+  class AliasTable {
+    std::vector<double> prob_{};
+    std::vector<std::uint32_t> alias_{};
+
+  public:
+    explicit AliasTable(const std::vector<double> &weights);
+    /// the index drawn by the uniform `u` in [0, 1)
+    [[nodiscard]] auto draw(double u) const -> std::size_t;
+  };
+
+  struct Written {
+    meta::blob_id_t blob_id;
+    std::size_t size;
+  };
+
+  SynthWorkload workload_;
+  AliasTable users_;
+  std::uint64_t state_;
+  std::size_t generated_{0};
+  meta::blob_id_t next_blob_id_{1};
+  double time_{0};
+  std::size_t user_{0};
+  /// a ring of the recent writes of each user, `user_history` each
+  std::vector<Written> history_;
+  std::vector<std::uint32_t> history_len_;
+  std::vector<std::uint32_t> history_head_;
+
+  /// uniform in [0, 1)
+  auto uniform() -> double;
+  auto next_size() -> std::size_t;
+
+public:
+  /// # Throw
+  /// `std::invalid_argument`, see `validate_workload`
+  explicit SynthTraceReader(SynthWorkload workload);
+
+  [[nodiscard]] auto next_trace() -> BlobAccessTrace override;
+};
+
+} // namespace trace
@@ -0,0 +1,59 @@
+
+#include "azure_trace.hh"
+#include "binary_trace.hh"
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+
+/// Convert an Azure blob access trace from CSV to the binary trace format
+/// once, the coordinator maps the converted trace instead of parsing the
+/// CSV, see `trace::BinaryTrace`.
+auto main(int argc, char *argv[]) -> int {
+  if (argc != 3) {
+    std::cerr << fmt::format("Usage: {} <trace.csv> <trace.bin>",
+                             argv[0]) // NOLINT
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  auto input = std::filesystem::path{argv[1]};  // NOLINT
+  auto output = std::filesystem::path{argv[2]}; // NOLINT
+  auto started = std::chrono::steady_clock::now();
+  try {
+    auto reader = trace::AzureTraceReader{input};
+    auto writer = trace::BinaryTraceWriter{output};
+    while (true) {
+      try {
+        writer.append(reader.next_trace());
+      } catch (trace::TraceException &e) {
+        if (e.error_enum() != trace::trace_error_e::Exhaust) {
+          throw;
+        }
+        break;
+      }
+    }
+    auto rows = writer.finish();
+    auto converted = trace::BinaryTrace{output};
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started);
+    std::cout << fmt::format(
+                     "[Info] {} records, {} blobs, converted in {} ms",
+                     rows,
+                     converted.first_access().size(),
+                     elapsed.count())
+              << std::endl;
+  } catch (std::exception &e) {
+    std::cerr << fmt::format("[Error] fail to convert {}: {}",
+                             input.string(),
+                             e.what())
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}